@@ -0,0 +1,376 @@
+/*
+ * batcher.c - Dynamic Request Batcher for Nodal
+ * Concurrent requests against one model are queued and, within a
+ * latency budget, executed together: each request's activations are a
+ * row of a stacked [B, ...] buffer, so every matmul runs once with
+ * M = B * M_tape and reads the shared weights once per batch instead
+ * of once per request. Ops that cannot be stacked run once per row,
+ * and attention and RoPE rows read each request's own KV sequence.
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "nodal.h"
+
+extern const nodal_tape_header_t *nodal_model_tape(const nodal_model_t *model);
+extern const nodal_tensor_t *nodal_model_tensors(const nodal_model_t *model, uint32_t *num_tensors);
+extern const nodal_buffer_t *nodal_model_bindings(const nodal_model_t *model);
+extern nodal_model_t *nodal_model_retain(nodal_model_t *model);
+extern void nodal_model_release(nodal_model_t *model);
+extern int nodal_bind_aux(const nodal_irop_t *ops, size_t op_count, const nodal_tensor_t *tensors,
+                          uint32_t num_tensors, nodal_buffer_t *tensor_runtime, uint32_t num_slots);
+extern int nodal_plan_build(const nodal_irop_t *ops, size_t op_count, const nodal_schedule_t *sched,
+                            const nodal_buffer_t *tensor_runtime, uint32_t num_tensors, nodal_plan_t *out);
+extern void nodal_plan_free(nodal_plan_t *plan);
+extern size_t nodal_op_output_bytes(const nodal_irop_t *op, uint32_t j);
+extern nodal_kernel_fn nodal_kernel_lookup(nodal_op_kind_t kind);
+extern size_t nodal_dtype_size(nodal_type_t t);
+extern uint32_t nodal_op_kv_input(const nodal_irop_t *op);
+
+/* One queued request; lives on the submitting thread's stack */
+typedef struct batch_req {
+    nodal_kv_seq_t *seq;           // Bound to the row's OP_ATTENTION / OP_ROPE calls
+    const void *input;
+    void *output;
+    size_t output_bytes;
+    uint64_t arrival_ns;
+    long result;
+    int done;
+    struct batch_req *next;
+} batch_req_t;
+
+struct nodal_batcher {
+    nodal_model_t *model;
+    const nodal_tape_header_t *th;
+    const nodal_irop_t *ops;
+    uint32_t max_batch;
+    uint64_t budget_ns;
+
+    nodal_buffer_t *shared;        // Weights and scales; NULL ptr = per-request activation
+    size_t *stride;                // Bytes of one request's copy of each activation slot
+    uint8_t **rows;                // Row 0 of each activation slot in the batch arena
+    void *arena;
+    size_t output_bytes;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;           // Work arrived / stop
+    pthread_cond_t done;           // Some request finished
+    batch_req_t *head, *tail;
+    uint32_t queued;
+    uint64_t oldest_ns;            // Arrival of the queue head
+    int stop;
+
+    nodal_batcher_stats_t stats;
+};
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static inline int is_act(const struct nodal_batcher *b, uint32_t t) {
+    return b->shared[t].ptr == NULL;
+}
+
+/* Activation operand t for row r (r = 0 with all rows when stacked) */
+static inline nodal_buffer_t act_buf(const struct nodal_batcher *b, uint32_t t, uint32_t r, uint32_t rows) {
+    return (nodal_buffer_t){ .ptr = b->rows[t] + (size_t)r * b->stride[t], .byte_len = (size_t)rows * b->stride[t] };
+}
+
+/**
+ * stackable
+ * True if the op can run once over all rows with its leading scalar
+ * (M, or size) multiplied by the row count. Matmuls stack when A, the
+ * optional addend and C are activations whose row strides match
+ * [M, K] / [M, N]; ADD, CAST and the activations stack when their
+ * inputs and output do, and EMBED_GATHER when its ids and output do and
+ * no per-row id count is bound.
+ * Everything else runs once per row.
+ */
+static int stackable(const struct nodal_batcher *b, const nodal_irop_t *op) {
+    const nodal_scalar_t *s = op->scalars;
+    switch (op->kind) {
+        case OP_MATMUL:
+        case OP_MATMUL_ADD:
+        case OP_MATMUL_QNF4:
+        case OP_MATMUL_QNF4_ADD:
+        case OP_MATMUL_Q8_0:
+        case OP_MATMUL_Q8_0_ADD: {
+            uint32_t addend = (op->kind == OP_MATMUL_ADD) ? 2
+                            : (op->kind == OP_MATMUL_QNF4_ADD || op->kind == OP_MATMUL_Q8_0_ADD) ? 3 : 0;
+            uint32_t a = op->inputs[0], c = op->outputs[0];
+            size_t mk = (size_t)s[0].v.u32 * s[2].v.u32 * sizeof(float);
+            size_t mn = (size_t)s[0].v.u32 * s[1].v.u32 * sizeof(float);
+            if (!is_act(b, a) || !is_act(b, c) || is_act(b, op->inputs[1])) return 0;
+            if (b->stride[a] != mk || b->stride[c] != mn) return 0;
+            if (addend && (!is_act(b, op->inputs[addend]) || b->stride[op->inputs[addend]] != mn)) return 0;
+            return 1;
+        }
+        case OP_ADD:
+        case OP_SILU:
+        case OP_GELU: {
+            size_t bytes = (size_t)s[0].v.u32 * sizeof(float);
+            for (uint32_t j = 0; j < op->num_inputs && j < 2; j++) {
+                if (!is_act(b, op->inputs[j]) || b->stride[op->inputs[j]] != bytes) return 0;
+            }
+            return is_act(b, op->outputs[0]) && b->stride[op->outputs[0]] == bytes;
+        }
+        case OP_CAST: {
+            size_t in = (size_t)s[0].v.u32 * nodal_dtype_size((nodal_type_t)s[1].v.u32);
+            size_t out = (size_t)s[0].v.u32 * nodal_dtype_size((nodal_type_t)s[2].v.u32);
+            return is_act(b, op->inputs[0]) && b->stride[op->inputs[0]] == in &&
+                   is_act(b, op->outputs[0]) && b->stride[op->outputs[0]] == out;
+        }
+        case OP_EMBED_GATHER: {
+            uint32_t ids = op->inputs[0], out = op->outputs[0];
+            if (op->num_inputs > 3 || !is_act(b, ids) || !is_act(b, out)) return 0;
+            return b->stride[ids] == (size_t)s[0].v.u32 * sizeof(uint32_t) &&
+                   b->stride[out] == (size_t)s[0].v.u32 * s[2].v.u32 * sizeof(float);
+        }
+        default:
+            return 0;
+    }
+}
+
+/* Executes the tape once for batch[0, rows); returns shared bytes read */
+static uint64_t run_batch(const struct nodal_batcher *b, batch_req_t *const *batch, uint32_t rows) {
+    uint64_t weight_bytes = 0;
+    for (uint32_t i = 0; i < b->th->num_ops; i++) {
+        const nodal_irop_t *op = &b->ops[i];
+        nodal_kernel_fn fn = nodal_kernel_lookup(op->kind);
+        int stacked = stackable(b, op);
+        uint32_t calls = stacked ? 1 : rows;
+        uint32_t kv = nodal_op_kv_input(op);
+
+        for (uint32_t r = 0; r < calls; r++) {
+            nodal_call_t call;
+            memset(&call, 0, sizeof(call));
+            for (uint32_t j = 0; j < op->num_inputs && j < 8; j++) {
+                uint32_t t = op->inputs[j];
+                call.inputs[j] = is_act(b, t) ? act_buf(b, t, r, stacked ? rows : 1) : b->shared[t];
+                if (!is_act(b, t)) weight_bytes += b->shared[t].byte_len;
+            }
+            for (uint32_t j = 0; j < op->num_outputs && j < 4; j++) {
+                call.outputs[j] = act_buf(b, op->outputs[j], r, stacked ? rows : 1);
+            }
+            if (kv) {
+                nodal_kv_seq_t *seq = batch[r]->seq;
+                call.inputs[kv] = (nodal_buffer_t){ .ptr = seq, .byte_len = seq ? sizeof(void *) : 0 };
+            }
+            memcpy(call.scalars, op->scalars, sizeof(call.scalars));
+            if (stacked) call.scalars[0].v.u32 *= rows;
+            fn(&call);
+        }
+    }
+    return weight_bytes;
+}
+
+static void *batcher_main(void *arg) {
+    struct nodal_batcher *b = (struct nodal_batcher *)arg;
+    const nodal_tape_header_t *th = b->th;
+    batch_req_t *batch[256];
+
+    pthread_mutex_lock(&b->lock);
+    for (;;) {
+        // 1. Wait for a full batch or for the oldest request's budget to expire
+        while (!b->stop && b->queued == 0) pthread_cond_wait(&b->wake, &b->lock);
+        while (!b->stop && b->queued < b->max_batch) {
+            uint64_t deadline = b->oldest_ns + b->budget_ns;
+            if (now_ns() >= deadline) break;
+            struct timespec ts = { (time_t)(deadline / 1000000000ull), (long)(deadline % 1000000000ull) };
+            pthread_cond_timedwait(&b->wake, &b->lock, &ts);
+        }
+        if (b->stop) break;
+
+        uint32_t rows = 0;
+        while (b->head && rows < b->max_batch) {
+            batch[rows++] = b->head;
+            b->head = b->head->next;
+        }
+        if (!b->head) b->tail = NULL;
+        b->queued -= rows;
+        if (b->head) b->oldest_ns = b->head->arrival_ns;
+        pthread_mutex_unlock(&b->lock);
+
+        // 2. Gather inputs, run once, scatter outputs
+        for (uint32_t r = 0; r < rows; r++) {
+            memcpy(b->rows[th->input_slot] + (size_t)r * th->input_bytes, batch[r]->input, th->input_bytes);
+        }
+        uint64_t weight_bytes = run_batch(b, batch, rows);
+        for (uint32_t r = 0; r < rows; r++) {
+            size_t n = batch[r]->output_bytes < b->output_bytes ? batch[r]->output_bytes : b->output_bytes;
+            if (batch[r]->output) memcpy(batch[r]->output, b->rows[th->output_slot] + (size_t)r * b->output_bytes, n);
+            batch[r]->result = (long)n;
+        }
+
+        pthread_mutex_lock(&b->lock);
+        for (uint32_t r = 0; r < rows; r++) batch[r]->done = 1;
+        b->stats.batches++;
+        b->stats.requests += rows;
+        b->stats.weight_bytes += weight_bytes;
+        if (rows > b->stats.max_rows) b->stats.max_rows = rows;
+        pthread_cond_broadcast(&b->done);
+    }
+
+    // Fail anything still queued at shutdown
+    for (batch_req_t *q = b->head; q; q = q->next) {
+        q->result = -1;
+        q->done = 1;
+    }
+    b->head = b->tail = NULL;
+    pthread_cond_broadcast(&b->done);
+    pthread_mutex_unlock(&b->lock);
+    return NULL;
+}
+
+/**
+ * nodal_batcher_create
+ * Sets up a batch arena for up to max_batch rows (at most 256) over a
+ * shared model and starts the batching thread. A request waits at most
+ * budget_us for others to join its batch. The batcher holds a model
+ * reference.
+ */
+nodal_batcher_t *nodal_batcher_create(nodal_model_t *model, uint32_t max_batch, uint32_t budget_us) {
+    const nodal_tape_header_t *th = nodal_model_tape(model);
+    if (!th || th->input_slot >= th->num_slots || th->output_slot >= th->num_slots) {
+        fprintf(stderr, "[BATCH] Model tape needs an input and an output slot\n");
+        return NULL;
+    }
+    struct nodal_batcher *b = (struct nodal_batcher *)calloc(1, sizeof(*b));
+    if (!b) return NULL;
+    b->th = th;
+    b->ops = (const nodal_irop_t *)(th + 1);     // Unfused: a matmul stacks, its fused bias add would not
+    b->max_batch = max_batch == 0 ? 1 : (max_batch > 256 ? 256 : max_batch);
+    b->budget_ns = (uint64_t)budget_us * 1000;
+    b->shared = (nodal_buffer_t *)calloc(th->num_slots, sizeof(nodal_buffer_t));
+    b->stride = (size_t *)calloc(th->num_slots, sizeof(size_t));
+    b->rows = (uint8_t **)calloc(th->num_slots, sizeof(uint8_t *));
+    nodal_plan_t plan = {0};
+    if (!b->shared || !b->stride || !b->rows) goto fail;
+
+    // 1. Shared operands: mapped weights and their scales
+    uint32_t num_tensors;
+    const nodal_tensor_t *tensors = nodal_model_tensors(model, &num_tensors);
+    uint32_t shared = num_tensors < th->num_slots ? num_tensors : th->num_slots;
+    memcpy(b->shared, nodal_model_bindings(model), shared * sizeof(nodal_buffer_t));
+    if (nodal_bind_aux(b->ops, th->num_ops, tensors, num_tensors, b->shared, th->num_slots) < 0) goto fail;
+
+    // 2. Exact per-request size of every activation
+    b->stride[th->input_slot] = th->input_bytes;
+    for (uint32_t i = 0; i < th->num_ops; i++) {
+        for (uint32_t j = 0; j < b->ops[i].num_outputs && j < 4; j++) {
+            uint32_t t = b->ops[i].outputs[j];
+            if (t >= th->num_slots) goto fail;
+            size_t bytes = nodal_op_output_bytes(&b->ops[i], j);
+            if (bytes > b->stride[t]) b->stride[t] = bytes;
+        }
+    }
+    b->output_bytes = b->stride[th->output_slot];
+
+    // 3. Batch arena: the single-request plan with every offset and size
+    // scaled by max_batch, so lifetimes that never overlap still share bytes
+    if (nodal_plan_build(b->ops, th->num_ops, NULL, b->shared, th->num_slots, &plan) != 0) goto fail;
+    size_t input_bytes = ((size_t)th->input_bytes * b->max_batch + 63) & ~(size_t)63;
+    b->arena = aligned_alloc(64, plan.arena_bytes * b->max_batch + input_bytes + 64);
+    if (!b->arena) goto fail;
+    for (uint32_t e = 0; e < plan.num_entries; e++) {
+        b->rows[plan.entries[e].tensor] = (uint8_t *)b->arena + plan.entries[e].offset * b->max_batch;
+    }
+    if (!b->rows[th->input_slot]) b->rows[th->input_slot] = (uint8_t *)b->arena + plan.arena_bytes * b->max_batch;
+    nodal_plan_free(&plan);
+    for (uint32_t t = 0; t < th->num_slots; t++) {
+        if (is_act(b, t) && !b->rows[t] && b->stride[t]) {
+            fprintf(stderr, "[BATCH] Slot %u is read but never written or bound\n", t);
+            goto fail;
+        }
+    }
+
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC); // Budget deadlines come from now_ns()
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->wake, &attr);
+    pthread_cond_init(&b->done, NULL);
+    pthread_condattr_destroy(&attr);
+    if (pthread_create(&b->thread, NULL, batcher_main, b) != 0) {
+        pthread_mutex_destroy(&b->lock);
+        pthread_cond_destroy(&b->wake);
+        pthread_cond_destroy(&b->done);
+        goto fail;
+    }
+    b->model = nodal_model_retain(model);
+    return b;
+
+fail:
+    nodal_plan_free(&plan);
+    free(b->arena);
+    free(b->shared);
+    free(b->stride);
+    free(b->rows);
+    free(b);
+    return NULL;
+}
+
+/**
+ * nodal_batcher_submit
+ * Queues one request and blocks until its batch has run. Thread-safe;
+ * input must hold the tape's input_bytes. The tape's OP_ATTENTION and
+ * OP_ROPE ops read and append to seq for this request's row (NULL if
+ * the tape has none); a sequence takes one request at a time.
+ * @return Bytes written to output, or -1 if the batcher shut down.
+ */
+long nodal_batcher_submit(nodal_batcher_t *b, nodal_kv_seq_t *seq, const void *input, void *output,
+                          size_t output_bytes) {
+    batch_req_t req = { seq, input, output, output_bytes, now_ns(), -1, 0, NULL };
+
+    pthread_mutex_lock(&b->lock);
+    if (b->stop) {
+        pthread_mutex_unlock(&b->lock);
+        return -1;
+    }
+    if (b->tail) b->tail->next = &req;
+    else {
+        b->head = &req;
+        b->oldest_ns = req.arrival_ns;
+    }
+    b->tail = &req;
+    b->queued++;
+    if (b->queued == 1 || b->queued >= b->max_batch) pthread_cond_signal(&b->wake);
+    while (!req.done) pthread_cond_wait(&b->done, &b->lock);
+    pthread_mutex_unlock(&b->lock);
+    return req.result;
+}
+
+/* Exact size of one request's output tensor */
+size_t nodal_batcher_output_bytes(const nodal_batcher_t *b) {
+    return b->output_bytes;
+}
+
+void nodal_batcher_stats(nodal_batcher_t *b, nodal_batcher_stats_t *out) {
+    pthread_mutex_lock(&b->lock);
+    *out = b->stats;
+    pthread_mutex_unlock(&b->lock);
+}
+
+void nodal_batcher_destroy(nodal_batcher_t *b) {
+    if (!b) return;
+    pthread_mutex_lock(&b->lock);
+    b->stop = 1;
+    pthread_cond_signal(&b->wake);
+    pthread_mutex_unlock(&b->lock);
+    pthread_join(b->thread, NULL);
+    pthread_mutex_destroy(&b->lock);
+    pthread_cond_destroy(&b->wake);
+    pthread_cond_destroy(&b->done);
+    nodal_model_release(b->model);
+    free(b->arena);
+    free(b->shared);
+    free(b->stride);
+    free(b->rows);
+    free(b);
+}
@@ -0,0 +1,949 @@
+/*
+ * bench.c - Nodal Kernel and Loader Benchmarks (make bench)
+ * Times every kernel through its nodal_call_t entry point, the same way
+ * the executor calls it, after warm-up. Reports median / p99 latency and
+ * achieved GFLOP/s and GB/s against peaks measured on this machine, and
+ * writes one JSON line per case so runs can be diffed or compared with
+ * --baseline to catch regressions. A bandwidth share above 100% means
+ * the working set stayed in cache between repetitions.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "nodal.h"
+
+extern void nodal_kernel_matmul_f32(const nodal_call_t *call);
+extern void nodal_kernel_matmul_qnf4(const nodal_call_t *call);
+extern void nodal_narrow(const float *src, nodal_type_t t, uint16_t *dst, size_t n);
+extern size_t nodal_nf4_tiled_bytes(uint32_t N, uint32_t K, uint32_t block_size);
+extern void nodal_nf4_tile(const uint8_t *W, const float *scales, uint32_t N, uint32_t K, uint32_t block_size,
+                           uint8_t *out);
+extern void nodal_kernel_matmul_q8_0(const nodal_call_t *call);
+extern void nodal_kernel_softmax_f32(const nodal_call_t *call);
+extern void nodal_kernel_rmsnorm_f32(const nodal_call_t *call);
+extern void nodal_kernel_silu_f32(const nodal_call_t *call);
+extern void nodal_kernel_rope_f32(const nodal_call_t *call);
+extern void nodal_kernel_embed_gather(const nodal_call_t *call);
+extern void nodal_kernel_sample(const nodal_call_t *call);
+extern size_t nodal_sample_scratch_bytes(uint32_t vocab, uint32_t rows);
+extern void nodal_kernel_add_f32(const nodal_call_t *call);
+extern void nodal_kernel_tokenize_bpe_parallel(const nodal_call_t *call);
+extern nodal_tokcache_t *nodal_tokcache_create(size_t max_bytes, nodal_evict_policy_t policy);
+extern void nodal_tokcache_destroy(nodal_tokcache_t *cache);
+extern nodal_model_t *nodal_model_open(const char *path, const nodal_load_opts_t *opts);
+extern void nodal_model_release(nodal_model_t *model);
+extern int nodal_set_num_threads(uint32_t num_threads, int pin);
+extern uint32_t nodal_get_num_threads(void);
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+#define BENCH_MAX_RESULTS  64
+#define BENCH_MAX_SAMPLES  10000
+#define BENCH_MIN_REPS     5
+#define BENCH_WARMUP_MS    20.0
+
+typedef void (*bench_fn)(void *ctx);
+
+typedef struct {
+    char name[64];
+    uint32_t reps;
+    double median_us;
+    double p99_us;
+    double min_us;
+    double gflops;                 // At the median; 0 when FLOPs are not meaningful
+    double gbps;
+    int roofline;                  // Compare against the machine peaks
+} bench_result_t;
+
+typedef struct {
+    double min_time_ms;            // Timed budget per case
+    const char *filter;            // Substring a case name must contain
+    int quick;                     // Skip the largest shapes
+    double peak_gflops;
+    double peak_gbps;
+    bench_result_t results[BENCH_MAX_RESULTS];
+    uint32_t num_results;
+} bench_ctx_t;
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static int cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static void fill_uniform(float *x, size_t n, uint32_t seed) {
+    for (size_t i = 0; i < n; i++) {
+        seed = seed * 1103515245u + 12345u;
+        x[i] = (float)((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+    }
+}
+
+/**
+ * bench_run
+ * Warms fn up, then times it until min_time_ms has elapsed (at least
+ * BENCH_MIN_REPS calls). prep, if set, runs untimed before every call.
+ * flops and bytes are per call and turn the median into GFLOP/s and GB/s;
+ * roofline marks cases worth comparing with the machine peaks.
+ * @return The recorded result, or NULL if filtered out.
+ */
+static bench_result_t *bench_run(bench_ctx_t *bc, const char *name, bench_fn prep, bench_fn fn, void *ctx,
+                                 double flops, double bytes, int roofline) {
+    if (bc->filter && !strstr(name, bc->filter)) return NULL;
+    if (bc->num_results == BENCH_MAX_RESULTS) return NULL;
+    static double samples[BENCH_MAX_SAMPLES];
+
+    // 1. Warm-up: caches, page faults, pool wake-up, branch predictors
+    double start = now_us();
+    for (int i = 0; i < 2 || now_us() - start < BENCH_WARMUP_MS * 1000.0; i++) {
+        if (prep) prep(ctx);
+        fn(ctx);
+        if (i > 1000) break;
+    }
+
+    // 2. Timed repetitions
+    uint32_t reps = 0;
+    double spent = 0.0;
+    while (reps < BENCH_MAX_SAMPLES && (reps < BENCH_MIN_REPS || spent < bc->min_time_ms * 1000.0)) {
+        if (prep) prep(ctx);
+        double t0 = now_us();
+        fn(ctx);
+        samples[reps] = now_us() - t0;
+        spent += samples[reps++];
+    }
+    qsort(samples, reps, sizeof(double), cmp_double);
+
+    bench_result_t *r = &bc->results[bc->num_results++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->reps = reps;
+    r->median_us = samples[reps / 2];
+    r->p99_us = samples[(uint32_t)ceil(0.99 * reps) - 1];
+    r->min_us = samples[0];
+    r->gflops = flops > 0 ? flops / (r->median_us * 1e3) : 0.0;
+    r->gbps = bytes > 0 ? bytes / (r->median_us * 1e3) : 0.0;
+    r->roofline = roofline;
+    return r;
+}
+
+/* One table row; the peak columns only for kernels bound by compute or DRAM */
+static void print_result(const bench_ctx_t *bc, const bench_result_t *r) {
+    if (!r) return;
+    char gf[16] = "-", gfp[16] = "", bw[16] = "-", bwp[16] = "";
+    if (r->gflops > 0) {
+        snprintf(gf, sizeof(gf), "%.1f", r->gflops);
+        if (r->roofline) snprintf(gfp, sizeof(gfp), "%3.0f%%", 100.0 * r->gflops / bc->peak_gflops);
+    }
+    if (r->gbps > 0) {
+        snprintf(bw, sizeof(bw), "%.2f", r->gbps);
+        if (r->roofline) snprintf(bwp, sizeof(bwp), "%3.0f%%", 100.0 * r->gbps / bc->peak_gbps);
+    }
+    printf("[BENCH] %-40s %10.1f %10.1f %6u %9s %5s %9s %5s\n", r->name, r->median_us, r->p99_us, r->reps, gf, gfp,
+           bw, bwp);
+    fflush(stdout);
+}
+
+/* --- Machine Peaks --- */
+
+#define PEAK_ITERS (1u << 22)
+
+typedef struct {
+    double seconds[256];
+    float sink[256];
+    const uint64_t *buf;
+    size_t words;
+    uint32_t tasks;
+    uint64_t sums[256];
+} peak_job_t;
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* 12 independent FMA chains hide the FMA latency on every core we target */
+__attribute__((target("avx512f")))
+static float fma_loop_avx512(uint32_t iters) {
+    __m512 acc[12], x = _mm512_set1_ps(0.999f), y = _mm512_set1_ps(1e-6f);
+    for (int i = 0; i < 12; i++) acc[i] = _mm512_set1_ps((float)i);
+    for (uint32_t it = 0; it < iters; it++) {
+        for (int i = 0; i < 12; i++) acc[i] = _mm512_fmadd_ps(acc[i], x, y);
+    }
+    for (int i = 1; i < 12; i++) acc[0] = _mm512_add_ps(acc[0], acc[i]);
+    return _mm512_reduce_add_ps(acc[0]);
+}
+
+__attribute__((target("avx2,fma")))
+static float fma_loop_avx2(uint32_t iters) {
+    __m256 acc[12], x = _mm256_set1_ps(0.999f), y = _mm256_set1_ps(1e-6f);
+    for (int i = 0; i < 12; i++) acc[i] = _mm256_set1_ps((float)i);
+    for (uint32_t it = 0; it < iters; it++) {
+        for (int i = 0; i < 12; i++) acc[i] = _mm256_fmadd_ps(acc[i], x, y);
+    }
+    for (int i = 1; i < 12; i++) acc[0] = _mm256_add_ps(acc[0], acc[i]);
+    float out[8];
+    _mm256_storeu_ps(out, acc[0]);
+    return out[0] + out[7];
+}
+#endif
+
+static float fma_loop_scalar(uint32_t iters) {
+    float acc[8];
+    for (int i = 0; i < 8; i++) acc[i] = (float)i;
+    for (uint32_t it = 0; it < iters; it++) {
+        for (int i = 0; i < 8; i++) acc[i] = acc[i] * 0.999f + 1e-6f;
+    }
+    return acc[0] + acc[7];
+}
+
+/* FLOPs per fma_loop iteration for the dispatched ISA */
+static double fma_flops_per_iter(void) {
+    switch (nodal_cpu_isa()) {
+        case NODAL_ISA_AVX512: return 12 * 16 * 2;
+        case NODAL_ISA_AVX2: return 12 * 8 * 2;
+        default: return 8 * 2;
+    }
+}
+
+static void peak_fma_task(void *ctx, uint32_t task) {
+    peak_job_t *job = (peak_job_t *)ctx;
+    double t0 = now_us();
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) job->sink[task] = fma_loop_avx512(PEAK_ITERS);
+    else if (isa == NODAL_ISA_AVX2) job->sink[task] = fma_loop_avx2(PEAK_ITERS);
+    else job->sink[task] = fma_loop_scalar(PEAK_ITERS);
+#else
+    job->sink[task] = fma_loop_scalar(PEAK_ITERS);
+#endif
+    job->seconds[task] = (now_us() - t0) / 1e6;
+}
+
+static uint64_t read_sum_scalar(const uint64_t *p, size_t n) {
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += p[i];
+    return s;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* Same loop; wide loads keep enough misses in flight to reach DRAM peak */
+__attribute__((target("avx2")))
+static uint64_t read_sum_avx2(const uint64_t *p, size_t n) {
+    uint64_t s = 0;
+    for (size_t i = 0; i < n; i++) s += p[i];
+    return s;
+}
+#endif
+
+static void peak_read_task(void *ctx, uint32_t task) {
+    peak_job_t *job = (peak_job_t *)ctx;
+    size_t chunk = job->words / job->tasks;
+    const uint64_t *p = job->buf + task * chunk;
+#if defined(__x86_64__) || defined(__i386__)
+    if (nodal_cpu_isa() != NODAL_ISA_GENERIC) {
+        job->sums[task] = read_sum_avx2(p, chunk);
+        return;
+    }
+#endif
+    job->sums[task] = read_sum_scalar(p, chunk);
+}
+
+/**
+ * measure_peaks
+ * Compute peak: every pool thread runs independent FMA chains at the
+ * dispatched vector width. Bandwidth peak: a parallel read of a buffer
+ * far larger than the last-level cache. Best of three runs each.
+ */
+static void measure_peaks(bench_ctx_t *bc) {
+    static peak_job_t job;
+    uint32_t threads = nodal_get_num_threads();
+    job.tasks = threads < 256 ? threads : 256;
+
+    bc->peak_gflops = 0.0;
+    for (int rep = 0; rep < 3; rep++) {
+        nodal_pool_run(nodal_pool_default(), peak_fma_task, &job, job.tasks);
+        double slowest = 0.0;
+        for (uint32_t t = 0; t < job.tasks; t++) slowest = job.seconds[t] > slowest ? job.seconds[t] : slowest;
+        double gflops = job.tasks * fma_flops_per_iter() * PEAK_ITERS / (slowest * 1e9);
+        bc->peak_gflops = gflops > bc->peak_gflops ? gflops : bc->peak_gflops;
+    }
+
+    const size_t bytes = (size_t)256 << 20;
+    uint64_t *buf = (uint64_t *)aligned_alloc(64, bytes);
+    if (!buf) {
+        bc->peak_gbps = 1.0;
+        return;
+    }
+    memset(buf, 1, bytes);
+    job.buf = buf;
+    job.words = bytes / sizeof(uint64_t);
+    double best = 1e30;
+    for (int rep = 0; rep < 3; rep++) {
+        double t0 = now_us();
+        nodal_pool_run(nodal_pool_default(), peak_read_task, &job, job.tasks);
+        double dt = now_us() - t0;
+        best = dt < best ? dt : best;
+    }
+    bc->peak_gbps = bytes / (best * 1e3);
+    free(buf);
+}
+
+/* --- Kernel Cases --- */
+
+typedef struct {
+    nodal_kernel_fn fn;
+    nodal_call_t call;
+} kernel_case_t;
+
+static void run_kernel(void *ctx) {
+    kernel_case_t *kc = (kernel_case_t *)ctx;
+    kc->fn(&kc->call);
+}
+
+/* C = A * B with B stored as bt (F32, F16 or BF16) */
+static void bench_matmul(bench_ctx_t *bc, const char *label, uint32_t M, uint32_t N, uint32_t K, nodal_type_t bt) {
+    const char *type = (bt == NODAL_F16) ? "f16" : (bt == NODAL_BF16) ? "bf16" : "f32";
+    const size_t bsz = (bt == NODAL_F32) ? 4 : 2;
+    char name[64];
+    snprintf(name, sizeof(name), "matmul_%s/%s/%ux%ux%u", type, label, M, N, K);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    float *A = (float *)aligned_alloc(64, (size_t)M * K * sizeof(float));
+    float *B = (float *)aligned_alloc(64, (size_t)K * N * sizeof(float));
+    float *C = (float *)aligned_alloc(64, (size_t)M * N * sizeof(float));
+    if (A && B && C) {
+        fill_uniform(A, (size_t)M * K, 1);
+        fill_uniform(B, (size_t)K * N, 2);
+        if (bt != NODAL_F32) nodal_narrow(B, bt, (uint16_t *)B, (size_t)K * N); // In place: reads stay ahead
+        kernel_case_t kc = { nodal_kernel_matmul_f32, { .inputs = { { A, (size_t)M * K * 4 }, { B, (size_t)K * N * bsz } },
+                                                        .outputs = { { C, (size_t)M * N * 4 } } } };
+        const uint32_t sc[4] = { M, N, K, bt };
+        for (int j = 0; j < 4; j++) kc.call.scalars[j] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = sc[j] };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 2.0 * M * N * K,
+                                   4.0 * ((double)M * K + (double)M * N) + (double)bsz * K * N, 1));
+    }
+    free(A);
+    free(B);
+    free(C);
+}
+
+/* Row-major NF4, or the same weights in NODAL_LAYOUT_NF4_TILED */
+static void bench_qnf4(bench_ctx_t *bc, uint32_t M, uint32_t N, uint32_t K, int tiled) {
+    const uint32_t bs = 64;
+    char name[64];
+    snprintf(name, sizeof(name), "matmul_qnf4%s/%ux%ux%u", tiled ? "_tiled" : "", M, N, K);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t nw = (size_t)N * K;
+    float *A = (float *)aligned_alloc(64, (size_t)M * K * sizeof(float));
+    uint8_t *W = (uint8_t *)aligned_alloc(64, nw / 2);
+    float *scales = (float *)aligned_alloc(64, nw / bs * sizeof(float));
+    float *C = (float *)aligned_alloc(64, (size_t)M * N * sizeof(float));
+    if (A && W && scales && C) {
+        fill_uniform(A, (size_t)M * K, 3);
+        for (size_t i = 0; i < nw / 2; i++) W[i] = (uint8_t)(i * 2654435761u >> 13);
+        for (size_t i = 0; i < nw / bs; i++) scales[i] = 0.01f + (float)(i % 7) * 0.003f;
+        kernel_case_t kc = { nodal_kernel_matmul_qnf4,
+                             { .inputs = { { A, (size_t)M * K * 4 }, { W, nw / 2 }, { scales, nw / bs * 4 } },
+                               .outputs = { { C, (size_t)M * N * 4 } } } };
+        const uint32_t sc[5] = { M, N, K, bs, tiled ? NODAL_LAYOUT_NF4_TILED : NODAL_LAYOUT_ROW_MAJOR };
+        for (int j = 0; j < 5; j++) kc.call.scalars[j] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = sc[j] };
+        uint8_t *T = tiled ? (uint8_t *)aligned_alloc(64, (nodal_nf4_tiled_bytes(N, K, bs) + 63) & ~(size_t)63) : NULL;
+        if (T) {
+            nodal_nf4_tile(W, scales, N, K, bs, T);
+            kc.call.inputs[1] = kc.call.inputs[2] = (nodal_buffer_t){ T, nodal_nf4_tiled_bytes(N, K, bs) };
+        }
+        double bytes = 4.0 * M * K + nw / 2.0 + 4.0 * nw / bs + 4.0 * M * N;
+        if (!tiled || T) print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 2.0 * M * N * K, bytes, 1));
+        free(T);
+    }
+    free(A);
+    free(W);
+    free(scales);
+    free(C);
+}
+
+static void bench_q8_0(bench_ctx_t *bc, uint32_t M, uint32_t N, uint32_t K) {
+    const uint32_t bs = 32;
+    char name[64];
+    snprintf(name, sizeof(name), "matmul_q8_0/%ux%ux%u", M, N, K);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t nw = (size_t)N * K;
+    float *A = (float *)aligned_alloc(64, (size_t)M * K * sizeof(float));
+    int8_t *W = (int8_t *)aligned_alloc(64, nw);
+    float *scales = (float *)aligned_alloc(64, nw / bs * sizeof(float));
+    float *C = (float *)aligned_alloc(64, (size_t)M * N * sizeof(float));
+    if (A && W && scales && C) {
+        fill_uniform(A, (size_t)M * K, 3);
+        for (size_t i = 0; i < nw; i++) W[i] = (int8_t)((int)((i * 2654435761u >> 13) % 255) - 127);
+        for (size_t i = 0; i < nw / bs; i++) scales[i] = (0.01f + (float)(i % 7) * 0.003f) / 127.0f;
+        kernel_case_t kc = { nodal_kernel_matmul_q8_0,
+                             { .inputs = { { A, (size_t)M * K * 4 }, { W, nw }, { scales, nw / bs * 4 } },
+                               .outputs = { { C, (size_t)M * N * 4 } } } };
+        const uint32_t sc[4] = { M, N, K, bs };
+        for (int j = 0; j < 4; j++) kc.call.scalars[j] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = sc[j] };
+        double bytes = 4.0 * M * K + nw + 4.0 * nw / bs + 4.0 * M * N;
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 2.0 * M * N * K, bytes, 1));
+    }
+    free(A);
+    free(W);
+    free(scales);
+    free(C);
+}
+
+static void bench_softmax(bench_ctx_t *bc, const char *label, uint32_t rows, uint32_t n, uint32_t flags) {
+    char name[64];
+    snprintf(name, sizeof(name), "softmax/%s/%ux%u", label, rows, n);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t total = (size_t)rows * n;
+    float *in = (float *)aligned_alloc(64, ((total * 4 + 63) & ~(size_t)63));
+    float *out = (float *)aligned_alloc(64, ((total * 4 + 63) & ~(size_t)63));
+    if (in && out) {
+        fill_uniform(in, total, 4);
+        for (size_t i = 0; i < total; i++) in[i] *= 8.0f;
+        kernel_case_t kc = { nodal_kernel_softmax_f32, { .inputs = { { in, total * 4 } }, .outputs = { { out, total * 4 } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = n };
+        kc.call.scalars[1] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = rows };
+        kc.call.scalars[3] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = flags };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 0.0, 8.0 * total, 1));
+    }
+    free(in);
+    free(out);
+}
+
+/* One draw from LM-shaped logits: a bell-shaped bulk around 0 and a few dozen leaders */
+static void bench_sample(bench_ctx_t *bc, const char *label, uint32_t vocab, float temp, uint32_t top_k, float top_p) {
+    char name[64];
+    snprintf(name, sizeof(name), "sample/%s/%u", label, vocab);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    float *logits = (float *)aligned_alloc(64, ((size_t)vocab * 4 + 63) & ~(size_t)63);
+    float *noise = (float *)malloc((size_t)vocab * 3 * sizeof(float));
+    size_t scratch_len = nodal_sample_scratch_bytes(vocab, 1);
+    void *scratch = malloc(scratch_len);
+    uint32_t hist[64], id = 0;
+    uint64_t state = 0;
+    if (logits && noise && scratch) {
+        fill_uniform(noise, (size_t)vocab * 3, 8);
+        for (uint32_t i = 0; i < vocab; i++) logits[i] = 2.0f * (noise[3 * i] + noise[3 * i + 1] + noise[3 * i + 2]);
+        for (uint32_t i = 0; i < 64; i++) logits[(i * 2654435761u) % vocab] = 8.0f + 0.125f * (float)i;
+        for (uint32_t i = 0; i < 64; i++) hist[i] = (i * 40503u) % vocab;
+        kernel_case_t kc = { nodal_kernel_sample, { .inputs = { { logits, (size_t)vocab * 4 }, { hist, sizeof(hist) },
+                                                                { NULL, 0 }, { &state, sizeof(state) } },
+                                                    .outputs = { { &id, sizeof(id) }, { scratch, scratch_len } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = vocab };
+        kc.call.scalars[2] = (nodal_scalar_t){ .kind = NODAL_F32, .v.f32 = temp };
+        kc.call.scalars[3] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = top_k };
+        kc.call.scalars[4] = (nodal_scalar_t){ .kind = NODAL_F32, .v.f32 = top_p };
+        kc.call.scalars[5] = (nodal_scalar_t){ .kind = NODAL_F32, .v.f32 = 1.1f };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 0.0, 4.0 * vocab, 1));
+    }
+    free(logits);
+    free(noise);
+    free(scratch);
+}
+
+static void bench_add(bench_ctx_t *bc, uint32_t n) {
+    char name[64];
+    snprintf(name, sizeof(name), "add/%u", n);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    float *a = (float *)aligned_alloc(64, (size_t)n * 4);
+    float *b = (float *)aligned_alloc(64, (size_t)n * 4);
+    float *c = (float *)aligned_alloc(64, (size_t)n * 4);
+    if (a && b && c) {
+        fill_uniform(a, n, 5);
+        fill_uniform(b, n, 6);
+        kernel_case_t kc = { nodal_kernel_add_f32, { .inputs = { { a, (size_t)n * 4 }, { b, (size_t)n * 4 } },
+                                                     .outputs = { { c, (size_t)n * 4 } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = n };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, (double)n, 12.0 * n, 1));
+    }
+    free(a);
+    free(b);
+    free(c);
+}
+
+static void bench_rmsnorm(bench_ctx_t *bc, uint32_t rows, uint32_t n) {
+    char name[64];
+    snprintf(name, sizeof(name), "rmsnorm/%ux%u", rows, n);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t total = (size_t)rows * n;
+    float *x = (float *)aligned_alloc(64, ((total * 4 + 63) & ~(size_t)63));
+    float *out = (float *)aligned_alloc(64, ((total * 4 + 63) & ~(size_t)63));
+    float *g = (float *)aligned_alloc(64, ((size_t)n * 4 + 63) & ~(size_t)63);
+    if (x && out && g) {
+        fill_uniform(x, total, 7);
+        fill_uniform(g, n, 8);
+        kernel_case_t kc = { nodal_kernel_rmsnorm_f32, { .inputs = { { x, total * 4 }, { g, (size_t)n * 4 } },
+                                                         .outputs = { { out, total * 4 } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = n };
+        kc.call.scalars[1] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = rows };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 5.0 * total, 8.0 * total + 4.0 * n, 1));
+    }
+    free(x);
+    free(out);
+    free(g);
+}
+
+/* silu(gate) * up */
+static void bench_swiglu(bench_ctx_t *bc, uint32_t n) {
+    char name[64];
+    snprintf(name, sizeof(name), "swiglu/%u", n);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    float *a = (float *)aligned_alloc(64, (size_t)n * 4);
+    float *b = (float *)aligned_alloc(64, (size_t)n * 4);
+    float *c = (float *)aligned_alloc(64, (size_t)n * 4);
+    if (a && b && c) {
+        fill_uniform(a, n, 9);
+        fill_uniform(b, n, 10);
+        kernel_case_t kc = { nodal_kernel_silu_f32, { .inputs = { { a, (size_t)n * 4 }, { b, (size_t)n * 4 } },
+                                                      .outputs = { { c, (size_t)n * 4 } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = n };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 5.0 * n, 12.0 * n, 1));
+    }
+    free(a);
+    free(b);
+    free(c);
+}
+
+static void bench_rope(bench_ctx_t *bc, uint32_t n, uint32_t heads, uint32_t head_dim) {
+    char name[64];
+    snprintf(name, sizeof(name), "rope/%ux%ux%u", n, heads, head_dim);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t total = (size_t)n * heads * head_dim;
+    float *x = (float *)aligned_alloc(64, ((total * 4 + 63) & ~(size_t)63));
+    if (x) {
+        fill_uniform(x, total, 11);
+        kernel_case_t kc = { nodal_kernel_rope_f32, { .inputs = { { x, total * 4 } }, .outputs = { { x, total * 4 } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = n };
+        kc.call.scalars[1] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = heads };
+        kc.call.scalars[2] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = head_dim };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 3.0 * total, 8.0 * total, 1));
+    }
+    free(x);
+}
+
+/* n prompt tokens gathered from an NF4 [vocab, dim] table */
+static void bench_embed_nf4(bench_ctx_t *bc, uint32_t n, uint32_t vocab, uint32_t dim) {
+    const uint32_t bs = 64;
+    char name[64];
+    snprintf(name, sizeof(name), "embed_nf4/%ux%ux%u", n, vocab, dim);
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    size_t nw = (size_t)vocab * dim;
+    uint8_t *W = (uint8_t *)aligned_alloc(64, nw / 2);
+    float *scales = (float *)aligned_alloc(64, nw / bs * sizeof(float));
+    uint32_t *ids = (uint32_t *)malloc((size_t)n * sizeof(uint32_t));
+    float *out = (float *)aligned_alloc(64, (size_t)n * dim * sizeof(float));
+    if (W && scales && ids && out) {
+        for (size_t i = 0; i < nw / 2; i++) W[i] = (uint8_t)(i * 2654435761u >> 13);
+        for (size_t i = 0; i < nw / bs; i++) scales[i] = 0.01f + (float)(i % 7) * 0.003f;
+        for (uint32_t t = 0; t < n; t++) ids[t] = (t * 2654435761u) % vocab;
+        kernel_case_t kc = { nodal_kernel_embed_gather,
+                             { .inputs = { { ids, (size_t)n * 4 }, { W, nw / 2 }, { scales, nw / bs * 4 } },
+                               .outputs = { { out, (size_t)n * dim * 4 } } } };
+        const uint32_t sc[6] = { n, vocab, dim, bs, NODAL_LAYOUT_ROW_MAJOR, NODAL_NF4 };
+        for (int j = 0; j < 6; j++) kc.call.scalars[j] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = sc[j] };
+        double bytes = (double)n * (4.0 + dim / 2.0 + 4.0 * dim / bs + 4.0 * dim);
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, (double)n * dim, bytes, 1));
+    }
+    free(W);
+    free(scales);
+    free(ids);
+    free(out);
+}
+
+/* --- Tokenizer --- */
+
+/* Appends code point cp to out as UTF-8; returns the byte count */
+static int utf8_put(uint32_t cp, char *out) {
+    if (cp < 0x80) { out[0] = (char)cp; return 1; }
+    if (cp < 0x800) { out[0] = (char)(0xC0 | (cp >> 6)); out[1] = (char)(0x80 | (cp & 0x3F)); return 2; }
+    out[0] = (char)(0xE0 | (cp >> 12));
+    out[1] = (char)(0x80 | ((cp >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (cp & 0x3F));
+    return 3;
+}
+
+/* Code point of s if it is exactly one UTF-8 character, else 0 */
+static uint32_t single_codepoint(const char *s, size_t len) {
+    const uint8_t *u = (const uint8_t *)s;
+    if (len == 1) return u[0];
+    if (len == 2 && (u[0] & 0xE0) == 0xC0) return ((u[0] & 0x1Fu) << 6) | (u[1] & 0x3F);
+    if (len == 3 && (u[0] & 0xF0) == 0xE0) return ((u[0] & 0x0Fu) << 12) | ((u[1] & 0x3Fu) << 6) | (u[2] & 0x3F);
+    if (len == 4 && (u[0] & 0xF8) == 0xF0) {
+        return ((u[0] & 0x07u) << 18) | ((u[1] & 0x3Fu) << 12) | ((u[2] & 0x3Fu) << 6) | (u[3] & 0x3F);
+    }
+    return 0;
+}
+
+static int cmp_rule(const void *a, const void *b) {
+    const bpe_rule_t *x = (const bpe_rule_t *)a, *y = (const bpe_rule_t *)b;
+    if (x->p1 != y->p1) return x->p1 < y->p1 ? -1 : 1;
+    if (x->p2 != y->p2) return x->p2 < y->p2 ? -1 : 1;
+    return (x->rank > y->rank) - (x->rank < y->rank);
+}
+
+/**
+ * load_merges
+ * Builds the merge table from a tokenizer.json the way tools/nc.py
+ * does (single-character parts by code point, others as 0, lowest rank
+ * per pair, sorted by pair). Returns the rule count, or -1.
+ */
+static int load_merges(const char *json, bpe_rule_t **out) {
+    const char *p = strstr(json, "\"merges\"");
+    if (!p || !(p = strchr(p, '['))) return -1;
+    p++;
+
+    size_t cap = 1024, count = 0;
+    bpe_rule_t *rules = (bpe_rule_t *)malloc(cap * sizeof(bpe_rule_t));
+    char merge[256];
+    for (uint32_t rank = 0; rules; rank++) {
+        while (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t' || *p == ',') p++;
+        if (*p != '"') break;
+        size_t len = 0;
+        for (p++; *p && *p != '"'; p++) {
+            char ch = *p;
+            if (ch == '\\' && p[1]) {
+                p++;
+                if (*p == 'u') {
+                    uint32_t cp = (uint32_t)strtoul((char[5]){ p[1], p[2], p[3], p[4], 0 }, NULL, 16);
+                    p += 4;
+                    if (len + 3 < sizeof(merge)) len += (size_t)utf8_put(cp, merge + len);
+                    continue;
+                }
+                ch = (*p == 'n') ? '\n' : (*p == 't') ? '\t' : *p;
+            }
+            if (len + 1 < sizeof(merge)) merge[len++] = ch;
+        }
+        if (*p == '"') p++;
+        merge[len] = 0;
+
+        char *space = strchr(merge, ' ');
+        if (!space || space == merge || !space[1] || strchr(space + 1, ' ')) continue;
+        if (count == cap) {
+            bpe_rule_t *grown = (bpe_rule_t *)realloc(rules, 2 * cap * sizeof(bpe_rule_t));
+            if (!grown) break;
+            rules = grown;
+            cap *= 2;
+        }
+        rules[count++] = (bpe_rule_t){ single_codepoint(merge, (size_t)(space - merge)),
+                                       single_codepoint(space + 1, strlen(space + 1)), rank };
+    }
+    if (!rules) return -1;
+
+    qsort(rules, count, sizeof(bpe_rule_t), cmp_rule);
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (kept && rules[kept - 1].p1 == rules[i].p1 && rules[kept - 1].p2 == rules[i].p2) continue;
+        rules[kept++] = rules[i];
+    }
+    *out = rules;
+    return (int)kept;
+}
+
+static void bench_tokenizer(bench_ctx_t *bc, const char *path) {
+    const char *name = "tokenize_bpe_parallel/tokenizer.json";
+    if (bc->filter && !strstr(name, bc->filter)) return;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        printf("[BENCH] %-40s skipped: %s not found\n", name, path);
+        return;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *text = (char *)malloc((size_t)len + 1);
+    uint32_t *ids = (uint32_t *)malloc((size_t)len * sizeof(uint32_t));
+    bpe_rule_t *rules = NULL;
+    int num_rules = -1;
+    if (text && ids && fread(text, 1, (size_t)len, f) == (size_t)len) {
+        text[len] = 0;
+        num_rules = load_merges(text, &rules);
+    }
+    fclose(f);
+
+    // The file is its own corpus: token strings, JSON and scripts of every kind
+    if (num_rules > 0) {
+        uint32_t count = 0;
+        nodal_tokcache_t *cache = nodal_tokcache_create((size_t)8 << 20, NODAL_EVICT_LRU);
+        kernel_case_t kc = { nodal_kernel_tokenize_bpe_parallel,
+                             { .inputs = { { text, (size_t)len }, { rules, (size_t)num_rules * sizeof(bpe_rule_t) },
+                                           { cache, cache ? sizeof(void *) : 0 } },
+                               .outputs = { { ids, (size_t)len * 4 }, { &count, sizeof(count) } } } };
+        kc.call.scalars[0] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = (uint32_t)len };
+        kc.call.scalars[1] = (nodal_scalar_t){ .kind = NODAL_U32, .v.u32 = (uint32_t)len };
+        print_result(bc, bench_run(bc, name, NULL, run_kernel, &kc, 0.0, (double)len, 0));
+        nodal_tokcache_destroy(cache);
+    } else {
+        printf("[BENCH] %-40s skipped: no merges in %s\n", name, path);
+    }
+    free(text);
+    free(ids);
+    free(rules);
+}
+
+/* --- Loader --- */
+
+typedef struct {
+    const char *path;
+    nodal_load_opts_t opts;
+    int cold;
+} loader_case_t;
+
+/* Evicts the model file from the page cache so the next open reads storage */
+static void drop_cache(void *ctx) {
+    const loader_case_t *lc = (const loader_case_t *)ctx;
+    if (!lc->cold) return;
+    int fd = open(lc->path, O_RDONLY);
+    if (fd < 0) return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+static void open_model(void *ctx) {
+    const loader_case_t *lc = (const loader_case_t *)ctx;
+    nodal_model_release(nodal_model_open(lc->path, &lc->opts));
+}
+
+/**
+ * bench_loader
+ * Time-to-ready of a populated mapping of a synthetic 64MB model,
+ * with the file evicted from the page cache (cold) and resident (warm).
+ * Cold numbers need a real filesystem; on tmpfs both read RAM.
+ */
+static void bench_loader(bench_ctx_t *bc, const char *dir) {
+    if (bc->filter && !strstr("loader/cold loader/warm", bc->filter)) return;
+
+    enum { NUM_T = 16, ELEMS = 1024 * 1024 };
+    char path[512];
+    snprintf(path, sizeof(path), "%s/nodal_bench_model.nbbin", dir);
+    const uint64_t data_off = 4096;
+    size_t file_bytes = data_off + (size_t)NUM_T * ELEMS * sizeof(float);
+
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        printf("[BENCH] %-40s skipped: cannot write %s\n", "loader", path);
+        return;
+    }
+    uint8_t head[4096] = {0};
+    *(nodal_header_t *)head = (nodal_header_t){ .magic = 0x4E42444E, .version = 1, .num_tensors = NUM_T,
+                                                .tensor_table_offset = sizeof(nodal_header_t) };
+    nodal_tensor_entry_t *table = (nodal_tensor_entry_t *)(head + sizeof(nodal_header_t));
+    for (uint32_t t = 0; t < NUM_T; t++) {
+        table[t] = (nodal_tensor_entry_t){ .dtype = NODAL_F32, .rank = 2, .shape = { 1024, 1024 },
+                                           .data_offset = data_off + (uint64_t)t * ELEMS * sizeof(float),
+                                           .data_size = ELEMS * sizeof(float) };
+    }
+    int ok = fwrite(head, 1, sizeof(head), f) == sizeof(head);
+    float *chunk = (float *)malloc(ELEMS * sizeof(float));
+    for (uint32_t t = 0; ok && chunk && t < NUM_T; t++) {
+        fill_uniform(chunk, ELEMS, 10 + t);
+        ok = fwrite(chunk, sizeof(float), ELEMS, f) == ELEMS;
+    }
+    free(chunk);
+    ok &= fclose(f) == 0;
+
+    if (ok) {
+        // The loader logs every open to stdout; keep the table readable
+        loader_case_t lc = { path, { .prefault = NODAL_PREFAULT_PARALLEL }, 1 };
+        fflush(stdout);
+        int saved = dup(STDOUT_FILENO), null_fd = open("/dev/null", O_WRONLY);
+        if (saved >= 0 && null_fd >= 0) dup2(null_fd, STDOUT_FILENO);
+        bench_result_t *cold = bench_run(bc, "loader/cold/64MB", drop_cache, open_model, &lc, 0.0, (double)file_bytes, 0);
+        lc.cold = 0;
+        bench_result_t *warm = bench_run(bc, "loader/warm/64MB", NULL, open_model, &lc, 0.0, (double)file_bytes, 0);
+        fflush(stdout);
+        if (saved >= 0 && null_fd >= 0) dup2(saved, STDOUT_FILENO);
+        if (saved >= 0) close(saved);
+        if (null_fd >= 0) close(null_fd);
+        print_result(bc, cold);
+        print_result(bc, warm);
+    }
+    unlink(path);
+}
+
+/* --- Reporting --- */
+
+static const char *isa_name(nodal_isa_t isa) {
+    return isa == NODAL_ISA_AVX512 ? "avx512" : isa == NODAL_ISA_AVX2 ? "avx2" : "generic";
+}
+
+static int write_json(const bench_ctx_t *bc, const char *path) {
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\n  \"machine\": {\"isa\": \"%s\", \"threads\": %u, \"peak_gflops\": %.1f, \"peak_gbps\": %.2f},\n",
+            isa_name(nodal_cpu_isa()), nodal_get_num_threads(), bc->peak_gflops, bc->peak_gbps);
+    fprintf(f, "  \"results\": [\n");
+    for (uint32_t i = 0; i < bc->num_results; i++) {
+        const bench_result_t *r = &bc->results[i];
+        fprintf(f, "    {\"name\": \"%s\", \"reps\": %u, \"median_us\": %.3f, \"p99_us\": %.3f, \"min_us\": %.3f, "
+                   "\"gflops\": %.3f, \"gbps\": %.3f}%s\n",
+                r->name, r->reps, r->median_us, r->p99_us, r->min_us, r->gflops, r->gbps,
+                i + 1 < bc->num_results ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    return fclose(f);
+}
+
+/**
+ * compare_baseline
+ * Matches cases by name against a JSON file written by --json and flags
+ * every median more than threshold percent slower.
+ * @return Number of regressions, or -1 if the baseline cannot be read.
+ */
+static int compare_baseline(const bench_ctx_t *bc, const char *path, double threshold) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *base = (char *)malloc((size_t)len + 1);
+    if (!base || fread(base, 1, (size_t)len, f) != (size_t)len) {
+        fclose(f);
+        free(base);
+        return -1;
+    }
+    fclose(f);
+    base[len] = 0;
+
+    int regressions = 0;
+    printf("[BENCH] Baseline %s (threshold +%.1f%%)\n", path, threshold);
+    for (uint32_t i = 0; i < bc->num_results; i++) {
+        const bench_result_t *r = &bc->results[i];
+        char key[96];
+        snprintf(key, sizeof(key), "\"name\": \"%s\"", r->name);
+        const char *hit = strstr(base, key);
+        const char *med = hit ? strstr(hit, "\"median_us\":") : NULL;
+        if (!med) {
+            printf("[BENCH] %-40s new\n", r->name);
+            continue;
+        }
+        double was = strtod(med + strlen("\"median_us\":"), NULL);
+        double delta = was > 0 ? 100.0 * (r->median_us - was) / was : 0.0;
+        int slow = delta > threshold;
+        regressions += slow;
+        printf("[BENCH] %-40s %10.1f -> %10.1f us  %+6.1f%%%s\n", r->name, was, r->median_us, delta,
+               slow ? "  REGRESSION" : "");
+    }
+    free(base);
+    return regressions;
+}
+
+int main(int argc, char *argv[]) {
+    static bench_ctx_t bc = { .min_time_ms = 200.0 };
+    const char *json_path = NULL, *baseline = NULL;
+    const char *tokenizer = "examples/tokenizer.json", *scratch = ".";
+    double threshold = 10.0;
+    uint32_t threads = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0 && i + 1 < argc) json_path = argv[++i];
+        else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baseline = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) bc.filter = argv[++i];
+        else if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) bc.min_time_ms = atof(argv[++i]);
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) threads = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--tokenizer") == 0 && i + 1 < argc) tokenizer = argv[++i];
+        else if (strcmp(argv[i], "--scratch") == 0 && i + 1 < argc) scratch = argv[++i];
+        else if (strcmp(argv[i], "--quick") == 0) bc.quick = 1;
+        else {
+            printf("Usage: nodal_bench [options]\n");
+            printf("  --json <file>       Write results as JSON (one line per case)\n");
+            printf("  --baseline <file>   Compare medians with an earlier --json run\n");
+            printf("  --threshold <pct>   Slowdown reported as a regression (default 10)\n");
+            printf("  --filter <text>     Only cases whose name contains text\n");
+            printf("  --min-time <ms>     Timed budget per case (default 200)\n");
+            printf("  --threads <N>       Worker threads (default: online CPUs)\n");
+            printf("  --tokenizer <file>  tokenizer.json for the BPE case (default examples/tokenizer.json)\n");
+            printf("  --scratch <dir>     Where the loader case writes its model (default .)\n");
+            printf("  --quick             Skip the largest shapes\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (nodal_set_num_threads(threads, 0) != 0) {
+        fprintf(stderr, "[ERROR] Failed to start worker pool.\n");
+        return EXIT_FAILURE;
+    }
+    measure_peaks(&bc);
+    printf("[BENCH] %s, %u thread(s): peak %.1f GFLOP/s, %.2f GB/s\n", isa_name(nodal_cpu_isa()),
+           nodal_get_num_threads(), bc.peak_gflops, bc.peak_gbps);
+    printf("[BENCH] %-40s %10s %10s %6s %9s %5s %9s %5s\n", "case", "median us", "p99 us", "reps", "GFLOP/s", "peak",
+           "GB/s", "peak");
+
+    // Square GEMM, M=1 decode GEMV, and 1-3B model projection shapes
+    bench_matmul(&bc, "square", 256, 256, 256, NODAL_F32);
+    bench_matmul(&bc, "square", 512, 512, 512, NODAL_F32);
+    if (!bc.quick) bench_matmul(&bc, "square", 1024, 1024, 1024, NODAL_F32);
+    bench_matmul(&bc, "gemv", 1, 4096, 4096, NODAL_F32);
+    bench_matmul(&bc, "slm_qkv", 1, 2048, 2048, NODAL_F32);
+    bench_matmul(&bc, "slm_mlp_up", 1, 5632, 2048, NODAL_F32);
+    if (!bc.quick) bench_matmul(&bc, "slm_prefill", 64, 2048, 2048, NODAL_F32);
+    for (nodal_type_t bt = NODAL_F16; bt <= NODAL_BF16; bt++) {
+        bench_matmul(&bc, "gemv", 1, 4096, 4096, bt);
+        if (!bc.quick) bench_matmul(&bc, "slm_prefill", 64, 2048, 2048, bt);
+    }
+
+    for (int tiled = 0; tiled <= 1; tiled++) {
+        bench_qnf4(&bc, 1, 4096, 4096, tiled);
+        bench_qnf4(&bc, 1, 5632, 2048, tiled);
+        if (!bc.quick) bench_qnf4(&bc, 64, 2048, 2048, tiled);
+    }
+    bench_q8_0(&bc, 1, 4096, 4096);
+    bench_q8_0(&bc, 1, 5632, 2048);
+    if (!bc.quick) bench_q8_0(&bc, 64, 2048, 2048);
+
+    bench_softmax(&bc, "vocab", 1, 50257, 0);
+    bench_softmax(&bc, "vocab_online", 1, 50257, NODAL_SOFTMAX_ONLINE);
+    bench_softmax(&bc, "scores_causal", 32, 1024, NODAL_SOFTMAX_CAUSAL);
+    bench_sample(&bc, "greedy", 50257, 0.0f, 0, 0.0f);
+    bench_sample(&bc, "temp", 50257, 0.8f, 0, 0.0f);
+    bench_sample(&bc, "top_k40", 50257, 0.8f, 40, 0.0f);
+    bench_sample(&bc, "top_p0.9", 50257, 0.8f, 0, 0.9f);
+    if (!bc.quick) bench_sample(&bc, "top_p0.9", 128256, 0.8f, 0, 0.9f);
+
+    bench_add(&bc, 1u << 22);
+    bench_rmsnorm(&bc, 1, 4096);
+    bench_rmsnorm(&bc, 64, 4096);
+    bench_swiglu(&bc, 11008);
+    if (!bc.quick) bench_swiglu(&bc, 64 * 11008);
+    bench_rope(&bc, 1, 32, 128);
+    if (!bc.quick) bench_rope(&bc, 64, 32, 128);
+    bench_embed_nf4(&bc, 1, 32000, 4096);
+    if (!bc.quick) bench_embed_nf4(&bc, 512, 32000, 4096);
+    bench_tokenizer(&bc, tokenizer);
+    bench_loader(&bc, scratch);
+
+    int rc = EXIT_SUCCESS;
+    if (json_path) {
+        if (write_json(&bc, json_path) == 0) printf("[BENCH] Wrote %s\n", json_path);
+        else rc = EXIT_FAILURE;
+    }
+    if (baseline) {
+        int regressions = compare_baseline(&bc, baseline, threshold);
+        if (regressions < 0) printf("[BENCH] Baseline %s not readable; skipped comparison\n", baseline);
+        if (regressions > 0) {
+            printf("[BENCH] %d regression(s)\n", regressions);
+            rc = EXIT_FAILURE;
+        }
+    }
+    nodal_set_num_threads(1, 0);
+    return rc;
+}
@@ -3,15 +3,78 @@
  * Full Version: High-precision auditing and zero-copy orchestration.
  */
 
+#include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
 #include "nodal.h"
 
 /* Runtime linkage */
-extern void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uint32_t max_tensors);
+extern nodal_model_t *nodal_model_open(const char *path, const nodal_load_opts_t *opts);
+extern void nodal_model_release(nodal_model_t *model);
+extern const nodal_tape_header_t *nodal_model_tape(const nodal_model_t *model);
+extern const nodal_irop_t *nodal_model_ops(const nodal_model_t *model, uint32_t *num_ops);
+extern const nodal_tensor_t *nodal_model_tensors(const nodal_model_t *model, uint32_t *num_tensors);
+extern const nodal_buffer_t *nodal_model_bindings(const nodal_model_t *model);
+extern const void *nodal_model_base(const nodal_model_t *model);
+extern const nodal_load_stats_t *nodal_model_load_stats(const nodal_model_t *model);
+extern nodal_session_t *nodal_session_create(nodal_model_t *model);
+extern long nodal_session_run(nodal_session_t *s, const void *input, size_t input_bytes, void *output,
+                              size_t output_bytes);
+extern size_t nodal_session_output_bytes(const nodal_session_t *s);
+extern size_t nodal_session_private_bytes(const nodal_session_t *s);
+extern void nodal_session_destroy(nodal_session_t *s);
+extern nodal_batcher_t *nodal_batcher_create(nodal_model_t *model, uint32_t max_batch, uint32_t budget_us);
+extern long nodal_batcher_submit(nodal_batcher_t *b, nodal_kv_seq_t *seq, const void *input, void *output,
+                                 size_t output_bytes);
+extern size_t nodal_batcher_output_bytes(const nodal_batcher_t *b);
+extern void nodal_batcher_stats(nodal_batcher_t *b, nodal_batcher_stats_t *out);
+extern void nodal_batcher_destroy(nodal_batcher_t *b);
+extern void nodal_execute_tape(const nodal_irop_t *ops, size_t op_count, const nodal_buffer_t *tensor_runtime);
+extern int nodal_set_num_threads(uint32_t num_threads, int pin);
+extern uint32_t nodal_get_num_threads(void);
+extern int nodal_bind_aux(const nodal_irop_t *ops, size_t op_count, const nodal_tensor_t *tensors,
+                          uint32_t num_tensors, nodal_buffer_t *tensor_runtime, uint32_t num_slots);
+extern nodal_tape_t *nodal_tape_resolve(const nodal_irop_t *ops, size_t op_count,
+                                        const nodal_buffer_t *tensor_runtime, uint32_t num_slots);
+extern void nodal_tape_run(const nodal_tape_t *tape);
+extern void nodal_tape_destroy(nodal_tape_t *tape);
+extern void nodal_tape_run_prefetched(const nodal_tape_t *tape, nodal_prefetch_t *pf);
+extern void nodal_tape_run_profiled(const nodal_tape_t *tape, nodal_prefetch_t *pf, nodal_profiler_t *prof);
+extern nodal_profiler_t *nodal_profiler_create(const nodal_irop_t *ops, size_t op_count, uint32_t flags);
+extern void nodal_profiler_report(const nodal_profiler_t *p, FILE *out);
+extern int nodal_profiler_write_trace(const nodal_profiler_t *p, const char *path);
+extern void nodal_profiler_destroy(nodal_profiler_t *p);
+extern nodal_prefetch_t *nodal_prefetch_create(const nodal_irop_t *ops, size_t op_count,
+                                               const nodal_buffer_t *tensor_runtime, const void *map_base,
+                                               size_t map_bytes, uint32_t distance, nodal_prefetch_mode_t mode);
+extern void nodal_prefetch_stats(nodal_prefetch_t *pf, nodal_prefetch_stats_t *out);
+extern void nodal_prefetch_destroy(nodal_prefetch_t *pf);
+extern nodal_schedule_t *nodal_schedule_build(const nodal_irop_t *ops, size_t op_count);
+extern void nodal_schedule_destroy(nodal_schedule_t *sched);
+extern void nodal_schedule_stats(const nodal_schedule_t *sched, nodal_schedule_stats_t *out);
+extern void nodal_execute_schedule(const nodal_schedule_t *sched, const nodal_buffer_t *tensor_runtime);
+extern int nodal_plan_build(const nodal_irop_t *ops, size_t op_count, const nodal_schedule_t *sched,
+                            const nodal_buffer_t *tensor_runtime, uint32_t num_tensors, nodal_plan_t *out);
+extern void nodal_plan_free(nodal_plan_t *plan);
+extern void nodal_plan_bind(const nodal_plan_t *plan, void *arena, nodal_buffer_t *tensor_runtime);
+extern nodal_tokcache_t *nodal_tokcache_create(size_t max_bytes, nodal_evict_policy_t policy);
+extern void nodal_tokcache_destroy(nodal_tokcache_t *cache);
+extern void nodal_tokcache_stats(nodal_tokcache_t *cache, nodal_tokcache_stats_t *out);
+
+#define NR_MAX_TENSORS 1024
+#define NR_VOCAB_SLOT  (NR_MAX_TENSORS - 1)   // Loader convention
+
+/* Scratch slots for the tokenizer benchmark, just below the vocab */
+#define NR_TOK_CACHE   (NR_MAX_TENSORS - 5)
+#define NR_TOK_TEXT    (NR_MAX_TENSORS - 4)
+#define NR_TOK_IDS     (NR_MAX_TENSORS - 3)
+#define NR_TOK_COUNT   (NR_MAX_TENSORS - 2)
 
 void print_banner() {
     printf("\033[1;34m"); // Blue
@@ -22,6 +85,413 @@ void print_banner() {
     printf("\033[0m\n");
 }
 
+/**
+ * read_input
+ * Fills input with exactly th->input_bytes from a raw file.
+ * @return 0 on success, -1 (reported) if the file is missing or short.
+ */
+static int read_input(const nodal_tape_header_t *th, const char *input_path, void *input) {
+    FILE *f = fopen(input_path, "rb");
+    size_t got = f ? fread(input, 1, th->input_bytes, f) : 0;
+    if (f) fclose(f);
+    if (got != th->input_bytes) {
+        fprintf(stderr, "[ERROR] Input %s must hold %u bytes.\n", input_path, th->input_bytes);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * run_model
+ * Executes the model's fused IR tape: binds the input, plans
+ * activations into one arena, then runs either the pre-resolved tape or
+ * the level scheduler and prints a summary of the output tensor. A non-zero
+ * prefetch distance streams mapped weights in ahead of the tape.
+ * profile (or a trace_path) runs the tape through the per-op profiler.
+ */
+static int run_model(const nodal_model_t *model, nodal_buffer_t *tensor_runtime,
+                     const char *input_path, uint32_t iters, int use_sched,
+                     uint32_t prefetch, nodal_prefetch_mode_t prefetch_mode,
+                     int profile, const char *trace_path) {
+    const nodal_tape_header_t *th = nodal_model_tape(model);
+    uint32_t num_tensors;
+    const nodal_tensor_t *tensors = nodal_model_tensors(model, &num_tensors);
+    uint32_t num_ops;
+    const nodal_irop_t *ops = nodal_model_ops(model, &num_ops);
+    if (th->num_slots > NR_TOK_CACHE) {
+        fprintf(stderr, "[ERROR] Tape needs %u slots, runtime has %d.\n", th->num_slots, NR_TOK_CACHE);
+        return -1;
+    }
+
+    // 1. Input tensor (zeros unless a raw file is given)
+    void *input = NULL;
+    if (th->input_slot < th->num_slots) {
+        input = calloc(1, th->input_bytes ? th->input_bytes : 1);
+        if (!input) return -1;
+        if (input_path && read_input(th, input_path, input) != 0) {
+            free(input);
+            return -1;
+        }
+        tensor_runtime[th->input_slot] = (nodal_buffer_t){ .ptr = input, .byte_len = th->input_bytes };
+    }
+    int aux = nodal_bind_aux(ops, num_ops, tensors, num_tensors, tensor_runtime, th->num_slots);
+    if (aux < 0) {
+        free(input);
+        return -1;
+    }
+    if (aux > 0) printf("[LOADER] Bound %d quantization scale segment(s)\n", aux);
+    if (num_ops < th->num_ops) {
+        printf("[FUSE] %u op pair(s) fused (%u -> %u ops)\n", th->num_ops - num_ops, th->num_ops, num_ops);
+    }
+
+    // 2. Schedule (optional) and activation arena
+    nodal_schedule_t *sched = use_sched ? nodal_schedule_build(ops, num_ops) : NULL;
+    nodal_plan_t plan;
+    if ((use_sched && !sched) || nodal_plan_build(ops, num_ops, sched, tensor_runtime, th->num_slots, &plan) != 0) {
+        nodal_schedule_destroy(sched);
+        free(input);
+        return -1;
+    }
+    void *arena = aligned_alloc(64, plan.arena_bytes ? plan.arena_bytes : 64);
+    if (!arena) {
+        fprintf(stderr, "[ERROR] Failed to allocate a %zu byte activation arena.\n", plan.arena_bytes);
+        nodal_plan_free(&plan);
+        nodal_schedule_destroy(sched);
+        free(input);
+        return -1;
+    }
+    nodal_plan_bind(&plan, arena, tensor_runtime);
+    printf("[PLAN] %u activations in a %.1f KB arena (%.1f KB unplanned)\n", plan.num_entries,
+           plan.arena_bytes / 1024.0, plan.naive_bytes / 1024.0);
+
+    // 3. Execute
+    nodal_tape_t *tape = sched ? NULL : nodal_tape_resolve(ops, num_ops, tensor_runtime, th->num_slots);
+    nodal_prefetch_t *pf = (tape && prefetch) ? nodal_prefetch_create(ops, num_ops, tensor_runtime, nodal_model_base(model),
+                                                                      nodal_model_load_stats(model)->map_bytes,
+                                                                      prefetch, prefetch_mode) : NULL;
+    if (sched && (profile || trace_path)) printf("[PROF] Profiling covers the serial tape; ignored with --sched\n");
+    nodal_profiler_t *prof = (tape && (profile || trace_path))
+                           ? nodal_profiler_create(ops, num_ops, NODAL_PROFILE_COUNTERS |
+                                                                    (trace_path ? NODAL_PROFILE_TRACE : 0))
+                           : NULL;
+    int rc = 0;
+    if (!sched && !tape) {
+        rc = -1;
+    } else {
+        if (sched) {
+            nodal_schedule_stats_t ss;
+            nodal_schedule_stats(sched, &ss);
+            printf("[SCHED] %u ops in %u levels (widest %u, %u solo)\n", ss.num_ops, ss.num_levels, ss.max_width,
+                   ss.num_solo);
+        }
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (uint32_t it = 0; it < iters; it++) {
+            if (sched) nodal_execute_schedule(sched, tensor_runtime);
+            else if (prof) nodal_tape_run_profiled(tape, pf, prof);
+            else if (pf) nodal_tape_run_prefetched(tape, pf);
+            else nodal_tape_run(tape);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        printf("[EXEC] %u ops x %u iteration(s): %.6f s (%.2f us/iter)\n", num_ops, iters, elapsed,
+               1e6 * elapsed / iters);
+        if (prof) {
+            nodal_profiler_report(prof, stdout);
+            if (trace_path && nodal_profiler_write_trace(prof, trace_path) == 0) {
+                printf("[PROF] Wrote Chrome trace to %s\n", trace_path);
+            } else if (trace_path) {
+                fprintf(stderr, "[ERROR] Failed to write trace %s\n", trace_path);
+            }
+        }
+        if (pf) {
+            nodal_prefetch_stats_t ps;
+            nodal_prefetch_stats(pf, &ps);
+            printf("[PREFETCH] %llu hits / %llu stalls (%llu pages), %llu ops ahead, %.2f MB prefetched\n",
+                   (unsigned long long)ps.hits, (unsigned long long)ps.stalls, (unsigned long long)ps.stall_pages,
+                   (unsigned long long)ps.ops_prefetched, ps.bytes_prefetched / (1024.0 * 1024.0));
+        }
+
+        // 4. Output summary
+        if (th->output_slot < th->num_slots && tensor_runtime[th->output_slot].ptr) {
+            const float *out = (const float *)tensor_runtime[th->output_slot].ptr;
+            size_t n = tensor_runtime[th->output_slot].byte_len / sizeof(float);
+            size_t best = 0;
+            for (size_t i = 1; i < n; i++) if (out[i] > out[best]) best = i;
+            printf("[OUTPUT] slot %u: %zu values, argmax %zu (%.6f), first [", th->output_slot, n, best, out[best]);
+            for (size_t i = 0; i < n && i < 4; i++) printf(i ? ", %.6f" : "%.6f", out[i]);
+            printf("]\n");
+        }
+    }
+
+    for (uint32_t i = 0; i < plan.num_entries; i++) {
+        memset(&tensor_runtime[plan.entries[i].tensor], 0, sizeof(nodal_buffer_t));
+    }
+    if (input) memset(&tensor_runtime[th->input_slot], 0, sizeof(nodal_buffer_t));
+    for (uint32_t i = 0; i < num_ops; i++) {
+        if (ops[i].kind != OP_MATMUL_QNF4 && ops[i].kind != OP_MATMUL_QNF4_ADD && ops[i].kind != OP_MATMUL_Q8_0 &&
+            ops[i].kind != OP_MATMUL_Q8_0_ADD && ops[i].kind != OP_EMBED_GATHER) continue;
+        // Only slots nodal_bind_aux could have bound: a third input, past the weights, inside the tape
+        if (ops[i].num_inputs < 3 || ops[i].inputs[2] < num_tensors || ops[i].inputs[2] >= th->num_slots) continue;
+        memset(&tensor_runtime[ops[i].inputs[2]], 0, sizeof(nodal_buffer_t));
+    }
+    nodal_profiler_destroy(prof);
+    nodal_prefetch_destroy(pf);
+    nodal_tape_destroy(tape);
+    nodal_schedule_destroy(sched);
+    nodal_plan_free(&plan);
+    free(arena);
+    free(input);
+    return rc;
+}
+
+typedef struct {
+    nodal_session_t *session;
+    const void *input;
+    size_t input_bytes;
+    float *output;
+    size_t output_bytes;
+    uint32_t iters;
+    int failed;
+} nr_session_job_t;
+
+static void *session_thread(void *arg) {
+    nr_session_job_t *job = (nr_session_job_t *)arg;
+    for (uint32_t it = 0; it < job->iters; it++) {
+        if (nodal_session_run(job->session, job->input, job->input_bytes, job->output, job->output_bytes) < 0) {
+            job->failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * run_sessions
+ * Serves num_sessions concurrent sessions over one shared mapping, one
+ * thread each, and checks that they all agree on the output.
+ */
+static int run_sessions(nodal_model_t *model, uint32_t num_sessions, uint32_t iters, const char *input_path) {
+    const nodal_tape_header_t *th = nodal_model_tape(model);
+    nr_session_job_t *jobs = (nr_session_job_t *)calloc(num_sessions, sizeof(nr_session_job_t));
+    pthread_t *threads = (pthread_t *)calloc(num_sessions, sizeof(pthread_t));
+    void *input = calloc(1, th->input_bytes ? th->input_bytes : 1);
+    int rc = (jobs && threads && input) ? 0 : -1;
+    if (rc == 0 && input_path) rc = read_input(th, input_path, input);
+
+    // 1. Sessions: private arenas, shared weights
+    uint32_t created = 0;
+    for (; rc == 0 && created < num_sessions; created++) {
+        nr_session_job_t *job = &jobs[created];
+        job->session = nodal_session_create(model);
+        if (!job->session) {
+            rc = -1;
+            break;
+        }
+        job->input = input;
+        job->input_bytes = th->input_bytes;
+        job->output_bytes = nodal_session_output_bytes(job->session);
+        job->output = (float *)calloc(1, job->output_bytes ? job->output_bytes : 1);
+        job->iters = iters;
+        if (!job->output) rc = -1;
+    }
+
+    // 2. One thread per session
+    if (rc == 0) {
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint32_t started = 0;
+        for (; started < num_sessions; started++) {
+            if (pthread_create(&threads[started], NULL, session_thread, &jobs[started]) != 0) break;
+        }
+        for (uint32_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+        float max_diff = 0.0f;
+        for (uint32_t i = 0; i < num_sessions; i++) {
+            rc |= (jobs[i].failed || i >= started) ? -1 : 0;
+            for (size_t k = 0; k < jobs[0].output_bytes / sizeof(float); k++) {
+                float d = fabsf(jobs[i].output[k] - jobs[0].output[k]);
+                max_diff = d > max_diff ? d : max_diff;
+            }
+        }
+        printf("[SESSION] %u session(s) x %u run(s): %.6f s (%.1f runs/s), outputs agree to %g\n", num_sessions,
+               iters, elapsed, num_sessions * iters / elapsed, max_diff);
+        printf("[SESSION] %.2f MB mapped once, %.1f KB private per session\n",
+               nodal_model_load_stats(model)->map_bytes / (1024.0 * 1024.0),
+               nodal_session_private_bytes(jobs[0].session) / 1024.0);
+    }
+
+    for (uint32_t i = 0; jobs && i < created; i++) {
+        nodal_session_destroy(jobs[i].session);
+        free(jobs[i].output);
+    }
+    free(jobs);
+    free(threads);
+    free(input);
+    return rc;
+}
+
+typedef struct {
+    nodal_batcher_t *batcher;
+    const void *input;
+    float *output;
+    size_t output_bytes;
+    uint32_t iters;
+    int failed;
+} nr_client_job_t;
+
+static void *client_thread(void *arg) {
+    nr_client_job_t *job = (nr_client_job_t *)arg;
+    for (uint32_t it = 0; it < job->iters; it++) {
+        if (nodal_batcher_submit(job->batcher, NULL, job->input, job->output, job->output_bytes) < 0) {
+            job->failed = 1;
+            break;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * run_batched
+ * num_clients threads submit the same input (zeros unless a raw file is
+ * given) to one batcher, which coalesces them into stacked matmuls;
+ * reports batch sizes and weight traffic.
+ */
+static int run_batched(nodal_model_t *model, uint32_t num_clients, uint32_t iters, uint32_t max_batch,
+                       uint32_t budget_us, const char *input_path) {
+    const nodal_tape_header_t *th = nodal_model_tape(model);
+    nodal_batcher_t *batcher = nodal_batcher_create(model, max_batch, budget_us);
+    nr_client_job_t *jobs = (nr_client_job_t *)calloc(num_clients, sizeof(nr_client_job_t));
+    pthread_t *threads = (pthread_t *)calloc(num_clients, sizeof(pthread_t));
+    void *input = calloc(1, th->input_bytes ? th->input_bytes : 1);
+    if (!batcher || !jobs || !threads || !input || (input_path && read_input(th, input_path, input) != 0)) {
+        nodal_batcher_destroy(batcher);
+        free(jobs);
+        free(threads);
+        free(input);
+        return -1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint32_t started = 0;
+    for (; started < num_clients; started++) {
+        nr_client_job_t *job = &jobs[started];
+        job->batcher = batcher;
+        job->input = input;
+        job->output_bytes = nodal_batcher_output_bytes(batcher);
+        job->output = (float *)malloc(job->output_bytes ? job->output_bytes : 1);
+        job->iters = iters;
+        if (!job->output || pthread_create(&threads[started], NULL, client_thread, job) != 0) {
+            free(job->output);
+            break;
+        }
+    }
+    for (uint32_t i = 0; i < started; i++) pthread_join(threads[i], NULL);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    int rc = (started == num_clients) ? 0 : -1;
+    float max_diff = 0.0f;
+    for (uint32_t i = 0; i < started; i++) {
+        rc |= jobs[i].failed ? -1 : 0;
+        for (size_t k = 0; k < jobs[0].output_bytes / sizeof(float); k++) {
+            float d = fabsf(jobs[i].output[k] - jobs[0].output[k]);
+            max_diff = d > max_diff ? d : max_diff;
+        }
+    }
+    for (uint32_t i = 0; i < started; i++) free(jobs[i].output);
+    nodal_batcher_stats_t bs;
+    nodal_batcher_stats(batcher, &bs);
+    printf("[BATCH] %llu request(s) in %llu batch(es): avg %.2f, max %u rows, %.1f req/s, outputs agree to %g\n",
+           (unsigned long long)bs.requests, (unsigned long long)bs.batches,
+           bs.batches ? (double)bs.requests / bs.batches : 0.0, bs.max_rows, bs.requests / elapsed, max_diff);
+    printf("[BATCH] Weight traffic %.3f MB per request\n",
+           bs.requests ? bs.weight_bytes / (1024.0 * 1024.0) / bs.requests : 0.0);
+
+    nodal_batcher_destroy(batcher);
+    free(jobs);
+    free(threads);
+    free(input);
+    return rc;
+}
+
+/**
+ * run_tokenize
+ * Tokenizes a text file with the model's merge table through the parallel
+ * tokenizer op and reports throughput.
+ */
+static int run_tokenize(const char *text_path, nodal_buffer_t *tensor_runtime, nodal_tokcache_t *cache) {
+    if (!tensor_runtime[NR_VOCAB_SLOT].ptr) {
+        fprintf(stderr, "[ERROR] Model has no vocab segment to tokenize with.\n");
+        return -1;
+    }
+
+    FILE *f = fopen(text_path, "rb");
+    if (!f) {
+        perror("[ERROR] Failed to open text file");
+        return -1;
+    }
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    uint8_t *text = (uint8_t *)malloc(len > 0 ? len : 1);
+    uint32_t *ids = (uint32_t *)malloc((len > 0 ? len : 1) * sizeof(uint32_t));
+    uint32_t count = 0;
+    if (!text || !ids || fread(text, 1, len, f) != (size_t)len) {
+        fprintf(stderr, "[ERROR] Failed to read %s\n", text_path);
+        fclose(f);
+        free(text);
+        free(ids);
+        return -1;
+    }
+    fclose(f);
+
+    tensor_runtime[NR_TOK_TEXT] = (nodal_buffer_t){ .ptr = text, .byte_len = len };
+    tensor_runtime[NR_TOK_IDS] = (nodal_buffer_t){ .ptr = ids, .byte_len = len * sizeof(uint32_t) };
+    tensor_runtime[NR_TOK_COUNT] = (nodal_buffer_t){ .ptr = &count, .byte_len = sizeof(count) };
+
+    tensor_runtime[NR_TOK_CACHE] = (nodal_buffer_t){ .ptr = cache, .byte_len = cache ? sizeof(void *) : 0 };
+
+    nodal_irop_t op = {
+        .kind = OP_TOKENIZE_BPE_PARALLEL,
+        .num_inputs = 3, .num_outputs = 2,
+        .inputs = { NR_TOK_TEXT, NR_VOCAB_SLOT, NR_TOK_CACHE },
+        .outputs = { NR_TOK_IDS, NR_TOK_COUNT },
+        .scalars = { { .kind = NODAL_U32, .v.u32 = (uint32_t)len },
+                     { .kind = NODAL_U32, .v.u32 = (uint32_t)len } }
+    };
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    nodal_execute_tape(&op, 1, tensor_runtime);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+
+    printf("[TOKENIZE] %ld bytes -> %u tokens on %u threads\n", len, count, nodal_get_num_threads());
+    printf("[TOKENIZE] %.6f seconds (%.2f MB/s)\n", elapsed,
+           elapsed > 0 ? (double)len / (1024.0 * 1024.0) / elapsed : 0.0);
+
+    if (cache) {
+        nodal_tokcache_stats_t st;
+        nodal_tokcache_stats(cache, &st);
+        uint64_t lookups = st.hits + st.misses;
+        printf("[TOKENIZE] Cache: %llu hits, %llu misses (%.1f%% hit rate), %llu evictions\n",
+               (unsigned long long)st.hits, (unsigned long long)st.misses,
+               lookups ? 100.0 * (double)st.hits / (double)lookups : 0.0, (unsigned long long)st.evictions);
+        printf("[TOKENIZE] Cache: %u/%u entries in %.2f MB\n", st.entries, st.capacity,
+               (double)st.bytes / (1024.0 * 1024.0));
+    }
+
+    memset(&tensor_runtime[NR_TOK_CACHE], 0, 4 * sizeof(nodal_buffer_t));
+    free(text);
+    free(ids);
+    return 0;
+}
+
 int main(int argc, char *argv[]) {
     print_banner();
 
@@ -30,16 +500,84 @@ int main(int argc, char *argv[]) {
         printf("Options:\n");
         printf("  --bench    Enable high-precision timing\n");
         printf("  --audit    Show memory mapping statistics\n");
+        printf("  --tokenize <file>  Tokenize a text file and report MB/s\n");
+        printf("  --tok-cache <MB>   Token cache size for --tokenize (0 disables, default 8)\n");
+        printf("  --tok-evict <lru|clock>  Token cache eviction policy\n");
+        printf("  --threads <N>      Worker threads (default: online CPUs, 1 = serial)\n");
+        printf("  --pin              Pin worker threads to CPUs\n");
+        printf("  --prefault <none|populate|parallel>  Fault the model in at load time\n");
+        printf("  --advice <none|auto|seq|random>      madvise access pattern per tensor kind\n");
+        printf("  --hugepages        2MB-align the mapping and request huge pages for tensors\n");
+        printf("  --mlock <MB|all>   Lock hot metadata and tensors in RAM up to a budget\n");
+        printf("  --prefetch <N>     Page in weights N ops ahead of the tape (0 = off)\n");
+        printf("  --prefetch-touch   Prefetch by touching pages instead of MADV_WILLNEED\n");
+        printf("  --sessions <N>     Run N concurrent sessions over one shared mapping\n");
+        printf("  --batch <N>        With --sessions, coalesce requests into batches of up to N\n");
+        printf("  --batch-us <us>    Latency budget a request waits for its batch (default 200)\n");
+        printf("  --input <file>     Raw input tensor for the model tape (default zeros)\n");
+        printf("  --iters <N>        Run the tape N times (default 1)\n");
+        printf("  --sched            Run independent ops concurrently via the level scheduler\n");
+        printf("  --profile          Per-op time, GFLOP/s, GB/s and perf counters for the tape\n");
+        printf("  --trace <file>     Write a Chrome trace_event JSON of every op run (implies --profile)\n");
         return EXIT_FAILURE;
     }
 
     const char *model_path = argv[1];
+    const char *tokenize_path = NULL;
+    double tok_cache_mb = 8.0;
+    nodal_evict_policy_t tok_evict = NODAL_EVICT_LRU;
+    const char *input_path = NULL;
+    uint32_t iters = 1;
+    int use_sched = 0;
+    uint32_t prefetch = 0;
+    uint32_t num_sessions = 0;
+    uint32_t max_batch = 0;
+    uint32_t batch_us = 200;
+    nodal_prefetch_mode_t prefetch_mode = NODAL_PREFETCH_WILLNEED;
+    uint32_t num_threads = 0;
+    int pin_threads = 0;
     int run_bench = 0;
     int run_audit = 0;
+    int run_profile = 0;
+    const char *trace_path = NULL;
+    nodal_load_opts_t load_opts = {0};
 
     for (int i = 2; i < argc; i++) {
         if (strcmp(argv[i], "--bench") == 0) run_bench = 1;
         if (strcmp(argv[i], "--audit") == 0) run_audit = 1;
+        if (strcmp(argv[i], "--tokenize") == 0 && i + 1 < argc) tokenize_path = argv[++i];
+        if (strcmp(argv[i], "--tok-cache") == 0 && i + 1 < argc) tok_cache_mb = atof(argv[++i]);
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) num_threads = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--pin") == 0) pin_threads = 1;
+        if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) input_path = argv[++i];
+        if (strcmp(argv[i], "--iters") == 0 && i + 1 < argc) iters = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--sched") == 0) use_sched = 1;
+        if (strcmp(argv[i], "--profile") == 0) run_profile = 1;
+        if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc) trace_path = argv[++i];
+        if (strcmp(argv[i], "--hugepages") == 0) load_opts.hugepages = 1;
+        if (strcmp(argv[i], "--prefetch") == 0 && i + 1 < argc) prefetch = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--sessions") == 0 && i + 1 < argc) num_sessions = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--batch") == 0 && i + 1 < argc) max_batch = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--batch-us") == 0 && i + 1 < argc) batch_us = (uint32_t)atoi(argv[++i]);
+        if (strcmp(argv[i], "--prefetch-touch") == 0) prefetch_mode = NODAL_PREFETCH_TOUCH;
+        if (strcmp(argv[i], "--prefault") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            load_opts.prefault = (strcmp(m, "populate") == 0) ? NODAL_PREFAULT_POPULATE
+                               : (strcmp(m, "parallel") == 0) ? NODAL_PREFAULT_PARALLEL : NODAL_PREFAULT_NONE;
+        }
+        if (strcmp(argv[i], "--advice") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            load_opts.advice = (strcmp(m, "auto") == 0) ? NODAL_ADVICE_AUTO
+                             : (strcmp(m, "seq") == 0) ? NODAL_ADVICE_SEQUENTIAL
+                             : (strcmp(m, "random") == 0) ? NODAL_ADVICE_RANDOM : NODAL_ADVICE_NONE;
+        }
+        if (strcmp(argv[i], "--mlock") == 0 && i + 1 < argc) {
+            const char *m = argv[++i];
+            load_opts.mlock_bytes = (strcmp(m, "all") == 0) ? (size_t)-1 : (size_t)(atof(m) * 1024 * 1024);
+        }
+        if (strcmp(argv[i], "--tok-evict") == 0 && i + 1 < argc) {
+            tok_evict = (strcmp(argv[++i], "clock") == 0) ? NODAL_EVICT_CLOCK : NODAL_EVICT_LRU;
+        }
     }
 
     struct stat st;
@@ -56,43 +594,86 @@ int main(int argc, char *argv[]) {
         printf("[AUDIT] Physical RAM Overhead: <1 MB (Static Table)\n");
     }
 
-    // 2. Initialize Runtime Table (Support up to 1024 tensors)
-    nodal_buffer_t *tensor_runtime = (nodal_buffer_t *)calloc(1024, sizeof(nodal_buffer_t));
+    // 2. Worker pool, created once and shared by every kernel
+    if (nodal_set_num_threads(num_threads, pin_threads) != 0) {
+        fprintf(stderr, "[ERROR] Failed to start worker pool.\n");
+        return EXIT_FAILURE;
+    }
+    printf("[POOL] %u thread(s)%s\n", nodal_get_num_threads(), pin_threads ? ", pinned" : "");
+
+    // 3. Initialize Runtime Table (Support up to 1024 tensors)
+    nodal_buffer_t *tensor_runtime = (nodal_buffer_t *)calloc(NR_MAX_TENSORS, sizeof(nodal_buffer_t));
     if (!tensor_runtime) {
         fprintf(stderr, "[ERROR] Failed to allocate tensor table.\n");
         return EXIT_FAILURE;
     }
 
-    // 3. Load Model via mmap
+    // 4. Load Model via mmap
     printf("[LOAD] Mapping %s into memory address space...\n", model_path);
-    void *base = nodal_load_model_mapped(model_path, tensor_runtime, 1024);
+    nodal_model_t *model = nodal_model_open(model_path, &load_opts);
 
-    if (!base) {
+    if (!model) {
         fprintf(stderr, "[ERROR] Model mapping failed.\n");
         free(tensor_runtime);
         return EXIT_FAILURE;
     }
+    memcpy(tensor_runtime, nodal_model_bindings(model), NR_MAX_TENSORS * sizeof(nodal_buffer_t));
+    const nodal_load_stats_t load_stats = *nodal_model_load_stats(model);
+    printf("[LOAD] Ready in %.3f ms: %llu minor / %llu major faults, %.2f MB locked, %.2f MB huge-page advised\n",
+           load_stats.ready_ms, (unsigned long long)load_stats.minor_faults,
+           (unsigned long long)load_stats.major_faults, load_stats.locked_bytes / (1024.0 * 1024.0),
+           load_stats.hugepage_bytes / (1024.0 * 1024.0));
 
-    // 4. Execution Cycle
+    // 5. Execution Cycle
     struct timespec start, end;
+    struct rusage ru_start, ru_end;
     if (run_bench) clock_gettime(CLOCK_MONOTONIC, &start);
+    getrusage(RUSAGE_SELF, &ru_start);
 
-    /* * Simulation: In the production loop, we would call nodal_execute_tape()
-     * here using the IR segment loaded from the .nbbin.
-     */
     printf("[EXEC] Starting inference cycle...\n");
+    if (num_sessions && (run_profile || trace_path)) printf("[PROF] Profiling covers the serial tape; ignored with --sessions\n");
+    if (nodal_model_tape(model)) {
+        int rc = (num_sessions && max_batch) ? run_batched(model, num_sessions, iters ? iters : 1, max_batch, batch_us,
+                                                             input_path)
+               : num_sessions ? run_sessions(model, num_sessions, iters ? iters : 1, input_path)
+                              : run_model(model, tensor_runtime, input_path, iters ? iters : 1, use_sched,
+                                          prefetch, prefetch_mode, run_profile, trace_path);
+        if (rc != 0) {
+            fprintf(stderr, "[ERROR] Tape execution failed.\n");
+            nodal_model_release(model);
+            free(tensor_runtime);
+            return EXIT_FAILURE;
+        }
+    } else {
+        printf("[EXEC] Model has no IR tape; nothing to run.\n");
+    }
 
+    getrusage(RUSAGE_SELF, &ru_end);
     if (run_bench) {
         clock_gettime(CLOCK_MONOTONIC, &end);
         double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
-        printf("[DONE] Inference completed in %.6f seconds.\n", elapsed);
+        printf("[DONE] Inference completed in %.6f seconds (%ld minor / %ld major faults).\n", elapsed,
+               ru_end.ru_minflt - ru_start.ru_minflt, ru_end.ru_majflt - ru_start.ru_majflt);
     } else {
         printf("[DONE] Inference completed.\n");
     }
 
-    // 5. Cleanup
-    // In production, munmap(base, st.st_size) would go here.
+    if (tokenize_path) {
+        nodal_tokcache_t *cache = NULL;
+        if (tok_cache_mb > 0) cache = nodal_tokcache_create((size_t)(tok_cache_mb * 1024 * 1024), tok_evict);
+        int rc = run_tokenize(tokenize_path, tensor_runtime, cache);
+        nodal_tokcache_destroy(cache);
+        if (rc != 0) {
+            nodal_model_release(model);
+            free(tensor_runtime);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // 6. Cleanup
+    nodal_model_release(model);
     free(tensor_runtime);
+    nodal_set_num_threads(1, 0);
     printf("[DONE] Memory Cleaned (Arena wiped).\n");
 
     return EXIT_SUCCESS;
@@ -0,0 +1,77 @@
+/*
+ * cpu_features.c - Runtime CPU Feature Detection for Kernel Dispatch
+ * Kernels compile every ISA variant with function-level target attributes
+ * and pick one here, so a single generic binary runs at full speed.
+ */
+
+#include "nodal.h"
+
+static int g_isa_detected = -1;
+static nodal_isa_t g_isa_limit = NODAL_ISA_AVX512;
+
+static nodal_isa_t detect_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl")) {
+        return NODAL_ISA_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+        return NODAL_ISA_AVX2;
+    }
+#endif
+    return NODAL_ISA_GENERIC;
+}
+
+/**
+ * nodal_cpu_isa
+ * The best ISA level this CPU supports, capped by nodal_cpu_set_isa_limit.
+ */
+nodal_isa_t nodal_cpu_isa(void) {
+    if (g_isa_detected < 0) g_isa_detected = (int)detect_isa();
+    nodal_isa_t isa = (nodal_isa_t)g_isa_detected;
+    return (isa < g_isa_limit) ? isa : g_isa_limit;
+}
+
+/**
+ * nodal_cpu_set_isa_limit
+ * Caps kernel dispatch (e.g. to validate the AVX2 path on an AVX-512 host).
+ */
+void nodal_cpu_set_isa_limit(nodal_isa_t limit) {
+    g_isa_limit = limit;
+}
+
+/**
+ * nodal_cpu_has_vnni
+ * AVX-512 VNNI (vpdpbusd) for int8 dot products; only reported while
+ * dispatch is allowed to use AVX-512.
+ */
+int nodal_cpu_has_vnni(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    static int vnni = -1;
+    if (vnni < 0) {
+        __builtin_cpu_init();
+        vnni = __builtin_cpu_supports("avx512vnni") ? 1 : 0;
+    }
+    return vnni && nodal_cpu_isa() == NODAL_ISA_AVX512;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * nodal_cpu_has_f16c
+ * F16C (vcvtph2ps / vcvtps2ph); implied by the AVX-512 level.
+ */
+int nodal_cpu_has_f16c(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    static int f16c = -1;
+    if (f16c < 0) {
+        __builtin_cpu_init();
+        f16c = __builtin_cpu_supports("f16c") ? 1 : 0;
+    }
+    return f16c && nodal_cpu_isa() != NODAL_ISA_GENERIC;
+#else
+    return 0;
+#endif
+}
@@ -4,14 +4,103 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "nodal.h"
 
 /* Kernel Forward Declarations */
-extern void nodal_kernel_matmul_generic(const nodal_call_t *call);
-extern void nodal_kernel_softmax_generic(const nodal_call_t *call);
-extern void nodal_kernel_add_generic(const nodal_call_t *call);
+extern void nodal_kernel_matmul_f32(const nodal_call_t *call);
+extern void nodal_kernel_matmul_qnf4(const nodal_call_t *call);
+extern void nodal_kernel_matmul_q8_0(const nodal_call_t *call);
+extern void nodal_kernel_softmax_f32(const nodal_call_t *call);
+extern void nodal_kernel_add_f32(const nodal_call_t *call);
+extern void nodal_kernel_add_softmax_f32(const nodal_call_t *call);
+extern void nodal_kernel_attention_f32(const nodal_call_t *call);
+extern void nodal_kernel_cast(const nodal_call_t *call);
+extern void nodal_kernel_rmsnorm_f32(const nodal_call_t *call);
+extern void nodal_kernel_layernorm_f32(const nodal_call_t *call);
+extern void nodal_kernel_silu_f32(const nodal_call_t *call);
+extern void nodal_kernel_gelu_f32(const nodal_call_t *call);
+extern void nodal_kernel_rope_f32(const nodal_call_t *call);
+extern void nodal_kernel_embed_gather(const nodal_call_t *call);
+extern void nodal_kernel_sample(const nodal_call_t *call);
 extern void nodal_kernel_tokenize_bpe(const nodal_call_t *call);
+extern void nodal_kernel_tokenize_bpe_parallel(const nodal_call_t *call);
+extern void nodal_prefetch_advance(nodal_prefetch_t *pf, uint32_t i);
+extern void nodal_profiler_begin(nodal_profiler_t *p);
+extern void nodal_profiler_end(nodal_profiler_t *p, uint32_t i);
+
+/* Op kind -> kernel; NULL entries are unknown kinds */
+static const nodal_kernel_fn NODAL_KERNELS[] = {
+    [OP_MATMUL] = nodal_kernel_matmul_f32,
+    [OP_MATMUL_QNF4] = nodal_kernel_matmul_qnf4,
+    [OP_SOFTMAX] = nodal_kernel_softmax_f32,
+    [OP_ADD] = nodal_kernel_add_f32,
+    [OP_TOKENIZE_BPE] = nodal_kernel_tokenize_bpe,
+    [OP_TOKENIZE_BPE_PARALLEL] = nodal_kernel_tokenize_bpe_parallel,
+    [OP_MATMUL_ADD] = nodal_kernel_matmul_f32,
+    [OP_MATMUL_QNF4_ADD] = nodal_kernel_matmul_qnf4,
+    [OP_ADD_SOFTMAX] = nodal_kernel_add_softmax_f32,
+    [OP_ATTENTION] = nodal_kernel_attention_f32,
+    [OP_MATMUL_Q8_0] = nodal_kernel_matmul_q8_0,
+    [OP_MATMUL_Q8_0_ADD] = nodal_kernel_matmul_q8_0,
+    [OP_CAST] = nodal_kernel_cast,
+    [OP_RMSNORM] = nodal_kernel_rmsnorm_f32,
+    [OP_LAYERNORM] = nodal_kernel_layernorm_f32,
+    [OP_SILU] = nodal_kernel_silu_f32,
+    [OP_GELU] = nodal_kernel_gelu_f32,
+    [OP_ROPE] = nodal_kernel_rope_f32,
+    [OP_EMBED_GATHER] = nodal_kernel_embed_gather,
+    [OP_SAMPLE] = nodal_kernel_sample,
+};
+
+#define NODAL_NUM_KINDS (sizeof(NODAL_KERNELS) / sizeof(NODAL_KERNELS[0]))
+
+struct nodal_tape {
+    uint32_t num_ops;
+    struct nodal_tape_rec {
+        nodal_kernel_fn fn;
+        nodal_call_t call;
+    } *recs;
+};
+
+nodal_kernel_fn nodal_kernel_lookup(nodal_op_kind_t kind) {
+    return ((uint32_t)kind < NODAL_NUM_KINDS) ? NODAL_KERNELS[kind] : NULL;
+}
+
+/* Builds the call for one op; only the operands it declares are bound */
+static void bind_call(const nodal_irop_t *op, const nodal_buffer_t *tensor_runtime, nodal_call_t *call) {
+    memset(call, 0, sizeof(*call));
+
+    // 1. Map IR indices to physical memory pointers
+    // Unused slots stay NULL so kernels can detect optional operands.
+    for (uint32_t j = 0; j < op->num_inputs && j < 8; j++) {
+        call->inputs[j] = tensor_runtime[op->inputs[j]];
+    }
+
+    for (uint32_t j = 0; j < op->num_outputs && j < 4; j++) {
+        call->outputs[j] = tensor_runtime[op->outputs[j]];
+    }
+
+    // 2. Copy scalars (parameters like M, N, K)
+    memcpy(call->scalars, op->scalars, sizeof(nodal_scalar_t) * 8);
+}
+
+/**
+ * nodal_dispatch_op
+ * Binds one IROp's operands to physical memory and runs its kernel.
+ */
+void nodal_dispatch_op(const nodal_irop_t *op, const nodal_buffer_t *tensor_runtime) {
+    nodal_kernel_fn fn = nodal_kernel_lookup(op->kind);
+    if (!fn) {
+        fprintf(stderr, "[EXEC] Unknown OP Code: %d\n", op->kind);
+        return;
+    }
+
+    nodal_call_t call;
+    bind_call(op, tensor_runtime, &call);
+    fn(&call);
+}
 
 /**
  * nodal_execute_tape
@@ -19,42 +108,86 @@ extern void nodal_kernel_tokenize_bpe(const nodal_call_t *call);
  */
 void nodal_execute_tape(const nodal_irop_t *ops, size_t op_count, const nodal_buffer_t *tensor_runtime) {
     for (size_t i = 0; i < op_count; i++) {
-        const nodal_irop_t *op = &ops[i];
-        nodal_call_t call;
+        nodal_dispatch_op(&ops[i], tensor_runtime);
+    }
+}
 
-        // 1. Map IR indices to physical memory pointers
-        for (uint32_t j = 0; j < 8; j++) {
-            if (j < 8) { // Safety check for fixed array size
-                uint32_t in_idx = op->inputs[j];
-                call.inputs[j] = tensor_runtime[in_idx];
-            }
-        }
+/**
+ * nodal_tape_resolve
+ * Pre-binds a tape against the runtime table: every op is checked once
+ * (known kind, operand counts, slots below num_slots) and turned into a
+ * (kernel, call) record. The records capture buffer pointers, so resolve
+ * again after rebinding any runtime entry. Returns NULL on invalid ops.
+ */
+nodal_tape_t *nodal_tape_resolve(const nodal_irop_t *ops, size_t op_count,
+                                 const nodal_buffer_t *tensor_runtime, uint32_t num_slots) {
+    nodal_tape_t *tape = (nodal_tape_t *)calloc(1, sizeof(nodal_tape_t));
+    if (!tape) return NULL;
+    tape->recs = (struct nodal_tape_rec *)malloc((op_count + 1) * sizeof(struct nodal_tape_rec));
+    if (!tape->recs) {
+        free(tape);
+        return NULL;
+    }
+    tape->num_ops = (uint32_t)op_count;
 
-        for (uint32_t j = 0; j < 4; j++) {
-            uint32_t out_idx = op->outputs[j];
-            call.outputs[j] = tensor_runtime[out_idx];
+    for (size_t i = 0; i < op_count; i++) {
+        const nodal_irop_t *op = &ops[i];
+        int ok = nodal_kernel_lookup(op->kind) && op->num_inputs <= 8 && op->num_outputs <= 4;
+        for (uint32_t j = 0; ok && j < op->num_inputs; j++) ok = op->inputs[j] < num_slots;
+        for (uint32_t j = 0; ok && j < op->num_outputs; j++) ok = op->outputs[j] < num_slots;
+        if (!ok) {
+            fprintf(stderr, "[EXEC] Invalid op %zu (kind %d) in tape\n", i, op->kind);
+            free(tape->recs);
+            free(tape);
+            return NULL;
         }
+        tape->recs[i].fn = nodal_kernel_lookup(op->kind);
+        bind_call(op, tensor_runtime, &tape->recs[i].call);
+    }
+    return tape;
+}
 
-        // 2. Copy scalars (parameters like M, N, K)
-        memcpy(call.scalars, op->scalars, sizeof(nodal_scalar_t) * 8);
-
-        // 3. Dispatch to the appropriate kernel
-        switch (op->kind) {
-            case OP_MATMUL:
-                nodal_kernel_matmul_generic(&call);
-                break;
-            case OP_SOFTMAX:
-                nodal_kernel_softmax_generic(&call);
-                break;
-            case OP_ADD:
-                nodal_kernel_add_generic(&call);
-                break;
-            case OP_TOKENIZE_BPE:
-                nodal_kernel_tokenize_bpe(&call);
-                break;
-            default:
-                fprintf(stderr, "[EXEC] Unknown OP Code: %d\n", op->kind);
-                break;
-        }
+/**
+ * nodal_tape_run
+ * The hot loop: no decoding, no switch, one indirect call per op.
+ */
+void nodal_tape_run(const nodal_tape_t *tape) {
+    const struct nodal_tape_rec *rec = tape->recs;
+    const struct nodal_tape_rec *end = rec + tape->num_ops;
+    for (; rec < end; rec++) rec->fn(&rec->call);
+}
+
+/**
+ * nodal_tape_run_prefetched
+ * nodal_tape_run with the prefetch window advanced before every op.
+ */
+void nodal_tape_run_prefetched(const nodal_tape_t *tape, nodal_prefetch_t *pf) {
+    for (uint32_t i = 0; i < tape->num_ops; i++) {
+        nodal_prefetch_advance(pf, i);
+        tape->recs[i].fn(&tape->recs[i].call);
     }
 }
+
+/**
+ * nodal_tape_run_profiled
+ * Separate runner so the hooks cost nothing when profiling is off:
+ * callers pick this one instead of nodal_tape_run. pf may be NULL.
+ */
+void nodal_tape_run_profiled(const nodal_tape_t *tape, nodal_prefetch_t *pf, nodal_profiler_t *prof) {
+    for (uint32_t i = 0; i < tape->num_ops; i++) {
+        if (pf) nodal_prefetch_advance(pf, i);
+        nodal_profiler_begin(prof);
+        tape->recs[i].fn(&tape->recs[i].call);
+        nodal_profiler_end(prof, i);
+    }
+}
+
+uint32_t nodal_tape_num_ops(const nodal_tape_t *tape) {
+    return tape->num_ops;
+}
+
+void nodal_tape_destroy(nodal_tape_t *tape) {
+    if (!tape) return;
+    free(tape->recs);
+    free(tape);
+}
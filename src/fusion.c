@@ -0,0 +1,147 @@
+/*
+ * fusion.c - Operator Fusion Pass for Nodal
+ * Rewrites producer/consumer pairs on the IR tape into fused ops whose
+ * kernels apply the consumer as an epilogue, so the intermediate tensor
+ * never makes a round trip through memory:
+ *   MATMUL      + ADD      -> MATMUL_ADD       (bias / residual)
+ *   MATMUL_QNF4 + ADD      -> MATMUL_QNF4_ADD
+ *   MATMUL_Q8_0 + ADD      -> MATMUL_Q8_0_ADD
+ *   ADD         + SOFTMAX  -> ADD_SOFTMAX
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "nodal.h"
+
+static uint32_t op_reads(const nodal_irop_t *op, uint32_t t) {
+    uint32_t n = 0;
+    for (uint32_t j = 0; j < op->num_inputs && j < 8; j++) n += (op->inputs[j] == t);
+    return n;
+}
+
+static int op_writes(const nodal_irop_t *op, uint32_t t) {
+    for (uint32_t j = 0; j < op->num_outputs && j < 4; j++) {
+        if (op->outputs[j] == t) return 1;
+    }
+    return 0;
+}
+
+/* Elements a producer writes, for matching against the consumer's size */
+static uint64_t producer_elems(const nodal_irop_t *op) {
+    if (op->kind == OP_MATMUL || op->kind == OP_MATMUL_QNF4 || op->kind == OP_MATMUL_Q8_0) {
+        return (uint64_t)op->scalars[0].v.u32 * op->scalars[1].v.u32;
+    }
+    return op->scalars[0].v.u32;
+}
+
+/**
+ * fuse_pair
+ * Builds the fused op for producer p feeding consumer c through tensor t.
+ * Returns 0 if the pair has no fused form.
+ */
+static int fuse_pair(const nodal_irop_t *p, const nodal_irop_t *c, uint32_t t, nodal_irop_t *out) {
+    uint32_t other = (c->inputs[0] == t) ? c->inputs[1] : c->inputs[0];
+    uint32_t dst = c->outputs[0];
+
+    uint64_t consumed = c->scalars[0].v.u32;
+    if (c->kind == OP_SOFTMAX && c->scalars[1].v.u32) consumed *= c->scalars[1].v.u32;
+    if (c->num_outputs != 1 || producer_elems(p) != consumed) return 0;
+
+    if ((p->kind == OP_MATMUL || p->kind == OP_MATMUL_QNF4 || p->kind == OP_MATMUL_Q8_0) && c->kind == OP_ADD) {
+        // The epilogue writes C tile by tile, so C must not alias a matmul operand
+        for (uint32_t j = 0; j < p->num_inputs; j++) {
+            if (p->inputs[j] == dst) return 0;
+        }
+        *out = *p;
+        out->kind = (p->kind == OP_MATMUL) ? OP_MATMUL_ADD
+                  : (p->kind == OP_MATMUL_QNF4) ? OP_MATMUL_QNF4_ADD : OP_MATMUL_Q8_0_ADD;
+        out->num_inputs = (p->kind == OP_MATMUL) ? 3 : 4;
+        out->inputs[out->num_inputs - 1] = other;
+        out->outputs[0] = dst;
+        return 1;
+    }
+
+    if (p->kind == OP_ADD && c->kind == OP_SOFTMAX) {
+        *out = *p;
+        out->kind = OP_ADD_SOFTMAX;
+        out->outputs[0] = dst;
+        memcpy(out->scalars, c->scalars, sizeof(out->scalars)); // Rows, temperature, mask
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * nodal_fuse_tape
+ * Fuses in place and compacts the tape; *op_count is updated and the
+ * number of fusions returned. A pair fuses only when the intermediate has
+ * exactly one reader, is not bound in tensor_runtime (NULL = nothing is
+ * bound, all intermediates are private), and no op between producer and
+ * consumer writes the intermediate or any producer input, since the
+ * fused op runs at the consumer's position.
+ */
+uint32_t nodal_fuse_tape(nodal_irop_t *ops, size_t *op_count, const nodal_buffer_t *tensor_runtime) {
+    size_t n = *op_count;
+    uint32_t num_tensors = 0, fused = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < ops[i].num_inputs && j < 8; j++) {
+            if (ops[i].inputs[j] >= num_tensors) num_tensors = ops[i].inputs[j] + 1;
+        }
+        for (uint32_t j = 0; j < ops[i].num_outputs && j < 4; j++) {
+            if (ops[i].outputs[j] >= num_tensors) num_tensors = ops[i].outputs[j] + 1;
+        }
+    }
+
+    // 1. Reader counts; fusion moves reads between ops but never adds any
+    uint32_t *readers = (uint32_t *)calloc(num_tensors + 1, sizeof(uint32_t));
+    uint8_t *dead = (uint8_t *)calloc(n + 1, 1);
+    if (!readers || !dead) {
+        free(readers);
+        free(dead);
+        return 0;
+    }
+    for (size_t i = 0; i < n; i++) {
+        for (uint32_t j = 0; j < ops[i].num_inputs && j < 8; j++) readers[ops[i].inputs[j]]++;
+    }
+
+    // 2. Match producer -> first later reader of its output
+    for (size_t i = 0; i < n; i++) {
+        nodal_irop_t *p = &ops[i];
+        if (p->kind != OP_MATMUL && p->kind != OP_MATMUL_QNF4 && p->kind != OP_MATMUL_Q8_0 && p->kind != OP_ADD) continue;
+        if (p->num_outputs != 1) continue;
+
+        uint32_t t = p->outputs[0];
+        if (readers[t] != 1 || (tensor_runtime && tensor_runtime[t].ptr)) continue;
+
+        size_t c_idx = n;
+        int blocked = 0;
+        for (size_t k = i + 1; k < n && !blocked; k++) {
+            if (dead[k]) continue;
+            if (op_reads(&ops[k], t)) {
+                c_idx = k;
+                break;
+            }
+            blocked |= op_writes(&ops[k], t);
+            for (uint32_t j = 0; j < p->num_inputs && j < 8; j++) blocked |= op_writes(&ops[k], p->inputs[j]);
+        }
+        if (blocked || c_idx == n || op_reads(&ops[c_idx], t) != 1) continue;
+
+        nodal_irop_t merged;
+        if (!fuse_pair(p, &ops[c_idx], t, &merged)) continue;
+        ops[c_idx] = merged;
+        dead[i] = 1;
+        readers[t] = 0;
+        fused++;
+    }
+
+    // 3. Compact, keeping tape order
+    size_t live = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (!dead[i]) ops[live++] = ops[i];
+    }
+    *op_count = live;
+    free(readers);
+    free(dead);
+    return fused;
+}
@@ -0,0 +1,190 @@
+/*
+ * activation.c - SiLU / GELU with an Optional Fused Gate
+ * Both are x * sigmoid(z): z = x for SiLU and
+ * z = 2 sqrt(2/pi) (x + 0.044715 x^3) for the tanh form of GELU. When the
+ * gate operand is bound the product with it (SwiGLU / GeGLU) happens in
+ * the same pass, so the activated gate projection never round-trips
+ * through memory. sigmoid uses the shared Cephes exp from nodal.h, with
+ * AVX-512 and AVX2/FMA versions and a scalar fallback; the element range
+ * is split over the worker pool.
+ */
+
+#include "../nodal.h"
+#include <stdint.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+#define ACT_GRAIN (1u << 14) // Elements per task
+
+#define GELU_K0 1.5957691216057308f  // 2 sqrt(2/pi)
+#define GELU_K1 0.044715f
+
+/* out[i] = act(a[i]) (* b[i] when b is set) over n elements */
+typedef void (*act_fn)(const float *a, const float *b, float *out, uint32_t n);
+
+typedef struct {
+    act_fn silu;
+    act_fn gelu;
+} act_isa_t;
+
+/* --- Scalar --- */
+
+static void silu_scalar(const float *a, const float *b, float *out, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        float v = a[i] / (1.0f + nodal_exp_scalar(-a[i]));
+        out[i] = b ? v * b[i] : v;
+    }
+}
+
+static void gelu_scalar(const float *a, const float *b, float *out, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        float x = a[i];
+        float v = x / (1.0f + nodal_exp_scalar(-GELU_K0 * (x + GELU_K1 * x * x * x)));
+        out[i] = b ? v * b[i] : v;
+    }
+}
+
+static const act_isa_t ACT_SCALAR = { silu_scalar, gelu_scalar };
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* --- AVX-512 --- */
+
+/* x / (1 + e^-z), then the gate */
+__attribute__((target("avx512f")))
+static inline void act_store_avx512(const float *b, float *out, uint32_t i, __m512 x, __m512 z) {
+    __m512 e = nodal_exp_avx512(_mm512_sub_ps(_mm512_setzero_ps(), z));
+    __m512 v = _mm512_div_ps(x, _mm512_add_ps(_mm512_set1_ps(1.0f), e));
+    if (b) v = _mm512_mul_ps(v, _mm512_loadu_ps(b + i));
+    _mm512_storeu_ps(out + i, v);
+}
+
+__attribute__((target("avx512f")))
+static void silu_avx512(const float *a, const float *b, float *out, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(a + i);
+        act_store_avx512(b, out, i, x, x);
+    }
+    silu_scalar(a + i, b ? b + i : NULL, out + i, n - i);
+}
+
+__attribute__((target("avx512f")))
+static void gelu_avx512(const float *a, const float *b, float *out, uint32_t n) {
+    const __m512 k0 = _mm512_set1_ps(GELU_K0), k1 = _mm512_set1_ps(GELU_K1);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = _mm512_loadu_ps(a + i);
+        __m512 z = _mm512_mul_ps(_mm512_mul_ps(k0, x), _mm512_fmadd_ps(_mm512_mul_ps(k1, x), x, _mm512_set1_ps(1.0f)));
+        act_store_avx512(b, out, i, x, z);
+    }
+    gelu_scalar(a + i, b ? b + i : NULL, out + i, n - i);
+}
+
+static const act_isa_t ACT_AVX512 = { silu_avx512, gelu_avx512 };
+
+/* --- AVX2 --- */
+
+__attribute__((target("avx2,fma")))
+static inline void act_store_avx2(const float *b, float *out, uint32_t i, __m256 x, __m256 z) {
+    __m256 e = nodal_exp_avx2(_mm256_sub_ps(_mm256_setzero_ps(), z));
+    __m256 v = _mm256_div_ps(x, _mm256_add_ps(_mm256_set1_ps(1.0f), e));
+    if (b) v = _mm256_mul_ps(v, _mm256_loadu_ps(b + i));
+    _mm256_storeu_ps(out + i, v);
+}
+
+__attribute__((target("avx2,fma")))
+static void silu_avx2(const float *a, const float *b, float *out, uint32_t n) {
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(a + i);
+        act_store_avx2(b, out, i, x, x);
+    }
+    silu_scalar(a + i, b ? b + i : NULL, out + i, n - i);
+}
+
+__attribute__((target("avx2,fma")))
+static void gelu_avx2(const float *a, const float *b, float *out, uint32_t n) {
+    const __m256 k0 = _mm256_set1_ps(GELU_K0), k1 = _mm256_set1_ps(GELU_K1);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(a + i);
+        __m256 z = _mm256_mul_ps(_mm256_mul_ps(k0, x), _mm256_fmadd_ps(_mm256_mul_ps(k1, x), x, _mm256_set1_ps(1.0f)));
+        act_store_avx2(b, out, i, x, z);
+    }
+    gelu_scalar(a + i, b ? b + i : NULL, out + i, n - i);
+}
+
+static const act_isa_t ACT_AVX2 = { silu_avx2, gelu_avx2 };
+#endif
+
+static const act_isa_t *act_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return &ACT_AVX512;
+    if (isa == NODAL_ISA_AVX2) return &ACT_AVX2;
+#endif
+    return &ACT_SCALAR;
+}
+
+/* --- Scheduling --- */
+
+typedef struct {
+    act_fn fn;
+    const float *a, *b;
+    float *out;
+    uint32_t n;
+    uint32_t chunk;                // Elements per task
+} act_job_t;
+
+static void act_task(void *ctx, uint32_t task) {
+    const act_job_t *job = (const act_job_t *)ctx;
+    uint32_t i = task * job->chunk;
+    uint32_t len = (job->n - i < job->chunk) ? job->n - i : job->chunk;
+    job->fn(job->a + i, job->b ? job->b + i : NULL, job->out + i, len);
+}
+
+static void act_call(const nodal_call_t *call, int gelu) {
+    act_job_t job;
+    job.fn = gelu ? act_isa()->gelu : act_isa()->silu;
+    job.a = (const float *)call->inputs[0].ptr;
+    job.b = (const float *)call->inputs[1].ptr;
+    job.out = (float *)call->outputs[0].ptr;
+    job.n = call->scalars[0].v.u32;
+    if (job.n == 0) return;
+
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, job.n, ACT_GRAIN);
+    job.chunk = (((job.n + tasks - 1) / tasks) + 15) & ~15u;
+    nodal_pool_run(pool, act_task, &job, (job.n + job.chunk - 1) / job.chunk);
+}
+
+/**
+ * OP_SILU (Vectorized, Threaded F32)
+ * out = silu(A) (* B); see nodal_kernel_silu_generic for the contract.
+ */
+void nodal_kernel_silu_f32(const nodal_call_t *call) {
+    act_call(call, 0);
+}
+
+/**
+ * OP_GELU (Vectorized, Threaded F32)
+ * out = gelu(A) (* B), tanh approximation; see
+ * nodal_kernel_gelu_generic for the contract.
+ */
+void nodal_kernel_gelu_f32(const nodal_call_t *call) {
+    act_call(call, 1);
+}
+
+/**
+ * nodal_activation_splits
+ * Whether OP_SILU / OP_GELU with these scalars is more than one task's
+ * worth of elements.
+ */
+int nodal_activation_splits(const nodal_scalar_t *s) {
+    return s[0].v.u32 > ACT_GRAIN;
+}
@@ -0,0 +1,128 @@
+/*
+ * attention.c - Causal Attention over the Paged KV Cache
+ * Each run appends the new tokens' K/V to the sequence and attends over
+ * the whole cached context block by block with an online softmax, so a
+ * decode step costs O(context) and never recomputes the prefix.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+extern nodal_pool_t *nodal_pool_default(void);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern long nodal_kv_seq_append(nodal_kv_seq_t *seq, uint32_t layer, const float *k, const float *v, uint32_t n,
+                                uint32_t num_kv_heads, uint32_t head_dim);
+extern uint32_t nodal_kv_seq_block_tokens(const nodal_kv_seq_t *seq);
+extern const float *nodal_kv_seq_block(const nodal_kv_seq_t *seq, uint32_t layer, uint32_t b);
+
+#define ATTN_MAX_HEAD_DIM     256  // Matches the cache's limits
+#define ATTN_MAX_BLOCK_TOKENS 256
+
+typedef struct {
+    const float *q;
+    float *out;
+    const nodal_kv_seq_t *seq;
+    uint32_t num_heads;
+    uint32_t num_kv_heads;
+    uint32_t head_dim;
+    uint32_t layer;
+    uint32_t pos0;                 // Position of the first new token
+    float scale;
+} attn_job_t;
+
+/* One (token, head): softmax(q K^T * scale) V over positions [0, pos] */
+static void attn_task(void *ctx, uint32_t task) {
+    const attn_job_t *job = (const attn_job_t *)ctx;
+    const uint32_t t = task / job->num_heads, h = task % job->num_heads;
+    const uint32_t g = h / (job->num_heads / job->num_kv_heads);
+    const uint32_t dh = job->head_dim, bt = nodal_kv_seq_block_tokens(job->seq);
+    const uint32_t ctx_len = job->pos0 + t + 1;
+    const float *q = job->q + ((size_t)t * job->num_heads + h) * dh;
+
+    float acc[ATTN_MAX_HEAD_DIM] = {0};
+    float scores[ATTN_MAX_BLOCK_TOKENS];
+    float m = -INFINITY, l = 0.0f;
+
+    for (uint32_t b = 0; b * bt < ctx_len; b++) {
+        const float *K = nodal_kv_seq_block(job->seq, job->layer, b) + (size_t)g * bt * dh;
+        const float *V = K + (size_t)job->num_kv_heads * bt * dh;
+        uint32_t n = (ctx_len - b * bt < bt) ? ctx_len - b * bt : bt;
+
+        // 1. Scores for this block and the running max
+        float bm = -INFINITY;
+        for (uint32_t j = 0; j < n; j++) {
+            float s = 0.0f;
+            for (uint32_t d = 0; d < dh; d++) s += q[d] * K[(size_t)j * dh + d];
+            scores[j] = s * job->scale;
+            if (scores[j] > bm) bm = scores[j];
+        }
+        if (bm > m) {
+            float corr = expf(m - bm);
+            for (uint32_t d = 0; d < dh; d++) acc[d] *= corr;
+            l *= corr;
+            m = bm;
+        }
+
+        // 2. Accumulate V weighted by the rescaled probabilities
+        for (uint32_t j = 0; j < n; j++) {
+            float w = expf(scores[j] - m);
+            l += w;
+            for (uint32_t d = 0; d < dh; d++) acc[d] += w * V[(size_t)j * dh + d];
+        }
+    }
+
+    float *o = job->out + ((size_t)t * job->num_heads + h) * dh;
+    for (uint32_t d = 0; d < dh; d++) o[d] = acc[d] / l;
+}
+
+/**
+ * OP_ATTENTION (F32, causal, grouped-query)
+ * inputs[0]: Q [n, num_heads, head_dim]
+ * inputs[1]: K [n, num_kv_heads, head_dim] for the new tokens
+ * inputs[2]: V [n, num_kv_heads, head_dim]
+ * inputs[3]: nodal_kv_seq_t the new K/V are appended to
+ * outputs[0]: O [n, num_heads, head_dim]
+ * scalars[0]=n, [1]=num_heads, [2]=num_kv_heads, [3]=head_dim,
+ * [4]=layer, [5]=scale (F32, 0 = 1/sqrt(head_dim))
+ */
+void nodal_kernel_attention_f32(const nodal_call_t *call) {
+    attn_job_t job;
+    nodal_kv_seq_t *seq = (nodal_kv_seq_t *)call->inputs[3].ptr;
+    uint32_t n = call->scalars[0].v.u32;
+    job.q = (const float *)call->inputs[0].ptr;
+    job.out = (float *)call->outputs[0].ptr;
+    job.seq = seq;
+    job.num_heads = call->scalars[1].v.u32;
+    job.num_kv_heads = call->scalars[2].v.u32;
+    job.head_dim = call->scalars[3].v.u32;
+    job.layer = call->scalars[4].v.u32;
+    job.scale = (call->scalars[5].kind == NODAL_F32) ? call->scalars[5].v.f32 : 0.0f;
+    if (job.scale == 0.0f && job.head_dim) job.scale = 1.0f / sqrtf((float)job.head_dim);
+    if (n == 0 || job.num_heads == 0) return;
+
+    size_t out_bytes = (size_t)n * job.num_heads * job.head_dim * sizeof(float);
+    if (!seq || job.num_kv_heads == 0 || job.num_heads % job.num_kv_heads != 0) {
+        fprintf(stderr, "[EXEC] OP_ATTENTION needs a KV sequence and num_heads divisible by num_kv_heads\n");
+        memset(job.out, 0, out_bytes);
+        return;
+    }
+
+    long pos0 = nodal_kv_seq_append(seq, job.layer, (const float *)call->inputs[1].ptr,
+                                    (const float *)call->inputs[2].ptr, n, job.num_kv_heads, job.head_dim);
+    if (pos0 < 0) {
+        memset(job.out, 0, out_bytes);
+        return;
+    }
+    job.pos0 = (uint32_t)pos0;
+    nodal_pool_run(nodal_pool_default(), attn_task, &job, n * job.num_heads);
+}
+
+/**
+ * nodal_attention_splits
+ * Whether OP_ATTENTION runs more than one task (one per token and head).
+ */
+int nodal_attention_splits(const nodal_scalar_t *s) {
+    return (uint64_t)s[0].v.u32 * s[1].v.u32 > 1;
+}
@@ -0,0 +1,238 @@
+/*
+ * convert.c - F16 / BF16 <-> F32 Conversion
+ * 16-bit tensors halve storage and memory traffic; kernels widen them to
+ * F32 as they load, so arithmetic and accumulation stay F32. F16 uses
+ * F16C (vcvtph2ps / vcvtps2ph) and BF16 an integer round to nearest
+ * even, with a scalar fallback that rounds the same way. Subnormals are
+ * kept on every path, so the bits never depend on the CPU (vcvtneps2bf16
+ * would flush them).
+ */
+
+#include "../nodal.h"
+#include <string.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern int nodal_cpu_has_f16c(void);
+
+static inline uint32_t f32_bits(float f) {
+    uint32_t u;
+    memcpy(&u, &f, sizeof(u));
+    return u;
+}
+
+static inline float bits_f32(uint32_t u) {
+    float f;
+    memcpy(&f, &u, sizeof(f));
+    return f;
+}
+
+/**
+ * nodal_f16_to_f32
+ * Exact widening of an IEEE half, including subnormals, Inf and NaN.
+ */
+float nodal_f16_to_f32(uint16_t h) {
+    const uint32_t shifted_exp = 0x7C00u << 13;
+    uint32_t u = (uint32_t)(h & 0x7FFF) << 13;
+    uint32_t exp = u & shifted_exp;
+    u += (uint32_t)(127 - 15) << 23;
+    if (exp == shifted_exp) {
+        u += (uint32_t)(128 - 16) << 23;                  // Inf / NaN
+    } else if (exp == 0) {
+        u += 1u << 23;                                    // Zero / subnormal: renormalize
+        u = f32_bits(bits_f32(u) - bits_f32(113u << 23));
+    }
+    return bits_f32(u | (uint32_t)(h & 0x8000) << 16);
+}
+
+/**
+ * nodal_f32_to_f16
+ * Round to nearest even; overflow gives Inf and NaN stays a quiet NaN.
+ */
+uint16_t nodal_f32_to_f16(float f) {
+    uint32_t u = f32_bits(f);
+    uint32_t sign = (u >> 16) & 0x8000;
+    u &= 0x7FFFFFFF;
+
+    if (u >= 0x47800000u) {                              // >= 65536, Inf or NaN
+        return (uint16_t)(sign | (u > 0x7F800000u ? 0x7E00 : 0x7C00));
+    }
+    if (u < (113u << 23)) {                              // Below 2^-14: F16 subnormal
+        // Adding 0.5 aligns the mantissa so the FPU does the rounding
+        return (uint16_t)(sign | (f32_bits(bits_f32(u) + 0.5f) - f32_bits(0.5f)));
+    }
+    uint32_t odd = (u >> 13) & 1;
+    u += ((uint32_t)(15 - 127) << 23) + 0xFFF + odd;
+    return (uint16_t)(sign | (u >> 13));
+}
+
+/**
+ * nodal_bf16_to_f32
+ * BF16 is the upper half of an F32.
+ */
+float nodal_bf16_to_f32(uint16_t h) {
+    return bits_f32((uint32_t)h << 16);
+}
+
+/**
+ * nodal_f32_to_bf16
+ * Round to nearest even; NaN stays a quiet NaN.
+ */
+uint16_t nodal_f32_to_bf16(float f) {
+    uint32_t u = f32_bits(f);
+    if ((u & 0x7FFFFFFF) > 0x7F800000u) return (uint16_t)((u >> 16) | 0x40);
+    return (uint16_t)((u + 0x7FFF + ((u >> 16) & 1)) >> 16);
+}
+
+/**
+ * nodal_dtype_size
+ * Bytes per element of the element-wise dtypes (0 for block formats).
+ */
+size_t nodal_dtype_size(nodal_type_t t) {
+    switch (t) {
+        case NODAL_F32:
+        case NODAL_U32: return 4;
+        case NODAL_F16:
+        case NODAL_BF16: return 2;
+        default: return 0;
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t widen_avx512(const uint16_t *src, nodal_type_t t, float *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256i h = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m512 v = (t == NODAL_F16) ? _mm512_cvtph_ps(h)
+                                    : _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+        _mm512_storeu_ps(dst + i, v);
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c")))
+static size_t widen_avx2(const uint16_t *src, nodal_type_t t, float *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i *)(src + i));
+        __m256 v = (t == NODAL_F16) ? _mm256_cvtph_ps(h)
+                                    : _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+        _mm256_storeu_ps(dst + i, v);
+    }
+    return i;
+}
+
+/* Integer round-to-nearest-even on 16 lanes; NaN lanes are quieted */
+__attribute__((target("avx512f,avx512bw")))
+static inline __m256i bf16_round_avx512(__m512 v) {
+    __m512i u = _mm512_castps_si512(v);
+    __m512i odd = _mm512_and_si512(_mm512_srli_epi32(u, 16), _mm512_set1_epi32(1));
+    __m512i r = _mm512_add_epi32(u, _mm512_add_epi32(odd, _mm512_set1_epi32(0x7FFF)));
+    __mmask16 nan = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    r = _mm512_mask_or_epi32(r, nan, u, _mm512_set1_epi32(0x400000));
+    return _mm512_cvtepi32_epi16(_mm512_srli_epi32(r, 16));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t narrow_avx512(const float *src, nodal_type_t t, uint16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_loadu_ps(src + i);
+        __m256i h = (t == NODAL_F16) ? _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)
+                                     : bf16_round_avx512(v);
+        _mm256_storeu_si256((__m256i *)(dst + i), h);
+    }
+    return i;
+}
+
+__attribute__((target("avx2,f16c")))
+static size_t narrow_avx2(const float *src, nodal_type_t t, uint16_t *dst, size_t n) {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(src + i);
+        __m128i h;
+        if (t == NODAL_F16) {
+            h = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+        } else {
+            __m256i u = _mm256_castps_si256(v);
+            __m256i odd = _mm256_and_si256(_mm256_srli_epi32(u, 16), _mm256_set1_epi32(1));
+            __m256i r = _mm256_add_epi32(u, _mm256_add_epi32(odd, _mm256_set1_epi32(0x7FFF)));
+            __m256i nan = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+            r = _mm256_blendv_epi8(r, _mm256_or_si256(u, _mm256_set1_epi32(0x400000)), nan);
+            r = _mm256_srli_epi32(r, 16);
+            h = _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), h);
+    }
+    return i;
+}
+
+#endif // x86
+
+/**
+ * nodal_widen
+ * dst[i] = (F32) src[i] for an F16 or BF16 source.
+ */
+void nodal_widen(const uint16_t *src, nodal_type_t t, float *dst, size_t n) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) i = widen_avx512(src, t, dst, n);
+    else if (isa == NODAL_ISA_AVX2 && nodal_cpu_has_f16c()) i = widen_avx2(src, t, dst, n);
+#endif
+    if (t == NODAL_F16) {
+        for (; i < n; i++) dst[i] = nodal_f16_to_f32(src[i]);
+    } else {
+        for (; i < n; i++) dst[i] = nodal_bf16_to_f32(src[i]);
+    }
+}
+
+/**
+ * nodal_narrow
+ * dst[i] = (F16 or BF16) src[i], rounding to nearest even.
+ */
+void nodal_narrow(const float *src, nodal_type_t t, uint16_t *dst, size_t n) {
+    size_t i = 0;
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) i = narrow_avx512(src, t, dst, n);
+    else if (isa == NODAL_ISA_AVX2 && nodal_cpu_has_f16c()) i = narrow_avx2(src, t, dst, n);
+#endif
+    if (t == NODAL_F16) {
+        for (; i < n; i++) dst[i] = nodal_f32_to_f16(src[i]);
+    } else {
+        for (; i < n; i++) dst[i] = nodal_f32_to_bf16(src[i]);
+    }
+}
+
+/**
+ * OP_CAST (Element-wise dtype conversion)
+ * Converts between F32, F16 and BF16; equal types copy.
+ * inputs[0]: Source, outputs[0]: Destination
+ * scalars[0]=count, [1]=source dtype, [2]=destination dtype
+ */
+void nodal_kernel_cast(const nodal_call_t *call) {
+    size_t n = call->scalars[0].v.u32;
+    nodal_type_t from = (nodal_type_t)call->scalars[1].v.u32;
+    nodal_type_t to = (nodal_type_t)call->scalars[2].v.u32;
+    const void *src = call->inputs[0].ptr;
+    void *dst = call->outputs[0].ptr;
+
+    if (from == to) {
+        memmove(dst, src, n * nodal_dtype_size(from));
+    } else if (from == NODAL_F32) {
+        nodal_narrow((const float *)src, to, (uint16_t *)dst, n);
+    } else if (to == NODAL_F32) {
+        nodal_widen((const uint16_t *)src, from, (float *)dst, n);
+    } else {
+        // F16 <-> BF16 through F32 in stack-sized pieces
+        float tmp[256];
+        for (size_t i = 0; i < n; i += 256) {
+            size_t m = (n - i < 256) ? n - i : 256;
+            nodal_widen((const uint16_t *)src + i, from, tmp, m);
+            nodal_narrow(tmp, to, (uint16_t *)dst + i, m);
+        }
+    }
+}
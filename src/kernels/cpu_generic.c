@@ -5,15 +5,23 @@
 
 #include "../nodal.h"
 #include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern float nodal_f16_to_f32(uint16_t h);
+extern float nodal_bf16_to_f32(uint16_t h);
+extern uint32_t nodal_kv_seq_layer_length(const nodal_kv_seq_t *seq, uint32_t layer);
 
 /**
- * OP_MATMUL (Generic F32)
- * C = A * B
- * scalars[0]=M, [1]=N, [2]=K
+ * OP_MATMUL / OP_MATMUL_ADD (Generic F32)
+ * C = A * B (+ D when inputs[2] is bound; D may alias C)
+ * scalars[0]=M, [1]=N, [2]=K, [3]=dtype of B (F32, F16 or BF16)
  */
 void nodal_kernel_matmul_generic(const nodal_call_t *call) {
     const float *A = (const float *)call->inputs[0].ptr;
-    const float *B = (const float *)call->inputs[1].ptr;
+    const void *B = call->inputs[1].ptr;
+    nodal_type_t bt = (nodal_type_t)call->scalars[3].v.u32;
+    const float *D = (const float *)call->inputs[2].ptr;
     float *C = (float *)call->outputs[0].ptr;
 
     uint32_t M = call->scalars[0].v.u32;
@@ -22,9 +30,13 @@ void nodal_kernel_matmul_generic(const nodal_call_t *call) {
 
     for (uint32_t i = 0; i < M; ++i) {
         for (uint32_t j = 0; j < N; ++j) {
-            float sum = 0.0f;
+            float sum = D ? D[i * N + j] : 0.0f;
             for (uint32_t k = 0; k < K; ++k) {
-                sum += A[i * K + k] * B[k * N + j];
+                size_t at = (size_t)k * N + j;
+                float b = (bt == NODAL_F16)  ? nodal_f16_to_f32(((const uint16_t *)B)[at])
+                        : (bt == NODAL_BF16) ? nodal_bf16_to_f32(((const uint16_t *)B)[at])
+                                             : ((const float *)B)[at];
+                sum += A[i * K + k] * b;
             }
             C[i * N + j] = sum;
         }
@@ -33,26 +45,44 @@ void nodal_kernel_matmul_generic(const nodal_call_t *call) {
 
 /**
  * OP_SOFTMAX (Generic F32)
- * scalars[0]=size
+ * Row-wise softmax(in / temperature) over [rows, size].
+ * scalars[0]=size, [1]=rows (0 = 1), [2]=temperature (F32, 0 = 1),
+ * [3]=NODAL_SOFTMAX_* flags. With NODAL_SOFTMAX_CAUSAL, row r only
+ * keeps columns [0, size - rows + r] and the rest are written as 0.
  */
 void nodal_kernel_softmax_generic(const nodal_call_t *call) {
-    const float *in = (const float *)call->inputs[0].ptr;
-    float *out = (float *)call->outputs[0].ptr;
     uint32_t size = call->scalars[0].v.u32;
+    uint32_t rows = call->scalars[1].v.u32 ? call->scalars[1].v.u32 : 1;
+    float temp = (call->scalars[2].kind == NODAL_F32 && call->scalars[2].v.f32 > 0.0f) ? call->scalars[2].v.f32 : 1.0f;
+    int causal = (call->scalars[3].v.u32 & NODAL_SOFTMAX_CAUSAL) != 0;
 
-    float max_val = in[0];
-    for (uint32_t i = 1; i < size; ++i) {
-        if (in[i] > max_val) max_val = in[i];
-    }
+    for (uint32_t r = 0; r < rows; ++r) {
+        const float *in = (const float *)call->inputs[0].ptr + (size_t)r * size;
+        float *out = (float *)call->outputs[0].ptr + (size_t)r * size;
+        int64_t keep = causal ? (int64_t)size - rows + r + 1 : size;
+        uint32_t len = keep <= 0 ? 0 : (keep > size ? size : (uint32_t)keep);
+        if (len == 0) {
+            for (uint32_t i = 0; i < size; ++i) out[i] = 0.0f;
+            continue;
+        }
 
-    float sum = 0.0f;
-    for (uint32_t i = 0; i < size; ++i) {
-        out[i] = expf(in[i] - max_val);
-        sum += out[i];
-    }
+        float max_val = in[0] / temp;
+        for (uint32_t i = 1; i < len; ++i) {
+            if (in[i] / temp > max_val) max_val = in[i] / temp;
+        }
 
-    for (uint32_t i = 0; i < size; ++i) {
-        out[i] /= sum;
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < len; ++i) {
+            out[i] = expf(in[i] / temp - max_val);
+            sum += out[i];
+        }
+
+        for (uint32_t i = 0; i < len; ++i) {
+            out[i] /= sum;
+        }
+        for (uint32_t i = len; i < size; ++i) {
+            out[i] = 0.0f;
+        }
     }
 }
 
@@ -70,3 +100,482 @@ void nodal_kernel_add_generic(const nodal_call_t *call) {
         C[i] = A[i] + B[i];
     }
 }
+
+/**
+ * OP_RMSNORM / OP_LAYERNORM (Generic F32)
+ * Row-wise over X [rows, size]; out may alias X.
+ * RMSNorm:   out = x / sqrt(mean(x^2) + eps) * gamma
+ * LayerNorm: out = (x - mean) / sqrt(var + eps) * gamma + beta
+ * inputs[0]: X, inputs[1]: gamma [size] (unbound = 1),
+ * inputs[2]: beta [size] (LayerNorm only, unbound = 0)
+ * scalars[0]=size, [1]=rows (0 = 1), [2]=eps (F32, 0 = NODAL_NORM_EPS)
+ */
+static void norm_generic(const nodal_call_t *call, int center) {
+    const float *gamma = (const float *)call->inputs[1].ptr;
+    const float *beta = center ? (const float *)call->inputs[2].ptr : NULL;
+    uint32_t size = call->scalars[0].v.u32;
+    uint32_t rows = call->scalars[1].v.u32 ? call->scalars[1].v.u32 : 1;
+    float eps = (call->scalars[2].kind == NODAL_F32 && call->scalars[2].v.f32 > 0.0f) ? call->scalars[2].v.f32
+                                                                                     : NODAL_NORM_EPS;
+    if (size == 0) return;
+
+    for (uint32_t r = 0; r < rows; ++r) {
+        const float *in = (const float *)call->inputs[0].ptr + (size_t)r * size;
+        float *out = (float *)call->outputs[0].ptr + (size_t)r * size;
+
+        double mean = 0.0, var = 0.0;
+        if (center) {
+            for (uint32_t i = 0; i < size; ++i) mean += in[i];
+            mean /= size;
+        }
+        for (uint32_t i = 0; i < size; ++i) var += (in[i] - mean) * (in[i] - mean);
+        float inv = (float)(1.0 / sqrt(var / size + eps));
+
+        for (uint32_t i = 0; i < size; ++i) {
+            float v = (float)(in[i] - mean) * inv * (gamma ? gamma[i] : 1.0f);
+            out[i] = beta ? v + beta[i] : v;
+        }
+    }
+}
+
+void nodal_kernel_rmsnorm_generic(const nodal_call_t *call) {
+    norm_generic(call, 0);
+}
+
+void nodal_kernel_layernorm_generic(const nodal_call_t *call) {
+    norm_generic(call, 1);
+}
+
+/**
+ * OP_SILU / OP_GELU (Generic F32)
+ * out = act(A), or act(A) * B when inputs[1] is bound (SwiGLU / GeGLU:
+ * A is the gate projection, B the up projection). out may alias A.
+ * silu(x) = x / (1 + e^-x); gelu is the tanh approximation
+ * 0.5 x (1 + tanh(sqrt(2/pi) (x + 0.044715 x^3))).
+ * scalars[0]=size
+ */
+static void act_generic(const nodal_call_t *call, int gelu) {
+    const float *A = (const float *)call->inputs[0].ptr;
+    const float *B = (const float *)call->inputs[1].ptr;
+    float *out = (float *)call->outputs[0].ptr;
+    uint32_t size = call->scalars[0].v.u32;
+
+    for (uint32_t i = 0; i < size; ++i) {
+        float x = A[i];
+        float v = gelu ? 0.5f * x * (1.0f + tanhf(0.7978845608f * (x + 0.044715f * x * x * x)))
+                       : x / (1.0f + expf(-x));
+        out[i] = B ? v * B[i] : v;
+    }
+}
+
+void nodal_kernel_silu_generic(const nodal_call_t *call) {
+    act_generic(call, 0);
+}
+
+void nodal_kernel_gelu_generic(const nodal_call_t *call) {
+    act_generic(call, 1);
+}
+
+/**
+ * OP_ROPE (Generic F32)
+ * Rotates X [n, heads, head_dim] by position: pair (a, b) of token t
+ * becomes (a cos - b sin, a sin + b cos) at angle
+ * (pos0 + t) * theta^(-2i / head_dim) for pair index i. Pairs are
+ * (2i, 2i + 1), or (i, i + head_dim/2) with NODAL_ROPE_NEOX.
+ * inputs[0]: X, inputs[1]: nodal_kv_seq_t (optional; pos0 is then the
+ * length of the layer's cache), outputs[0]: out (may alias X)
+ * scalars[0]=n, [1]=heads, [2]=head_dim (even), [3]=pos0, [4]=layer,
+ * [5]=theta (F32, 0 = NODAL_ROPE_THETA), [6]=NODAL_ROPE_* flags
+ */
+void nodal_kernel_rope_generic(const nodal_call_t *call) {
+    const float *in = (const float *)call->inputs[0].ptr;
+    const nodal_kv_seq_t *seq = (const nodal_kv_seq_t *)call->inputs[1].ptr;
+    float *out = (float *)call->outputs[0].ptr;
+    uint32_t n = call->scalars[0].v.u32;
+    uint32_t heads = call->scalars[1].v.u32;
+    uint32_t dh = call->scalars[2].v.u32;
+    uint32_t pos0 = seq ? nodal_kv_seq_layer_length(seq, call->scalars[4].v.u32) : call->scalars[3].v.u32;
+    float theta = (call->scalars[5].kind == NODAL_F32 && call->scalars[5].v.f32 > 0.0f) ? call->scalars[5].v.f32
+                                                                                       : NODAL_ROPE_THETA;
+    int neox = (call->scalars[6].v.u32 & NODAL_ROPE_NEOX) != 0;
+    uint32_t half = dh / 2;
+
+    for (uint32_t t = 0; t < n; ++t) {
+        for (uint32_t h = 0; h < heads; ++h) {
+            size_t base = ((size_t)t * heads + h) * dh;
+            for (uint32_t i = 0; i < half; ++i) {
+                float angle = (float)(pos0 + t) * powf(theta, -2.0f * (float)i / (float)dh);
+                size_t a = base + (neox ? i : 2 * i), b = base + (neox ? i + half : 2 * i + 1);
+                float xa = in[a], xb = in[b];
+                out[a] = xa * cosf(angle) - xb * sinf(angle);
+                out[b] = xa * sinf(angle) + xb * cosf(angle);
+            }
+        }
+    }
+}
+
+/* Canonical NF4 code book, identical to NF4_LUT in tools/nc.py */
+static const float NF4_LUT[16] = {
+    -1.0f, -0.6944172978401184f, -0.5120928883552551f, -0.37310290336608887f,
+    -0.25598612427711487f, -0.15016591548919678f, -0.05151525139808655f, 0.0f,
+    0.05151525139808655f, 0.15016591548919678f, 0.25598612427711487f, 0.37310290336608887f,
+    0.5120928883552551f, 0.6944172978401184f, 1.0f, 1.25f
+};
+
+/**
+ * nodal_nf4_tiled_bytes
+ * Size of W [N, K] in NODAL_LAYOUT_NF4_TILED; K % block_size == 0.
+ */
+size_t nodal_nf4_tiled_bytes(uint32_t N, uint32_t K, uint32_t block_size) {
+    size_t panels = (N + NODAL_NF4_PANEL - 1) / NODAL_NF4_PANEL;
+    return panels * (K / block_size) * NODAL_NF4_PANEL * (sizeof(float) + block_size / 2);
+}
+
+/**
+ * nodal_nf4_tile
+ * Repacks row-major NF4 weights and their flat block scales into
+ * NODAL_LAYOUT_NF4_TILED, byte-identical to nc.py's pack_nf4_tiled.
+ * Needs K % block_size == 0 and an even block_size.
+ */
+void nodal_nf4_tile(const uint8_t *W, const float *scales, uint32_t N, uint32_t K, uint32_t block_size,
+                    uint8_t *out) {
+    const uint32_t P = NODAL_NF4_PANEL, blocks = K / block_size, run = block_size / 2;
+    memset(out, 0, nodal_nf4_tiled_bytes(N, K, block_size));
+    for (uint32_t p = 0; p < (N + P - 1) / P; p++) {
+        for (uint32_t b = 0; b < blocks; b++) {
+            uint8_t *tile = out + ((size_t)p * blocks + b) * P * (sizeof(float) + run);
+            for (uint32_t r = 0; r < P && p * P + r < N; r++) {
+                size_t n = (size_t)p * P + r;
+                memcpy(tile + r * sizeof(float), &scales[n * blocks + b], sizeof(float));
+                memcpy(tile + P * sizeof(float) + (size_t)r * run, W + (n * K + (size_t)b * block_size) / 2, run);
+            }
+        }
+    }
+}
+
+/**
+ * OP_MATMUL_QNF4 / OP_MATMUL_QNF4_ADD (Generic Reference)
+ * C = A * W^T with W stored as nc.py's quantize_nf4 emits it.
+ * inputs[0]: Activations A [M, K] (F32)
+ * inputs[1]: Weights W [N, K] (NF4, 2 per byte, low nibble first)
+ * inputs[2]: Scales (F32, 1 per block_size flat elements of W; unused
+ *            when W is tiled, since the tiles carry their scales)
+ * inputs[3]: Optional addend D [M, N] (F32, may alias C)
+ * scalars[0]=M, [1]=N, [2]=K, [3]=block_size, [4]=layout of W
+ * (NODAL_LAYOUT_ROW_MAJOR or NODAL_LAYOUT_NF4_TILED)
+ */
+void nodal_kernel_matmul_qnf4_generic(const nodal_call_t *call) {
+    const float *A = (const float *)call->inputs[0].ptr;
+    const uint8_t *W = (const uint8_t *)call->inputs[1].ptr;
+    const float *scales = (const float *)call->inputs[2].ptr;
+    const float *D = (const float *)call->inputs[3].ptr;
+    float *C = (float *)call->outputs[0].ptr;
+
+    uint32_t M = call->scalars[0].v.u32;
+    uint32_t N = call->scalars[1].v.u32;
+    uint32_t K = call->scalars[2].v.u32;
+    uint32_t block_size = call->scalars[3].v.u32;
+    if (block_size == 0) return;
+
+    if (call->scalars[4].v.u32 == NODAL_LAYOUT_NF4_TILED) {
+        const uint32_t P = NODAL_NF4_PANEL, blocks = K / block_size;
+        const size_t tile_bytes = P * (sizeof(float) + block_size / 2);
+        for (uint32_t m = 0; m < M; m++) {
+            for (uint32_t n = 0; n < N; n++) {
+                float sum = 0.0f;
+                for (uint32_t b = 0; b < blocks; b++) {
+                    const uint8_t *tile = W + ((size_t)(n / P) * blocks + b) * tile_bytes;
+                    const uint8_t *w = tile + P * sizeof(float) + (size_t)(n % P) * (block_size / 2);
+                    float scale;
+                    memcpy(&scale, tile + (n % P) * sizeof(float), sizeof(float));
+                    for (uint32_t i = 0; i < block_size; i++) {
+                        uint8_t code = (i & 1) ? (w[i / 2] >> 4) : (w[i / 2] & 0x0F);
+                        sum += A[(size_t)m * K + (size_t)b * block_size + i] * NF4_LUT[code] * scale;
+                    }
+                }
+                C[(size_t)m * N + n] = D ? D[(size_t)m * N + n] + sum : sum;
+            }
+        }
+        return;
+    }
+
+    for (uint32_t m = 0; m < M; m++) {
+        for (uint32_t n = 0; n < N; n++) {
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < K; k++) {
+                size_t flat = (size_t)n * K + k;
+                uint8_t byte = W[flat / 2];
+                uint8_t code = (flat & 1) ? (byte >> 4) : (byte & 0x0F);
+                sum += A[(size_t)m * K + k] * NF4_LUT[code] * scales[flat / block_size];
+            }
+            C[(size_t)m * N + n] = D ? D[(size_t)m * N + n] + sum : sum;
+        }
+    }
+}
+
+/**
+ * OP_EMBED_GATHER (Generic Reference)
+ * out[t] = row ids[t] of the table, dequantized to F32. Only the selected
+ * rows (and their scales) are read.
+ * inputs[0]: Token ids [n] (U32, as nodal_kernel_tokenize_bpe emits them)
+ * inputs[1]: Table [vocab, dim] (F32, F16, BF16, or row-major NF4 / Q8_0)
+ * inputs[2]: Scales (NF4 / Q8_0: F32, 1 per block_size elements of a row)
+ * inputs[3]: Optional id count (U32); rows from the count on are zeroed
+ * outputs[0]: out [n, dim] (F32)
+ * scalars[0]=n, [1]=vocab, [2]=dim, [3]=block_size (must divide dim),
+ * [4]=layout (NODAL_LAYOUT_ROW_MAJOR), [5]=dtype of the table.
+ * Ids outside the vocabulary produce zero rows.
+ */
+void nodal_kernel_embed_gather_generic(const nodal_call_t *call) {
+    const uint32_t *ids = (const uint32_t *)call->inputs[0].ptr;
+    const void *table = call->inputs[1].ptr;
+    const float *scales = (const float *)call->inputs[2].ptr;
+    const uint32_t *count = (const uint32_t *)call->inputs[3].ptr;
+    float *out = (float *)call->outputs[0].ptr;
+
+    uint32_t n = call->scalars[0].v.u32;
+    uint32_t vocab = call->scalars[1].v.u32;
+    uint32_t dim = call->scalars[2].v.u32;
+    uint32_t bs = call->scalars[3].v.u32;
+    nodal_type_t dt = (nodal_type_t)call->scalars[5].v.u32;
+    uint32_t live = (count && *count < n) ? *count : n;
+
+    for (uint32_t t = 0; t < n; t++) {
+        float *o = out + (size_t)t * dim;
+        uint32_t id = ids[t];
+        if (t >= live || id >= vocab) {
+            memset(o, 0, (size_t)dim * sizeof(float));
+            continue;
+        }
+        for (uint32_t k = 0; k < dim; k++) {
+            size_t flat = (size_t)id * dim + k;
+            switch (dt) {
+                case NODAL_F16: o[k] = nodal_f16_to_f32(((const uint16_t *)table)[flat]); break;
+                case NODAL_BF16: o[k] = nodal_bf16_to_f32(((const uint16_t *)table)[flat]); break;
+                case NODAL_NF4: {
+                    uint8_t byte = ((const uint8_t *)table)[flat / 2];
+                    o[k] = NF4_LUT[(flat & 1) ? (byte >> 4) : (byte & 0x0F)] * scales[flat / bs];
+                    break;
+                }
+                case NODAL_Q8_0: o[k] = ((const int8_t *)table)[flat] * scales[flat / bs]; break;
+                default: o[k] = ((const float *)table)[flat]; break;
+            }
+        }
+    }
+}
+
+/**
+ * nodal_rng_seed
+ * Sampler RNG state for key (splitmix64 finalizer); never 0, which
+ * OP_SAMPLE reserves for "not seeded yet".
+ */
+uint64_t nodal_rng_seed(uint64_t key) {
+    uint64_t z = key + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return z ? z : 0x9E3779B97F4A7C15ull;
+}
+
+/**
+ * nodal_rng_uniform
+ * Advances a xorshift64* state and returns a float in [0, 1).
+ */
+float nodal_rng_uniform(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return (float)((x * 0x2545F4914F6CDD1Dull) >> 40) * (1.0f / 16777216.0f);
+}
+
+typedef struct {
+    float z;
+    uint32_t id;
+} sample_entry_t;
+
+/* Sampling order: higher logit first, lower id on ties */
+static int sample_entry_cmp(const void *pa, const void *pb) {
+    const sample_entry_t *a = (const sample_entry_t *)pa, *b = (const sample_entry_t *)pb;
+    if (a->z != b->z) return a->z > b->z ? -1 : 1;
+    return (a->id > b->id) - (a->id < b->id);
+}
+
+/**
+ * OP_SAMPLE (Generic Reference)
+ * Draws one token id per row of logits:
+ * 1. Ids in the history get the repetition penalty: z / penalty when
+ *    z > 0, z * penalty otherwise (once per distinct id).
+ * 2. temperature <= 0 or top_k == 1 picks the argmax (lowest id on ties)
+ *    without touching the RNG.
+ * 3. Otherwise the ids are ranked by z (lower id first on ties), the
+ *    first top_k kept, weighted exp((z - max) / temperature), and cut to
+ *    the shortest prefix of the ranking holding top_p of the kept mass
+ *    (summed in id order).
+ *    One uniform draw then walks the survivors in ascending id order.
+ * inputs[0]: Logits [rows, vocab] (F32)
+ * inputs[1]: History ids (U32, optional); shared by every row
+ * inputs[2]: History count (U32, optional; default inputs[1].size / 4)
+ * inputs[3]: RNG state (U64 per row, optional); advanced in place, and
+ *            seeded from (seed, row) while 0. Without it each run seeds
+ *            from (seed, row, history count).
+ * outputs[0]: Ids [rows] (U32)
+ * scalars[0]=vocab, [1]=rows (0 = 1), [2]=temperature (F32),
+ * [3]=top_k (0 = all), [4]=top_p (F32, 0 or >= 1 = off),
+ * [5]=repetition penalty (F32, 0 or 1 = off), [6]=seed
+ */
+void nodal_kernel_sample_generic(const nodal_call_t *call) {
+    const float *logits = (const float *)call->inputs[0].ptr;
+    const uint32_t *hist = (const uint32_t *)call->inputs[1].ptr;
+    const uint32_t *count = (const uint32_t *)call->inputs[2].ptr;
+    uint64_t *states = (uint64_t *)call->inputs[3].ptr;
+    uint32_t *ids = (uint32_t *)call->outputs[0].ptr;
+    const nodal_scalar_t *s = call->scalars;
+
+    uint32_t vocab = s[0].v.u32;
+    uint32_t rows = s[1].v.u32 ? s[1].v.u32 : 1;
+    float temp = (s[2].kind == NODAL_F32) ? s[2].v.f32 : 0.0f;
+    uint32_t top_k = s[3].v.u32;
+    float top_p = (s[4].kind == NODAL_F32) ? s[4].v.f32 : 0.0f;
+    float penalty = (s[5].kind == NODAL_F32 && s[5].v.f32 > 0.0f) ? s[5].v.f32 : 1.0f;
+    uint32_t n_hist = hist ? (count ? *count : (uint32_t)(call->inputs[1].byte_len / sizeof(uint32_t))) : 0;
+    if (vocab == 0) return;
+
+    sample_entry_t *e = (sample_entry_t *)malloc((size_t)vocab * sizeof(sample_entry_t));
+    float *w = (float *)malloc((size_t)vocab * sizeof(float));
+    float *wid = (float *)malloc((size_t)vocab * sizeof(float));
+    uint8_t *mark = (uint8_t *)malloc(vocab);
+    if (!e || !w || !wid || !mark) goto done;
+
+    for (uint32_t r = 0; r < rows; r++) {
+        const float *x = logits + (size_t)r * vocab;
+
+        // 1. Penalized logits
+        memset(mark, 0, vocab);
+        for (uint32_t i = 0; i < vocab; i++) e[i] = (sample_entry_t){ x[i], i };
+        for (uint32_t h = 0; h < n_hist && penalty != 1.0f; h++) {
+            uint32_t id = hist[h];
+            if (id >= vocab || mark[id]) continue;
+            mark[id] = 1;
+            e[id].z = e[id].z > 0.0f ? e[id].z / penalty : e[id].z * penalty;
+        }
+
+        // 2. Greedy
+        if (temp <= 0.0f || top_k == 1) {
+            uint32_t best = 0;
+            for (uint32_t i = 1; i < vocab; i++) best = (e[i].z > e[best].z) ? i : best;
+            ids[r] = best;
+            continue;
+        }
+
+        // 3. Rank, top-k, weights (summed in id order), top-p
+        qsort(e, vocab, sizeof(sample_entry_t), sample_entry_cmp);
+        uint32_t kept = (top_k && top_k < vocab) ? top_k : vocab;
+        memset(wid, 0, (size_t)vocab * sizeof(float));
+        for (uint32_t i = 0; i < kept; i++) {
+            w[i] = (e[i].z == e[0].z) ? 1.0f : expf((e[i].z - e[0].z) / temp);
+            wid[e[i].id] = w[i];
+        }
+        double total = 0.0;
+        for (uint32_t i = 0; i < vocab; i++) total += wid[i];
+        if (top_p > 0.0f && top_p < 1.0f) {
+            double cum = 0.0;
+            uint32_t i = 0;
+            while (i < kept && (i == 0 || cum < top_p * total)) cum += w[i++];
+            for (uint32_t j = i; j < kept; j++) wid[e[j].id] = 0.0f;
+            total = cum;
+        }
+
+        // 4. One draw over the survivors in id order
+        uint64_t st = nodal_rng_seed(((uint64_t)s[6].v.u32 << 32 | n_hist) + r * 0x9E3779B97F4A7C15ull);
+        uint64_t *state = states ? &states[r] : &st;
+        if (*state == 0) *state = nodal_rng_seed(((uint64_t)s[6].v.u32 << 32) + r * 0x9E3779B97F4A7C15ull);
+        double u = nodal_rng_uniform(state) * total, acc = 0.0;
+        uint32_t pick = e[0].id;
+        for (uint32_t i = 0; i < vocab; i++) {
+            if (wid[i] <= 0.0f) continue;
+            pick = i;
+            acc += wid[i];
+            if (u < acc) break;
+        }
+        ids[r] = pick;
+    }
+
+done:
+    free(e);
+    free(w);
+    free(wid);
+    free(mark);
+}
+
+/**
+ * nodal_q8_quantize_row
+ * Q8_0 activation quantization, shared by every matmul_q8_0 path so
+ * they all see the same integers: each block of bs values becomes
+ * round(x * 127 / max|x|) with scale max|x| / 127. K % bs == 0.
+ */
+void nodal_q8_quantize_row(const float *x, uint32_t K, uint32_t bs, int8_t *q, float *scales) {
+    for (uint32_t b = 0; b < K / bs; b++) {
+        const float *xb = x + (size_t)b * bs;
+        float amax = 0.0f;
+        for (uint32_t i = 0; i < bs; i++) amax = fmaxf(amax, fabsf(xb[i]));
+        float inv = amax > 0.0f ? 127.0f / amax : 0.0f;
+        for (uint32_t i = 0; i < bs; i++) q[(size_t)b * bs + i] = (int8_t)lrintf(xb[i] * inv);
+        scales[b] = amax / 127.0f;
+    }
+}
+
+/**
+ * OP_MATMUL_Q8_0 / OP_MATMUL_Q8_0_ADD (Generic Reference)
+ * C = A * W^T with W stored as nc.py's quantize_q8_0 emits it. A is
+ * quantized to int8 per block on the fly and each block contributes
+ * int_dot(a, w) * scale_a * scale_w. Activations are quantized a run of
+ * whole blocks at a time into stack buffers, once per tile of columns.
+ * inputs[0]: Activations A [M, K] (F32)
+ * inputs[1]: Weights W [N, K] (int8, row-major)
+ * inputs[2]: Scales (F32, 1 per block_size elements of a row of W)
+ * inputs[3]: Optional addend D [M, N] (F32, may alias C)
+ * scalars[0]=M, [1]=N, [2]=K, [3]=block_size (must divide K, at most NODAL_Q8_MAX_BLOCK)
+ */
+void nodal_kernel_matmul_q8_0_generic(const nodal_call_t *call) {
+    enum { RUN = 2 * NODAL_Q8_MAX_BLOCK, RUN_BLOCKS = 64, TILE = 64 };
+    const float *A = (const float *)call->inputs[0].ptr;
+    const int8_t *W = (const int8_t *)call->inputs[1].ptr;
+    const float *scales = (const float *)call->inputs[2].ptr;
+    const float *D = (const float *)call->inputs[3].ptr;
+    float *C = (float *)call->outputs[0].ptr;
+
+    uint32_t M = call->scalars[0].v.u32;
+    uint32_t N = call->scalars[1].v.u32;
+    uint32_t K = call->scalars[2].v.u32;
+    uint32_t bs = call->scalars[3].v.u32;
+    if (bs == 0 || K % bs || bs > NODAL_Q8_MAX_BLOCK) return;
+
+    const uint32_t nb = K / bs, run = (RUN / bs < RUN_BLOCKS) ? RUN / bs : RUN_BLOCKS;
+    int8_t qa[RUN];
+    float sa[RUN_BLOCKS], acc[TILE];
+    for (uint32_t m = 0; m < M; m++) {
+        for (uint32_t n0 = 0; n0 < N; n0 += TILE) {
+            uint32_t nt = (N - n0 < TILE) ? N - n0 : TILE;
+            memset(acc, 0, sizeof(acc));
+            for (uint32_t b0 = 0; b0 < nb; b0 += run) {
+                uint32_t rb = (nb - b0 < run) ? nb - b0 : run;
+                nodal_q8_quantize_row(A + (size_t)m * K + (size_t)b0 * bs, rb * bs, bs, qa, sa);
+                for (uint32_t t = 0; t < nt; t++) {
+                    const int8_t *w = W + (size_t)(n0 + t) * K + (size_t)b0 * bs;
+                    const float *ws = scales + (size_t)(n0 + t) * nb + b0;
+                    for (uint32_t b = 0; b < rb; b++) {
+                        int32_t dot = 0;
+                        for (uint32_t i = b * bs; i < (b + 1) * bs; i++) dot += (int32_t)qa[i] * w[i];
+                        acc[t] += (float)dot * (sa[b] * ws[b]);
+                    }
+                }
+            }
+            for (uint32_t t = 0; t < nt; t++) {
+                size_t idx = (size_t)m * N + n0 + t;
+                C[idx] = D ? D[idx] + acc[t] : acc[t];
+            }
+        }
+    }
+}
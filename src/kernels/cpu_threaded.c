@@ -0,0 +1,69 @@
+/*
+ * cpu_threaded.c - Pool-Parallel Elementwise Kernels
+ * Same contracts as the cpu_generic.c references, with the work split
+ * over the default worker pool. Small inputs stay on the calling thread.
+ * Softmax lives in softmax.c.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+#define ELEM_GRAIN      (1u << 14) // Elements per task, multiple of 16
+#define ELEM_MAX_TASKS  256
+
+typedef struct {
+    const float *a, *b;
+    float *out;
+    uint32_t size;
+    uint32_t chunk;
+} elem_job_t;
+
+static inline void chunk_range(const elem_job_t *job, uint32_t task, uint32_t *begin, uint32_t *end) {
+    *begin = task * job->chunk;
+    *end = (job->size - *begin < job->chunk) ? job->size : *begin + job->chunk;
+}
+
+/* Splits size into chunks; returns the task count (1 = run serially) */
+static uint32_t elem_plan(elem_job_t *job, nodal_pool_t *pool) {
+    uint32_t tasks = nodal_pool_tasks(pool, job->size, ELEM_GRAIN);
+    if (tasks > ELEM_MAX_TASKS) tasks = ELEM_MAX_TASKS;
+    uint32_t chunk = (job->size + tasks - 1) / tasks;
+    job->chunk = (chunk + 15) & ~15u;
+    return job->chunk ? (job->size + job->chunk - 1) / job->chunk : 1;
+}
+
+static void add_task(void *ctx, uint32_t task) {
+    const elem_job_t *job = (const elem_job_t *)ctx;
+    uint32_t begin, end;
+    chunk_range(job, task, &begin, &end);
+    for (uint32_t i = begin; i < end; i++) job->out[i] = job->a[i] + job->b[i];
+}
+
+/**
+ * OP_ADD (Threaded F32)
+ * scalars[0]=size
+ */
+void nodal_kernel_add_f32(const nodal_call_t *call) {
+    elem_job_t job;
+    job.a = (const float *)call->inputs[0].ptr;
+    job.b = (const float *)call->inputs[1].ptr;
+    job.out = (float *)call->outputs[0].ptr;
+    job.size = call->scalars[0].v.u32;
+    if (job.size == 0) return;
+
+    nodal_pool_t *pool = nodal_pool_default();
+    nodal_pool_run(pool, add_task, &job, elem_plan(&job, pool));
+}
+
+/**
+ * nodal_add_splits
+ * Whether OP_ADD with these scalars is more than one task's worth of
+ * elements.
+ */
+int nodal_add_splits(const nodal_scalar_t *s) {
+    return s[0].v.u32 > ELEM_GRAIN;
+}
@@ -0,0 +1,197 @@
+/*
+ * embed.c - Embedding Gather from F32 / F16 / BF16 / NF4 / Q8_0 Tables
+ * Copies the rows of the selected token ids out of the mapped table,
+ * dequantizing block by block as it goes, so neither the whole table
+ * nor a one-hot matmul is ever materialized. Only the pages holding
+ * those rows (and their scales) are faulted in, which matters for a
+ * cold vocab x dim table during prefill. Tokens are split over the
+ * worker pool; NF4 rows decode with AVX-512 or AVX2 nibble lookups.
+ */
+
+#include "../nodal.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern void nodal_widen(const uint16_t *src, nodal_type_t t, float *dst, size_t n);
+
+#define EMBED_GRAIN (1u << 14) // Output elements per task
+
+static const float NF4_LUT[16] __attribute__((aligned(64))) = {
+    -1.0f, -0.6944172978401184f, -0.5120928883552551f, -0.37310290336608887f,
+    -0.25598612427711487f, -0.15016591548919678f, -0.05151525139808655f, 0.0f,
+    0.05151525139808655f, 0.15016591548919678f, 0.25598612427711487f, 0.37310290336608887f,
+    0.5120928883552551f, 0.6944172978401184f, 1.0f, 1.25f
+};
+
+/*
+ * Decodes the leading elements of an NF4 row and returns how many it
+ * wrote; the scalar loop in gather_row finishes the row.
+ */
+typedef uint32_t (*nf4_row_fn)(const uint8_t *w, const float *scales, uint32_t dim, uint32_t bs, float *o);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* 32 elements (16 bytes) per step; needs blocks of a multiple of 32 */
+__attribute__((target("avx512f")))
+static uint32_t nf4_row_avx512(const uint8_t *w, const float *scales, uint32_t dim, uint32_t bs, float *o) {
+    if (bs % 32) return 0;
+    const __m512 lut = _mm512_load_ps(NF4_LUT);
+    const __m512i nibble = _mm512_set1_epi32(0x0F);
+    const __m512i even = _mm512_setr_epi32(0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23);
+    const __m512i odd = _mm512_setr_epi32(8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31);
+    uint32_t k = 0;
+    for (; k + 32 <= dim; k += 32) {
+        __m512i codes = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)(w + k / 2)));
+        __m512 lo = _mm512_permutexvar_ps(_mm512_and_si512(codes, nibble), lut);
+        __m512 hi = _mm512_permutexvar_ps(_mm512_srli_epi32(codes, 4), lut);
+        __m512 s = _mm512_set1_ps(scales[k / bs]);
+        _mm512_storeu_ps(o + k, _mm512_mul_ps(_mm512_permutex2var_ps(lo, even, hi), s));
+        _mm512_storeu_ps(o + k + 16, _mm512_mul_ps(_mm512_permutex2var_ps(lo, odd, hi), s));
+    }
+    return k;
+}
+
+/* 16 elements (8 bytes) per step; needs blocks of a multiple of 16 */
+__attribute__((target("avx2,fma")))
+static uint32_t nf4_row_avx2(const uint8_t *w, const float *scales, uint32_t dim, uint32_t bs, float *o) {
+    if (bs % 16) return 0;
+    const __m256 lut_lo = _mm256_load_ps(NF4_LUT), lut_hi = _mm256_load_ps(NF4_LUT + 8);
+    const __m256i nibble = _mm256_set1_epi32(0x0F), seven = _mm256_set1_epi32(7);
+    uint32_t k = 0;
+    for (; k + 16 <= dim; k += 16) {
+        __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(w + k / 2)));
+        __m256i c_lo = _mm256_and_si256(codes, nibble), c_hi = _mm256_srli_epi32(codes, 4);
+        __m256 lo = _mm256_blendv_ps(_mm256_permutevar8x32_ps(lut_lo, c_lo), _mm256_permutevar8x32_ps(lut_hi, c_lo),
+                                     _mm256_castsi256_ps(_mm256_cmpgt_epi32(c_lo, seven)));
+        __m256 hi = _mm256_blendv_ps(_mm256_permutevar8x32_ps(lut_lo, c_hi), _mm256_permutevar8x32_ps(lut_hi, c_hi),
+                                     _mm256_castsi256_ps(_mm256_cmpgt_epi32(c_hi, seven)));
+        __m256 a = _mm256_unpacklo_ps(lo, hi), b = _mm256_unpackhi_ps(lo, hi);
+        __m256 s = _mm256_set1_ps(scales[k / bs]);
+        _mm256_storeu_ps(o + k, _mm256_mul_ps(_mm256_permute2f128_ps(a, b, 0x20), s));
+        _mm256_storeu_ps(o + k + 8, _mm256_mul_ps(_mm256_permute2f128_ps(a, b, 0x31), s));
+    }
+    return k;
+}
+#endif
+
+static nf4_row_fn nf4_row_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return nf4_row_avx512;
+    if (isa == NODAL_ISA_AVX2) return nf4_row_avx2;
+#endif
+    return NULL;
+}
+
+/* --- Token Scheduling --- */
+
+typedef struct {
+    nf4_row_fn nf4_row;
+    const uint32_t *ids;
+    const uint8_t *table;
+    const float *scales;
+    float *out;
+    uint32_t n;
+    uint32_t live;                 // Tokens with an id; the rest are zeroed
+    uint32_t vocab;
+    uint32_t dim;
+    uint32_t bs;
+    nodal_type_t dtype;
+    uint32_t tokens_per_task;
+} embed_job_t;
+
+static void gather_row(const embed_job_t *job, uint32_t id, float *o) {
+    const uint32_t dim = job->dim, bs = job->bs;
+    const size_t row = (size_t)id * dim;
+    switch (job->dtype) {
+        case NODAL_F16:
+        case NODAL_BF16:
+            nodal_widen((const uint16_t *)job->table + row, job->dtype, o, dim);
+            break;
+        case NODAL_NF4: {
+            const uint8_t *w = job->table + row / 2;
+            const float *s = job->scales + row / bs;
+            for (uint32_t k = job->nf4_row ? job->nf4_row(w, s, dim, bs, o) : 0; k < dim; k++) {
+                uint8_t byte = w[k / 2];
+                o[k] = NF4_LUT[(k & 1) ? (byte >> 4) : (byte & 0x0F)] * s[k / bs];
+            }
+            break;
+        }
+        case NODAL_Q8_0: {
+            const int8_t *w = (const int8_t *)job->table + row;
+            const float *s = job->scales + row / bs;
+            for (uint32_t b = 0; b < dim / bs; b++) {
+                for (uint32_t k = b * bs; k < (b + 1) * bs; k++) o[k] = (float)w[k] * s[b];
+            }
+            break;
+        }
+        default:
+            memcpy(o, (const float *)job->table + row, (size_t)dim * sizeof(float));
+            break;
+    }
+}
+
+static void embed_task(void *ctx, uint32_t task) {
+    const embed_job_t *job = (const embed_job_t *)ctx;
+    uint32_t begin = task * job->tokens_per_task;
+    uint32_t end = (job->n - begin < job->tokens_per_task) ? job->n : begin + job->tokens_per_task;
+    for (uint32_t t = begin; t < end; t++) {
+        float *o = job->out + (size_t)t * job->dim;
+        uint32_t id = job->ids[t];
+        if (t >= job->live || id >= job->vocab) memset(o, 0, (size_t)job->dim * sizeof(float));
+        else gather_row(job, id, o);
+    }
+}
+
+/**
+ * OP_EMBED_GATHER (Threaded, F32 Output)
+ * See nodal_kernel_embed_gather_generic for the contract. NF4 tables
+ * must be row-major (tiled panels would scatter a row over 16x the
+ * bytes it needs).
+ */
+void nodal_kernel_embed_gather(const nodal_call_t *call) {
+    embed_job_t job;
+    const nodal_scalar_t *s = call->scalars;
+    const uint32_t *count = (const uint32_t *)call->inputs[3].ptr;
+    job.nf4_row = nf4_row_isa();
+    job.ids = (const uint32_t *)call->inputs[0].ptr;
+    job.table = (const uint8_t *)call->inputs[1].ptr;
+    job.scales = (const float *)call->inputs[2].ptr;
+    job.out = (float *)call->outputs[0].ptr;
+    job.n = s[0].v.u32;
+    job.vocab = s[1].v.u32;
+    job.dim = s[2].v.u32;
+    job.bs = s[3].v.u32;
+    job.dtype = (nodal_type_t)s[5].v.u32;
+    job.live = (count && *count < job.n) ? *count : job.n;
+    if (job.n == 0 || job.dim == 0) return;
+
+    int quantized = (job.dtype == NODAL_NF4 || job.dtype == NODAL_Q8_0);
+    if (quantized && (!job.scales || job.bs == 0 || job.dim % job.bs || s[4].v.u32 != NODAL_LAYOUT_ROW_MAJOR ||
+                      (job.dtype == NODAL_NF4 && job.dim % 2))) {
+        fprintf(stderr, "[EXEC] OP_EMBED_GATHER needs scales, block_size dividing dim and a row-major table\n");
+        memset(job.out, 0, (size_t)job.n * job.dim * sizeof(float));
+        return;
+    }
+
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, (size_t)job.n * job.dim, EMBED_GRAIN);
+    if (tasks > job.n) tasks = job.n;
+    job.tokens_per_task = (job.n + tasks - 1) / tasks;
+    nodal_pool_run(pool, embed_task, &job, (job.n + job.tokens_per_task - 1) / job.tokens_per_task);
+}
+
+/**
+ * nodal_embed_gather_splits
+ * Whether OP_EMBED_GATHER with these scalars is more than one task's
+ * worth of output; tasks own whole tokens.
+ */
+int nodal_embed_gather_splits(const nodal_scalar_t *s) {
+    return s[0].v.u32 > 1 && (uint64_t)s[0].v.u32 * s[2].v.u32 > EMBED_GRAIN;
+}
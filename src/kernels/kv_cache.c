@@ -0,0 +1,260 @@
+/*
+ * kv_cache.c - Paged KV Cache for Incremental Attention
+ * K/V live in fixed-size blocks handed out from one slab through a free
+ * list, so any mix of sequence lengths packs without fragmentation and
+ * a decode step only appends to its last block. Sequences map logical
+ * blocks to physical ones through a block table; forks share blocks by
+ * reference count and copy a block only when writing into a shared one.
+ */
+
+#include "../nodal.h"
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KV_MAX_BLOCK_TOKENS 256
+#define KV_MAX_HEAD_DIM     256
+
+struct nodal_kv_cache {
+    pthread_mutex_t lock;          // Guards refs, the free list and cow_copies
+    float *slab;
+    uint32_t num_layers;
+    uint32_t num_kv_heads;
+    uint32_t head_dim;
+    uint32_t block_tokens;
+    uint32_t num_blocks;
+    size_t block_floats;           // [layer][K|V][kv_head][block_tokens][head_dim]
+    uint32_t *refs;
+    uint32_t *free_list;
+    uint32_t num_free;
+    uint64_t cow_copies;
+};
+
+struct nodal_kv_seq {
+    nodal_kv_cache_t *cache;
+    uint32_t *blocks;              // Logical -> physical block; room for the whole pool
+    uint32_t num_blocks;
+    uint32_t *len;                 // Tokens stored, per layer
+};
+
+/**
+ * nodal_kv_cache_create
+ * Preallocates num_blocks blocks of block_tokens positions each.
+ * Returns NULL on bad dimensions or allocation failure.
+ */
+nodal_kv_cache_t *nodal_kv_cache_create(uint32_t num_layers, uint32_t num_kv_heads, uint32_t head_dim,
+                                        uint32_t block_tokens, uint32_t num_blocks) {
+    if (!num_layers || !num_kv_heads || !head_dim || !block_tokens || !num_blocks ||
+        head_dim > KV_MAX_HEAD_DIM || block_tokens > KV_MAX_BLOCK_TOKENS) {
+        fprintf(stderr, "[KV] Unsupported cache shape\n");
+        return NULL;
+    }
+    nodal_kv_cache_t *cache = (nodal_kv_cache_t *)calloc(1, sizeof(nodal_kv_cache_t));
+    if (!cache) return NULL;
+    cache->num_layers = num_layers;
+    cache->num_kv_heads = num_kv_heads;
+    cache->head_dim = head_dim;
+    cache->block_tokens = block_tokens;
+    cache->num_blocks = num_blocks;
+    cache->block_floats = (size_t)num_layers * 2 * num_kv_heads * block_tokens * head_dim;
+
+    size_t slab_bytes = (cache->block_floats * num_blocks * sizeof(float) + 63) & ~(size_t)63;
+    cache->slab = (float *)aligned_alloc(64, slab_bytes);
+    cache->refs = (uint32_t *)calloc(num_blocks, sizeof(uint32_t));
+    cache->free_list = (uint32_t *)malloc(num_blocks * sizeof(uint32_t));
+    if (!cache->slab || !cache->refs || !cache->free_list) {
+        free(cache->slab);
+        free(cache->refs);
+        free(cache->free_list);
+        free(cache);
+        return NULL;
+    }
+    // Low block ids come out first
+    for (uint32_t i = 0; i < num_blocks; i++) cache->free_list[i] = num_blocks - 1 - i;
+    cache->num_free = num_blocks;
+    pthread_mutex_init(&cache->lock, NULL);
+    return cache;
+}
+
+/* Every sequence must be released first */
+void nodal_kv_cache_destroy(nodal_kv_cache_t *cache) {
+    if (!cache) return;
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->slab);
+    free(cache->refs);
+    free(cache->free_list);
+    free(cache);
+}
+
+void nodal_kv_cache_stats(nodal_kv_cache_t *cache, nodal_kv_stats_t *out) {
+    pthread_mutex_lock(&cache->lock);
+    out->num_blocks = cache->num_blocks;
+    out->free_blocks = cache->num_free;
+    out->shared_blocks = 0;
+    for (uint32_t i = 0; i < cache->num_blocks; i++) out->shared_blocks += (cache->refs[i] > 1);
+    out->block_tokens = cache->block_tokens;
+    out->block_bytes = cache->block_floats * sizeof(float);
+    out->cow_copies = cache->cow_copies;
+    pthread_mutex_unlock(&cache->lock);
+}
+
+static inline float *block_ptr(const nodal_kv_cache_t *cache, uint32_t physical) {
+    return cache->slab + (size_t)physical * cache->block_floats;
+}
+
+/**
+ * nodal_kv_seq_create
+ * Empty sequence. Its block table is sized for the whole pool up front
+ * (a sequence never maps one physical block twice), so appends never
+ * grow it on the decode path.
+ */
+nodal_kv_seq_t *nodal_kv_seq_create(nodal_kv_cache_t *cache) {
+    nodal_kv_seq_t *seq = (nodal_kv_seq_t *)calloc(1, sizeof(nodal_kv_seq_t));
+    if (!seq) return NULL;
+    seq->cache = cache;
+    seq->len = (uint32_t *)calloc(cache->num_layers, sizeof(uint32_t));
+    seq->blocks = (uint32_t *)malloc(cache->num_blocks * sizeof(uint32_t));
+    if (!seq->len || !seq->blocks) {
+        free(seq->len);
+        free(seq->blocks);
+        free(seq);
+        return NULL;
+    }
+    return seq;
+}
+
+/**
+ * nodal_kv_seq_fork
+ * New sequence sharing every block of parent; O(blocks), no K/V copy.
+ */
+nodal_kv_seq_t *nodal_kv_seq_fork(const nodal_kv_seq_t *parent) {
+    nodal_kv_seq_t *seq = nodal_kv_seq_create(parent->cache);
+    if (!seq) return NULL;
+    memcpy(seq->blocks, parent->blocks, parent->num_blocks * sizeof(uint32_t));
+    memcpy(seq->len, parent->len, parent->cache->num_layers * sizeof(uint32_t));
+    seq->num_blocks = parent->num_blocks;
+
+    pthread_mutex_lock(&seq->cache->lock);
+    for (uint32_t b = 0; b < seq->num_blocks; b++) seq->cache->refs[seq->blocks[b]]++;
+    pthread_mutex_unlock(&seq->cache->lock);
+    return seq;
+}
+
+/* Returns the sequence's blocks to the pool */
+void nodal_kv_seq_release(nodal_kv_seq_t *seq) {
+    if (!seq) return;
+    nodal_kv_cache_t *cache = seq->cache;
+    pthread_mutex_lock(&cache->lock);
+    for (uint32_t b = 0; b < seq->num_blocks; b++) {
+        uint32_t p = seq->blocks[b];
+        if (--cache->refs[p] == 0) cache->free_list[cache->num_free++] = p;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    free(seq->blocks);
+    free(seq->len);
+    free(seq);
+}
+
+/* Tokens stored in every layer */
+uint32_t nodal_kv_seq_length(const nodal_kv_seq_t *seq) {
+    uint32_t n = seq->len[0];
+    for (uint32_t l = 1; l < seq->cache->num_layers; l++) n = seq->len[l] < n ? seq->len[l] : n;
+    return n;
+}
+
+/* Tokens stored in one layer; OP_ROPE reads its first position here */
+uint32_t nodal_kv_seq_layer_length(const nodal_kv_seq_t *seq, uint32_t layer) {
+    return layer < seq->cache->num_layers ? seq->len[layer] : 0;
+}
+
+uint32_t nodal_kv_seq_block_tokens(const nodal_kv_seq_t *seq) {
+    return seq->cache->block_tokens;
+}
+
+/**
+ * nodal_kv_seq_block
+ * K of logical block b for layer: [num_kv_heads][block_tokens][head_dim],
+ * with V directly after it in the same layout.
+ */
+const float *nodal_kv_seq_block(const nodal_kv_seq_t *seq, uint32_t layer, uint32_t b) {
+    const nodal_kv_cache_t *cache = seq->cache;
+    size_t layer_floats = (size_t)2 * cache->num_kv_heads * cache->block_tokens * cache->head_dim;
+    return block_ptr(cache, seq->blocks[b]) + layer * layer_floats;
+}
+
+/**
+ * Makes logical blocks [first, last] writable: missing blocks are taken
+ * from the free list and shared ones are copied. Caller holds the lock.
+ * @return 0, or -1 (with nothing taken) when the pool has too few blocks.
+ */
+static int reserve_blocks(nodal_kv_seq_t *seq, uint32_t first, uint32_t last) {
+    nodal_kv_cache_t *cache = seq->cache;
+    uint32_t fresh_needed = 0;
+    for (uint32_t b = first; b <= last; b++) {
+        fresh_needed += (b >= seq->num_blocks || cache->refs[seq->blocks[b]] != 1);
+    }
+    if (fresh_needed > cache->num_free) return -1;
+
+    for (uint32_t b = first; b <= last; b++) {
+        if (b < seq->num_blocks && cache->refs[seq->blocks[b]] == 1) continue;
+        uint32_t fresh = cache->free_list[--cache->num_free];
+        cache->refs[fresh] = 1;
+        if (b < seq->num_blocks) {
+            uint32_t shared = seq->blocks[b];
+            memcpy(block_ptr(cache, fresh), block_ptr(cache, shared), cache->block_floats * sizeof(float));
+            cache->refs[shared]--;
+            cache->cow_copies++;
+            seq->blocks[b] = fresh;
+        } else {
+            seq->blocks[seq->num_blocks++] = fresh;
+        }
+    }
+    return 0;
+}
+
+/**
+ * nodal_kv_seq_append
+ * Appends n tokens of K and V ([n][num_kv_heads][head_dim] each) to
+ * layer's cache, allocating or un-sharing the blocks they land in.
+ * @return Position of the first new token, or -1 on a shape mismatch
+ * or an exhausted pool (the sequence is left unchanged).
+ */
+long nodal_kv_seq_append(nodal_kv_seq_t *seq, uint32_t layer, const float *k, const float *v, uint32_t n,
+                         uint32_t num_kv_heads, uint32_t head_dim) {
+    nodal_kv_cache_t *cache = seq->cache;
+    if (layer >= cache->num_layers || num_kv_heads != cache->num_kv_heads || head_dim != cache->head_dim) {
+        fprintf(stderr, "[KV] Layer %u with %u x %u heads does not match the cache\n", layer, num_kv_heads, head_dim);
+        return -1;
+    }
+    if (n == 0) return seq->len[layer];
+
+    // 1. Writable blocks for the new positions; the table already has room for the pool
+    const uint32_t bt = cache->block_tokens, pos0 = seq->len[layer];
+    uint64_t need = ((uint64_t)pos0 + n + bt - 1) / bt;
+    int rc = -1;
+    if (need <= cache->num_blocks) {
+        pthread_mutex_lock(&cache->lock);
+        rc = reserve_blocks(seq, pos0 / bt, (uint32_t)need - 1);
+        pthread_mutex_unlock(&cache->lock);
+    }
+    if (rc != 0) {
+        fprintf(stderr, "[KV] Cache out of blocks (%u in use)\n", cache->num_blocks);
+        return -1;
+    }
+
+    // 2. Scatter into the head-major block layout
+    const size_t head_floats = (size_t)bt * head_dim;
+    const size_t kv_floats = num_kv_heads * head_floats;
+    for (uint32_t t = 0; t < n; t++) {
+        uint32_t pos = pos0 + t;
+        float *K = (float *)nodal_kv_seq_block(seq, layer, pos / bt) + (size_t)(pos % bt) * head_dim;
+        for (uint32_t g = 0; g < num_kv_heads; g++) {
+            const size_t src = ((size_t)t * num_kv_heads + g) * head_dim;
+            memcpy(K + g * head_floats, k + src, head_dim * sizeof(float));
+            memcpy(K + kv_floats + g * head_floats, v + src, head_dim * sizeof(float));
+        }
+    }
+    seq->len[layer] = pos0 + n;
+    return pos0;
+}
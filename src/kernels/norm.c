@@ -0,0 +1,239 @@
+/*
+ * norm.c - Row-Batched RMSNorm and LayerNorm
+ * Each row is read once for its statistics (sum and sum of squares
+ * together) and once more to write x * inv_std * gamma (+ beta), so the
+ * scale is applied in the same pass that normalizes. LayerNorm sums
+ * around the row's first element, which keeps the one-pass variance
+ * from cancelling on rows with a large mean. Rows are split over the
+ * worker pool with AVX-512 and AVX2/FMA bodies picked via CPUID.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+#include <stdint.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+#define NORM_GRAIN (1u << 14) // Elements per task
+
+/*
+ * Row primitives over n elements: sums of (x - c) and (x - c)^2, and
+ * out = (x - mean) * inv * gamma + beta with gamma and beta optional.
+ */
+typedef struct {
+    void (*stats)(const float *x, uint32_t n, float c, float *sum, float *sumsq);
+    void (*apply)(const float *x, const float *g, const float *b, float *out, uint32_t n, float mean, float inv);
+} norm_isa_t;
+
+/* --- Scalar --- */
+
+static void stats_scalar(const float *x, uint32_t n, float c, float *sum, float *sumsq) {
+    float s = 0.0f, q = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        float d = x[i] - c;
+        s += d;
+        q += d * d;
+    }
+    *sum += s;
+    *sumsq += q;
+}
+
+static void apply_scalar(const float *x, const float *g, const float *b, float *out, uint32_t n, float mean, float inv) {
+    for (uint32_t i = 0; i < n; i++) {
+        float v = (x[i] - mean) * inv * (g ? g[i] : 1.0f);
+        out[i] = b ? v + b[i] : v;
+    }
+}
+
+static const norm_isa_t NORM_SCALAR = { stats_scalar, apply_scalar };
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* --- AVX-512 --- */
+
+/* Two accumulator pairs so the FMA chains overlap */
+__attribute__((target("avx512f")))
+static void stats_avx512(const float *x, uint32_t n, float c, float *sum, float *sumsq) {
+    const __m512 vc = _mm512_set1_ps(c);
+    __m512 s0 = _mm512_setzero_ps(), s1 = _mm512_setzero_ps();
+    __m512 q0 = _mm512_setzero_ps(), q1 = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(x + i), vc);
+        __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(x + i + 16), vc);
+        s0 = _mm512_add_ps(s0, d0);
+        s1 = _mm512_add_ps(s1, d1);
+        q0 = _mm512_fmadd_ps(d0, d0, q0);
+        q1 = _mm512_fmadd_ps(d1, d1, q1);
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m512 d = _mm512_sub_ps(_mm512_loadu_ps(x + i), vc);
+        s0 = _mm512_add_ps(s0, d);
+        q0 = _mm512_fmadd_ps(d, d, q0);
+    }
+    *sum += _mm512_reduce_add_ps(_mm512_add_ps(s0, s1));
+    *sumsq += _mm512_reduce_add_ps(_mm512_add_ps(q0, q1));
+    stats_scalar(x + i, n - i, c, sum, sumsq);
+}
+
+__attribute__((target("avx512f")))
+static void apply_avx512(const float *x, const float *g, const float *b, float *out, uint32_t n, float mean, float inv) {
+    const __m512 vm = _mm512_set1_ps(mean), vi = _mm512_set1_ps(inv);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 v = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(x + i), vm), vi);
+        if (g) v = _mm512_mul_ps(v, _mm512_loadu_ps(g + i));
+        if (b) v = _mm512_add_ps(v, _mm512_loadu_ps(b + i));
+        _mm512_storeu_ps(out + i, v);
+    }
+    apply_scalar(x + i, g ? g + i : NULL, b ? b + i : NULL, out + i, n - i, mean, inv);
+}
+
+static const norm_isa_t NORM_AVX512 = { stats_avx512, apply_avx512 };
+
+/* --- AVX2 --- */
+
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2(__m256 v) {
+    __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static void stats_avx2(const float *x, uint32_t n, float c, float *sum, float *sumsq) {
+    const __m256 vc = _mm256_set1_ps(c);
+    __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+    __m256 q0 = _mm256_setzero_ps(), q1 = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(x + i), vc);
+        __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(x + i + 8), vc);
+        s0 = _mm256_add_ps(s0, d0);
+        s1 = _mm256_add_ps(s1, d1);
+        q0 = _mm256_fmadd_ps(d0, d0, q0);
+        q1 = _mm256_fmadd_ps(d1, d1, q1);
+    }
+    for (; i + 8 <= n; i += 8) {
+        __m256 d = _mm256_sub_ps(_mm256_loadu_ps(x + i), vc);
+        s0 = _mm256_add_ps(s0, d);
+        q0 = _mm256_fmadd_ps(d, d, q0);
+    }
+    *sum += hsum_avx2(_mm256_add_ps(s0, s1));
+    *sumsq += hsum_avx2(_mm256_add_ps(q0, q1));
+    stats_scalar(x + i, n - i, c, sum, sumsq);
+}
+
+__attribute__((target("avx2,fma")))
+static void apply_avx2(const float *x, const float *g, const float *b, float *out, uint32_t n, float mean, float inv) {
+    const __m256 vm = _mm256_set1_ps(mean), vi = _mm256_set1_ps(inv);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(x + i), vm), vi);
+        if (g) v = _mm256_mul_ps(v, _mm256_loadu_ps(g + i));
+        if (b) v = _mm256_add_ps(v, _mm256_loadu_ps(b + i));
+        _mm256_storeu_ps(out + i, v);
+    }
+    apply_scalar(x + i, g ? g + i : NULL, b ? b + i : NULL, out + i, n - i, mean, inv);
+}
+
+static const norm_isa_t NORM_AVX2 = { stats_avx2, apply_avx2 };
+#endif
+
+static const norm_isa_t *norm_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return &NORM_AVX512;
+    if (isa == NODAL_ISA_AVX2) return &NORM_AVX2;
+#endif
+    return &NORM_SCALAR;
+}
+
+/* --- Row Scheduling --- */
+
+typedef struct {
+    const norm_isa_t *isa;
+    const float *x, *gamma, *beta;
+    float *out;
+    uint32_t n;
+    uint32_t rows;
+    uint32_t rows_per_task;
+    float eps;
+    int center;                    // LayerNorm: subtract the mean
+} norm_job_t;
+
+static void norm_row(const norm_job_t *job, uint32_t r) {
+    const size_t off = (size_t)r * job->n;
+    const float *x = job->x + off;
+    float c = job->center ? x[0] : 0.0f;
+    float sum = 0.0f, sumsq = 0.0f;
+    job->isa->stats(x, job->n, c, &sum, &sumsq);
+
+    float mean = 0.0f, var = sumsq / job->n;
+    if (job->center) {
+        float d = sum / job->n;
+        mean = c + d;
+        var = fmaxf(var - d * d, 0.0f);
+    }
+    job->isa->apply(x, job->gamma, job->beta, job->out + off, job->n, mean, 1.0f / sqrtf(var + job->eps));
+}
+
+static void norm_task(void *ctx, uint32_t task) {
+    const norm_job_t *job = (const norm_job_t *)ctx;
+    uint32_t begin = task * job->rows_per_task;
+    uint32_t end = (job->rows - begin < job->rows_per_task) ? job->rows : begin + job->rows_per_task;
+    for (uint32_t r = begin; r < end; r++) norm_row(job, r);
+}
+
+static void norm_call(const nodal_call_t *call, int center) {
+    norm_job_t job;
+    const nodal_scalar_t *s = call->scalars;
+    job.isa = norm_isa();
+    job.x = (const float *)call->inputs[0].ptr;
+    job.gamma = (const float *)call->inputs[1].ptr;
+    job.beta = center ? (const float *)call->inputs[2].ptr : NULL;
+    job.out = (float *)call->outputs[0].ptr;
+    job.n = s[0].v.u32;
+    job.rows = s[1].v.u32 ? s[1].v.u32 : 1;
+    job.eps = (s[2].kind == NODAL_F32 && s[2].v.f32 > 0.0f) ? s[2].v.f32 : NODAL_NORM_EPS;
+    job.center = center;
+    if (job.n == 0) return;
+
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, (size_t)job.n * job.rows, NORM_GRAIN);
+    if (tasks > job.rows) tasks = job.rows;
+    job.rows_per_task = (job.rows + tasks - 1) / tasks;
+    nodal_pool_run(pool, norm_task, &job, (job.rows + job.rows_per_task - 1) / job.rows_per_task);
+}
+
+/**
+ * OP_RMSNORM (Vectorized, Threaded F32)
+ * Row-wise over [rows, size]; see nodal_kernel_rmsnorm_generic for the
+ * scalar contract.
+ */
+void nodal_kernel_rmsnorm_f32(const nodal_call_t *call) {
+    norm_call(call, 0);
+}
+
+/**
+ * OP_LAYERNORM (Vectorized, Threaded F32)
+ * Row-wise over [rows, size]; see nodal_kernel_layernorm_generic for
+ * the scalar contract.
+ */
+void nodal_kernel_layernorm_f32(const nodal_call_t *call) {
+    norm_call(call, 1);
+}
+
+/**
+ * nodal_norm_splits
+ * Whether OP_RMSNORM / OP_LAYERNORM with these scalars is more than one
+ * task's worth of elements; tasks own whole rows.
+ */
+int nodal_norm_splits(const nodal_scalar_t *s) {
+    return s[1].v.u32 > 1 && (uint64_t)s[0].v.u32 * s[1].v.u32 > NORM_GRAIN;
+}
@@ -0,0 +1,201 @@
+/*
+ * rope.c - Rotary Position Embedding
+ * Rotates each (a, b) pair of a head by its position's angle, in place
+ * or into a separate output. The cos/sin of a token are built once into
+ * per-element tables and shared by all of its heads, so the rotation
+ * itself is one multiply and one FMA per element: a pair-swapping
+ * permute for interleaved pairs, or the two head halves for NeoX-style
+ * pairs. Tokens are split over the worker pool.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern uint32_t nodal_kv_seq_layer_length(const nodal_kv_seq_t *seq, uint32_t layer);
+
+#define ROPE_GRAIN        (1u << 14) // Elements per task
+#define ROPE_MAX_HEAD_DIM 256        // Matches the KV cache's limit
+
+/*
+ * One head: out[j] = x[j] * C[j] + x[partner(j)] * S[j], where C holds
+ * cos and S holds -sin on a pair's first element and +sin on its second.
+ */
+typedef void (*rope_fn)(const float *x, float *out, const float *C, const float *S, uint32_t d, int neox);
+
+/* --- Scalar --- */
+
+/* Pairs [from, d/2); both elements are read before either is written */
+static void rotate_pairs(const float *x, float *out, const float *C, const float *S, uint32_t d, int neox,
+                         uint32_t from) {
+    const uint32_t half = d / 2;
+    for (uint32_t p = from; p < half; p++) {
+        uint32_t ia = neox ? p : 2 * p, ib = neox ? p + half : 2 * p + 1;
+        float a = x[ia], b = x[ib];
+        out[ia] = a * C[ia] + b * S[ia];
+        out[ib] = b * C[ib] + a * S[ib];
+    }
+}
+
+static void rope_scalar(const float *x, float *out, const float *C, const float *S, uint32_t d, int neox) {
+    rotate_pairs(x, out, C, S, d, neox, 0);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* --- AVX-512 --- */
+
+__attribute__((target("avx512f")))
+static void rope_avx512(const float *x, float *out, const float *C, const float *S, uint32_t d, int neox) {
+    const uint32_t half = d / 2;
+    uint32_t p = 0;
+    if (neox) {
+        for (; p + 16 <= half; p += 16) {
+            __m512 lo = _mm512_loadu_ps(x + p), hi = _mm512_loadu_ps(x + half + p);
+            __m512 olo = _mm512_fmadd_ps(lo, _mm512_loadu_ps(C + p), _mm512_mul_ps(hi, _mm512_loadu_ps(S + p)));
+            __m512 ohi = _mm512_fmadd_ps(hi, _mm512_loadu_ps(C + half + p),
+                                         _mm512_mul_ps(lo, _mm512_loadu_ps(S + half + p)));
+            _mm512_storeu_ps(out + p, olo);
+            _mm512_storeu_ps(out + half + p, ohi);
+        }
+    } else {
+        for (; 2 * p + 16 <= d; p += 8) {
+            __m512 v = _mm512_loadu_ps(x + 2 * p);
+            __m512 sw = _mm512_permute_ps(v, 0xB1); // (a, b) -> (b, a)
+            _mm512_storeu_ps(out + 2 * p, _mm512_fmadd_ps(v, _mm512_loadu_ps(C + 2 * p),
+                                                          _mm512_mul_ps(sw, _mm512_loadu_ps(S + 2 * p))));
+        }
+    }
+    rotate_pairs(x, out, C, S, d, neox, p);
+}
+
+/* --- AVX2 --- */
+
+__attribute__((target("avx2,fma")))
+static void rope_avx2(const float *x, float *out, const float *C, const float *S, uint32_t d, int neox) {
+    const uint32_t half = d / 2;
+    uint32_t p = 0;
+    if (neox) {
+        for (; p + 8 <= half; p += 8) {
+            __m256 lo = _mm256_loadu_ps(x + p), hi = _mm256_loadu_ps(x + half + p);
+            __m256 olo = _mm256_fmadd_ps(lo, _mm256_loadu_ps(C + p), _mm256_mul_ps(hi, _mm256_loadu_ps(S + p)));
+            __m256 ohi = _mm256_fmadd_ps(hi, _mm256_loadu_ps(C + half + p),
+                                         _mm256_mul_ps(lo, _mm256_loadu_ps(S + half + p)));
+            _mm256_storeu_ps(out + p, olo);
+            _mm256_storeu_ps(out + half + p, ohi);
+        }
+    } else {
+        for (; 2 * p + 8 <= d; p += 4) {
+            __m256 v = _mm256_loadu_ps(x + 2 * p);
+            __m256 sw = _mm256_permute_ps(v, 0xB1);
+            _mm256_storeu_ps(out + 2 * p, _mm256_fmadd_ps(v, _mm256_loadu_ps(C + 2 * p),
+                                                          _mm256_mul_ps(sw, _mm256_loadu_ps(S + 2 * p))));
+        }
+    }
+    rotate_pairs(x, out, C, S, d, neox, p);
+}
+#endif
+
+static rope_fn rope_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return rope_avx512;
+    if (isa == NODAL_ISA_AVX2) return rope_avx2;
+#endif
+    return rope_scalar;
+}
+
+/* --- Token Scheduling --- */
+
+typedef struct {
+    rope_fn fn;
+    const float *x;
+    float *out;
+    uint32_t n;
+    uint32_t heads;
+    uint32_t head_dim;
+    uint32_t pos0;
+    int neox;
+    uint32_t tokens_per_task;
+    float inv_freq[ROPE_MAX_HEAD_DIM / 2];  // theta^(-2i / head_dim)
+} rope_job_t;
+
+static void rope_task(void *ctx, uint32_t task) {
+    const rope_job_t *job = (const rope_job_t *)ctx;
+    const uint32_t d = job->head_dim, half = d / 2;
+    uint32_t begin = task * job->tokens_per_task;
+    uint32_t end = (job->n - begin < job->tokens_per_task) ? job->n : begin + job->tokens_per_task;
+    float C[ROPE_MAX_HEAD_DIM], S[ROPE_MAX_HEAD_DIM];
+
+    for (uint32_t t = begin; t < end; t++) {
+        // 1. This position's tables, laid out like the head
+        for (uint32_t i = 0; i < half; i++) {
+            float angle = (float)(job->pos0 + t) * job->inv_freq[i];
+            float c = cosf(angle), s = sinf(angle);
+            uint32_t ia = job->neox ? i : 2 * i, ib = job->neox ? i + half : 2 * i + 1;
+            C[ia] = c;
+            C[ib] = c;
+            S[ia] = -s;
+            S[ib] = s;
+        }
+
+        // 2. Rotate every head of the token
+        for (uint32_t h = 0; h < job->heads; h++) {
+            size_t off = ((size_t)t * job->heads + h) * d;
+            job->fn(job->x + off, job->out + off, C, S, d, job->neox);
+        }
+    }
+}
+
+/**
+ * OP_ROPE (Vectorized, Threaded F32)
+ * See nodal_kernel_rope_generic for the contract; head_dim is limited
+ * to ROPE_MAX_HEAD_DIM, and an odd or larger one zeroes the output.
+ */
+void nodal_kernel_rope_f32(const nodal_call_t *call) {
+    rope_job_t job;
+    const nodal_scalar_t *s = call->scalars;
+    const nodal_kv_seq_t *seq = (const nodal_kv_seq_t *)call->inputs[1].ptr;
+    job.fn = rope_isa();
+    job.x = (const float *)call->inputs[0].ptr;
+    job.out = (float *)call->outputs[0].ptr;
+    job.n = s[0].v.u32;
+    job.heads = s[1].v.u32;
+    job.head_dim = s[2].v.u32;
+    job.pos0 = seq ? nodal_kv_seq_layer_length(seq, s[4].v.u32) : s[3].v.u32;
+    job.neox = (s[6].v.u32 & NODAL_ROPE_NEOX) != 0;
+    float theta = (s[5].kind == NODAL_F32 && s[5].v.f32 > 0.0f) ? s[5].v.f32 : NODAL_ROPE_THETA;
+    if (job.n == 0 || job.heads == 0) return;
+
+    if (job.head_dim == 0 || job.head_dim % 2 || job.head_dim > ROPE_MAX_HEAD_DIM) {
+        fprintf(stderr, "[EXEC] OP_ROPE needs an even head_dim of at most %u (got %u)\n", ROPE_MAX_HEAD_DIM,
+                job.head_dim);
+        memset(job.out, 0, (size_t)job.n * job.heads * job.head_dim * sizeof(float));
+        return;
+    }
+    for (uint32_t i = 0; i < job.head_dim / 2; i++) {
+        job.inv_freq[i] = powf(theta, -2.0f * (float)i / (float)job.head_dim);
+    }
+
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, (size_t)job.n * job.heads * job.head_dim, ROPE_GRAIN);
+    if (tasks > job.n) tasks = job.n;
+    job.tokens_per_task = (job.n + tasks - 1) / tasks;
+    nodal_pool_run(pool, rope_task, &job, (job.n + job.tokens_per_task - 1) / job.tokens_per_task);
+}
+
+/**
+ * nodal_rope_splits
+ * Whether OP_ROPE with these scalars is more than one task's worth of
+ * elements; tasks own whole tokens.
+ */
+int nodal_rope_splits(const nodal_scalar_t *s) {
+    return s[0].v.u32 > 1 && (uint64_t)s[0].v.u32 * s[1].v.u32 * s[2].v.u32 > ROPE_GRAIN;
+}
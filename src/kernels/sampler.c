@@ -0,0 +1,670 @@
+/*
+ * sampler.c - Logits Sampling with Vectorized Scans and Partial Selection
+ * Greedy, temperature, top-k, top-p and repetition penalty without
+ * sorting the vocabulary or storing its probabilities. A max pass anchors
+ * everything; a profile pass then counts the logits above a ladder of
+ * thresholds below the max, and only the tokens above the tightest rung
+ * that can hold the answer are collected and exponentiated. Top-k is a
+ * quickselect over those; top-p pops a heap only until the nucleus is
+ * full, and keeps the draw once the counts prove the tokens left out
+ * cannot move its cut. Plain temperature sampling weighs the vocabulary
+ * once in chunks and walks only the chunk the draw lands in. The ladder
+ * ends temperature * (ln vocab + SAMPLE_TAIL) below the max, where the
+ * rest of the vocabulary weighs under e^-SAMPLE_TAIL of the top token.
+ * Rows are split over the worker pool; each task draws into its own
+ * slot of the planner-sized scratch in outputs[1], so no row allocates.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern uint64_t nodal_rng_seed(uint64_t key);
+extern float nodal_rng_uniform(uint64_t *state);
+
+#define SAMPLE_GRAIN  (1u << 16) // Logits per task
+#define SAMPLE_TAIL   16.0f      // Mass below the ladder stays under e^-16 of the top token
+#define SAMPLE_LEVELS 8          // Ladder rungs, halving the distance to the max each step
+#define SAMPLE_CHUNK  1024       // Logits summed per step of the temperature walk
+#define SAMPLE_MAX_CHUNKS 512    // Chunk sums kept on the stack; larger vocabularies use longer chunks
+#define SAMPLE_NUCLEUS_SPLIT 4   // Left-out weight may take 1 / 4 of the slack around the nucleus cut
+#define SAMPLE_RETRY  UINT32_MAX // draw(): the left-out weight could move the nucleus cut
+#define SAMPLE_GOLD   0x9E3779B97F4A7C15ull
+
+/*
+ * Scans over n logits: the max (NaN ignored); the ids and values of
+ * those >= theta in ascending id order, returning how many; and a
+ * profile that adds, per level l, the count of logits >= lv[l] and
+ * (with weigh) the sum of their exp((x - m) * inv_t) to count[l] /
+ * mass[l], and the sum over all n to *total.
+ */
+typedef struct {
+    float (*max)(const float *x, uint32_t n);
+    uint32_t (*collect)(const float *x, uint32_t n, float theta, uint32_t *ids, float *z);
+    void (*profile)(const float *x, uint32_t n, float m, float inv_t, const float *lv, uint32_t levels,
+                    uint32_t *count, float *mass, float *total, int weigh);
+} sample_isa_t;
+
+/* --- Scalar --- */
+
+static float max_scalar(const float *x, uint32_t n) {
+    float m = -INFINITY;
+    for (uint32_t i = 0; i < n; i++) m = (x[i] > m) ? x[i] : m;
+    return m;
+}
+
+static uint32_t collect_scalar(const float *x, uint32_t n, float theta, uint32_t *ids, float *z) {
+    uint32_t c = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (x[i] >= theta) {
+            ids[c] = i;
+            z[c++] = x[i];
+        }
+    }
+    return c;
+}
+
+static void profile_scalar(const float *x, uint32_t n, float m, float inv_t, const float *lv, uint32_t levels,
+                           uint32_t *count, float *mass, float *total, int weigh) {
+    double t = 0.0;  // A running float sum would drift over a whole vocabulary
+    for (uint32_t i = 0; i < n; i++) {
+        float w = weigh ? nodal_exp_scalar((x[i] - m) * inv_t) : 0.0f;
+        t += w;
+        for (uint32_t l = 0; l < levels; l++) {
+            if (x[i] < lv[l]) continue;
+            count[l]++;
+            if (weigh) mass[l] += w;
+        }
+    }
+    if (weigh) *total += (float)t;
+}
+
+static const sample_isa_t SAMPLE_SCALAR = { max_scalar, collect_scalar, profile_scalar };
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* --- AVX-512 --- */
+
+/* max_ps returns its second operand on NaN, so the accumulator goes second */
+__attribute__((target("avx512f")))
+static float max_avx512(const float *x, uint32_t n) {
+    const __m512 ninf = _mm512_set1_ps(-INFINITY);
+    __m512 m0 = ninf, m1 = ninf;
+    uint32_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        m0 = _mm512_max_ps(_mm512_loadu_ps(x + i), m0);
+        m1 = _mm512_max_ps(_mm512_loadu_ps(x + i + 16), m1);
+    }
+    for (; i + 16 <= n; i += 16) m0 = _mm512_max_ps(_mm512_loadu_ps(x + i), m0);
+    if (i < n) m1 = _mm512_max_ps(_mm512_mask_loadu_ps(ninf, (__mmask16)((1u << (n - i)) - 1), x + i), m1);
+    return _mm512_reduce_max_ps(_mm512_max_ps(m0, m1));
+}
+
+__attribute__((target("avx512f")))
+static uint32_t collect_avx512(const float *x, uint32_t n, float theta, uint32_t *ids, float *z) {
+    const __m512 th = _mm512_set1_ps(theta);
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512i idx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    uint32_t c = 0;
+    for (uint32_t i = 0; i < n; i += 16, idx = _mm512_add_epi32(idx, step)) {
+        __mmask16 live = (n - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+        __m512 v = _mm512_maskz_loadu_ps(live, x + i);
+        __mmask16 keep = _mm512_mask_cmp_ps_mask(live, v, th, _CMP_GE_OQ);
+        if (!keep) continue;
+        _mm512_mask_compressstoreu_ps(z + c, keep, v);
+        _mm512_mask_compressstoreu_epi32(ids + c, keep, idx);
+        c += (uint32_t)__builtin_popcount(keep);
+    }
+    return c;
+}
+
+__attribute__((target("avx512f")))
+static void profile_avx512(const float *x, uint32_t n, float m, float inv_t, const float *lv, uint32_t levels,
+                           uint32_t *count, float *mass, float *total, int weigh) {
+    const __m512 vm = _mm512_set1_ps(m), vt = _mm512_set1_ps(inv_t);
+    __m512 vl[SAMPLE_LEVELS], acc[SAMPLE_LEVELS], tot = _mm512_setzero_ps();
+    for (uint32_t l = 0; l < levels; l++) {
+        vl[l] = _mm512_set1_ps(lv[l]);
+        acc[l] = _mm512_setzero_ps();
+    }
+    for (uint32_t i = 0; i < n; i += 16) {
+        __mmask16 live = (n - i >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (n - i)) - 1);
+        __m512 v = _mm512_maskz_loadu_ps(live, x + i);
+        __m512 w = _mm512_setzero_ps();
+        if (weigh) {
+            w = _mm512_maskz_mov_ps(live, nodal_exp_avx512(_mm512_mul_ps(_mm512_sub_ps(v, vm), vt)));
+            tot = _mm512_add_ps(tot, w);
+        }
+        for (uint32_t l = 0; l < levels; l++) {
+            __mmask16 k = _mm512_mask_cmp_ps_mask(live, v, vl[l], _CMP_GE_OQ);
+            count[l] += (uint32_t)__builtin_popcount(k);
+            acc[l] = _mm512_mask_add_ps(acc[l], k, acc[l], w);
+        }
+    }
+    if (!weigh) return;
+    *total += _mm512_reduce_add_ps(tot);
+    for (uint32_t l = 0; l < levels; l++) mass[l] += _mm512_reduce_add_ps(acc[l]);
+}
+
+static const sample_isa_t SAMPLE_AVX512 = { max_avx512, collect_avx512, profile_avx512 };
+
+/* --- AVX2 --- */
+
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2(__m256 v) {
+    __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static float max_avx2(const float *x, uint32_t n) {
+    const __m256 ninf = _mm256_set1_ps(-INFINITY);
+    __m256 m0 = ninf, m1 = ninf;
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        m0 = _mm256_max_ps(_mm256_loadu_ps(x + i), m0);
+        m1 = _mm256_max_ps(_mm256_loadu_ps(x + i + 8), m1);
+    }
+    m0 = _mm256_max_ps(m0, m1);
+    __m128 h = _mm_max_ps(_mm256_castps256_ps128(m0), _mm256_extractf128_ps(m0, 1));
+    h = _mm_max_ps(h, _mm_movehl_ps(h, h));
+    h = _mm_max_ss(h, _mm_shuffle_ps(h, h, 1));
+    float m = _mm_cvtss_f32(h), t = max_scalar(x + i, n - i);
+    return (t > m) ? t : m;
+}
+
+/* Survivors are rare, so the mask is walked bit by bit */
+__attribute__((target("avx2,fma")))
+static uint32_t collect_avx2(const float *x, uint32_t n, float theta, uint32_t *ids, float *z) {
+    const __m256 th = _mm256_set1_ps(theta);
+    uint32_t c = 0, i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t keep = (uint32_t)_mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x + i), th, _CMP_GE_OQ));
+        while (keep) {
+            uint32_t j = i + (uint32_t)__builtin_ctz(keep);
+            ids[c] = j;
+            z[c++] = x[j];
+            keep &= keep - 1;
+        }
+    }
+    uint32_t t = collect_scalar(x + i, n - i, theta, ids + c, z + c);
+    for (uint32_t j = c; j < c + t; j++) ids[j] += i;
+    return c + t;
+}
+
+__attribute__((target("avx2,fma")))
+static void profile_avx2(const float *x, uint32_t n, float m, float inv_t, const float *lv, uint32_t levels,
+                         uint32_t *count, float *mass, float *total, int weigh) {
+    const __m256 vm = _mm256_set1_ps(m), vt = _mm256_set1_ps(inv_t);
+    __m256 vl[SAMPLE_LEVELS], acc[SAMPLE_LEVELS], tot = _mm256_setzero_ps();
+    for (uint32_t l = 0; l < levels; l++) {
+        vl[l] = _mm256_set1_ps(lv[l]);
+        acc[l] = _mm256_setzero_ps();
+    }
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(x + i);
+        __m256 w = _mm256_setzero_ps();
+        if (weigh) {
+            w = nodal_exp_avx2(_mm256_mul_ps(_mm256_sub_ps(v, vm), vt));
+            tot = _mm256_add_ps(tot, w);
+        }
+        for (uint32_t l = 0; l < levels; l++) {
+            __m256 k = _mm256_cmp_ps(v, vl[l], _CMP_GE_OQ);
+            count[l] += (uint32_t)__builtin_popcount((uint32_t)_mm256_movemask_ps(k));
+            acc[l] = _mm256_add_ps(acc[l], _mm256_and_ps(k, w));
+        }
+    }
+    if (weigh) {
+        *total += hsum_avx2(tot);
+        for (uint32_t l = 0; l < levels; l++) mass[l] += hsum_avx2(acc[l]);
+    }
+    profile_scalar(x + i, n - i, m, inv_t, lv, levels, count, mass, total, weigh);
+}
+
+static const sample_isa_t SAMPLE_AVX2 = { max_avx2, collect_avx2, profile_avx2 };
+#endif
+
+static const sample_isa_t *sample_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return &SAMPLE_AVX512;
+    if (isa == NODAL_ISA_AVX2) return &SAMPLE_AVX2;
+#endif
+    return &SAMPLE_SCALAR;
+}
+
+/* --- Candidate Selection --- */
+
+typedef struct {
+    float z;
+    uint32_t id;
+} sample_cand_t;
+
+/* Sampling order: higher logit first, lower id on ties */
+static inline int ranks_before(const sample_cand_t *a, const sample_cand_t *b) {
+    return a->z > b->z || (a->z == b->z && a->id < b->id);
+}
+
+static inline void swap_u32(uint32_t *a, uint32_t *b) {
+    uint32_t t = *a;
+    *a = *b;
+    *b = t;
+}
+
+/* Reorders idx[0, n) so idx[k] is the candidate of rank k (ranks are distinct) */
+static void select_rank(const sample_cand_t *c, uint32_t *idx, uint32_t n, uint32_t k) {
+    uint32_t lo = 0, hi = n - 1;
+    while (lo < hi) {
+        swap_u32(&idx[lo + (hi - lo) / 2], &idx[hi]);
+        const sample_cand_t *pivot = &c[idx[hi]];
+        uint32_t store = lo;
+        for (uint32_t i = lo; i < hi; i++) {
+            if (ranks_before(&c[idx[i]], pivot)) swap_u32(&idx[i], &idx[store++]);
+        }
+        swap_u32(&idx[store], &idx[hi]);
+        if (k == store) return;
+        if (k < store) hi = store - 1;
+        else lo = store + 1;
+    }
+}
+
+static void heap_down(const sample_cand_t *c, uint32_t *heap, uint32_t n, uint32_t at) {
+    for (;;) {
+        uint32_t best = at, l = 2 * at + 1, r = l + 1;
+        if (l < n && ranks_before(&c[heap[l]], &c[heap[best]])) best = l;
+        if (r < n && ranks_before(&c[heap[r]], &c[heap[best]])) best = r;
+        if (best == at) return;
+        swap_u32(&heap[at], &heap[best]);
+        at = best;
+    }
+}
+
+/* Drops the candidates ranked after key, keeping ascending id order */
+static uint32_t keep_through(sample_cand_t *c, float *w, uint32_t n, sample_cand_t key) {
+    uint32_t m = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        if (ranks_before(&key, &c[i])) continue;
+        if (w) w[m] = w[i];
+        c[m++] = c[i];
+    }
+    return m;
+}
+
+/* --- Scratch --- */
+
+/* One row's candidate buffers; merged candidates never exceed vocab */
+typedef struct {
+    uint32_t *raw_ids;             // Ids collected above theta
+    float *raw_z;                  // Their logits
+    sample_cand_t *cand;           // Raw merged with the penalized history
+    float *w;                      // Candidate weights
+    uint32_t *idx;                 // Quickselect / heap order
+} sample_slot_t;
+
+static inline size_t slot_bytes(uint32_t vocab) {
+    return (size_t)vocab * (2 * sizeof(uint32_t) + 2 * sizeof(float) + sizeof(sample_cand_t));
+}
+
+/* Shared by every row: a bitmap deduplicating the history and its distinct ids */
+static inline size_t hist_bytes(uint32_t vocab) {
+    return ((size_t)vocab + 63) / 64 * sizeof(uint64_t) + (size_t)vocab * sizeof(uint32_t);
+}
+
+static sample_slot_t slot_at(uint8_t *scratch, uint32_t vocab, uint32_t slot) {
+    uint8_t *p = scratch + hist_bytes(vocab) + (size_t)slot * slot_bytes(vocab);
+    sample_slot_t sl;
+    sl.cand = (sample_cand_t *)p;
+    sl.raw_ids = (uint32_t *)(sl.cand + vocab);
+    sl.raw_z = (float *)(sl.raw_ids + vocab);
+    sl.w = sl.raw_z + vocab;
+    sl.idx = (uint32_t *)(sl.w + vocab);
+    return sl;
+}
+
+/**
+ * nodal_sample_scratch_bytes
+ * Bytes OP_SAMPLE needs in outputs[1] for rows rows of vocab logits:
+ * the history once, plus one candidate slot per row drawn at the same
+ * time (at most NODAL_SAMPLE_SLOTS). Fewer slots only serialize rows.
+ */
+size_t nodal_sample_scratch_bytes(uint32_t vocab, uint32_t rows) {
+    uint32_t slots = rows ? rows : 1;
+    if (slots > NODAL_SAMPLE_SLOTS) slots = NODAL_SAMPLE_SLOTS;
+    return hist_bytes(vocab) + (size_t)slots * slot_bytes(vocab);
+}
+
+/* --- Row Scheduling --- */
+
+typedef struct {
+    const sample_isa_t *isa;
+    const float *logits;
+    const uint32_t *hist;          // Distinct penalized ids, ascending
+    uint64_t *states;
+    uint32_t *out;
+    uint8_t *scratch;              // outputs[1]: history, then one slot per task
+    uint32_t vocab;
+    uint32_t rows;
+    uint32_t n_hist;               // Ids in hist
+    uint32_t hist_count;           // History length as bound (seeds runs without states)
+    uint32_t top_k;
+    uint32_t seed;
+    float temp;
+    float top_p;
+    float penalty;
+    uint32_t rows_per_task;
+} sample_job_t;
+
+static inline float penalize(const sample_job_t *job, float v) {
+    return v > 0.0f ? v / job->penalty : v * job->penalty;
+}
+
+static uint64_t *row_state(const sample_job_t *job, uint32_t r, uint64_t *tmp) {
+    *tmp = nodal_rng_seed(((uint64_t)job->seed << 32 | job->hist_count) + r * SAMPLE_GOLD);
+    uint64_t *state = job->states ? &job->states[r] : tmp;
+    if (*state == 0) *state = nodal_rng_seed(((uint64_t)job->seed << 32) + r * SAMPLE_GOLD);
+    return state;
+}
+
+/* Rungs m - window / 2^(SAMPLE_LEVELS - 1 - l): the tightest first, the window last */
+static void ladder(float m, float window, float *lv) {
+    for (uint32_t l = 0; l < SAMPLE_LEVELS; l++) lv[l] = m - ldexpf(window, (int)l - (SAMPLE_LEVELS - 1));
+}
+
+/* Survivors >= theta merged with the penalized history; returns the count and their max */
+static uint32_t gather(const sample_job_t *job, const sample_slot_t *sl, const float *x, float theta, float *zmax) {
+    uint32_t raw = job->isa->collect(x, job->vocab, theta, sl->raw_ids, sl->raw_z);
+    uint32_t n = 0, a = 0, h = 0;
+    float m = -INFINITY;
+    while (a < raw || h < job->n_hist) {
+        sample_cand_t e;
+        if (h < job->n_hist && (a == raw || job->hist[h] <= sl->raw_ids[a])) {
+            e = (sample_cand_t){ penalize(job, x[job->hist[h]]), job->hist[h] };
+            if (a < raw && sl->raw_ids[a] == job->hist[h]) a++;
+            h++;
+        } else {
+            e = (sample_cand_t){ sl->raw_z[a], sl->raw_ids[a] };
+            a++;
+        }
+        m = (e.z > m) ? e.z : m;
+        sl->cand[n++] = e;
+    }
+    *zmax = m;
+    return n;
+}
+
+/*
+ * Weighs the n candidates against zref, cuts them to the top-p nucleus
+ * of their sum and draws one. Tokens left out may weigh up to below in
+ * all; when that could move the cut, nothing is drawn and SAMPLE_RETRY
+ * comes back.
+ */
+static uint32_t draw(const sample_job_t *job, const sample_slot_t *sl, uint32_t r, uint32_t n, float zref,
+                     float below) {
+    sample_cand_t *c = sl->cand;
+    float *w = sl->w;
+    double total = 0.0;
+    for (uint32_t i = 0; i < n; i++) {
+        w[i] = (c[i].z == zref) ? 1.0f : expf((c[i].z - zref) / job->temp);
+        total += w[i];
+    }
+    if (job->top_p > 0.0f && job->top_p < 1.0f) {
+        uint32_t *heap = sl->idx, size = n, last = 0;
+        double goal = job->top_p * total, reach = job->top_p * (total + below), cum = 0.0;
+        for (uint32_t i = 0; i < n; i++) heap[i] = i;
+        for (uint32_t i = n / 2; i-- > 0;) heap_down(c, heap, n, i);
+        for (uint32_t popped = 0; size && (popped == 0 || cum < goal); popped++) {
+            last = heap[0];
+            cum += w[last];
+            heap[0] = heap[--size];
+            heap_down(c, heap, size, 0);
+        }
+        if (below > 0.0f && cum < reach) return SAMPLE_RETRY;
+        n = keep_through(c, w, n, c[last]);
+        total = cum;
+    }
+
+    uint64_t tmp, *state = row_state(job, r, &tmp);
+    double u = nodal_rng_uniform(state) * total, acc = 0.0;
+    uint32_t pick = c[0].id;
+    for (uint32_t i = 0; i < n; i++) {
+        if (w[i] <= 0.0f) continue;
+        pick = c[i].id;
+        acc += w[i];
+        if (u < acc) break;
+    }
+    return pick;
+}
+
+/* Argmax of the penalized logits, lowest id on ties */
+static uint32_t sample_greedy(const sample_job_t *job, const sample_slot_t *sl, const float *x, float m) {
+    float zmax;
+    uint32_t n = gather(job, sl, x, m, &zmax);
+    if (zmax < m) n = gather(job, sl, x, zmax, &zmax);  // The raw max was penalized away
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < n; i++) best = (sl->cand[i].z > sl->cand[best].z) ? i : best;
+    return n ? sl->cand[best].id : 0;
+}
+
+static uint32_t sample_top_k(const sample_job_t *job, const sample_slot_t *sl, uint32_t r, const float *x, float m,
+                             float window) {
+    const uint32_t k = job->top_k;
+
+    // 1. Tightest rung holding k raw logits plus every history id (penalties may pull those under it)
+    float lv[SAMPLE_LEVELS], zmax;
+    uint32_t count[SAMPLE_LEVELS] = {0};
+    ladder(m, window, lv);
+    job->isa->profile(x, job->vocab, 0.0f, 0.0f, lv, SAMPLE_LEVELS, count, NULL, NULL, 0);
+    float theta = lv[SAMPLE_LEVELS - 1];
+    for (uint32_t l = 0; l < SAMPLE_LEVELS; l++) {
+        if (count[l] >= k + job->n_hist) {
+            theta = lv[l];
+            break;
+        }
+    }
+
+    // 2. Complete once the k-th candidate clears theta, or nothing within the window was left out
+    uint32_t n = gather(job, sl, x, theta, &zmax), above = 0;
+    for (uint32_t i = 0; i < n; i++) above += (sl->cand[i].z >= theta);
+    if (above < k && zmax - window < theta) n = gather(job, sl, x, zmax - window, &zmax);
+
+    // 3. Quickselect the k-th rank and keep everything up to it
+    if (n > k) {
+        for (uint32_t i = 0; i < n; i++) sl->idx[i] = i;
+        select_rank(sl->cand, sl->idx, n, k - 1);
+        n = keep_through(sl->cand, NULL, n, sl->cand[sl->idx[k - 1]]);
+    }
+    return draw(job, sl, r, n, zmax, 0.0f);
+}
+
+/* Rungs m - window (l + 1) / SAMPLE_LEVELS, evenly spaced to resolve the bulk of the vocabulary */
+static void ladder_linear(float m, float window, float *lv) {
+    for (uint32_t l = 0; l < SAMPLE_LEVELS; l++) lv[l] = m - window * (float)(l + 1) / SAMPLE_LEVELS;
+}
+
+/*
+ * Bound, from counts alone, on what the logits under rung l weigh
+ * against the top token: each band between rungs at most its upper
+ * rung, and everything under the ladder at most its end.
+ */
+static float weight_below(const sample_job_t *job, const uint32_t *count, const float *lv, uint32_t l, float m) {
+    const float inv_t = 1.0f / job->temp;
+    float b = (float)(job->vocab - count[SAMPLE_LEVELS - 1]) * nodal_exp_scalar((lv[SAMPLE_LEVELS - 1] - m) * inv_t);
+    for (uint32_t j = l + 1; j < SAMPLE_LEVELS; j++) {
+        b += (float)(count[j] - count[j - 1]) * nodal_exp_scalar((lv[j - 1] - m) * inv_t);
+    }
+    return b;
+}
+
+/*
+ * Top-p over the whole vocabulary, with weights against m (the top
+ * token weighs 1). Only the tokens above the chosen rung are
+ * exponentiated; the draw stands once what lies under the rung cannot
+ * move the cut, otherwise the next rung down is tried. The ladder's
+ * end is always accepted.
+ */
+static uint32_t sample_nucleus(const sample_job_t *job, const sample_slot_t *sl, uint32_t r, const float *x, float m,
+                               float window) {
+    float lv[SAMPLE_LEVELS], zmax;
+    uint32_t count[SAMPLE_LEVELS] = {0};
+    ladder_linear(m, window, lv);
+    job->isa->profile(x, job->vocab, 0.0f, 0.0f, lv, SAMPLE_LEVELS, count, NULL, NULL, 0);
+
+    // 1. Tightest rung whose left-out weight stays within a share of the slack around the cut
+    float slack = (1.0f - job->top_p) / job->top_p / SAMPLE_NUCLEUS_SPLIT;
+    uint32_t l = 0;
+    while (l < SAMPLE_LEVELS - 1 && weight_below(job, count, lv, l, m) > slack) l++;
+
+    // 2. Draw over the tokens above it, stepping down while the cut is not settled
+    for (;; l++) {
+        float below = (l < SAMPLE_LEVELS - 1) ? weight_below(job, count, lv, l, m) : 0.0f;
+        uint32_t id = draw(job, sl, r, gather(job, sl, x, lv[l], &zmax), m, below);
+        if (id != SAMPLE_RETRY) return id;
+    }
+}
+
+/* Temperature over the whole vocabulary: chunk sums in one pass, then the walk repeats only the chunk it lands in */
+static uint32_t sample_temperature(const sample_job_t *job, uint32_t r, const float *x, float m) {
+    const float inv_t = 1.0f / job->temp;
+    uint32_t chunk = SAMPLE_CHUNK;
+    if (job->vocab / SAMPLE_MAX_CHUNKS >= SAMPLE_CHUNK) chunk = job->vocab / SAMPLE_MAX_CHUNKS + 1;
+    uint32_t chunks = (job->vocab + chunk - 1) / chunk, h = 0;
+    float sum[SAMPLE_MAX_CHUNKS];
+    double total = 0.0;
+
+    // 1. Weight of every chunk; history ids move to their penalized weight
+    for (uint32_t c = 0; c < chunks; c++) {
+        uint32_t base = c * chunk, len = (job->vocab - base < chunk) ? job->vocab - base : chunk;
+        float s = 0.0f;
+        job->isa->profile(x + base, len, m, inv_t, NULL, 0, NULL, NULL, &s, 1);
+        for (; h < job->n_hist && job->hist[h] < base + len; h++) {
+            float raw = x[job->hist[h]];
+            s += nodal_exp_scalar((penalize(job, raw) - m) * inv_t) - nodal_exp_scalar((raw - m) * inv_t);
+        }
+        sum[c] = s;
+        total += s;
+    }
+
+    // 2. Skip whole chunks by their sums, then walk the one the draw lands in
+    uint64_t tmp, *state = row_state(job, r, &tmp);
+    double u = nodal_rng_uniform(state) * total, acc = 0.0;
+    uint32_t c = 0;
+    while (c + 1 < chunks && acc + sum[c] <= u) acc += sum[c++];
+    uint32_t base = c * chunk, end = (job->vocab - base < chunk) ? job->vocab : base + chunk;
+    for (h = 0; h < job->n_hist && job->hist[h] < base; h++) {}
+    for (uint32_t i = base; i < end; i++) {
+        float z = (h < job->n_hist && job->hist[h] == i) ? penalize(job, x[job->hist[h++]]) : x[i];
+        acc += nodal_exp_scalar((z - m) * inv_t);
+        if (u < acc) return i;
+    }
+    return end - 1;  // The draw fell in the rounding gap at the end of the chunk
+}
+
+static uint32_t sample_row(const sample_job_t *job, const sample_slot_t *sl, uint32_t r) {
+    const float *x = job->logits + (size_t)r * job->vocab;
+    float m = job->isa->max(x, job->vocab);
+    if (job->temp <= 0.0f || job->top_k == 1) return sample_greedy(job, sl, x, m);
+
+    float window = job->temp * (logf((float)job->vocab) + SAMPLE_TAIL);
+    if (job->top_k && job->top_k < job->vocab) return sample_top_k(job, sl, r, x, m, window);
+    for (uint32_t h = 0; h < job->n_hist; h++) {
+        float pen = penalize(job, x[job->hist[h]]);
+        m = (pen > m) ? pen : m;
+    }
+    if (job->top_p > 0.0f && job->top_p < 1.0f) return sample_nucleus(job, sl, r, x, m, window);
+    return sample_temperature(job, r, x, m);
+}
+
+static void sample_task(void *ctx, uint32_t task) {
+    const sample_job_t *job = (const sample_job_t *)ctx;
+    sample_slot_t sl = slot_at(job->scratch, job->vocab, task);
+    uint32_t begin = task * job->rows_per_task;
+    uint32_t end = (job->rows - begin < job->rows_per_task) ? job->rows : begin + job->rows_per_task;
+    for (uint32_t r = begin; r < end; r++) job->out[r] = sample_row(job, &sl, r);
+}
+
+/**
+ * OP_SAMPLE (Vectorized, Threaded F32)
+ * See nodal_kernel_sample_generic for the contract. Greedy, top-k and
+ * top-p draws match it; top-p leaves out only what lies below the
+ * ladder. Temperature draws measure the vocabulary's mass with a
+ * polynomial exp, so they only differ when a draw lands within rounding
+ * of a token boundary.
+ * outputs[1]: Scratch (nodal_sample_scratch_bytes(vocab, rows), as the
+ *             planner sizes it); smaller scratch draws fewer rows at
+ *             once. The reference ignores it.
+ */
+void nodal_kernel_sample(const nodal_call_t *call) {
+    sample_job_t job;
+    const nodal_scalar_t *s = call->scalars;
+    const uint32_t *hist = (const uint32_t *)call->inputs[1].ptr;
+    const uint32_t *count = (const uint32_t *)call->inputs[2].ptr;
+    job.isa = sample_isa();
+    job.logits = (const float *)call->inputs[0].ptr;
+    job.states = (uint64_t *)call->inputs[3].ptr;
+    job.out = (uint32_t *)call->outputs[0].ptr;
+    job.scratch = (uint8_t *)call->outputs[1].ptr;
+    job.vocab = s[0].v.u32;
+    job.rows = s[1].v.u32 ? s[1].v.u32 : 1;
+    job.temp = (s[2].kind == NODAL_F32) ? s[2].v.f32 : 0.0f;
+    job.top_k = s[3].v.u32;
+    job.top_p = (s[4].kind == NODAL_F32) ? s[4].v.f32 : 0.0f;
+    job.penalty = (s[5].kind == NODAL_F32 && s[5].v.f32 > 0.0f) ? s[5].v.f32 : 1.0f;
+    job.seed = s[6].v.u32;
+    job.hist_count = hist ? (count ? *count : (uint32_t)(call->inputs[1].byte_len / sizeof(uint32_t))) : 0;
+    job.n_hist = 0;
+    job.hist = NULL;
+    if (job.vocab == 0) return;
+
+    size_t have = job.scratch ? call->outputs[1].byte_len : 0;
+    if (have < hist_bytes(job.vocab) + slot_bytes(job.vocab)) {
+        fprintf(stderr, "[EXEC] OP_SAMPLE needs at least %zu bytes of scratch in outputs[1] (vocab %u, got %zu)\n",
+                nodal_sample_scratch_bytes(job.vocab, 1), job.vocab, have);
+        memset(job.out, 0, (size_t)job.rows * sizeof(uint32_t));
+        return;
+    }
+
+    // 1. Distinct in-vocabulary history ids in ascending order, only when they are penalized
+    if (job.penalty != 1.0f && job.hist_count) {
+        size_t words = ((size_t)job.vocab + 63) / 64;
+        uint64_t *seen = (uint64_t *)job.scratch;
+        uint32_t *ids = (uint32_t *)(seen + words);
+        memset(seen, 0, words * sizeof(uint64_t));
+        for (uint32_t h = 0; h < job.hist_count; h++) {
+            if (hist[h] < job.vocab) seen[hist[h] >> 6] |= 1ull << (hist[h] & 63);
+        }
+        for (size_t wd = 0; wd < words; wd++) {
+            for (uint64_t bits = seen[wd]; bits; bits &= bits - 1) {
+                ids[job.n_hist++] = (uint32_t)(wd * 64) + (uint32_t)__builtin_ctzll(bits);
+            }
+        }
+        job.hist = ids;
+    }
+
+    // 2. Rows over the pool, one scratch slot per task
+    uint32_t slots = (uint32_t)((have - hist_bytes(job.vocab)) / slot_bytes(job.vocab));
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, (size_t)job.rows * job.vocab, SAMPLE_GRAIN);
+    if (tasks > job.rows) tasks = job.rows;
+    if (tasks > slots) tasks = slots;
+    job.rows_per_task = (job.rows + tasks - 1) / tasks;
+    nodal_pool_run(pool, sample_task, &job, (job.rows + job.rows_per_task - 1) / job.rows_per_task);
+}
+
+/**
+ * nodal_sample_splits
+ * Whether OP_SAMPLE with these scalars is more than one task's worth of
+ * logits; tasks own whole rows.
+ */
+int nodal_sample_splits(const nodal_scalar_t *s) {
+    return s[1].v.u32 > 1 && (uint64_t)s[0].v.u32 * s[1].v.u32 > SAMPLE_GRAIN;
+}
@@ -0,0 +1,409 @@
+/*
+ * softmax.c - Row-Batched Softmax with a Polynomial exp
+ * Softmax over [rows, N] with optional temperature and causal mask. exp
+ * is range-reduced to [-ln2/2, ln2/2] and evaluated as a degree-6
+ * polynomial (the Cephes exp in nodal.h), with AVX-512 and AVX2/FMA
+ * versions picked via CPUID and a scalar fallback. Rows are split over
+ * the worker pool; a single long row (vocabulary logits) is split into
+ * chunks instead.
+ */
+
+#include "../nodal.h"
+#include <math.h>
+#include <stdint.h>
+
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+#define SOFTMAX_GRAIN     (1u << 14) // Elements per task
+#define SOFTMAX_MAX_TASKS 256
+
+/*
+ * Row primitives over n elements of x = (a + b) * t, b optional:
+ * max, out = exp(x - m) returning the sum, an online max/sum in one
+ * read, and out = exp(x - m) * s.
+ */
+typedef struct {
+    float (*max)(const float *a, const float *b, uint32_t n, float t);
+    float (*exp_sum)(const float *a, const float *b, float *out, uint32_t n, float t, float m);
+    void (*max_sum)(const float *a, const float *b, uint32_t n, float t, float *m, float *s);
+    void (*exp_scale)(const float *a, const float *b, float *out, uint32_t n, float t, float m, float s);
+} softmax_isa_t;
+
+/* --- Scalar --- */
+
+static inline float in_scalar(const float *a, const float *b, uint32_t i, float t) {
+    return (b ? a[i] + b[i] : a[i]) * t;
+}
+
+static float max_scalar(const float *a, const float *b, uint32_t n, float t) {
+    float m = -INFINITY;
+    for (uint32_t i = 0; i < n; i++) {
+        float v = in_scalar(a, b, i, t);
+        m = (v > m) ? v : m;
+    }
+    return m;
+}
+
+static float exp_sum_scalar(const float *a, const float *b, float *out, uint32_t n, float t, float m) {
+    float sum = 0.0f;
+    for (uint32_t i = 0; i < n; i++) {
+        out[i] = nodal_exp_scalar(in_scalar(a, b, i, t) - m);
+        sum += out[i];
+    }
+    return sum;
+}
+
+/* Continues the running (m, s) pair, so vector bodies can hand over their tails */
+static void max_sum_scalar(const float *a, const float *b, uint32_t n, float t, float *m, float *s) {
+    float mm = *m, ss = *s;
+    for (uint32_t i = 0; i < n; i++) {
+        float v = in_scalar(a, b, i, t);
+        if (v > mm) {
+            ss *= nodal_exp_scalar(mm - v);
+            mm = v;
+        }
+        ss += nodal_exp_scalar(v - mm);
+    }
+    *m = mm;
+    *s = ss;
+}
+
+static void exp_scale_scalar(const float *a, const float *b, float *out, uint32_t n, float t, float m, float s) {
+    for (uint32_t i = 0; i < n; i++) out[i] = nodal_exp_scalar(in_scalar(a, b, i, t) - m) * s;
+}
+
+static const softmax_isa_t SOFTMAX_SCALAR = { max_scalar, exp_sum_scalar, max_sum_scalar, exp_scale_scalar };
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* --- AVX-512 --- */
+
+__attribute__((target("avx512f")))
+static inline __m512 in_avx512(const float *a, const float *b, uint32_t i, __m512 t) {
+    __m512 x = _mm512_loadu_ps(a + i);
+    if (b) x = _mm512_add_ps(x, _mm512_loadu_ps(b + i));
+    return _mm512_mul_ps(x, t);
+}
+
+__attribute__((target("avx512f")))
+static float max_avx512(const float *a, const float *b, uint32_t n, float t) {
+    const __m512 vt = _mm512_set1_ps(t);
+    __m512 vm = _mm512_set1_ps(-INFINITY);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) vm = _mm512_max_ps(vm, in_avx512(a, b, i, vt));
+    float m = _mm512_reduce_max_ps(vm);
+    float tail = max_scalar(a + i, b ? b + i : NULL, n - i, t);
+    return (tail > m) ? tail : m;
+}
+
+__attribute__((target("avx512f")))
+static float exp_sum_avx512(const float *a, const float *b, float *out, uint32_t n, float t, float m) {
+    const __m512 vt = _mm512_set1_ps(t), vm = _mm512_set1_ps(m);
+    __m512 vs = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 e = nodal_exp_avx512(_mm512_sub_ps(in_avx512(a, b, i, vt), vm));
+        _mm512_storeu_ps(out + i, e);
+        vs = _mm512_add_ps(vs, e);
+    }
+    return _mm512_reduce_add_ps(vs) + exp_sum_scalar(a + i, b ? b + i : NULL, out + i, n - i, t, m);
+}
+
+/* Per-lane running max and sum, merged across lanes at the end */
+__attribute__((target("avx512f")))
+static void max_sum_avx512(const float *a, const float *b, uint32_t n, float t, float *m, float *s) {
+    const __m512 vt = _mm512_set1_ps(t);
+    __m512 vm = _mm512_set1_ps(-INFINITY), vs = _mm512_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 x = in_avx512(a, b, i, vt);
+        __m512 nm = _mm512_max_ps(vm, x);
+        vs = _mm512_fmadd_ps(vs, nodal_exp_avx512(_mm512_sub_ps(vm, nm)), nodal_exp_avx512(_mm512_sub_ps(x, nm)));
+        vm = nm;
+    }
+    float mm = _mm512_reduce_max_ps(vm);
+    float ss = _mm512_reduce_add_ps(_mm512_mul_ps(vs, nodal_exp_avx512(_mm512_sub_ps(vm, _mm512_set1_ps(mm)))));
+    max_sum_scalar(a + i, b ? b + i : NULL, n - i, t, &mm, &ss);
+    *m = mm;
+    *s = ss;
+}
+
+__attribute__((target("avx512f")))
+static void exp_scale_avx512(const float *a, const float *b, float *out, uint32_t n, float t, float m, float s) {
+    const __m512 vt = _mm512_set1_ps(t), vm = _mm512_set1_ps(m), vs = _mm512_set1_ps(s);
+    uint32_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        _mm512_storeu_ps(out + i, _mm512_mul_ps(nodal_exp_avx512(_mm512_sub_ps(in_avx512(a, b, i, vt), vm)), vs));
+    }
+    exp_scale_scalar(a + i, b ? b + i : NULL, out + i, n - i, t, m, s);
+}
+
+static const softmax_isa_t SOFTMAX_AVX512 = { max_avx512, exp_sum_avx512, max_sum_avx512, exp_scale_avx512 };
+
+/* --- AVX2 --- */
+
+__attribute__((target("avx2,fma")))
+static inline __m256 in_avx2(const float *a, const float *b, uint32_t i, __m256 t) {
+    __m256 x = _mm256_loadu_ps(a + i);
+    if (b) x = _mm256_add_ps(x, _mm256_loadu_ps(b + i));
+    return _mm256_mul_ps(x, t);
+}
+
+__attribute__((target("avx2,fma")))
+static inline float hmax_avx2(__m256 v) {
+    __m128 x = _mm_max_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_max_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_max_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static inline float hsum_avx2(__m256 v) {
+    __m128 x = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    x = _mm_add_ps(x, _mm_movehl_ps(x, x));
+    x = _mm_add_ss(x, _mm_shuffle_ps(x, x, 1));
+    return _mm_cvtss_f32(x);
+}
+
+__attribute__((target("avx2,fma")))
+static float max_avx2(const float *a, const float *b, uint32_t n, float t) {
+    const __m256 vt = _mm256_set1_ps(t);
+    __m256 vm = _mm256_set1_ps(-INFINITY);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) vm = _mm256_max_ps(vm, in_avx2(a, b, i, vt));
+    float m = hmax_avx2(vm);
+    float tail = max_scalar(a + i, b ? b + i : NULL, n - i, t);
+    return (tail > m) ? tail : m;
+}
+
+__attribute__((target("avx2,fma")))
+static float exp_sum_avx2(const float *a, const float *b, float *out, uint32_t n, float t, float m) {
+    const __m256 vt = _mm256_set1_ps(t), vm = _mm256_set1_ps(m);
+    __m256 vs = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 e = nodal_exp_avx2(_mm256_sub_ps(in_avx2(a, b, i, vt), vm));
+        _mm256_storeu_ps(out + i, e);
+        vs = _mm256_add_ps(vs, e);
+    }
+    return hsum_avx2(vs) + exp_sum_scalar(a + i, b ? b + i : NULL, out + i, n - i, t, m);
+}
+
+__attribute__((target("avx2,fma")))
+static void max_sum_avx2(const float *a, const float *b, uint32_t n, float t, float *m, float *s) {
+    const __m256 vt = _mm256_set1_ps(t);
+    __m256 vm = _mm256_set1_ps(-INFINITY), vs = _mm256_setzero_ps();
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = in_avx2(a, b, i, vt);
+        __m256 nm = _mm256_max_ps(vm, x);
+        vs = _mm256_fmadd_ps(vs, nodal_exp_avx2(_mm256_sub_ps(vm, nm)), nodal_exp_avx2(_mm256_sub_ps(x, nm)));
+        vm = nm;
+    }
+    float mm = hmax_avx2(vm);
+    float ss = hsum_avx2(_mm256_mul_ps(vs, nodal_exp_avx2(_mm256_sub_ps(vm, _mm256_set1_ps(mm)))));
+    max_sum_scalar(a + i, b ? b + i : NULL, n - i, t, &mm, &ss);
+    *m = mm;
+    *s = ss;
+}
+
+__attribute__((target("avx2,fma")))
+static void exp_scale_avx2(const float *a, const float *b, float *out, uint32_t n, float t, float m, float s) {
+    const __m256 vt = _mm256_set1_ps(t), vm = _mm256_set1_ps(m), vs = _mm256_set1_ps(s);
+    uint32_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        _mm256_storeu_ps(out + i, _mm256_mul_ps(nodal_exp_avx2(_mm256_sub_ps(in_avx2(a, b, i, vt), vm)), vs));
+    }
+    exp_scale_scalar(a + i, b ? b + i : NULL, out + i, n - i, t, m, s);
+}
+
+static const softmax_isa_t SOFTMAX_AVX2 = { max_avx2, exp_sum_avx2, max_sum_avx2, exp_scale_avx2 };
+#endif
+
+static const softmax_isa_t *softmax_isa(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_AVX512) return &SOFTMAX_AVX512;
+    if (isa == NODAL_ISA_AVX2) return &SOFTMAX_AVX2;
+#endif
+    return &SOFTMAX_SCALAR;
+}
+
+/* --- Row Scheduling --- */
+
+typedef struct {
+    const softmax_isa_t *isa;
+    const float *a, *b;
+    float *out;
+    uint32_t n;
+    uint32_t rows;
+    float inv_temp;
+    uint32_t flags;                // NODAL_SOFTMAX_*
+    uint32_t rows_per_task;
+    uint32_t chunk;                // Single-row split: elements per task
+    float max_val;
+    float inv_sum;
+    float part_max[SOFTMAX_MAX_TASKS];
+    float part_sum[SOFTMAX_MAX_TASKS];
+} softmax_job_t;
+
+/* Columns row r keeps: all of them, or [0, n - rows + r] when causal */
+static inline uint32_t row_len(const softmax_job_t *job, uint32_t r) {
+    if (!(job->flags & NODAL_SOFTMAX_CAUSAL)) return job->n;
+    int64_t keep = (int64_t)job->n - job->rows + r + 1;
+    return keep <= 0 ? 0 : (keep >= job->n ? job->n : (uint32_t)keep);
+}
+
+static void softmax_row(const softmax_job_t *job, uint32_t r) {
+    const size_t off = (size_t)r * job->n;
+    const float *a = job->a + off, *b = job->b ? job->b + off : NULL;
+    float *out = job->out + off;
+    uint32_t len = row_len(job, r);
+
+    if (len && (job->flags & NODAL_SOFTMAX_ONLINE)) {
+        float m = -INFINITY, s = 0.0f;
+        job->isa->max_sum(a, b, len, job->inv_temp, &m, &s);
+        job->isa->exp_scale(a, b, out, len, job->inv_temp, m, 1.0f / s);
+    } else if (len) {
+        float m = job->isa->max(a, b, len, job->inv_temp);
+        float inv = 1.0f / job->isa->exp_sum(a, b, out, len, job->inv_temp, m);
+        for (uint32_t i = 0; i < len; i++) out[i] *= inv;
+    }
+    for (uint32_t i = len; i < job->n; i++) out[i] = 0.0f;
+}
+
+static void rows_task(void *ctx, uint32_t task) {
+    const softmax_job_t *job = (const softmax_job_t *)ctx;
+    uint32_t begin = task * job->rows_per_task;
+    uint32_t end = (job->rows - begin < job->rows_per_task) ? job->rows : begin + job->rows_per_task;
+    for (uint32_t r = begin; r < end; r++) softmax_row(job, r);
+}
+
+/* Single long row: chunk tasks reduce partial (max, sum), then normalize */
+static inline void chunk_range(const softmax_job_t *job, uint32_t task, uint32_t *begin, uint32_t *len) {
+    *begin = task * job->chunk;
+    *len = (job->n - *begin < job->chunk) ? job->n - *begin : job->chunk;
+}
+
+static void chunk_max_task(void *ctx, uint32_t task) {
+    softmax_job_t *job = (softmax_job_t *)ctx;
+    uint32_t i, len;
+    chunk_range(job, task, &i, &len);
+    job->part_max[task] = job->isa->max(job->a + i, job->b ? job->b + i : NULL, len, job->inv_temp);
+}
+
+static void chunk_exp_sum_task(void *ctx, uint32_t task) {
+    softmax_job_t *job = (softmax_job_t *)ctx;
+    uint32_t i, len;
+    chunk_range(job, task, &i, &len);
+    job->part_sum[task] = job->isa->exp_sum(job->a + i, job->b ? job->b + i : NULL, job->out + i, len,
+                                            job->inv_temp, job->max_val);
+}
+
+static void chunk_scale_task(void *ctx, uint32_t task) {
+    const softmax_job_t *job = (const softmax_job_t *)ctx;
+    uint32_t i, len;
+    chunk_range(job, task, &i, &len);
+    for (uint32_t k = i; k < i + len; k++) job->out[k] *= job->inv_sum;
+}
+
+static void chunk_max_sum_task(void *ctx, uint32_t task) {
+    softmax_job_t *job = (softmax_job_t *)ctx;
+    uint32_t i, len;
+    chunk_range(job, task, &i, &len);
+    job->part_max[task] = -INFINITY;
+    job->part_sum[task] = 0.0f;
+    job->isa->max_sum(job->a + i, job->b ? job->b + i : NULL, len, job->inv_temp, &job->part_max[task],
+                      &job->part_sum[task]);
+}
+
+static void chunk_exp_scale_task(void *ctx, uint32_t task) {
+    const softmax_job_t *job = (const softmax_job_t *)ctx;
+    uint32_t i, len;
+    chunk_range(job, task, &i, &len);
+    job->isa->exp_scale(job->a + i, job->b ? job->b + i : NULL, job->out + i, len, job->inv_temp,
+                        job->max_val, job->inv_sum);
+}
+
+static void softmax_run(softmax_job_t *job) {
+    if (job->n == 0 || job->rows == 0) return;
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t tasks = nodal_pool_tasks(pool, (size_t)job->n * job->rows, SOFTMAX_GRAIN);
+
+    // 1. Many rows (or little work): whole rows per task
+    if (job->rows > 1 || tasks == 1) {
+        if (tasks > job->rows) tasks = job->rows;
+        job->rows_per_task = (job->rows + tasks - 1) / tasks;
+        nodal_pool_run(pool, rows_task, job, (job->rows + job->rows_per_task - 1) / job->rows_per_task);
+        return;
+    }
+
+    // 2. One long row: chunks reduce partials, then a normalize pass
+    if (tasks > SOFTMAX_MAX_TASKS) tasks = SOFTMAX_MAX_TASKS;
+    job->chunk = (((job->n + tasks - 1) / tasks) + 15) & ~15u;
+    tasks = (job->n + job->chunk - 1) / job->chunk;
+    float sum = 0.0f;
+    if (job->flags & NODAL_SOFTMAX_ONLINE) {
+        nodal_pool_run(pool, chunk_max_sum_task, job, tasks);
+        job->max_val = job->part_max[0];
+        for (uint32_t t = 1; t < tasks; t++) job->max_val = (job->part_max[t] > job->max_val) ? job->part_max[t] : job->max_val;
+        for (uint32_t t = 0; t < tasks; t++) {
+            sum += job->part_sum[t] * nodal_exp_scalar(job->part_max[t] - job->max_val);
+        }
+        job->inv_sum = 1.0f / sum;
+        nodal_pool_run(pool, chunk_exp_scale_task, job, tasks);
+    } else {
+        nodal_pool_run(pool, chunk_max_task, job, tasks);
+        job->max_val = job->part_max[0];
+        for (uint32_t t = 1; t < tasks; t++) job->max_val = (job->part_max[t] > job->max_val) ? job->part_max[t] : job->max_val;
+        nodal_pool_run(pool, chunk_exp_sum_task, job, tasks);
+        for (uint32_t t = 0; t < tasks; t++) sum += job->part_sum[t];
+        job->inv_sum = 1.0f / sum;
+        nodal_pool_run(pool, chunk_scale_task, job, tasks);
+    }
+}
+
+static void softmax_call(const nodal_call_t *call, const float *b) {
+    softmax_job_t job;
+    const nodal_scalar_t *s = call->scalars;
+    job.isa = softmax_isa();
+    job.a = (const float *)call->inputs[0].ptr;
+    job.b = b;
+    job.out = (float *)call->outputs[0].ptr;
+    job.n = s[0].v.u32;
+    job.rows = s[1].v.u32 ? s[1].v.u32 : 1;
+    job.inv_temp = (s[2].kind == NODAL_F32 && s[2].v.f32 > 0.0f) ? 1.0f / s[2].v.f32 : 1.0f;
+    job.flags = s[3].v.u32;
+    softmax_run(&job);
+}
+
+/**
+ * OP_SOFTMAX (Vectorized, Threaded F32)
+ * Row-wise over [rows, size]; see nodal_kernel_softmax_generic for the
+ * scalar contract.
+ */
+void nodal_kernel_softmax_f32(const nodal_call_t *call) {
+    softmax_call(call, NULL);
+}
+
+/**
+ * OP_ADD_SOFTMAX (Fused, Vectorized, Threaded F32)
+ * out = softmax(A + B); the sum is recomputed in registers by every pass
+ * instead of being written out and read back. B has A's shape.
+ */
+void nodal_kernel_add_softmax_f32(const nodal_call_t *call) {
+    softmax_call(call, (const float *)call->inputs[1].ptr);
+}
+
+/**
+ * nodal_softmax_splits
+ * Whether OP_SOFTMAX / OP_ADD_SOFTMAX with these scalars is more than
+ * one task's worth of elements.
+ */
+int nodal_softmax_splits(const nodal_scalar_t *s) {
+    return (uint64_t)s[0].v.u32 * (s[1].v.u32 ? s[1].v.u32 : 1) > SOFTMAX_GRAIN;
+}
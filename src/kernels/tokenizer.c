@@ -1,32 +1,248 @@
 /*
  * tokenizer.c - Fast Byte-Level BPE Tokenizer for Nodal
- * Includes Binary Search Merge Logic for 61k+ rules.
+ * Heap-driven merge engine with binary search over 61k+ sorted merge rules.
  */
 
 #include "../nodal.h"
 #include <string.h>
 #include <stdio.h>
 
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern uint32_t nodal_pool_size(const nodal_pool_t *pool);
+extern nodal_pool_t *nodal_pool_default(void);
+extern int nodal_tokcache_lookup(nodal_tokcache_t *cache, const uint8_t *key, uint32_t len,
+                                 uint32_t *ids, uint32_t max_ids);
+extern void nodal_tokcache_insert(nodal_tokcache_t *cache, const uint8_t *key, uint32_t len,
+                                  const uint32_t *ids, uint32_t num_ids);
+
+/* Symbols merged per window. Longer pre-tokens are streamed window by window. */
+#define BPE_WINDOW 2048
+#define BPE_NONE   0xFFFFFFFFu
+
+/* Parallel tokenization: chunk sizing for the worker pool */
+#define BPE_MIN_CHUNK  (16 * 1024)
+#define BPE_MAX_CHUNKS 256
+
+/* A candidate merge of the pair starting at symbol 'pos' */
 typedef struct {
-    uint32_t p1;
-    uint32_t p2;
     uint32_t rank;
-} bpe_rule_t;
+    uint32_t pos;
+} bpe_cand_t;
 
 /**
  * find_merge_rank
- * Linear search for the alpha (to be upgraded to binary search in Beta).
- * Searches the merge table for a pair of tokens.
+ * Binary search over the (p1, p2)-sorted merge table.
+ * Returns the rank of the pair, or -1 if no rule applies.
  */
 int find_merge_rank(uint32_t p1, uint32_t p2, const bpe_rule_t *rules, uint32_t num_rules) {
-    for (uint32_t i = 0; i < num_rules; i++) {
-        if (rules[i].p1 == p1 && rules[i].p2 == p2) {
-            return (int)rules[i].rank;
+    uint32_t lo = 0, hi = num_rules;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        const bpe_rule_t *r = &rules[mid];
+        if (r->p1 < p1 || (r->p1 == p1 && r->p2 < p2)) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
     }
+    if (lo < num_rules && rules[lo].p1 == p1 && rules[lo].p2 == p2) {
+        return (int)rules[lo].rank;
+    }
     return -1;
 }
 
+/* Min-heap ordered by (rank, pos): lowest rank first, leftmost on ties */
+static inline int cand_less(bpe_cand_t a, bpe_cand_t b) {
+    return a.rank < b.rank || (a.rank == b.rank && a.pos < b.pos);
+}
+
+static void heap_push(bpe_cand_t *heap, uint32_t *len, bpe_cand_t c) {
+    uint32_t i = (*len)++;
+    while (i > 0) {
+        uint32_t parent = (i - 1) / 2;
+        if (!cand_less(c, heap[parent])) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = c;
+}
+
+static bpe_cand_t heap_pop(bpe_cand_t *heap, uint32_t *len) {
+    bpe_cand_t top = heap[0];
+    bpe_cand_t last = heap[--(*len)];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t child = 2 * i + 1;
+        if (child >= *len) break;
+        if (child + 1 < *len && cand_less(heap[child + 1], heap[child])) child++;
+        if (!cand_less(heap[child], last)) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return top;
+}
+
+static void push_pair(bpe_cand_t *heap, uint32_t *len, const uint32_t *tok, uint32_t left, uint32_t right,
+                      const bpe_rule_t *rules, uint32_t num_rules) {
+    int rank = find_merge_rank(tok[left], tok[right], rules, num_rules);
+    if (rank >= 0) {
+        heap_push(heap, len, (bpe_cand_t){ .rank = (uint32_t)rank, .pos = left });
+    }
+}
+
+/**
+ * bpe_encode_window
+ * Merges up to BPE_WINDOW bytes with a doubly linked symbol list and a
+ * candidate heap: O(n log n) instead of rescanning every pair per merge.
+ * Returns the number of ids written to out (at most max_out).
+ */
+static uint32_t bpe_encode_window(const uint8_t *bytes, uint32_t n, const bpe_rule_t *rules, uint32_t num_rules,
+                                  uint32_t *out, uint32_t max_out) {
+    uint32_t tok[BPE_WINDOW];
+    uint32_t prev[BPE_WINDOW];
+    uint32_t next[BPE_WINDOW];
+    bpe_cand_t heap[3 * BPE_WINDOW]; // n - 1 seeds + at most 2 pushes per merge
+    uint32_t heap_len = 0;
+
+    // 1. Initial State: Raw bytes to tokens
+    for (uint32_t i = 0; i < n; i++) {
+        tok[i] = bytes[i];
+        prev[i] = (i > 0) ? i - 1 : BPE_NONE;
+        next[i] = (i + 1 < n) ? i + 1 : BPE_NONE;
+    }
+    for (uint32_t i = 0; i + 1 < n; i++) {
+        push_pair(heap, &heap_len, tok, i, i + 1, rules, num_rules);
+    }
+
+    // 2. Merge Loop: pop the best candidate, drop it if the pair went stale
+    while (heap_len > 0) {
+        bpe_cand_t c = heap_pop(heap, &heap_len);
+        uint32_t left = c.pos;
+        uint32_t right = next[left];
+
+        if (tok[left] == BPE_NONE || right == BPE_NONE) continue;
+        if (find_merge_rank(tok[left], tok[right], rules, num_rules) != (int)c.rank) continue;
+
+        // Merge the pair: [p1, p2] -> [256 + rank]
+        tok[left] = 256 + c.rank;
+        tok[right] = BPE_NONE;
+        next[left] = next[right];
+        if (next[right] != BPE_NONE) prev[next[right]] = left;
+
+        if (prev[left] != BPE_NONE) push_pair(heap, &heap_len, tok, prev[left], left, rules, num_rules);
+        if (next[left] != BPE_NONE) push_pair(heap, &heap_len, tok, left, next[left], rules, num_rules);
+    }
+
+    // 3. Emit surviving symbols in order
+    uint32_t count = 0;
+    if (n == 0) return 0;
+    for (uint32_t i = 0; i != BPE_NONE && count < max_out; i = next[i]) {
+        out[count++] = tok[i];
+    }
+    return count;
+}
+
+static inline int is_space(uint8_t c) {
+    return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+/* Byte classes for pre-tokenization; bytes >= 0x80 count as letters (UTF-8) */
+enum { CH_SPACE, CH_LETTER, CH_DIGIT, CH_OTHER };
+
+static inline int char_class(uint8_t c) {
+    if (is_space(c)) return CH_SPACE;
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'z') return CH_LETTER;
+    if (c >= 0x80) return CH_LETTER;
+    if (c >= '0' && c <= '9') return CH_DIGIT;
+    return CH_OTHER;
+}
+
+/**
+ * nodal_pretokenize_next
+ * Returns the end of the pre-token starting at pos, following the GPT-2
+ * split pattern at byte level: contractions, ' ?letters', ' ?digits',
+ * ' ?punctuation', and whitespace runs that leave their last space to
+ * the next word. Merges never cross these boundaries.
+ */
+size_t nodal_pretokenize_next(const uint8_t *s, size_t len, size_t pos) {
+    size_t i = pos;
+
+    // 1. Contractions: 's 't 'm 'd 're 've 'll
+    if (s[i] == '\'' && i + 1 < len) {
+        uint8_t c = s[i + 1];
+        if (c == 's' || c == 't' || c == 'm' || c == 'd') return i + 2;
+        if (i + 2 < len && ((c == 'r' && s[i + 2] == 'e') || (c == 'v' && s[i + 2] == 'e') ||
+                            (c == 'l' && s[i + 2] == 'l'))) return i + 3;
+    }
+
+    // 2. Whitespace runs
+    int cls = char_class(s[i]);
+    if (cls == CH_SPACE) {
+        size_t e = i;
+        while (e < len && is_space(s[e])) e++;
+        if (e == len) return e;
+        if (e - i > 1) return e - 1;      // Last space goes with the next word
+        if (s[i] != ' ') return i + 1;    // Lone '\n' or '\t' stands alone
+        i++;                              // ' ' prefixes the following run
+        cls = char_class(s[i]);
+    }
+
+    // 3. Same-class run
+    size_t e = i + 1;
+    while (e < len && char_class(s[e]) == cls) e++;
+    return e;
+}
+
+/**
+ * nodal_bpe_encode
+ * Tokenizes an input of any length pre-token by pre-token, streaming ids
+ * into the caller's buffer. Repeated pre-tokens are served from the
+ * optional cache. Returns the number of ids written (at most max_tokens).
+ */
+uint32_t nodal_bpe_encode(const uint8_t *input, size_t input_len, const bpe_rule_t *rules, uint32_t num_rules,
+                          nodal_tokcache_t *cache, uint32_t *output_ids, uint32_t max_tokens) {
+    uint32_t count = 0;
+    size_t pos = 0;
+
+    while (pos < input_len && count < max_tokens) {
+        size_t end = nodal_pretokenize_next(input, input_len, pos);
+
+        if (cache) {
+            uint32_t room = max_tokens - count;
+            int hit = nodal_tokcache_lookup(cache, input + pos, (uint32_t)(end - pos), output_ids + count, room);
+            if (hit >= 0) {
+                count += ((uint32_t)hit < room) ? (uint32_t)hit : room;
+                pos = end;
+                continue;
+            }
+            if (end - pos <= BPE_WINDOW) {
+                uint32_t n = bpe_encode_window(input + pos, (uint32_t)(end - pos), rules, num_rules,
+                                               output_ids + count, room);
+                if (n < room) nodal_tokcache_insert(cache, input + pos, (uint32_t)(end - pos), output_ids + count, n);
+                count += n;
+                pos = end;
+                continue;
+            }
+        }
+
+        // Pathologically long runs are merged in BPE_WINDOW slices
+        while (pos < end && count < max_tokens) {
+            uint32_t n = (end - pos > BPE_WINDOW) ? BPE_WINDOW : (uint32_t)(end - pos);
+            count += bpe_encode_window(input + pos, n, rules, num_rules, output_ids + count, max_tokens - count);
+            pos += n;
+        }
+    }
+    return count;
+}
+
+/**
+ * OP_TOKENIZE_BPE
+ * inputs[0]: UTF-8 bytes, inputs[1]: sorted merge table (bpe_rule_t)
+ * inputs[2]: optional nodal_tokcache_t shared across calls
+ * outputs[0]: token ids (U32), outputs[1]: optional U32 token count
+ * scalars[0]=input_len, [1]=max_tokens
+ */
 void nodal_kernel_tokenize_bpe(const nodal_call_t *call) {
     const uint8_t *input = (const uint8_t *)call->inputs[0].ptr;
     const bpe_rule_t *rules = (const bpe_rule_t *)call->inputs[1].ptr;
@@ -35,39 +251,120 @@ void nodal_kernel_tokenize_bpe(const nodal_call_t *call) {
     uint32_t input_len = call->scalars[0].v.u32;
     uint32_t max_tokens = call->scalars[1].v.u32;
     uint32_t num_rules = call->inputs[1].byte_len / sizeof(bpe_rule_t);
+    nodal_tokcache_t *cache = (nodal_tokcache_t *)call->inputs[2].ptr;
 
-    // 1. Initial State: Raw bytes to tokens
-    uint32_t current_tokens[1024]; // Scratchpad
-    uint32_t n = (input_len < 1024) ? input_len : 1024;
-    for (uint32_t i = 0; i < n; i++) current_tokens[i] = input[i];
-
-    // 2. Iterative Merge Loop
-    while (n > 1) {
-        int best_rank = -1;
-        uint32_t best_idx = 0;
-
-        for (uint32_t i = 0; i < n - 1; i++) {
-            int rank = find_merge_rank(current_tokens[i], current_tokens[i+1], rules, num_rules);
-            if (rank != -1 && (best_rank == -1 || rank < best_rank)) {
-                best_rank = rank;
-                best_idx = i;
-            }
-        }
+    uint32_t count = nodal_bpe_encode(input, input_len, rules, num_rules, cache, output_ids, max_tokens);
+
+    if (call->outputs[1].ptr && call->outputs[1].byte_len >= sizeof(uint32_t)) {
+        *(uint32_t *)call->outputs[1].ptr = count;
+    }
+}
 
-        if (best_rank == -1) break; // No more rules apply
+typedef struct {
+    const uint8_t *input;
+    const bpe_rule_t *rules;
+    uint32_t num_rules;
+    nodal_tokcache_t *cache;
+    uint32_t *scratch;             // Chunk c writes at scratch[starts[c]]
+    const size_t *starts;          // num_chunks + 1 boundaries
+    uint32_t *counts;
+} bpe_par_ctx_t;
 
-        // Merge the pair: [p1, p2] -> [new_token]
-        // For Alpha, we simulate the new ID as 256 + rank
-        current_tokens[best_idx] = 256 + best_rank;
-        for (uint32_t i = best_idx + 1; i < n - 1; i++) {
-            current_tokens[i] = current_tokens[i+1];
-        }
-        n--;
+static void bpe_chunk_task(void *arg, uint32_t chunk) {
+    bpe_par_ctx_t *ctx = (bpe_par_ctx_t *)arg;
+    size_t begin = ctx->starts[chunk];
+    size_t len = ctx->starts[chunk + 1] - begin;
+
+    // A chunk never yields more ids than bytes, so its scratch slot fits
+    ctx->counts[chunk] = nodal_bpe_encode(ctx->input + begin, len, ctx->rules, ctx->num_rules, ctx->cache,
+                                          ctx->scratch + begin, (uint32_t)len);
+}
+
+/**
+ * bpe_split_chunks
+ * Cuts the input into roughly equal chunks, each starting on a pre-token
+ * boundary (a space after a non-space byte), so chunks tokenize independently.
+ */
+static uint32_t bpe_split_chunks(const uint8_t *input, size_t len, size_t target, size_t *starts) {
+    uint32_t n = 0;
+    size_t pos = 0;
+    starts[n++] = 0;
+
+    while (n < BPE_MAX_CHUNKS) {
+        size_t cut = pos + target;
+        if (cut >= len) break;
+        while (cut < len && !(is_space(input[cut]) && !is_space(input[cut - 1]))) cut++;
+        if (cut >= len) break;
+        starts[n++] = cut;
+        pos = cut;
     }
+    starts[n] = len;
+    return n;
+}
+
+/**
+ * OP_TOKENIZE_BPE_PARALLEL
+ * Same contract and ids as OP_TOKENIZE_BPE, but chunks are tokenized
+ * concurrently on the default worker pool and stitched back in order.
+ * outputs[2]: optional U32 scratch of input_len entries; without it the
+ * output buffer doubles as scratch when max_tokens >= input_len.
+ */
+void nodal_kernel_tokenize_bpe_parallel(const nodal_call_t *call) {
+    const uint8_t *input = (const uint8_t *)call->inputs[0].ptr;
+    const bpe_rule_t *rules = (const bpe_rule_t *)call->inputs[1].ptr;
+    uint32_t *output_ids = (uint32_t *)call->outputs[0].ptr;
+
+    uint32_t input_len = call->scalars[0].v.u32;
+    uint32_t max_tokens = call->scalars[1].v.u32;
+    uint32_t num_rules = call->inputs[1].byte_len / sizeof(bpe_rule_t);
 
-    // 3. Final Output
-    uint32_t final_count = (n < max_tokens) ? n : max_tokens;
-    for (uint32_t i = 0; i < final_count; i++) {
-        output_ids[i] = current_tokens[i];
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t *scratch = NULL;
+    if (call->outputs[2].ptr && call->outputs[2].byte_len >= (size_t)input_len * sizeof(uint32_t)) {
+        scratch = (uint32_t *)call->outputs[2].ptr;
+    } else if (max_tokens >= input_len) {
+        scratch = output_ids;
     }
+
+    // Fall back to the serial path when there is nothing to split across
+    if (!scratch || nodal_pool_size(pool) < 2 || input_len < 2 * BPE_MIN_CHUNK) {
+        nodal_kernel_tokenize_bpe(call);
+        return;
+    }
+
+    size_t starts[BPE_MAX_CHUNKS + 1];
+    uint32_t counts[BPE_MAX_CHUNKS];
+    size_t target = input_len / (4 * nodal_pool_size(pool));
+    if (target < BPE_MIN_CHUNK) target = BPE_MIN_CHUNK;
+    if (target < input_len / BPE_MAX_CHUNKS) target = input_len / BPE_MAX_CHUNKS;
+
+    bpe_par_ctx_t ctx = {
+        .input = input, .rules = rules, .num_rules = num_rules,
+        .cache = (nodal_tokcache_t *)call->inputs[2].ptr,
+        .scratch = scratch, .starts = starts, .counts = counts
+    };
+    uint32_t num_chunks = bpe_split_chunks(input, input_len, target, starts);
+    nodal_pool_run(pool, bpe_chunk_task, &ctx, num_chunks);
+
+    // Stitch: chunk c's ids move left to their final offset, in order
+    uint32_t count = 0;
+    for (uint32_t c = 0; c < num_chunks && count < max_tokens; c++) {
+        uint32_t n = counts[c];
+        if (n > max_tokens - count) n = max_tokens - count;
+        memmove(output_ids + count, scratch + starts[c], n * sizeof(uint32_t));
+        count += n;
+    }
+
+    if (call->outputs[1].ptr && call->outputs[1].byte_len >= sizeof(uint32_t)) {
+        *(uint32_t *)call->outputs[1].ptr = count;
+    }
+}
+
+/**
+ * nodal_tokenize_bpe_splits
+ * Whether OP_TOKENIZE_BPE_PARALLEL with these scalars is long enough to
+ * cut into chunks.
+ */
+int nodal_tokenize_bpe_splits(const nodal_scalar_t *s) {
+    return s[0].v.u32 >= 2 * BPE_MIN_CHUNK;
 }
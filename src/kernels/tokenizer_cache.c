@@ -0,0 +1,235 @@
+/*
+ * tokenizer_cache.c - Word-Level Token Cache for the BPE Tokenizer
+ * Fixed-size slots are allocated once at creation time, so the cache
+ * never allocates on the tokenize path and never exceeds its cap.
+ */
+
+#include "../nodal.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TOKCACHE_SHARDS   16       // Independent locks for parallel tokenization
+#define TOKCACHE_MAX_KEY  32       // Longer pre-tokens bypass the cache
+#define TOKCACHE_MAX_IDS  16
+#define TOKCACHE_NIL      0xFFFFFFFFu
+
+typedef struct {
+    uint32_t hash;
+    uint32_t chain;                // Next slot in the bucket
+    uint32_t prev, next;           // LRU list (most recent at head)
+    uint8_t  key_len;
+    uint8_t  num_ids;
+    uint8_t  referenced;           // CLOCK bit
+    uint8_t  pad;
+    uint8_t  key[TOKCACHE_MAX_KEY];
+    uint32_t ids[TOKCACHE_MAX_IDS];
+} tokcache_slot_t;
+
+typedef struct {
+    pthread_mutex_t lock;
+    tokcache_slot_t *slots;
+    uint32_t *buckets;
+    uint32_t num_slots;
+    uint32_t bucket_mask;
+    uint32_t used;                 // Slots handed out so far (never shrinks)
+    uint32_t head, tail;
+    uint32_t hand;
+    uint64_t hits, misses, evictions;
+} tokcache_shard_t;
+
+struct nodal_tokcache {
+    nodal_evict_policy_t policy;
+    size_t bytes;
+    tokcache_shard_t shards[TOKCACHE_SHARDS];
+};
+
+void nodal_tokcache_destroy(nodal_tokcache_t *cache);
+
+static uint32_t tokcache_hash(const uint8_t *key, uint32_t len) {
+    uint32_t h = 2166136261u; // FNV-1a
+    for (uint32_t i = 0; i < len; i++) {
+        h ^= key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * nodal_tokcache_create
+ * Sizes the slot tables to fit max_bytes. Returns NULL if the cap is too
+ * small to hold a single entry per shard.
+ */
+nodal_tokcache_t *nodal_tokcache_create(size_t max_bytes, nodal_evict_policy_t policy) {
+    // Each slot costs the slot itself plus at most 2 bucket heads (pow2 rounding)
+    size_t per_slot = sizeof(tokcache_slot_t) + 2 * sizeof(uint32_t);
+    size_t budget = (max_bytes > sizeof(nodal_tokcache_t)) ? max_bytes - sizeof(nodal_tokcache_t) : 0;
+    uint32_t slots_per_shard = (uint32_t)(budget / per_slot / TOKCACHE_SHARDS);
+    if (slots_per_shard == 0) return NULL;
+
+    uint32_t num_buckets = 1;
+    while (num_buckets < slots_per_shard) num_buckets <<= 1;
+
+    nodal_tokcache_t *cache = (nodal_tokcache_t *)calloc(1, sizeof(nodal_tokcache_t));
+    if (!cache) return NULL;
+    cache->policy = policy;
+    cache->bytes = sizeof(nodal_tokcache_t);
+
+    for (uint32_t s = 0; s < TOKCACHE_SHARDS; s++) {
+        tokcache_shard_t *sh = &cache->shards[s];
+        pthread_mutex_init(&sh->lock, NULL);
+        sh->slots = (tokcache_slot_t *)calloc(slots_per_shard, sizeof(tokcache_slot_t));
+        sh->buckets = (uint32_t *)malloc(num_buckets * sizeof(uint32_t));
+        sh->num_slots = slots_per_shard;
+        sh->bucket_mask = num_buckets - 1;
+        sh->head = sh->tail = TOKCACHE_NIL;
+        if (sh->buckets) memset(sh->buckets, 0xFF, num_buckets * sizeof(uint32_t));
+        cache->bytes += slots_per_shard * sizeof(tokcache_slot_t) + num_buckets * sizeof(uint32_t);
+    }
+    for (uint32_t s = 0; s < TOKCACHE_SHARDS; s++) {
+        if (!cache->shards[s].slots || !cache->shards[s].buckets) {
+            nodal_tokcache_destroy(cache);
+            return NULL;
+        }
+    }
+    return cache;
+}
+
+void nodal_tokcache_destroy(nodal_tokcache_t *cache) {
+    if (!cache) return;
+    for (uint32_t s = 0; s < TOKCACHE_SHARDS; s++) {
+        pthread_mutex_destroy(&cache->shards[s].lock);
+        free(cache->shards[s].slots);
+        free(cache->shards[s].buckets);
+    }
+    free(cache);
+}
+
+static void lru_unlink(tokcache_shard_t *sh, uint32_t i) {
+    tokcache_slot_t *e = &sh->slots[i];
+    if (e->prev != TOKCACHE_NIL) sh->slots[e->prev].next = e->next; else sh->head = e->next;
+    if (e->next != TOKCACHE_NIL) sh->slots[e->next].prev = e->prev; else sh->tail = e->prev;
+}
+
+static void lru_push_front(tokcache_shard_t *sh, uint32_t i) {
+    tokcache_slot_t *e = &sh->slots[i];
+    e->prev = TOKCACHE_NIL;
+    e->next = sh->head;
+    if (sh->head != TOKCACHE_NIL) sh->slots[sh->head].prev = i; else sh->tail = i;
+    sh->head = i;
+}
+
+static uint32_t shard_find(const tokcache_shard_t *sh, uint32_t hash, const uint8_t *key, uint32_t len) {
+    uint32_t i = sh->buckets[(hash >> 4) & sh->bucket_mask];
+    while (i != TOKCACHE_NIL) {
+        const tokcache_slot_t *e = &sh->slots[i];
+        if (e->hash == hash && e->key_len == len && memcmp(e->key, key, len) == 0) return i;
+        i = e->chain;
+    }
+    return TOKCACHE_NIL;
+}
+
+static void shard_unchain(tokcache_shard_t *sh, uint32_t victim) {
+    uint32_t *link = &sh->buckets[(sh->slots[victim].hash >> 4) & sh->bucket_mask];
+    while (*link != victim) link = &sh->slots[*link].chain;
+    *link = sh->slots[victim].chain;
+}
+
+/* Picks a slot for a new entry, evicting one per the cache policy when full */
+static uint32_t shard_claim(tokcache_shard_t *sh, nodal_evict_policy_t policy) {
+    if (sh->used < sh->num_slots) return sh->used++;
+
+    uint32_t victim;
+    if (policy == NODAL_EVICT_CLOCK) {
+        for (;;) {
+            tokcache_slot_t *e = &sh->slots[sh->hand];
+            victim = sh->hand;
+            sh->hand = (sh->hand + 1 == sh->num_slots) ? 0 : sh->hand + 1;
+            if (!e->referenced) break;
+            e->referenced = 0;
+        }
+    } else {
+        victim = sh->tail;
+        lru_unlink(sh, victim);
+    }
+    shard_unchain(sh, victim);
+    sh->evictions++;
+    return victim;
+}
+
+/**
+ * nodal_tokcache_lookup
+ * Copies up to max_ids cached ids for key into ids. Returns the full id
+ * count of the entry, or -1 on a miss.
+ */
+int nodal_tokcache_lookup(nodal_tokcache_t *cache, const uint8_t *key, uint32_t len,
+                          uint32_t *ids, uint32_t max_ids) {
+    if (len == 0 || len > TOKCACHE_MAX_KEY) return -1;
+    uint32_t hash = tokcache_hash(key, len);
+    tokcache_shard_t *sh = &cache->shards[hash % TOKCACHE_SHARDS];
+
+    pthread_mutex_lock(&sh->lock);
+    uint32_t i = shard_find(sh, hash, key, len);
+    if (i == TOKCACHE_NIL) {
+        sh->misses++;
+        pthread_mutex_unlock(&sh->lock);
+        return -1;
+    }
+
+    tokcache_slot_t *e = &sh->slots[i];
+    if (cache->policy == NODAL_EVICT_CLOCK) {
+        e->referenced = 1;
+    } else if (sh->head != i) {
+        lru_unlink(sh, i);
+        lru_push_front(sh, i);
+    }
+    int n = e->num_ids;
+    memcpy(ids, e->ids, ((uint32_t)n < max_ids ? (uint32_t)n : max_ids) * sizeof(uint32_t));
+    sh->hits++;
+    pthread_mutex_unlock(&sh->lock);
+    return n;
+}
+
+/**
+ * nodal_tokcache_insert
+ * Records the ids for key. Keys or id runs too long for a slot are skipped.
+ */
+void nodal_tokcache_insert(nodal_tokcache_t *cache, const uint8_t *key, uint32_t len,
+                           const uint32_t *ids, uint32_t num_ids) {
+    if (len == 0 || len > TOKCACHE_MAX_KEY || num_ids > TOKCACHE_MAX_IDS) return;
+    uint32_t hash = tokcache_hash(key, len);
+    tokcache_shard_t *sh = &cache->shards[hash % TOKCACHE_SHARDS];
+
+    pthread_mutex_lock(&sh->lock);
+    if (shard_find(sh, hash, key, len) == TOKCACHE_NIL) {
+        uint32_t i = shard_claim(sh, cache->policy);
+        tokcache_slot_t *e = &sh->slots[i];
+        e->hash = hash;
+        e->key_len = (uint8_t)len;
+        e->num_ids = (uint8_t)num_ids;
+        e->referenced = 0;
+        memcpy(e->key, key, len);
+        memcpy(e->ids, ids, num_ids * sizeof(uint32_t));
+
+        uint32_t *bucket = &sh->buckets[(hash >> 4) & sh->bucket_mask];
+        e->chain = *bucket;
+        *bucket = i;
+        if (cache->policy == NODAL_EVICT_LRU) lru_push_front(sh, i);
+    }
+    pthread_mutex_unlock(&sh->lock);
+}
+
+void nodal_tokcache_stats(nodal_tokcache_t *cache, nodal_tokcache_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->bytes = cache->bytes;
+    for (uint32_t s = 0; s < TOKCACHE_SHARDS; s++) {
+        tokcache_shard_t *sh = &cache->shards[s];
+        pthread_mutex_lock(&sh->lock);
+        out->hits += sh->hits;
+        out->misses += sh->misses;
+        out->evictions += sh->evictions;
+        out->entries += sh->used;
+        out->capacity += sh->num_slots;
+        pthread_mutex_unlock(&sh->lock);
+    }
+}
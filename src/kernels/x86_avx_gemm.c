@@ -0,0 +1,465 @@
+/*
+ * x86_avx_gemm.c - Cache-Blocked F32 GEMM with AVX2/FMA and AVX-512 Microkernels
+ * BLIS-style loop nest: B is packed into KC x NC panels of NR-wide slivers,
+ * A into MC x KC blocks of MR-row slivers, and a register-tiled MR x NR
+ * microkernel streams both. The ISA is picked at runtime via CPUID.
+ * B may be F16 / BF16: it is widened while packing (GEMM) or loading
+ * (GEMV), so the microkernels only ever see F32.
+ */
+
+#include "../nodal.h"
+#include <string.h>
+
+extern void nodal_kernel_matmul_generic(const nodal_call_t *call);
+extern nodal_isa_t nodal_cpu_isa(void);
+extern int nodal_cpu_has_f16c(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_size(const nodal_pool_t *pool);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern void *nodal_pool_scratch(void);
+extern void nodal_widen(const uint16_t *src, nodal_type_t t, float *dst, size_t n);
+extern float nodal_f16_to_f32(uint16_t h);
+extern float nodal_bf16_to_f32(uint16_t h);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+/* Blocking: KC x NR slivers stay in L1, MC x KC in L2, KC x NC in L3 */
+#define GEMM_KC 256
+#define GEMM_MC 96                 // Multiple of every MR below
+#define GEMM_NC 512                // Multiple of every NR below
+#define GEMM_MR_MAX 8
+#define GEMM_NR_MAX 32
+
+/* M=1 decode path: y chunk kept hot in L1 while B streams through once */
+#define GEMV_NB 2048
+
+/* Threading: below these sizes the pool round trip costs more than it saves */
+#define GEMM_PAR_MIN_FLOPS (1u << 20)
+#define GEMV_PAR_MIN_COLS  256
+
+/*
+ * Microkernel contract: c[MR x NR] = init[MR x NR] + a_sliver * b_sliver,
+ * where init may be NULL (zeros), C itself (K-block accumulation) or an
+ * epilogue operand.
+ */
+typedef void (*gemm_ukernel_fn)(uint32_t kc, const float *a, const float *b,
+                                const float *init, size_t ldi, float *c, size_t ldc);
+
+typedef struct {
+    uint32_t mr;
+    uint32_t nr;
+    gemm_ukernel_fn kernel;
+} gemm_isa_t;
+
+/* Packed A block, then the packed B panel, in the thread's kernel scratch */
+_Static_assert((GEMM_MC * GEMM_KC + GEMM_KC * GEMM_NC) * sizeof(float) <= NODAL_SCRATCH_BYTES,
+               "GEMM packing exceeds NODAL_SCRATCH_BYTES");
+
+/* --- Microkernels --- */
+
+__attribute__((target("avx2,fma")))
+static void ukernel_avx2_6x16(uint32_t kc, const float *a, const float *b,
+                              const float *init, size_t ldi, float *c, size_t ldc) {
+    __m256 acc[6][2];
+    for (int i = 0; i < 6; i++) {
+        acc[i][0] = init ? _mm256_loadu_ps(init + i * ldi) : _mm256_setzero_ps();
+        acc[i][1] = init ? _mm256_loadu_ps(init + i * ldi + 8) : _mm256_setzero_ps();
+    }
+    for (uint32_t k = 0; k < kc; k++) {
+        __m256 b0 = _mm256_load_ps(b);
+        __m256 b1 = _mm256_load_ps(b + 8);
+        for (int i = 0; i < 6; i++) {
+            __m256 ai = _mm256_broadcast_ss(a + i);
+            acc[i][0] = _mm256_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm256_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += 6;
+        b += 16;
+    }
+    for (int i = 0; i < 6; i++) {
+        _mm256_storeu_ps(c + i * ldc, acc[i][0]);
+        _mm256_storeu_ps(c + i * ldc + 8, acc[i][1]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void ukernel_avx512_8x32(uint32_t kc, const float *a, const float *b,
+                                const float *init, size_t ldi, float *c, size_t ldc) {
+    __m512 acc[8][2];
+    for (int i = 0; i < 8; i++) {
+        acc[i][0] = init ? _mm512_loadu_ps(init + i * ldi) : _mm512_setzero_ps();
+        acc[i][1] = init ? _mm512_loadu_ps(init + i * ldi + 16) : _mm512_setzero_ps();
+    }
+    for (uint32_t k = 0; k < kc; k++) {
+        __m512 b0 = _mm512_load_ps(b);
+        __m512 b1 = _mm512_load_ps(b + 16);
+        for (int i = 0; i < 8; i++) {
+            __m512 ai = _mm512_set1_ps(a[i]);
+            acc[i][0] = _mm512_fmadd_ps(ai, b0, acc[i][0]);
+            acc[i][1] = _mm512_fmadd_ps(ai, b1, acc[i][1]);
+        }
+        a += 8;
+        b += 32;
+    }
+    for (int i = 0; i < 8; i++) {
+        _mm512_storeu_ps(c + i * ldc, acc[i][0]);
+        _mm512_storeu_ps(c + i * ldc + 16, acc[i][1]);
+    }
+}
+
+static const gemm_isa_t GEMM_AVX2 = { 6, 16, ukernel_avx2_6x16 };
+static const gemm_isa_t GEMM_AVX512 = { 8, 32, ukernel_avx512_8x32 };
+
+/* --- Packing --- */
+
+/* A[mc x kc] (row stride lda) -> MR-row slivers, k-major, zero padded */
+static void pack_a(const float *A, size_t lda, uint32_t mc, uint32_t kc, uint32_t mr, float *dst) {
+    for (uint32_t i0 = 0; i0 < mc; i0 += mr) {
+        uint32_t rows = (mc - i0 < mr) ? mc - i0 : mr;
+        for (uint32_t k = 0; k < kc; k++) {
+            uint32_t ii = 0;
+            for (; ii < rows; ii++) *dst++ = A[(size_t)(i0 + ii) * lda + k];
+            for (; ii < mr; ii++) *dst++ = 0.0f;
+        }
+    }
+}
+
+/* B[kc x nc] (row stride ldb, elements of type bt) -> F32 NR-column slivers, k-major, zero padded */
+static void pack_b(const void *B, nodal_type_t bt, size_t ldb, uint32_t kc, uint32_t nc, uint32_t nr, float *dst) {
+    for (uint32_t j0 = 0; j0 < nc; j0 += nr) {
+        uint32_t cols = (nc - j0 < nr) ? nc - j0 : nr;
+        for (uint32_t k = 0; k < kc; k++) {
+            size_t at = (size_t)k * ldb + j0;
+            if (bt == NODAL_F32) memcpy(dst, (const float *)B + at, cols * sizeof(float));
+            else nodal_widen((const uint16_t *)B + at, bt, dst, cols);
+            if (cols < nr) memset(dst + cols, 0, (nr - cols) * sizeof(float));
+            dst += nr;
+        }
+    }
+}
+
+/**
+ * gemm_blocked
+ * C[m_begin:m_end, n_begin:n_end] = D + A * B over one output tile (D may
+ * be NULL). Tiles are independent, so threads can own disjoint ones.
+ */
+static void gemm_blocked(const gemm_isa_t *isa, const float *A, const void *B, nodal_type_t bt, const float *D,
+                         float *C, uint32_t N, uint32_t K, uint32_t m_begin, uint32_t m_end, uint32_t n_begin,
+                         uint32_t n_end) {
+    const uint32_t mr = isa->mr, nr = isa->nr;
+    float *pa = (float *)nodal_pool_scratch();
+    float *pb = pa + GEMM_MC * GEMM_KC;
+    float tile[GEMM_MR_MAX * GEMM_NR_MAX] __attribute__((aligned(64)));
+
+    if (K == 0) {
+        for (uint32_t i = m_begin; i < m_end; i++) {
+            for (uint32_t j = n_begin; j < n_end; j++) C[(size_t)i * N + j] = D ? D[(size_t)i * N + j] : 0.0f;
+        }
+        return;
+    }
+
+    for (uint32_t jc = n_begin; jc < n_end; jc += GEMM_NC) {
+        uint32_t nc = (n_end - jc < GEMM_NC) ? n_end - jc : GEMM_NC;
+
+        for (uint32_t pc = 0; pc < K; pc += GEMM_KC) {
+            uint32_t kc = (K - pc < GEMM_KC) ? K - pc : GEMM_KC;
+            pack_b((const char *)B + ((size_t)pc * N + jc) * (bt == NODAL_F32 ? 4 : 2), bt, N, kc, nc, nr, pb);
+
+            for (uint32_t ic = m_begin; ic < m_end; ic += GEMM_MC) {
+                uint32_t mc = (m_end - ic < GEMM_MC) ? m_end - ic : GEMM_MC;
+                pack_a(A + (size_t)ic * K + pc, K, mc, kc, mr, pa);
+
+                for (uint32_t jr = 0; jr < nc; jr += nr) {
+                    uint32_t cols = (nc - jr < nr) ? nc - jr : nr;
+
+                    for (uint32_t ir = 0; ir < mc; ir += mr) {
+                        uint32_t rows = (mc - ir < mr) ? mc - ir : mr;
+                        size_t off = (size_t)(ic + ir) * N + jc + jr;
+                        float *c = C + off;
+                        const float *init = (pc > 0) ? c : (D ? D + off : NULL);
+                        const float *a_sliver = pa + (size_t)ir * kc;
+                        const float *b_sliver = pb + (size_t)jr * kc;
+
+                        if (rows == mr && cols == nr) {
+                            isa->kernel(kc, a_sliver, b_sliver, init, N, c, N);
+                            continue;
+                        }
+
+                        // Edge tile: run the full kernel on a padded copy
+                        for (uint32_t i = 0; i < mr; i++) {
+                            for (uint32_t j = 0; j < nr; j++) {
+                                tile[i * nr + j] = (init && i < rows && j < cols) ? init[(size_t)i * N + j] : 0.0f;
+                            }
+                        }
+                        isa->kernel(kc, a_sliver, b_sliver, tile, nr, tile, nr);
+                        for (uint32_t i = 0; i < rows; i++) {
+                            memcpy(c + (size_t)i * N, tile + i * nr, cols * sizeof(float));
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+/* --- GEMV (M = 1) --- */
+
+/* Up to 16 (masked) elements of a B row, widened to F32 */
+__attribute__((target("avx512f,avx512bw,avx512vl"), always_inline))
+static inline __m512 load_b_avx512(const void *B, size_t at, __mmask16 m, nodal_type_t bt) {
+    if (bt == NODAL_F32) return _mm512_maskz_loadu_ps(m, (const float *)B + at);
+    __m256i h = _mm256_maskz_loadu_epi16(m, (const uint16_t *)B + at);
+    if (bt == NODAL_F16) return _mm512_cvtph_ps(h);
+    return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_cvtepu16_epi32(h), 16));
+}
+
+__attribute__((target("avx2,fma,f16c"), always_inline))
+static inline __m256 load_b_avx2(const void *B, size_t at, nodal_type_t bt) {
+    if (bt == NODAL_F32) return _mm256_loadu_ps((const float *)B + at);
+    __m128i h = _mm_loadu_si128((const __m128i *)((const uint16_t *)B + at));
+    if (bt == NODAL_F16) return _mm256_cvtph_ps(h);
+    return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_cvtepu16_epi32(h), 16));
+}
+
+static inline float load_b(const void *B, size_t at, nodal_type_t bt) {
+    if (bt == NODAL_F32) return ((const float *)B)[at];
+    uint16_t h = ((const uint16_t *)B)[at];
+    return (bt == NODAL_F16) ? nodal_f16_to_f32(h) : nodal_bf16_to_f32(h);
+}
+
+/*
+ * y[n_begin:n_end] = d + a * B, streaming B row-major exactly once with
+ * four rows in flight; the y chunk stays in L1 between rows.
+ */
+__attribute__((target("avx512f,avx512bw,avx512vl"), always_inline))
+static inline void gemv_avx512_typed(const float *a, const void *B, nodal_type_t bt, const float *d, float *y,
+                                     uint32_t N, uint32_t K, uint32_t n_begin, uint32_t n_end) {
+    for (uint32_t j0 = n_begin; j0 < n_end; j0 += GEMV_NB) {
+        uint32_t nb = (n_end - j0 < GEMV_NB) ? n_end - j0 : GEMV_NB;
+        float *yc = y + j0;
+        if (d) memmove(yc, d + j0, nb * sizeof(float));
+        else memset(yc, 0, nb * sizeof(float));
+
+        uint32_t k = 0;
+        for (; k + 4 <= K; k += 4) {
+            size_t r0 = (size_t)k * N + j0, r1 = r0 + N, r2 = r1 + N, r3 = r2 + N;
+            __m512 a0 = _mm512_set1_ps(a[k]), a1 = _mm512_set1_ps(a[k + 1]);
+            __m512 a2 = _mm512_set1_ps(a[k + 2]), a3 = _mm512_set1_ps(a[k + 3]);
+            for (uint32_t j = 0; j < nb; j += 16) {
+                __mmask16 m = (nb - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (nb - j)) - 1);
+                __m512 acc = _mm512_maskz_loadu_ps(m, yc + j);
+                acc = _mm512_fmadd_ps(a0, load_b_avx512(B, r0 + j, m, bt), acc);
+                acc = _mm512_fmadd_ps(a1, load_b_avx512(B, r1 + j, m, bt), acc);
+                acc = _mm512_fmadd_ps(a2, load_b_avx512(B, r2 + j, m, bt), acc);
+                acc = _mm512_fmadd_ps(a3, load_b_avx512(B, r3 + j, m, bt), acc);
+                _mm512_mask_storeu_ps(yc + j, m, acc);
+            }
+        }
+        for (; k < K; k++) {
+            size_t r0 = (size_t)k * N + j0;
+            __m512 a0 = _mm512_set1_ps(a[k]);
+            for (uint32_t j = 0; j < nb; j += 16) {
+                __mmask16 m = (nb - j >= 16) ? (__mmask16)0xFFFF : (__mmask16)((1u << (nb - j)) - 1);
+                __m512 acc = _mm512_maskz_loadu_ps(m, yc + j);
+                acc = _mm512_fmadd_ps(a0, load_b_avx512(B, r0 + j, m, bt), acc);
+                _mm512_mask_storeu_ps(yc + j, m, acc);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma,f16c"), always_inline))
+static inline void gemv_avx2_typed(const float *a, const void *B, nodal_type_t bt, const float *d, float *y,
+                                   uint32_t N, uint32_t K, uint32_t n_begin, uint32_t n_end) {
+    for (uint32_t j0 = n_begin; j0 < n_end; j0 += GEMV_NB) {
+        uint32_t nb = (n_end - j0 < GEMV_NB) ? n_end - j0 : GEMV_NB;
+        uint32_t nv = nb & ~7u;
+        float *yc = y + j0;
+        if (d) memmove(yc, d + j0, nb * sizeof(float));
+        else memset(yc, 0, nb * sizeof(float));
+
+        uint32_t k = 0;
+        for (; k + 4 <= K; k += 4) {
+            size_t r0 = (size_t)k * N + j0, r1 = r0 + N, r2 = r1 + N, r3 = r2 + N;
+            __m256 a0 = _mm256_set1_ps(a[k]), a1 = _mm256_set1_ps(a[k + 1]);
+            __m256 a2 = _mm256_set1_ps(a[k + 2]), a3 = _mm256_set1_ps(a[k + 3]);
+            uint32_t j = 0;
+            for (; j < nv; j += 8) {
+                __m256 acc = _mm256_loadu_ps(yc + j);
+                acc = _mm256_fmadd_ps(a0, load_b_avx2(B, r0 + j, bt), acc);
+                acc = _mm256_fmadd_ps(a1, load_b_avx2(B, r1 + j, bt), acc);
+                acc = _mm256_fmadd_ps(a2, load_b_avx2(B, r2 + j, bt), acc);
+                acc = _mm256_fmadd_ps(a3, load_b_avx2(B, r3 + j, bt), acc);
+                _mm256_storeu_ps(yc + j, acc);
+            }
+            for (; j < nb; j++) {
+                yc[j] += a[k] * load_b(B, r0 + j, bt) + a[k + 1] * load_b(B, r1 + j, bt) +
+                         a[k + 2] * load_b(B, r2 + j, bt) + a[k + 3] * load_b(B, r3 + j, bt);
+            }
+        }
+        for (; k < K; k++) {
+            size_t r0 = (size_t)k * N + j0;
+            __m256 a0 = _mm256_set1_ps(a[k]);
+            uint32_t j = 0;
+            for (; j < nv; j += 8) {
+                _mm256_storeu_ps(yc + j, _mm256_fmadd_ps(a0, load_b_avx2(B, r0 + j, bt), _mm256_loadu_ps(yc + j)));
+            }
+            for (; j < nb; j++) yc[j] += a[k] * load_b(B, r0 + j, bt);
+        }
+    }
+}
+
+/* One GEMV per B dtype so the element loads compile branch-free */
+#define GEMV_SPECIALIZE(name, target_isa)                                                                    \
+    __attribute__((target(target_isa)))                                                                      \
+    static void name(const float *a, const void *B, nodal_type_t bt, const float *d, float *y,               \
+                     uint32_t N, uint32_t K, uint32_t n_begin, uint32_t n_end) {                             \
+        switch (bt) {                                                                                        \
+            case NODAL_F16: name##_typed(a, B, NODAL_F16, d, y, N, K, n_begin, n_end); break;                \
+            case NODAL_BF16: name##_typed(a, B, NODAL_BF16, d, y, N, K, n_begin, n_end); break;              \
+            default: name##_typed(a, B, NODAL_F32, d, y, N, K, n_begin, n_end); break;                       \
+        }                                                                                                    \
+    }
+
+GEMV_SPECIALIZE(gemv_avx512, "avx512f,avx512bw,avx512vl")
+GEMV_SPECIALIZE(gemv_avx2, "avx2,fma,f16c")
+
+/* --- Threading --- */
+
+typedef struct {
+    nodal_isa_t isa;
+    const float *A, *D;
+    const void *B;
+    nodal_type_t bt;               // Element type of B
+    float *C;
+    uint32_t M, N, K;
+    uint32_t mt, nt;               // Tile height / width
+    uint32_t n_tiles;
+} gemm_job_t;
+
+static void gemm_task(void *ctx, uint32_t task) {
+    const gemm_job_t *job = (const gemm_job_t *)ctx;
+    uint32_t m0 = (task / job->n_tiles) * job->mt;
+    uint32_t n0 = (task % job->n_tiles) * job->nt;
+    uint32_t m1 = (job->M - m0 < job->mt) ? job->M : m0 + job->mt;
+    uint32_t n1 = (job->N - n0 < job->nt) ? job->N : n0 + job->nt;
+
+    if (job->M == 1) {
+        if (job->isa == NODAL_ISA_AVX512) gemv_avx512(job->A, job->B, job->bt, job->D, job->C, job->N, job->K, n0, n1);
+        else gemv_avx2(job->A, job->B, job->bt, job->D, job->C, job->N, job->K, n0, n1);
+        return;
+    }
+    gemm_blocked(job->isa == NODAL_ISA_AVX512 ? &GEMM_AVX512 : &GEMM_AVX2,
+                 job->A, job->B, job->bt, job->D, job->C, job->N, job->K, m0, m1, n0, n1);
+}
+
+/*
+ * Cuts C into MC-row by NR-aligned column tiles, about 4 per thread.
+ * Splitting N keeps each thread's packed B panel private; splitting M
+ * only re-packs the (smaller) A block.
+ */
+static uint32_t gemm_plan(gemm_job_t *job, uint32_t threads) {
+    uint32_t nr = (job->isa == NODAL_ISA_AVX512) ? GEMM_AVX512.nr : GEMM_AVX2.nr;
+    uint32_t target = 4 * threads;
+
+    if (job->M == 1) {
+        uint32_t nt = (job->N + target - 1) / target;
+        nt = (nt + 15) & ~15u;
+        job->mt = 1;
+        job->nt = (nt < GEMV_PAR_MIN_COLS) ? GEMV_PAR_MIN_COLS : nt;
+    } else {
+        uint32_t m_tiles = (job->M + GEMM_MC - 1) / GEMM_MC;
+        uint32_t n_split = (m_tiles >= target) ? 1 : (target + m_tiles - 1) / m_tiles;
+        uint32_t nt = (job->N + n_split - 1) / n_split;
+        nt = (nt + nr - 1) / nr * nr;
+        job->mt = GEMM_MC;
+        job->nt = nt ? nt : nr;
+    }
+    job->n_tiles = (job->N + job->nt - 1) / job->nt;
+    return ((job->M + job->mt - 1) / job->mt) * job->n_tiles;
+}
+
+#endif // x86
+
+/**
+ * nodal_matmul_typed
+ * C = D + A * B with runtime ISA dispatch; D may be NULL and B is F32,
+ * F16 or BF16 (bt). Output tiles are spread over the default worker pool
+ * when the problem is big enough. Returns 0 if no SIMD path applies and
+ * the caller must fall back.
+ */
+int nodal_matmul_typed(const float *A, const void *B, nodal_type_t bt, const float *D, float *C,
+                       uint32_t M, uint32_t N, uint32_t K) {
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa == NODAL_ISA_GENERIC) return 0;
+    if (bt != NODAL_F32 && bt != NODAL_F16 && bt != NODAL_BF16) return 0;
+    if (bt != NODAL_F32 && isa == NODAL_ISA_AVX2 && !nodal_cpu_has_f16c()) return 0;
+    if (!nodal_pool_scratch()) return 0;
+
+    if (M == 0 || N == 0) return 1;
+
+    gemm_job_t job = { .isa = isa, .A = A, .B = B, .bt = bt, .D = D, .C = C, .M = M, .N = N, .K = K };
+    nodal_pool_t *pool = nodal_pool_default();
+    uint32_t threads = nodal_pool_size(pool);
+
+    if (threads < 2 || (uint64_t)M * N * K < GEMM_PAR_MIN_FLOPS) {
+        job.mt = M;
+        job.nt = N;
+        job.n_tiles = 1;
+        gemm_task(&job, 0);
+        return 1;
+    }
+    nodal_pool_run(pool, gemm_task, &job, gemm_plan(&job, threads));
+    return 1;
+#else
+    (void)A; (void)B; (void)bt; (void)D; (void)C; (void)M; (void)N; (void)K;
+    return 0;
+#endif
+}
+
+/**
+ * nodal_matmul_f32
+ * nodal_matmul_typed with an F32 B.
+ */
+int nodal_matmul_f32(const float *A, const float *B, const float *D, float *C,
+                     uint32_t M, uint32_t N, uint32_t K) {
+    return nodal_matmul_typed(A, B, NODAL_F32, D, C, M, N, K);
+}
+
+/**
+ * OP_MATMUL / OP_MATMUL_ADD (Dispatching F32)
+ * C = A * B (+ D from inputs[2], applied as the microkernel's initial
+ * accumulator so the sum never makes a separate pass), scalars[0]=M,
+ * [1]=N, [2]=K, [3]=dtype of B (F32, F16 or BF16). Uses the best SIMD
+ * GEMM/GEMV for this CPU, else the generic reference.
+ */
+void nodal_kernel_matmul_f32(const nodal_call_t *call) {
+    const float *A = (const float *)call->inputs[0].ptr;
+    const void *B = call->inputs[1].ptr;
+    const float *D = (const float *)call->inputs[2].ptr;
+    float *C = (float *)call->outputs[0].ptr;
+
+    uint32_t M = call->scalars[0].v.u32;
+    uint32_t N = call->scalars[1].v.u32;
+    uint32_t K = call->scalars[2].v.u32;
+
+    if (!nodal_matmul_typed(A, B, (nodal_type_t)call->scalars[3].v.u32, D, C, M, N, K)) {
+        nodal_kernel_matmul_generic(call);
+    }
+}
+
+/**
+ * nodal_matmul_f32_splits
+ * Whether OP_MATMUL with these scalars is big enough for the SIMD GEMM to
+ * split it over the pool.
+ */
+int nodal_matmul_f32_splits(const nodal_scalar_t *s) {
+#if defined(__x86_64__) || defined(__i386__)
+    return (uint64_t)s[0].v.u32 * s[1].v.u32 * s[2].v.u32 >= GEMM_PAR_MIN_FLOPS;
+#else
+    (void)s;
+    return 0;
+#endif
+}
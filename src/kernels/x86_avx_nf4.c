@@ -0,0 +1,392 @@
+/*
+ * x86_avx_nf4.c - Fused NF4 Dequant-MatMul for AVX2 and AVX-512
+ * Nibbles are decoded with an in-register LUT permute (vpermps) and fed
+ * straight into FMAs; F32 weights are never materialized. Per-block
+ * scales are applied once per block to the block's partial dot product.
+ * Row-major weights and NODAL_LAYOUT_NF4_TILED panels share the decode.
+ */
+
+#include "../nodal.h"
+#include <string.h>
+
+extern void nodal_kernel_matmul_qnf4_generic(const nodal_call_t *call);
+extern nodal_isa_t nodal_cpu_isa(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern void *nodal_pool_scratch(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define QNF4_MB  4                 // Activation rows sharing one weight decode
+#define QNF4_KC  4096              // K chunk whose split activations stay in L1/L2
+#define QNF4_PAR_MIN_WEIGHTS (1u << 16) // Weights (N x K) each task decodes at least
+
+static const float NF4_LUT[16] __attribute__((aligned(64))) = {
+    -1.0f, -0.6944172978401184f, -0.5120928883552551f, -0.37310290336608887f,
+    -0.25598612427711487f, -0.15016591548919678f, -0.05151525139808655f, 0.0f,
+    0.05151525139808655f, 0.15016591548919678f, 0.25598612427711487f, 0.37310290336608887f,
+    0.5120928883552551f, 0.6944172978401184f, 1.0f, 1.25f
+};
+
+/*
+ * Activations split by parity: byte j of W holds elements 2j (low nibble)
+ * and 2j+1 (high nibble), so a[even] pairs with low and a[odd] with high
+ * nibbles without any shuffling of the weights. Lives in the thread's
+ * kernel scratch.
+ */
+typedef struct {
+    float even[QNF4_MB][QNF4_KC / 2];
+    float odd[QNF4_MB][QNF4_KC / 2];
+} qnf4_split_t;
+
+_Static_assert(sizeof(qnf4_split_t) <= NODAL_SCRATCH_BYTES, "NF4 activation split exceeds NODAL_SCRATCH_BYTES");
+
+static void split_activations(qnf4_split_t *a, const float *A, uint32_t K, uint32_t m0, uint32_t mb, uint32_t k0,
+                              uint32_t kc) {
+    for (uint32_t r = 0; r < mb; r++) {
+        const float *row = A + (size_t)(m0 + r) * K + k0;
+        for (uint32_t j = 0; j < kc / 2; j++) {
+            a->even[r][j] = row[2 * j];
+            a->odd[r][j] = row[2 * j + 1];
+        }
+    }
+}
+
+/* Writes the chunk's dot products: the first K chunk starts from the
+ * epilogue addend D (if any), later ones accumulate into C */
+static inline void store_dot(float *C, const float *D, size_t idx, float v, int first) {
+    C[idx] = first ? (D ? D[idx] + v : v) : C[idx] + v;
+}
+
+__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), always_inline))
+static inline void qnf4_chunk_avx512_mb(const qnf4_split_t *a, const uint8_t *W, const float *scales,
+                                        const float *D, float *C, uint32_t N, uint32_t K, uint32_t bs,
+                                        uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end) {
+    const __m512 lut = _mm512_load_ps(NF4_LUT);
+
+    for (uint32_t n = n_begin; n < n_end; n++) {
+        const uint8_t *w = W + ((size_t)n * K + k0) / 2;
+        const float *sc = scales + ((size_t)n * K + k0) / bs;
+        __m512 acc[QNF4_MB];
+        for (uint32_t r = 0; r < QNF4_MB; r++) acc[r] = _mm512_setzero_ps();
+
+        uint32_t off = 0;
+        for (uint32_t b = 0; b < kc / bs; b++) {
+            __m512 blk_lo[QNF4_MB], blk_hi[QNF4_MB];
+            for (uint32_t r = 0; r < QNF4_MB; r++) {
+                blk_lo[r] = _mm512_setzero_ps();
+                blk_hi[r] = _mm512_setzero_ps();
+            }
+            // 16 bytes -> 32 weights per step
+            for (uint32_t g = 0; g < bs; g += 32) {
+                __m512i codes = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)w));
+                __m512 w_lo = _mm512_permutexvar_ps(codes, lut);                       // Uses bits 0-3
+                __m512 w_hi = _mm512_permutexvar_ps(_mm512_srli_epi32(codes, 4), lut);
+                for (uint32_t r = 0; r < mb; r++) {
+                    blk_lo[r] = _mm512_fmadd_ps(w_lo, _mm512_load_ps(&a->even[r][off]), blk_lo[r]);
+                    blk_hi[r] = _mm512_fmadd_ps(w_hi, _mm512_load_ps(&a->odd[r][off]), blk_hi[r]);
+                }
+                w += 16;
+                off += 16;
+            }
+            __m512 scale = _mm512_set1_ps(sc[b]);
+            for (uint32_t r = 0; r < mb; r++) {
+                acc[r] = _mm512_fmadd_ps(_mm512_add_ps(blk_lo[r], blk_hi[r]), scale, acc[r]);
+            }
+        }
+        for (uint32_t r = 0; r < mb; r++) {
+            store_dot(C, D, (size_t)(m0 + r) * N + n, _mm512_reduce_add_ps(acc[r]), k0 == 0);
+        }
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 nf4_lookup_avx2(__m256i codes, __m256 lut_lo, __m256 lut_hi) {
+    // vpermps indexes 8 entries; bit 3 of the code selects the upper half
+    __m256 lo = _mm256_permutevar8x32_ps(lut_lo, codes);
+    __m256 hi = _mm256_permutevar8x32_ps(lut_hi, codes);
+    return _mm256_blendv_ps(lo, hi, _mm256_castsi256_ps(_mm256_slli_epi32(codes, 28)));
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline void qnf4_chunk_avx2_mb(const qnf4_split_t *a, const uint8_t *W, const float *scales,
+                                      const float *D, float *C, uint32_t N, uint32_t K, uint32_t bs,
+                                      uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end) {
+    const __m256 lut_lo = _mm256_load_ps(NF4_LUT);
+    const __m256 lut_hi = _mm256_load_ps(NF4_LUT + 8);
+    const __m256i nibble = _mm256_set1_epi32(0x0F);
+
+    for (uint32_t n = n_begin; n < n_end; n++) {
+        const uint8_t *w = W + ((size_t)n * K + k0) / 2;
+        const float *sc = scales + ((size_t)n * K + k0) / bs;
+        __m256 acc[QNF4_MB];
+        for (uint32_t r = 0; r < QNF4_MB; r++) acc[r] = _mm256_setzero_ps();
+
+        uint32_t off = 0;
+        for (uint32_t b = 0; b < kc / bs; b++) {
+            __m256 blk_lo[QNF4_MB], blk_hi[QNF4_MB];
+            for (uint32_t r = 0; r < QNF4_MB; r++) {
+                blk_lo[r] = _mm256_setzero_ps();
+                blk_hi[r] = _mm256_setzero_ps();
+            }
+            // 8 bytes -> 16 weights per step
+            for (uint32_t g = 0; g < bs; g += 16) {
+                __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)w));
+                __m256 w_lo = nf4_lookup_avx2(_mm256_and_si256(codes, nibble), lut_lo, lut_hi);
+                __m256 w_hi = nf4_lookup_avx2(_mm256_srli_epi32(codes, 4), lut_lo, lut_hi);
+                for (uint32_t r = 0; r < mb; r++) {
+                    blk_lo[r] = _mm256_fmadd_ps(w_lo, _mm256_load_ps(&a->even[r][off]), blk_lo[r]);
+                    blk_hi[r] = _mm256_fmadd_ps(w_hi, _mm256_load_ps(&a->odd[r][off]), blk_hi[r]);
+                }
+                w += 8;
+                off += 8;
+            }
+            __m256 scale = _mm256_set1_ps(sc[b]);
+            for (uint32_t r = 0; r < mb; r++) {
+                acc[r] = _mm256_fmadd_ps(_mm256_add_ps(blk_lo[r], blk_hi[r]), scale, acc[r]);
+            }
+        }
+        for (uint32_t r = 0; r < mb; r++) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc[r]), _mm256_extractf128_ps(acc[r], 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_movehdup_ps(s));
+            store_dot(C, D, (size_t)(m0 + r) * N + n, _mm_cvtss_f32(s), k0 == 0);
+        }
+    }
+}
+
+/*
+ * Tiled layout: one panel of NODAL_NF4_PANEL weight rows at a time, its
+ * tiles (scales, then each row's nibbles) consumed strictly in address
+ * order. Per-row accumulators live in a small L1-resident array.
+ */
+__attribute__((target("avx512f,avx512bw,avx512dq,avx512vl"), always_inline))
+static inline void qnf4_tiled_avx512_mb(const qnf4_split_t *a, const uint8_t *W, const float *scales,
+                                        const float *D, float *C, uint32_t N, uint32_t K, uint32_t bs,
+                                        uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end) {
+    (void)scales;
+    const __m512 lut = _mm512_load_ps(NF4_LUT);
+    const uint32_t P = NODAL_NF4_PANEL;
+    const size_t tile_bytes = P * (sizeof(float) + bs / 2);
+
+    for (uint32_t n0 = n_begin; n0 < n_end; n0 += P) {
+        uint32_t rows = (n_end - n0 < P) ? n_end - n0 : P;
+        const uint8_t *t = W + ((size_t)(n0 / P) * (K / bs) + k0 / bs) * tile_bytes;
+        __m512 acc[NODAL_NF4_PANEL][QNF4_MB];
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t i = 0; i < QNF4_MB; i++) acc[r][i] = _mm512_setzero_ps();
+        }
+
+        for (uint32_t b = 0; b < kc / bs; b++, t += tile_bytes) {
+            const float *sc = (const float *)t;
+            const uint8_t *w = t + P * sizeof(float);
+            for (uint32_t r = 0; r < rows; r++) {
+                __m512 blk_lo[QNF4_MB], blk_hi[QNF4_MB];
+                for (uint32_t i = 0; i < QNF4_MB; i++) {
+                    blk_lo[i] = _mm512_setzero_ps();
+                    blk_hi[i] = _mm512_setzero_ps();
+                }
+                uint32_t off = b * bs / 2;
+                for (uint32_t g = 0; g < bs; g += 32) {
+                    __m512i codes = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i *)w));
+                    __m512 w_lo = _mm512_permutexvar_ps(codes, lut);
+                    __m512 w_hi = _mm512_permutexvar_ps(_mm512_srli_epi32(codes, 4), lut);
+                    for (uint32_t i = 0; i < mb; i++) {
+                        blk_lo[i] = _mm512_fmadd_ps(w_lo, _mm512_load_ps(&a->even[i][off]), blk_lo[i]);
+                        blk_hi[i] = _mm512_fmadd_ps(w_hi, _mm512_load_ps(&a->odd[i][off]), blk_hi[i]);
+                    }
+                    w += 16;
+                    off += 16;
+                }
+                __m512 scale = _mm512_set1_ps(sc[r]);
+                for (uint32_t i = 0; i < mb; i++) {
+                    acc[r][i] = _mm512_fmadd_ps(_mm512_add_ps(blk_lo[i], blk_hi[i]), scale, acc[r][i]);
+                }
+            }
+        }
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t i = 0; i < mb; i++) {
+                store_dot(C, D, (size_t)(m0 + i) * N + n0 + r, _mm512_reduce_add_ps(acc[r][i]), k0 == 0);
+            }
+        }
+    }
+}
+
+__attribute__((target("avx2,fma"), always_inline))
+static inline void qnf4_tiled_avx2_mb(const qnf4_split_t *a, const uint8_t *W, const float *scales,
+                                      const float *D, float *C, uint32_t N, uint32_t K, uint32_t bs,
+                                      uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end) {
+    (void)scales;
+    const __m256 lut_lo = _mm256_load_ps(NF4_LUT);
+    const __m256 lut_hi = _mm256_load_ps(NF4_LUT + 8);
+    const __m256i nibble = _mm256_set1_epi32(0x0F);
+    const uint32_t P = NODAL_NF4_PANEL;
+    const size_t tile_bytes = P * (sizeof(float) + bs / 2);
+
+    for (uint32_t n0 = n_begin; n0 < n_end; n0 += P) {
+        uint32_t rows = (n_end - n0 < P) ? n_end - n0 : P;
+        const uint8_t *t = W + ((size_t)(n0 / P) * (K / bs) + k0 / bs) * tile_bytes;
+        __m256 acc[NODAL_NF4_PANEL][QNF4_MB];
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t i = 0; i < QNF4_MB; i++) acc[r][i] = _mm256_setzero_ps();
+        }
+
+        for (uint32_t b = 0; b < kc / bs; b++, t += tile_bytes) {
+            const float *sc = (const float *)t;
+            const uint8_t *w = t + P * sizeof(float);
+            for (uint32_t r = 0; r < rows; r++) {
+                __m256 blk_lo[QNF4_MB], blk_hi[QNF4_MB];
+                for (uint32_t i = 0; i < QNF4_MB; i++) {
+                    blk_lo[i] = _mm256_setzero_ps();
+                    blk_hi[i] = _mm256_setzero_ps();
+                }
+                uint32_t off = b * bs / 2;
+                for (uint32_t g = 0; g < bs; g += 16) {
+                    __m256i codes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)w));
+                    __m256 w_lo = nf4_lookup_avx2(_mm256_and_si256(codes, nibble), lut_lo, lut_hi);
+                    __m256 w_hi = nf4_lookup_avx2(_mm256_srli_epi32(codes, 4), lut_lo, lut_hi);
+                    for (uint32_t i = 0; i < mb; i++) {
+                        blk_lo[i] = _mm256_fmadd_ps(w_lo, _mm256_load_ps(&a->even[i][off]), blk_lo[i]);
+                        blk_hi[i] = _mm256_fmadd_ps(w_hi, _mm256_load_ps(&a->odd[i][off]), blk_hi[i]);
+                    }
+                    w += 8;
+                    off += 8;
+                }
+                __m256 scale = _mm256_set1_ps(sc[r]);
+                for (uint32_t i = 0; i < mb; i++) {
+                    acc[r][i] = _mm256_fmadd_ps(_mm256_add_ps(blk_lo[i], blk_hi[i]), scale, acc[r][i]);
+                }
+            }
+        }
+        for (uint32_t r = 0; r < rows; r++) {
+            for (uint32_t i = 0; i < mb; i++) {
+                __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc[r][i]), _mm256_extractf128_ps(acc[r][i], 1));
+                s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+                s = _mm_add_ss(s, _mm_movehdup_ps(s));
+                store_dot(C, D, (size_t)(m0 + i) * N + n0 + r, _mm_cvtss_f32(s), k0 == 0);
+            }
+        }
+    }
+}
+
+/* Instantiate each row-block height so accumulators stay in registers */
+#define QNF4_SPECIALIZE(name, target_isa)                                                                      \
+    __attribute__((target(target_isa)))                                                                        \
+    static void name(const qnf4_split_t *a, const uint8_t *W, const float *scales, const float *D, float *C,   \
+                     uint32_t N, uint32_t K, uint32_t bs,                                                      \
+                     uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end) {   \
+        switch (mb) {                                                                                          \
+            case 1: name##_mb(a, W, scales, D, C, N, K, bs, m0, 1, k0, kc, n_begin, n_end); break;             \
+            case 2: name##_mb(a, W, scales, D, C, N, K, bs, m0, 2, k0, kc, n_begin, n_end); break;             \
+            case 3: name##_mb(a, W, scales, D, C, N, K, bs, m0, 3, k0, kc, n_begin, n_end); break;             \
+            default: name##_mb(a, W, scales, D, C, N, K, bs, m0, 4, k0, kc, n_begin, n_end); break;            \
+        }                                                                                                      \
+    }
+
+QNF4_SPECIALIZE(qnf4_chunk_avx512, "avx512f,avx512bw,avx512dq,avx512vl")
+QNF4_SPECIALIZE(qnf4_chunk_avx2, "avx2,fma")
+QNF4_SPECIALIZE(qnf4_tiled_avx512, "avx512f,avx512bw,avx512dq,avx512vl")
+QNF4_SPECIALIZE(qnf4_tiled_avx2, "avx2,fma")
+
+typedef void (*qnf4_chunk_fn)(const qnf4_split_t *a, const uint8_t *W, const float *scales, const float *D, float *C,
+                              uint32_t N, uint32_t K, uint32_t bs,
+                              uint32_t m0, uint32_t mb, uint32_t k0, uint32_t kc, uint32_t n_begin, uint32_t n_end);
+
+/**
+ * qnf4_rows
+ * C[:, n_begin:n_end] for all M rows: activations are split once per
+ * (row block, K chunk) and each weight row is decoded once per row block.
+ * For tiled weights n_begin is panel aligned.
+ */
+static void qnf4_rows(qnf4_chunk_fn chunk, const float *A, const uint8_t *W, const float *scales,
+                      const float *D, float *C,
+                      uint32_t M, uint32_t N, uint32_t K, uint32_t bs, uint32_t n_begin, uint32_t n_end) {
+    qnf4_split_t *a = (qnf4_split_t *)nodal_pool_scratch();
+    uint32_t kc_max = (QNF4_KC / bs) * bs;
+
+    for (uint32_t m0 = 0; m0 < M; m0 += QNF4_MB) {
+        uint32_t mb = (M - m0 < QNF4_MB) ? M - m0 : QNF4_MB;
+        for (uint32_t k0 = 0; k0 < K; k0 += kc_max) {
+            uint32_t kc = (K - k0 < kc_max) ? K - k0 : kc_max;
+            split_activations(a, A, K, m0, mb, k0, kc);
+            chunk(a, W, scales, D, C, N, K, bs, m0, mb, k0, kc, n_begin, n_end);
+        }
+    }
+}
+
+typedef struct {
+    qnf4_chunk_fn chunk;
+    const float *A;
+    const uint8_t *W;
+    const float *scales;
+    const float *D;
+    float *C;
+    uint32_t M, N, K, bs;
+    uint32_t rows_per_task;
+} qnf4_job_t;
+
+/* Each task owns a band of weight rows, i.e. a column band of C */
+static void qnf4_task(void *ctx, uint32_t task) {
+    const qnf4_job_t *job = (const qnf4_job_t *)ctx;
+    uint32_t n_begin = task * job->rows_per_task;
+    uint32_t n_end = (job->N - n_begin < job->rows_per_task) ? job->N : n_begin + job->rows_per_task;
+    qnf4_rows(job->chunk, job->A, job->W, job->scales, job->D, job->C, job->M, job->N, job->K, job->bs, n_begin, n_end);
+}
+
+#endif // x86
+
+/**
+ * OP_MATMUL_QNF4 / OP_MATMUL_QNF4_ADD (Dispatching)
+ * Same contract as nodal_kernel_matmul_qnf4_generic. The SIMD path needs
+ * blocks that tile whole rows (K % block_size == 0, block_size % 32 == 0);
+ * other shapes take the reference kernel. Weight rows are split across
+ * the default worker pool, in whole panels when W is tiled.
+ */
+void nodal_kernel_matmul_qnf4(const nodal_call_t *call) {
+#if defined(__x86_64__) || defined(__i386__)
+    const float *A = (const float *)call->inputs[0].ptr;
+    const uint8_t *W = (const uint8_t *)call->inputs[1].ptr;
+    const float *scales = (const float *)call->inputs[2].ptr;
+    const float *D = (const float *)call->inputs[3].ptr;
+    float *C = (float *)call->outputs[0].ptr;
+
+    uint32_t M = call->scalars[0].v.u32;
+    uint32_t N = call->scalars[1].v.u32;
+    uint32_t K = call->scalars[2].v.u32;
+    uint32_t bs = call->scalars[3].v.u32;
+    int tiled = call->scalars[4].v.u32 == NODAL_LAYOUT_NF4_TILED;
+    nodal_isa_t isa = nodal_cpu_isa();
+
+    if (isa != NODAL_ISA_GENERIC && bs >= 32 && bs <= QNF4_KC && bs % 32 == 0 && K % bs == 0 && K > 0 &&
+        nodal_pool_scratch()) {
+        qnf4_chunk_fn chunk = (isa == NODAL_ISA_AVX512) ? (tiled ? qnf4_tiled_avx512 : qnf4_chunk_avx512)
+                                                        : (tiled ? qnf4_tiled_avx2 : qnf4_chunk_avx2);
+        nodal_pool_t *pool = nodal_pool_default();
+        uint32_t min_rows = (QNF4_PAR_MIN_WEIGHTS + K - 1) / K;
+        uint32_t tasks = nodal_pool_tasks(pool, N, min_rows);
+        qnf4_job_t job = { chunk, A, W, scales, D, C, M, N, K, bs, (N + tasks - 1) / tasks };
+        if (tiled) job.rows_per_task = (job.rows_per_task + NODAL_NF4_PANEL - 1) / NODAL_NF4_PANEL * NODAL_NF4_PANEL;
+        if (job.rows_per_task == 0) return;
+        nodal_pool_run(pool, qnf4_task, &job, (N + job.rows_per_task - 1) / job.rows_per_task);
+        return;
+    }
+#endif
+    nodal_kernel_matmul_qnf4_generic(call);
+}
+
+/**
+ * nodal_matmul_qnf4_splits
+ * Whether OP_MATMUL_QNF4 with these scalars has more than one task's
+ * worth of weight rows.
+ */
+int nodal_matmul_qnf4_splits(const nodal_scalar_t *s) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t N = s[1].v.u32, K = s[2].v.u32;
+    return K > 0 && N > (QNF4_PAR_MIN_WEIGHTS + K - 1) / K;
+#else
+    (void)s;
+    return 0;
+#endif
+}
@@ -0,0 +1,249 @@
+/*
+ * x86_avx_q8.c - Q8_0 Integer Dot-Product MatMul for AVX2 and AVX-512
+ * Each task quantizes the activation rows it is working on to int8 per
+ * block in fixed thread-local buffers, then every weight block is an
+ * integer dot product: AVX2 maddubs/madd, AVX-512BW
+ * maddubs on 64 bytes, or a single vpdpbusd with VNNI. The int32 block
+ * sums are scaled into F32 accumulators and reduced once per output.
+ */
+
+#include "../nodal.h"
+#include <stdio.h>
+#include <string.h>
+
+extern void nodal_kernel_matmul_q8_0_generic(const nodal_call_t *call);
+extern void nodal_q8_quantize_row(const float *x, uint32_t K, uint32_t bs, int8_t *q, float *scales);
+extern nodal_isa_t nodal_cpu_isa(void);
+extern int nodal_cpu_has_vnni(void);
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern void *nodal_pool_scratch(void);
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+#define Q8_MB  4                   // Activation rows sharing one weight load
+#define Q8_MAX_K (1u << 15)        // Longest row the SIMD path quantizes; longer ones use the reference
+#define Q8_PAR_MIN_WEIGHTS (1u << 16) // Weights (N x K) each task reads at least
+
+typedef struct {
+    const float *A;                // F32 activations [M, K]
+    const int8_t *aq;              // Quantized activations of the current row block [Q8_MB, K]
+    const float *as;               // Their block scales [Q8_MB, K / bs]
+    const int8_t *W;
+    const float *ws;
+    const float *D;
+    float *C;
+    uint32_t M, N, K, bs;
+    uint32_t rows_per_task;
+} q8_job_t;
+
+/* One row block of quantized activations, then its scales (block_size >= 32), in the thread's kernel scratch */
+#define Q8_SCRATCH_AQ (Q8_MB * Q8_MAX_K)
+_Static_assert(Q8_SCRATCH_AQ + Q8_MB * Q8_MAX_K / 32 * sizeof(float) <= NODAL_SCRATCH_BYTES,
+               "Q8 activation block exceeds NODAL_SCRATCH_BYTES");
+
+static inline void store_out(const q8_job_t *job, size_t idx, float v) {
+    job->C[idx] = job->D ? job->D[idx] + v : v;
+}
+
+/*
+ * maddubs multiplies unsigned by signed bytes, so each pair is fed as
+ * (|a|, w * sign(a)). Products stay below 2 * 127 * 127 and the int16
+ * pair sums cannot saturate for weights in [-127, 127].
+ */
+__attribute__((target("avx2,fma"), always_inline))
+static inline void q8_rows_avx2_mb(const q8_job_t *job, uint32_t m0, uint32_t mb, uint32_t n_begin, uint32_t n_end) {
+    const uint32_t K = job->K, bs = job->bs, nb = K / bs;
+    const __m256i ones = _mm256_set1_epi16(1);
+
+    for (uint32_t n = n_begin; n < n_end; n++) {
+        const int8_t *w = job->W + (size_t)n * K;
+        const float *ws = job->ws + (size_t)n * nb;
+        __m256 acc[Q8_MB];
+        for (uint32_t r = 0; r < Q8_MB; r++) acc[r] = _mm256_setzero_ps();
+
+        for (uint32_t b = 0; b < nb; b++) {
+            __m256i dot[Q8_MB];
+            for (uint32_t r = 0; r < Q8_MB; r++) dot[r] = _mm256_setzero_si256();
+            for (uint32_t g = b * bs; g < (b + 1) * bs; g += 32) {
+                __m256i wv = _mm256_loadu_si256((const __m256i *)(w + g));
+                for (uint32_t r = 0; r < mb; r++) {
+                    __m256i av = _mm256_loadu_si256((const __m256i *)(job->aq + (size_t)(m0 + r) * K + g));
+                    __m256i p = _mm256_maddubs_epi16(_mm256_sign_epi8(av, av), _mm256_sign_epi8(wv, av));
+                    dot[r] = _mm256_add_epi32(dot[r], _mm256_madd_epi16(p, ones));
+                }
+            }
+            for (uint32_t r = 0; r < mb; r++) {
+                __m256 scale = _mm256_set1_ps(ws[b] * job->as[(size_t)(m0 + r) * nb + b]);
+                acc[r] = _mm256_fmadd_ps(_mm256_cvtepi32_ps(dot[r]), scale, acc[r]);
+            }
+        }
+        for (uint32_t r = 0; r < mb; r++) {
+            __m128 s = _mm_add_ps(_mm256_castps256_ps128(acc[r]), _mm256_extractf128_ps(acc[r], 1));
+            s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+            s = _mm_add_ss(s, _mm_movehdup_ps(s));
+            store_out(job, (size_t)(m0 + r) * job->N + n, _mm_cvtss_f32(s));
+        }
+    }
+}
+
+/* 64 int8 pairs -> 16 int32 lanes, each the sum of 4 adjacent products */
+__attribute__((target("avx512f,avx512bw"), always_inline))
+static inline __m512i dot_bw(__m512i u, __m512i s) {
+    return _mm512_madd_epi16(_mm512_maddubs_epi16(u, s), _mm512_set1_epi16(1));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vnni"), always_inline))
+static inline __m512i dot_vnni(__m512i u, __m512i s) {
+    return _mm512_dpbusd_epi32(_mm512_setzero_si512(), u, s);
+}
+
+/*
+ * 64 bytes per step (K % 64 == 0). With 32-element blocks the low and
+ * high lane halves belong to consecutive blocks and get their own scale;
+ * larger blocks (bs % 64 == 0) share one scale across the vector.
+ * AVX-512 has no vpsignb: |a| comes from vpabsb and w * sign(a) from a
+ * masked negate on a's sign bits.
+ */
+#define Q8_AVX512_ROWS(name, target_isa, DOT)                                                                  \
+    __attribute__((target(target_isa), always_inline))                                                         \
+    static inline void name##_mb(const q8_job_t *job, uint32_t m0, uint32_t mb, uint32_t n_begin, uint32_t n_end) { \
+        const uint32_t K = job->K, bs = job->bs, nb = K / bs;                                                  \
+        const __m512i zero = _mm512_setzero_si512();                                                           \
+        for (uint32_t n = n_begin; n < n_end; n++) {                                                           \
+            const int8_t *w = job->W + (size_t)n * K;                                                          \
+            const float *ws = job->ws + (size_t)n * nb;                                                        \
+            __m512 acc[Q8_MB];                                                                                 \
+            for (uint32_t r = 0; r < Q8_MB; r++) acc[r] = _mm512_setzero_ps();                                 \
+            for (uint32_t k = 0; k < K; k += 64) {                                                             \
+                __m512i wv = _mm512_loadu_si512((const void *)(w + k));                                        \
+                uint32_t b = k / bs;                                                                           \
+                for (uint32_t r = 0; r < mb; r++) {                                                            \
+                    const float *as = job->as + (size_t)(m0 + r) * nb;                                         \
+                    __m512i av = _mm512_loadu_si512((const void *)(job->aq + (size_t)(m0 + r) * K + k));       \
+                    __m512i sw = _mm512_mask_sub_epi8(wv, _mm512_movepi8_mask(av), zero, wv);                  \
+                    __m512 scale = (bs == 32)                                                                  \
+                        ? _mm512_insertf32x8(_mm512_castps256_ps512(_mm256_set1_ps(ws[b] * as[b])),            \
+                                             _mm256_set1_ps(ws[b + 1] * as[b + 1]), 1)                         \
+                        : _mm512_set1_ps(ws[b] * as[b]);                                                       \
+                    __m512i dot = DOT(_mm512_abs_epi8(av), sw);                                                \
+                    acc[r] = _mm512_fmadd_ps(_mm512_cvtepi32_ps(dot), scale, acc[r]);                          \
+                }                                                                                              \
+            }                                                                                                  \
+            for (uint32_t r = 0; r < mb; r++) {                                                                \
+                store_out(job, (size_t)(m0 + r) * job->N + n, _mm512_reduce_add_ps(acc[r]));                   \
+            }                                                                                                  \
+        }                                                                                                      \
+    }
+
+Q8_AVX512_ROWS(q8_rows_avx512bw, "avx512f,avx512bw,avx512dq,avx512vl", dot_bw)
+Q8_AVX512_ROWS(q8_rows_avx512vnni, "avx512f,avx512bw,avx512dq,avx512vl,avx512vnni", dot_vnni)
+
+/* Instantiate each row-block height so accumulators stay in registers */
+#define Q8_SPECIALIZE(name, target_isa)                                                                        \
+    __attribute__((target(target_isa)))                                                                        \
+    static void name(const q8_job_t *job, uint32_t m0, uint32_t mb, uint32_t n_begin, uint32_t n_end) {        \
+        switch (mb) {                                                                                          \
+            case 1: name##_mb(job, m0, 1, n_begin, n_end); break;                                              \
+            case 2: name##_mb(job, m0, 2, n_begin, n_end); break;                                              \
+            case 3: name##_mb(job, m0, 3, n_begin, n_end); break;                                              \
+            default: name##_mb(job, m0, 4, n_begin, n_end); break;                                             \
+        }                                                                                                      \
+    }
+
+Q8_SPECIALIZE(q8_rows_avx2, "avx2,fma")
+Q8_SPECIALIZE(q8_rows_avx512bw, "avx512f,avx512bw,avx512dq,avx512vl")
+Q8_SPECIALIZE(q8_rows_avx512vnni, "avx512f,avx512bw,avx512dq,avx512vl,avx512vnni")
+
+typedef void (*q8_rows_fn)(const q8_job_t *job, uint32_t m0, uint32_t mb, uint32_t n_begin, uint32_t n_end);
+
+typedef struct {
+    q8_job_t job;
+    q8_rows_fn rows;
+} q8_task_t;
+
+/*
+ * Each task owns a band of weight rows, i.e. a column band of C. It
+ * quantizes Q8_MB activation rows at a time into its own buffers; the
+ * repeat across tasks is one pass over A per band of at least
+ * Q8_PAR_MIN_WEIGHTS weights.
+ */
+static void q8_task(void *ctx, uint32_t task) {
+    const q8_task_t *t = (const q8_task_t *)ctx;
+    const q8_job_t *job = &t->job;
+    const uint32_t K = job->K, nb = K / job->bs;
+    uint32_t n_begin = task * job->rows_per_task;
+    uint32_t n_end = (job->N - n_begin < job->rows_per_task) ? job->N : n_begin + job->rows_per_task;
+    int8_t *aq = (int8_t *)nodal_pool_scratch();
+    float *as = (float *)(aq + Q8_SCRATCH_AQ);
+    q8_job_t block = *job;
+    block.aq = aq;
+    block.as = as;
+    for (uint32_t m0 = 0; m0 < job->M; m0 += Q8_MB) {
+        uint32_t mb = (job->M - m0 < Q8_MB) ? job->M - m0 : Q8_MB;
+        for (uint32_t r = 0; r < mb; r++) {
+            nodal_q8_quantize_row(job->A + (size_t)(m0 + r) * K, K, job->bs, aq + (size_t)r * K, as + r * nb);
+        }
+        block.C = job->C + (size_t)m0 * job->N;
+        block.D = job->D ? job->D + (size_t)m0 * job->N : NULL;
+        t->rows(&block, 0, mb, n_begin, n_end);
+    }
+}
+
+#endif // x86
+
+/**
+ * OP_MATMUL_Q8_0 / OP_MATMUL_Q8_0_ADD (Dispatching)
+ * Same contract as nodal_kernel_matmul_q8_0_generic. The SIMD path needs
+ * block_size % 32 == 0 and K <= Q8_MAX_K; AVX-512 additionally K % 64 == 0
+ * and block_size 32 or a multiple of 64, otherwise AVX2 runs. Weight rows
+ * are split across the default worker pool.
+ */
+void nodal_kernel_matmul_q8_0(const nodal_call_t *call) {
+    uint32_t M = call->scalars[0].v.u32;
+    uint32_t N = call->scalars[1].v.u32;
+    uint32_t K = call->scalars[2].v.u32;
+    uint32_t bs = call->scalars[3].v.u32;
+    if (bs == 0 || K % bs || bs > NODAL_Q8_MAX_BLOCK) {
+        fprintf(stderr, "[EXEC] OP_MATMUL_Q8_0 needs a block size dividing K, at most %u (K=%u, block %u)\n",
+                NODAL_Q8_MAX_BLOCK, K, bs);
+        memset(call->outputs[0].ptr, 0, (size_t)M * N * sizeof(float));
+        return;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    nodal_isa_t isa = nodal_cpu_isa();
+    if (isa != NODAL_ISA_GENERIC && bs % 32 == 0 && M > 0 && N > 0 && K > 0 && K <= Q8_MAX_K && nodal_pool_scratch()) {
+        // Integer dot products over bands of weight rows; each task quantizes the activations it uses
+        q8_task_t t = { { (const float *)call->inputs[0].ptr, NULL, NULL, (const int8_t *)call->inputs[1].ptr,
+                          (const float *)call->inputs[2].ptr, (const float *)call->inputs[3].ptr,
+                          (float *)call->outputs[0].ptr, M, N, K, bs, 0 },
+                        q8_rows_avx2 };
+        if (isa == NODAL_ISA_AVX512 && K % 64 == 0 && (bs == 32 || bs % 64 == 0)) {
+            t.rows = nodal_cpu_has_vnni() ? q8_rows_avx512vnni : q8_rows_avx512bw;
+        }
+        nodal_pool_t *pool = nodal_pool_default();
+        uint32_t tasks = nodal_pool_tasks(pool, N, (Q8_PAR_MIN_WEIGHTS + K - 1) / K);
+        t.job.rows_per_task = (N + tasks - 1) / tasks;
+        nodal_pool_run(pool, q8_task, &t, (N + t.job.rows_per_task - 1) / t.job.rows_per_task);
+        return;
+    }
+#endif
+    nodal_kernel_matmul_q8_0_generic(call);
+}
+
+/**
+ * nodal_matmul_q8_0_splits
+ * Whether OP_MATMUL_Q8_0 with these scalars has more than one task's
+ * worth of weight rows.
+ */
+int nodal_matmul_q8_0_splits(const nodal_scalar_t *s) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t N = s[1].v.u32, K = s[2].v.u32;
+    return K > 0 && N > (Q8_PAR_MIN_WEIGHTS + K - 1) / K;
+#else
+    (void)s;
+    return 0;
+#endif
+}
@@ -1,25 +1,281 @@
 /*
  * loader.c - Zero-Copy Model Loader for Nodal
- * Maps .nbbin files and resolves Tensor/Vocab pointers.
+ * Maps .nbbin files and resolves Tensor/Vocab pointers. Optional
+ * residency controls trade load time for a fault-free first inference.
  */
 
 #include <fcntl.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/stat.h>
+#include <time.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <string.h>
 #include "nodal.h"
 
+#define LOAD_HUGE_PAGE (2u << 20)
+#define LOAD_PREFAULT_GRAIN 256    // Pages per prefault task
+
+extern nodal_pool_t *nodal_pool_default(void);
+extern uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+
+typedef struct {
+    const volatile uint8_t *base;
+    size_t num_pages;
+    size_t page;
+    size_t pages_per_task;
+} prefault_job_t;
+
+static void prefault_task(void *ctx, uint32_t task) {
+    const prefault_job_t *job = (const prefault_job_t *)ctx;
+    size_t begin = (size_t)task * job->pages_per_task;
+    size_t end = begin + job->pages_per_task < job->num_pages ? begin + job->pages_per_task : job->num_pages;
+    for (size_t p = begin; p < end; p++) (void)job->base[p * job->page];
+}
+
+static void load_faults(uint64_t *minor, uint64_t *major) {
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    *minor = (uint64_t)ru.ru_minflt;
+    *major = (uint64_t)ru.ru_majflt;
+}
+
+/* True if [off, off + len) lies inside a mapping of size bytes */
+static inline int region_ok(uint64_t off, uint64_t len, size_t size) {
+    return len > 0 && off < size && len <= size - off;
+}
+
+/* madvise on the pages covering [off, off + len); failures are advisory */
+static void advise_region(uint8_t *base, uint64_t off, uint64_t len, size_t page, int advice) {
+    uintptr_t lo = (uintptr_t)(base + off) & ~(uintptr_t)(page - 1);
+    uintptr_t hi = ((uintptr_t)(base + off + len) + page - 1) & ~(uintptr_t)(page - 1);
+    madvise((void *)lo, hi - lo, advice);
+}
+
+/* mlock [off, off + len) if it fits the remaining budget */
+static void lock_region(uint8_t *base, uint64_t off, uint64_t len, size_t *budget, nodal_load_stats_t *st) {
+    if (len == 0 || len > *budget) return;
+    if (mlock(base + off, len) != 0) {
+        if (*budget != 0) perror("[LOADER] mlock failed (check RLIMIT_MEMLOCK)");
+        *budget = 0;
+        return;
+    }
+    *budget -= len;
+    st->locked_bytes += len;
+}
+
+/* Maps the file at a 2MB-aligned address so file and virtual huge page boundaries coincide */
+static void *map_aligned(int fd, size_t size, int flags) {
+    size_t reserve = size + LOAD_HUGE_PAGE;
+    uint8_t *area = mmap(NULL, reserve, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (area == MAP_FAILED) return MAP_FAILED;
+
+    uint8_t *aligned = (uint8_t *)(((uintptr_t)area + LOAD_HUGE_PAGE - 1) & ~(uintptr_t)(LOAD_HUGE_PAGE - 1));
+    void *base = mmap(aligned, size, PROT_READ, flags | MAP_FIXED, fd, 0);
+    if (base == MAP_FAILED) {
+        munmap(area, reserve);
+        return MAP_FAILED;
+    }
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t mapped = (size + page - 1) & ~(page - 1);
+    if (aligned > area) munmap(area, aligned - area);
+    if (area + reserve > aligned + mapped) munmap(aligned + mapped, (area + reserve) - (aligned + mapped));
+    return base;
+}
+
 /**
- * nodal_load_model_mapped
- * Maps a .nbbin file into virtual memory and populates the tensor runtime.
- * * @param path         Path to the .nbbin file.
+ * describe_entry
+ * Validates one tensor-table entry against a mapping of size bytes and
+ * fills its descriptor. Prints the reason and returns -1 if invalid.
+ */
+static int describe_entry(const uint8_t *base, size_t size, const nodal_tensor_entry_t *e, uint32_t idx,
+                          nodal_tensor_t *out) {
+    memset(out, 0, sizeof(*out));
+    const char *why = NULL;
+
+    // 1. Type, rank and element count
+    uint64_t numel = 1;
+    if (e->dtype != NODAL_F32 && e->dtype != NODAL_U32 && e->dtype != NODAL_F16 && e->dtype != NODAL_BF16 &&
+        e->dtype != NODAL_NF4 && e->dtype != NODAL_Q8_0) why = "unknown dtype";
+    else if (e->rank == 0 || e->rank > 4) why = "rank outside 1..4";
+    else if (e->layout != NODAL_LAYOUT_ROW_MAJOR &&
+             !(e->layout == NODAL_LAYOUT_NF4_TILED && e->dtype == NODAL_NF4 && e->rank == 2)) why = "unsupported layout";
+    for (uint32_t d = 0; !why && d < e->rank; d++) {
+        if (e->shape[d] == 0 || numel > UINT64_MAX / e->shape[d]) why = "bad shape";
+        else numel *= e->shape[d];
+    }
+    if (!why && !region_ok(e->data_offset, e->data_size, size)) why = "data outside the file";
+    if (!why && e->has_aux && !region_ok(e->aux_offset, e->aux_size, size)) why = "aux outside the file";
+
+    // 2. Payload size per dtype; NF4 and Q8_0 need their block header and every
+    //    scale, tiled NF4 only the header since its tiles carry the scales
+    uint64_t expect = 0;
+    const nodal_nf4_aux_t *nf4 = NULL;
+    if (!why && e->layout == NODAL_LAYOUT_NF4_TILED) {
+        if (!e->has_aux || e->aux_size < sizeof(nodal_nf4_aux_t) || e->aux_offset % 4) {
+            why = "quantized tensor without a block header";
+        } else {
+            nf4 = (const nodal_nf4_aux_t *)(base + e->aux_offset);
+            uint64_t panels = (e->shape[0] + NODAL_NF4_PANEL - 1) / NODAL_NF4_PANEL;
+            if (nf4->block_size == 0 || nf4->block_size % 2) why = "bad block size";
+            else if (e->shape[1] % nf4->block_size) why = "tiled blocks split a row";
+            else if (nf4->num_scales != 0) why = "tiled NF4 keeps its scales in the tiles";
+            else if (e->data_offset % 4) why = "misaligned tiles";
+            expect = nf4->block_size ? panels * (e->shape[1] / nf4->block_size) * NODAL_NF4_PANEL *
+                                       (sizeof(float) + nf4->block_size / 2) : 0;
+        }
+    } else if (!why && (e->dtype == NODAL_NF4 || e->dtype == NODAL_Q8_0)) {
+        if (!e->has_aux || e->aux_size < sizeof(nodal_nf4_aux_t) || e->aux_offset % 4) {
+            why = "quantized tensor without a block header";
+        } else {
+            nf4 = (const nodal_nf4_aux_t *)(base + e->aux_offset);
+            uint64_t blocks = nf4->block_size ? (numel + nf4->block_size - 1) / nf4->block_size : 0;
+            if (nf4->block_size == 0 || (e->dtype == NODAL_NF4 && nf4->block_size % 2)) why = "bad block size";
+            else if (e->dtype == NODAL_Q8_0 && e->shape[e->rank - 1] % nf4->block_size) why = "Q8_0 blocks split a row";
+            else if (nf4->num_scales != blocks) why = "scale count does not match shape";
+            else if (e->aux_size < sizeof(nodal_nf4_aux_t) + blocks * sizeof(float)) why = "scales truncated";
+            expect = (e->dtype == NODAL_NF4) ? blocks * nf4->block_size / 2 : numel;
+        }
+    } else if (!why) {
+        expect = numel * ((e->dtype == NODAL_F16 || e->dtype == NODAL_BF16) ? 2 : 4);
+    }
+    if (!why && e->data_size != expect) why = "data size does not match shape";
+    if (why) {
+        fprintf(stderr, "[LOADER] Tensor %u invalid: %s\n", idx, why);
+        return -1;
+    }
+
+    // 3. Zero-copy descriptor
+    out->data = base + e->data_offset;
+    out->data_bytes = e->data_size;
+    out->aux = e->has_aux ? base + e->aux_offset : NULL;
+    out->aux_bytes = e->has_aux ? e->aux_size : 0;
+    if (nf4) {
+        out->scales = nf4->num_scales ? (const float *)(nf4 + 1) : NULL;
+        out->num_scales = nf4->num_scales;
+        out->block_size = nf4->block_size;
+    }
+    out->dtype = (nodal_type_t)e->dtype;
+    out->layout = e->layout;
+    out->rank = e->rank;
+    out->numel = numel;
+    uint64_t stride = 1;
+    for (int d = (int)e->rank - 1; d >= 0; d--) {
+        out->shape[d] = e->shape[d];
+        out->strides[d] = stride;
+        stride *= e->shape[d];
+    }
+    return 0;
+}
+
+/**
+ * nodal_tensor_table
+ * Fills typed descriptors for the first max_tensors entries of a mapped
+ * model, validating every entry of the table.
+ * @return Number of descriptors written, or -1 if the table is invalid.
+ */
+int nodal_tensor_table(const void *base, size_t size, nodal_tensor_t *out, uint32_t max_tensors) {
+    const nodal_header_t *hdr = (const nodal_header_t *)base;
+    uint64_t table_bytes = (uint64_t)hdr->num_tensors * sizeof(nodal_tensor_entry_t);
+    if (hdr->num_tensors && !region_ok(hdr->tensor_table_offset, table_bytes, size)) {
+        fprintf(stderr, "[LOADER] Tensor table outside the file\n");
+        return -1;
+    }
+    const nodal_tensor_entry_t *table = (const nodal_tensor_entry_t *)((const uint8_t *)base + hdr->tensor_table_offset);
+    nodal_tensor_t scratch;
+    for (uint32_t i = 0; i < hdr->num_tensors; i++) {
+        if (describe_entry((const uint8_t *)base, size, &table[i], i, i < max_tensors ? &out[i] : &scratch) != 0) {
+            return -1;
+        }
+    }
+    return (int)(hdr->num_tensors < max_tensors ? hdr->num_tensors : max_tensors);
+}
+
+/**
+ * nodal_bind_aux
+ * Binds the scales operand (inputs[2]) of every QNF4 / Q8_0 op whose
+ * weight is a described tensor of that dtype and whose scales slot is
+ * still unbound. The op's N, K, block_size and layout scalars must match
+ * the descriptor. Tiled NF4 weights carry their scales, so the slot is
+ * bound to the tile stream itself. F32 matmuls only get their weight
+ * dtype (scalars[3]: F32, F16 or BF16) checked against the descriptor.
+ * OP_EMBED_GATHER is treated the same way with its table's dtype in
+ * scalars[5] and must read a row-major table.
+ * @return Number of slots bound, or -1 on a mismatch.
+ */
+int nodal_bind_aux(const nodal_irop_t *ops, size_t op_count, const nodal_tensor_t *tensors, uint32_t num_tensors,
+                   nodal_buffer_t *tensor_runtime, uint32_t num_slots) {
+    int bound = 0;
+    for (size_t i = 0; i < op_count; i++) {
+        const nodal_irop_t *op = &ops[i];
+        int gather = (op->kind == OP_EMBED_GATHER);
+        uint32_t want = op->scalars[gather ? 5 : 3].v.u32;
+        if ((op->kind == OP_MATMUL || op->kind == OP_MATMUL_ADD || gather) && op->num_inputs >= 2 &&
+            op->inputs[1] < num_tensors && tensors[op->inputs[1]].dtype != (nodal_type_t)want) {
+            fprintf(stderr, "[LOADER] Op %zu: weight %u is dtype %u, op expects %u\n", i, op->inputs[1],
+                    (unsigned)tensors[op->inputs[1]].dtype, want);
+            return -1;
+        }
+        nodal_type_t dtype = (op->kind == OP_MATMUL_QNF4 || op->kind == OP_MATMUL_QNF4_ADD) ? NODAL_NF4
+                           : (op->kind == OP_MATMUL_Q8_0 || op->kind == OP_MATMUL_Q8_0_ADD) ? NODAL_Q8_0
+                           : (gather && (want == NODAL_NF4 || want == NODAL_Q8_0)) ? (nodal_type_t)want : NODAL_F32;
+        if (dtype == NODAL_F32) continue;
+        if (op->num_inputs < 3 || op->inputs[1] >= num_tensors || op->inputs[2] >= num_slots) continue;
+
+        const nodal_tensor_t *w = &tensors[op->inputs[1]];
+        if (w->dtype != dtype) continue;
+        uint32_t n = op->scalars[1].v.u32, k = op->scalars[2].v.u32;
+        if (w->rank != 2 || w->shape[0] != n || w->shape[1] != k ||
+            op->scalars[3].v.u32 != w->block_size || op->scalars[4].v.u32 != w->layout) {
+            fprintf(stderr, "[LOADER] Op %zu: quantized weight %u is not [%u, %u] / block %u / layout %u\n", i,
+                    op->inputs[1], n, k, op->scalars[3].v.u32, op->scalars[4].v.u32);
+            return -1;
+        }
+        if (gather && w->layout != NODAL_LAYOUT_ROW_MAJOR) {
+            fprintf(stderr, "[LOADER] Op %zu: embedding table %u must be row-major\n", i, op->inputs[1]);
+            return -1;
+        }
+
+        nodal_buffer_t *sc = &tensor_runtime[op->inputs[2]];
+        if (sc->ptr) continue;
+        if (w->layout == NODAL_LAYOUT_NF4_TILED) {
+            sc->ptr = (void *)w->data;
+            sc->byte_len = w->data_bytes;
+        } else {
+            sc->ptr = (void *)w->scales;
+            sc->byte_len = (size_t)w->num_scales * sizeof(float);
+        }
+        bound++;
+    }
+    return bound;
+}
+
+/**
+ * nodal_load_model
+ * Maps a .nbbin file into virtual memory, applies the residency options
+ * and populates the tensor runtime.
+ * @param path         Path to the .nbbin file.
  * @param out_runtime  Pointer to an array of nodal_buffer_t to be populated.
  * @param max_tensors  Size of the out_runtime array.
- * @return             The base address of the mapping (for future munmap).
+ * @param opts         Residency options (NULL = lazy mapping).
+ * @param stats        Optional load report; map_bytes is needed to munmap.
+ * @return             The base address of the mapping.
  */
-void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uint32_t max_tensors) {
+void *nodal_load_model(const char *path, nodal_buffer_t *out_runtime, uint32_t max_tensors,
+                       const nodal_load_opts_t *opts, nodal_load_stats_t *stats) {
+    static const nodal_load_opts_t lazy = {0};
+    nodal_load_stats_t local;
+    if (!opts) opts = &lazy;
+    if (!stats) stats = &local;
+    memset(stats, 0, sizeof(*stats));
+
+    struct timespec t0, t1;
+    uint64_t minor0, major0;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    load_faults(&minor0, &major0);
+
     int fd = open(path, O_RDONLY);
     if (fd < 0) {
         perror("[LOADER] Error opening file");
@@ -27,20 +283,23 @@ void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uin
     }
 
     struct stat st;
-    if (fstat(fd, &st) < 0) {
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(nodal_header_t)) {
         close(fd);
         return NULL;
     }
     size_t size = st.st_size;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
 
     // 1. Memory Map the entire file (Read-Only, Private)
-    void *base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    int flags = MAP_PRIVATE | (opts->prefault == NODAL_PREFAULT_POPULATE ? MAP_POPULATE : 0);
+    void *base = opts->hugepages ? map_aligned(fd, size, flags) : mmap(NULL, size, PROT_READ, flags, fd, 0);
     close(fd); // FD no longer needed after mapping
 
     if (base == MAP_FAILED) {
         perror("[LOADER] mmap failed");
         return NULL;
     }
+    stats->map_bytes = size;
 
     // 2. Validate Header
     nodal_header_t *hdr = (nodal_header_t *)base;
@@ -51,6 +310,10 @@ void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uin
     }
 
     printf("[LOADER] Mapping Model v%d (%u tensors)\n", hdr->version, hdr->num_tensors);
+    if (nodal_tensor_table(base, size, NULL, 0) < 0) {
+        munmap(base, size);
+        return NULL;
+    }
 
     // 3. Resolve Vocabulary (String Table)
     // We map the vocab to the last slot in the runtime table as a convention.
@@ -64,17 +327,112 @@ void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uin
     // 4. Map Individual Tensors
     // The tensor table starts at hdr->tensor_table_offset
     nodal_tensor_entry_t *table = (nodal_tensor_entry_t *)((uint8_t *)base + hdr->tensor_table_offset);
-    
-    for (uint32_t i = 0; i < hdr->num_tensors && i < (max_tensors - 1); i++) {
+    uint64_t table_end = hdr->tensor_table_offset + (uint64_t)hdr->num_tensors * sizeof(nodal_tensor_entry_t);
+    uint32_t num_tensors = hdr->num_tensors;
+
+    for (uint32_t i = 0; i < num_tensors && i < (max_tensors - 1); i++) {
         // Map the main data pointer
         out_runtime[i].ptr = (uint8_t *)base + table[i].data_offset;
         out_runtime[i].byte_len = table[i].data_size;
+    }
 
-        /* Note: In a production build, aux_data (scales/min-max) 
-         * would be handled by a secondary mapping or an aux_runtime array.
-         * For Alpha, we focus on the primary weight data.
-         */
+    // 5. Residency: access hints, huge pages, prefault, then locks
+    uint8_t *b = (uint8_t *)base;
+    int has_vocab = hdr->string_table_offset > 0 && hdr->string_table_offset < size;
+    if (opts->advice != NODAL_ADVICE_NONE) {
+        int weights = (opts->advice == NODAL_ADVICE_RANDOM) ? MADV_RANDOM : MADV_SEQUENTIAL;
+        int vocab = (opts->advice == NODAL_ADVICE_SEQUENTIAL) ? MADV_SEQUENTIAL : MADV_RANDOM;
+        for (uint32_t i = 0; i < num_tensors; i++) {
+            if (region_ok(table[i].data_offset, table[i].data_size, size)) {
+                advise_region(b, table[i].data_offset, table[i].data_size, page, weights);
+            }
+        }
+        if (has_vocab) advise_region(b, hdr->string_table_offset, size - hdr->string_table_offset, page, vocab);
+    }
+    if (opts->hugepages) {
+        for (uint32_t i = 0; i < num_tensors; i++) {
+            if (!region_ok(table[i].data_offset, table[i].data_size, size)) continue;
+            uint64_t lo = (table[i].data_offset + LOAD_HUGE_PAGE - 1) & ~(uint64_t)(LOAD_HUGE_PAGE - 1);
+            uint64_t hi = (table[i].data_offset + table[i].data_size) & ~(uint64_t)(LOAD_HUGE_PAGE - 1);
+            if (hi > lo && madvise(b + lo, hi - lo, MADV_HUGEPAGE) == 0) stats->hugepage_bytes += hi - lo;
+        }
+    }
+    if (opts->prefault == NODAL_PREFAULT_PARALLEL) {
+        prefault_job_t job = { b, (size + page - 1) / page, page, 0 };
+        nodal_pool_t *pool = nodal_pool_default();
+        uint32_t tasks = nodal_pool_tasks(pool, job.num_pages, LOAD_PREFAULT_GRAIN);
+        job.pages_per_task = (job.num_pages + tasks - 1) / tasks;
+        nodal_pool_run(pool, prefault_task, &job, tasks);
+    }
+    if (opts->mlock_bytes) {
+        // Hot first: header, tensor table and tape, then tensors in table order, then vocab
+        size_t budget = opts->mlock_bytes;
+        lock_region(b, 0, table_end <= size ? table_end : sizeof(nodal_header_t), &budget, stats);
+        if ((hdr->flags & NODAL_FLAG_TAPE) && region_ok(hdr->tape_offset, sizeof(nodal_tape_header_t), size)) {
+            const nodal_tape_header_t *tape = (const nodal_tape_header_t *)(b + hdr->tape_offset);
+            uint64_t len = sizeof(nodal_tape_header_t) + (uint64_t)tape->num_ops * tape->op_size;
+            if (region_ok(hdr->tape_offset, len, size)) lock_region(b, hdr->tape_offset, len, &budget, stats);
+        }
+        for (uint32_t i = 0; i < num_tensors; i++) {
+            if (region_ok(table[i].data_offset, table[i].data_size, size)) {
+                lock_region(b, table[i].data_offset, table[i].data_size, &budget, stats);
+            }
+            if (region_ok(table[i].aux_offset, table[i].aux_size, size)) {
+                lock_region(b, table[i].aux_offset, table[i].aux_size, &budget, stats);
+            }
+        }
+        if (has_vocab) lock_region(b, hdr->string_table_offset, size - hdr->string_table_offset, &budget, stats);
     }
 
+    uint64_t minor1, major1;
+    load_faults(&minor1, &major1);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    stats->minor_faults = minor1 - minor0;
+    stats->major_faults = major1 - major0;
+    stats->ready_ms = (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
     return base;
 }
+
+/**
+ * nodal_load_model_mapped
+ * Lazy mapping with no residency hints; see nodal_load_model.
+ * @return             The base address of the mapping (for future munmap).
+ */
+void* nodal_load_model_mapped(const char *path, nodal_buffer_t *out_runtime, uint32_t max_tensors) {
+    return nodal_load_model(path, out_runtime, max_tensors, NULL, NULL);
+}
+
+/**
+ * nodal_map_tape
+ * Locates the IR tape section of a mapped model. The ops follow the
+ * returned header and are used in place (zero-copy).
+ * @param base  Mapping returned by nodal_load_model_mapped.
+ * @param size  Size of the mapping in bytes.
+ * @return      The tape header, or NULL if the file has none or it is malformed.
+ */
+const nodal_tape_header_t *nodal_map_tape(const void *base, size_t size) {
+    const nodal_header_t *hdr = (const nodal_header_t *)base;
+    if (!(hdr->flags & NODAL_FLAG_TAPE) || hdr->tape_offset == 0) return NULL;
+
+    if (hdr->tape_offset % 4 != 0 || hdr->tape_offset > size - sizeof(nodal_tape_header_t)) {
+        fprintf(stderr, "[LOADER] Tape offset %llu outside the file\n", (unsigned long long)hdr->tape_offset);
+        return NULL;
+    }
+    const nodal_tape_header_t *tape = (const nodal_tape_header_t *)((const uint8_t *)base + hdr->tape_offset);
+    if (tape->magic != 0x45504154) { // 'TAPE'
+        fprintf(stderr, "[LOADER] Invalid tape magic: 0x%08X\n", tape->magic);
+        return NULL;
+    }
+    if (tape->op_size != sizeof(nodal_irop_t)) {
+        fprintf(stderr, "[LOADER] Tape op size %u does not match runtime (%zu)\n", tape->op_size, sizeof(nodal_irop_t));
+        return NULL;
+    }
+    size_t ops_end = hdr->tape_offset + sizeof(nodal_tape_header_t) + (size_t)tape->num_ops * sizeof(nodal_irop_t);
+    if (ops_end > size) {
+        fprintf(stderr, "[LOADER] Tape of %u ops runs past the end of the file\n", tape->num_ops);
+        return NULL;
+    }
+
+    printf("[LOADER] Tape mapped: %u ops over %u slots\n", tape->num_ops, tape->num_slots);
+    return tape;
+}
@@ -10,6 +10,8 @@
 
 /* --- Nodal Binary Specification (NDBN) --- */
 
+#define NODAL_FLAG_TAPE 0x0001     // File carries an IR tape section
+
 /**
  * Nodal Header (32 bytes)
  * Fixed-size entry point for the model file.
@@ -17,11 +19,11 @@
 typedef struct {
     uint32_t magic;                // 0x4E42444E ('NDBN')
     uint16_t version;              // Format version
-    uint16_t flags;                // Feature flags
+    uint16_t flags;                // Feature flags (NODAL_FLAG_*)
     uint32_t num_tensors;          // Count of tensors in table
     uint32_t tensor_table_offset;  // Offset to start of Tensor Entries
     uint64_t string_table_offset;  // Offset to Vocab/Merge data
-    uint64_t reserved;             // Alignment padding
+    uint64_t tape_offset;          // Offset to the IR tape section (0 = none)
 } nodal_header_t;
 
 /**
@@ -30,25 +32,56 @@ typedef struct {
  */
 typedef struct {
     uint32_t name_offset;          // Offset to name in string table
-    uint8_t  dtype;                // 0=F32, 4=NF4
+    uint8_t  dtype;                // 0=F32, 2=F16, 3=BF16, 4=NF4, 8=Q8_0
     uint8_t  rank;                 // Number of dimensions
-    uint8_t  layout;               // Memory layout (Row-major)
+    uint8_t  layout;               // NODAL_LAYOUT_*
     uint8_t  has_aux;              // 1 if scale/min-max data exists
     uint32_t shape[4];             // Support for up to 4D tensors
     uint64_t data_offset;          // Offset to raw weights
     uint64_t data_size;            // Size of raw weights in bytes
     uint64_t aux_offset;           // Offset to scales (if has_aux=1)
     uint64_t aux_size;             // Size of scale data
+    uint64_t reserved;             // Pads the entry to 64 bytes
 } nodal_tensor_entry_t;
 
+#define NODAL_LAYOUT_ROW_MAJOR 0
+#define NODAL_LAYOUT_NF4_TILED 1   // NF4 only: panel-interleaved tiles, see below
+
+/*
+ * NF4 tiled layout: rows of W [N, K] are grouped into panels of
+ * NODAL_NF4_PANEL rows, and each panel is stored as K / block_size tiles
+ * in K order. A tile holds the panel's NODAL_NF4_PANEL F32 scales for
+ * that block followed by NODAL_NF4_PANEL runs of block_size / 2 nibble
+ * bytes (one per row, low nibble first). Rows past N are zero padded, so
+ * a matmul reads the weights as a single forward stream. The aux header
+ * keeps block_size with num_scales = 0.
+ */
+#define NODAL_NF4_PANEL 16
+
+/**
+ * NF4 / Q8_0 Aux Header (12 bytes)
+ * Start of a quantized tensor's aux segment, followed by num_scales F32
+ * block scales (one per block_size flat elements, last block padded).
+ */
+typedef struct {
+    uint8_t  reserved[4];
+    uint32_t block_size;
+    uint32_t num_scales;
+} nodal_nf4_aux_t;
+
 /* --- Runtime Structures --- */
 
 typedef enum {
     NODAL_F32 = 0,
     NODAL_U32 = 1,
-    NODAL_NF4 = 4
+    NODAL_F16 = 2,                 // IEEE half
+    NODAL_BF16 = 3,                // Upper 16 bits of an F32
+    NODAL_NF4 = 4,
+    NODAL_Q8_0 = 8                 // int8 in [-127, 127], one F32 scale per block of a row
 } nodal_type_t;
 
+#define NODAL_Q8_MAX_BLOCK 1024    // Largest Q8_0 block_size the matmul kernels accept
+
 /**
  * Nodal Buffer
  * A generic pointer+length descriptor for memory segments.
@@ -58,6 +91,27 @@ typedef struct {
     size_t    byte_len;
 } nodal_buffer_t;
 
+/**
+ * Tensor Descriptor
+ * Typed view of one tensor-table entry, filled zero-copy from the
+ * mapping and validated against the file size. Strides are in elements.
+ */
+typedef struct {
+    const void *data;
+    size_t   data_bytes;
+    const void *aux;               // Raw aux segment (NULL if none)
+    size_t   aux_bytes;
+    const float *scales;           // NF4 / Q8_0 block scales inside aux
+    uint32_t num_scales;
+    uint32_t block_size;           // Quantization block (0 = unquantized)
+    nodal_type_t dtype;
+    uint32_t layout;               // NODAL_LAYOUT_*
+    uint32_t rank;
+    uint32_t shape[4];
+    uint64_t strides[4];
+    uint64_t numel;
+} nodal_tensor_t;
+
 typedef struct {
     nodal_type_t kind;
     union {
@@ -76,6 +130,65 @@ typedef struct {
     nodal_scalar_t scalars[8];     // Contextual parameters (M, N, K, etc.)
 } nodal_call_t;
 
+/* --- Loader --- */
+
+typedef enum {
+    NODAL_PREFAULT_NONE = 0,       // Pages fault in on first touch
+    NODAL_PREFAULT_POPULATE = 1,   // MAP_POPULATE: kernel reads the file in at mmap time
+    NODAL_PREFAULT_PARALLEL = 2    // Worker pool touches every page after mmap
+} nodal_prefault_t;
+
+typedef enum {
+    NODAL_ADVICE_NONE = 0,
+    NODAL_ADVICE_AUTO = 1,         // Weights SEQUENTIAL, vocab RANDOM
+    NODAL_ADVICE_SEQUENTIAL = 2,
+    NODAL_ADVICE_RANDOM = 3
+} nodal_advice_t;
+
+/**
+ * Load Options
+ * Residency strategy for the mapped model. Zero-initialized options
+ * give the plain lazy mapping.
+ */
+typedef struct {
+    nodal_prefault_t prefault;
+    nodal_advice_t advice;         // madvise per tensor kind
+    int hugepages;                 // 2MB-align the mapping, MADV_HUGEPAGE tensor regions
+    size_t mlock_bytes;            // Lock metadata + tensors in table order up to this budget
+} nodal_load_opts_t;
+
+typedef struct {
+    size_t map_bytes;              // Length of the mapping (for munmap)
+    size_t hugepage_bytes;         // Bytes advised MADV_HUGEPAGE
+    size_t locked_bytes;           // Bytes actually mlock'ed
+    uint64_t minor_faults;         // Faults taken while loading
+    uint64_t major_faults;
+    double ready_ms;               // open() to fully mapped and resident per opts
+} nodal_load_stats_t;
+
+/* --- Prefetcher --- */
+
+typedef enum {
+    NODAL_PREFETCH_WILLNEED = 0,   // madvise(MADV_WILLNEED): async readahead
+    NODAL_PREFETCH_TOUCH = 1       // Read one byte per page: I/O and page tables done off-thread
+} nodal_prefetch_mode_t;
+
+/**
+ * Weight Prefetcher
+ * Background thread that pages in the mapped inputs of the next ops on
+ * the tape while the current op computes.
+ */
+typedef struct nodal_prefetch nodal_prefetch_t;
+
+typedef struct {
+    uint64_t ops_checked;          // Ops with mapped inputs the executor reached
+    uint64_t hits;                 // ... whose pages were all resident
+    uint64_t stalls;               // ... that still had pages to read
+    uint64_t stall_pages;          // Non-resident pages found at dispatch
+    uint64_t ops_prefetched;       // Ops the thread issued ahead of the executor
+    uint64_t bytes_prefetched;
+} nodal_prefetch_stats_t;
+
 /* --- IR Operation Types --- */
 
 typedef enum {
@@ -83,9 +196,38 @@ typedef enum {
     OP_MATMUL_QNF4 = 1,
     OP_SOFTMAX = 2,
     OP_ADD = 3,
-    OP_TOKENIZE_BPE = 4
+    OP_TOKENIZE_BPE = 4,
+    OP_TOKENIZE_BPE_PARALLEL = 5,
+    OP_MATMUL_ADD = 6,             // Fused: C = A * B + D (inputs A, B, D)
+    OP_MATMUL_QNF4_ADD = 7,        // Fused: C = A * W^T + D (inputs A, W, scales, D)
+    OP_ADD_SOFTMAX = 8,            // Fused: out = softmax(A + B)
+    OP_ATTENTION = 9,              // Causal GQA attention over a paged KV sequence
+    OP_MATMUL_Q8_0 = 10,           // C = A * W^T, W int8 (inputs A, W, scales)
+    OP_MATMUL_Q8_0_ADD = 11,       // Fused: C = A * W^T + D (inputs A, W, scales, D)
+    OP_CAST = 12,                  // Element-wise F32 / F16 / BF16 conversion
+    OP_RMSNORM = 13,               // Row-wise x / rms(x) * gamma (inputs X, gamma)
+    OP_LAYERNORM = 14,             // Row-wise (x - mean) / std * gamma + beta (inputs X, gamma, beta)
+    OP_SILU = 15,                  // silu(A), or silu(A) * B when the gate B is bound (SwiGLU)
+    OP_GELU = 16,                  // gelu(A), or gelu(A) * B when the gate B is bound (GeGLU)
+    OP_ROPE = 17,                  // Rotary position embedding over [n, heads, head_dim]
+    OP_EMBED_GATHER = 18,          // Table rows by token id (inputs ids, table, scales, count)
+    OP_SAMPLE = 19                 // Token id per logits row (inputs logits, history, count, rng state)
 } nodal_op_kind_t;
 
+/* OP_SAMPLE scratch (outputs[1]) is planned for this many rows drawn at the same time */
+#define NODAL_SAMPLE_SLOTS 8
+
+/* OP_SOFTMAX / OP_ADD_SOFTMAX flags (scalars[3]) */
+#define NODAL_SOFTMAX_CAUSAL 0x1   // Row r of R keeps columns [0, N - R + r], the rest are 0
+#define NODAL_SOFTMAX_ONLINE 0x2   // Running max/sum in one read, then one normalize pass
+
+/* OP_RMSNORM / OP_LAYERNORM epsilon when scalars[2] is 0 */
+#define NODAL_NORM_EPS 1e-5f
+
+/* OP_ROPE frequency base when scalars[5] is 0, and flags (scalars[6]) */
+#define NODAL_ROPE_THETA 10000.0f
+#define NODAL_ROPE_NEOX  0x1       // Rotate (d, d + head_dim/2) pairs instead of (2i, 2i + 1)
+
 typedef struct {
     nodal_op_kind_t kind;
     uint32_t num_inputs;
@@ -95,4 +237,298 @@ typedef struct {
     nodal_scalar_t scalars[8];
 } nodal_irop_t;
 
+/**
+ * Tape Section Header (32 bytes)
+ * Found at nodal_header_t.tape_offset, followed directly by num_ops
+ * nodal_irop_t records (op_size bytes each) that are mapped zero-copy.
+ * Slots below the model's num_tensors are weights; the rest are
+ * activations for the memory planner.
+ */
+typedef struct {
+    uint32_t magic;                // 0x45504154 ('TAPE')
+    uint32_t num_ops;
+    uint32_t op_size;              // sizeof(nodal_irop_t) the compiler assumed
+    uint32_t num_slots;            // Runtime table entries the tape references
+    uint32_t input_slot;           // Slot the caller fills (0xFFFFFFFF = none)
+    uint32_t input_bytes;
+    uint32_t output_slot;          // Slot holding the result (0xFFFFFFFF = none)
+    uint32_t reserved;
+} nodal_tape_header_t;
+
+/**
+ * Kernel Entry Point
+ * Every op kind resolves to one of these through the executor's table.
+ */
+typedef void (*nodal_kernel_fn)(const nodal_call_t *call);
+
+/**
+ * Resolved Tape
+ * The tape pre-bound to physical memory: one (kernel, call) record per
+ * op, so execution is a walk over an array of indirect calls.
+ */
+typedef struct nodal_tape nodal_tape_t;
+
+/* --- Tokenizer --- */
+
+/**
+ * BPE Merge Rule (12 bytes)
+ * The vocab segment emitted by nc.py is an array of these, sorted by
+ * (p1, p2) with duplicate pairs removed, so lookups are a binary search.
+ * Merging p1+p2 produces token id 256 + rank.
+ */
+typedef struct {
+    uint32_t p1;
+    uint32_t p2;
+    uint32_t rank;
+} bpe_rule_t;
+
+typedef enum {
+    NODAL_EVICT_LRU = 0,           // Exact least-recently-used
+    NODAL_EVICT_CLOCK = 1          // Second-chance sweep, cheaper hits
+} nodal_evict_policy_t;
+
+/**
+ * Token Cache
+ * Bounded map from pre-token bytes to their BPE ids, shared by all
+ * tokenizer calls of a session. Passed to the tokenizer ops as inputs[2].
+ */
+typedef struct nodal_tokcache nodal_tokcache_t;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint32_t entries;              // Live entries
+    uint32_t capacity;             // Entry slots fitting in the memory cap
+    size_t   bytes;                // Memory reserved by the cache
+} nodal_tokcache_stats_t;
+
+/* --- Hardware Dispatch --- */
+
+/**
+ * Nodal ISA Level
+ * Ordered so that a higher level implies every lower one.
+ */
+typedef enum {
+    NODAL_ISA_GENERIC = 0,         // Portable C
+    NODAL_ISA_AVX2 = 1,            // AVX2 + FMA
+    NODAL_ISA_AVX512 = 2           // AVX-512 F/BW/DQ/VL
+} nodal_isa_t;
+
+/* --- Worker Pool --- */
+
+typedef struct nodal_pool nodal_pool_t;
+
+/* Kernel scratch each thread owns (nodal_pool_scratch); GEMM packing is the largest user */
+#define NODAL_SCRATCH_BYTES (608u * 1024)
+
+/**
+ * Pool Task
+ * One unit of a parallel-for; task indices run in [0, num_tasks).
+ */
+typedef void (*nodal_task_fn)(void *ctx, uint32_t task);
+
+/* --- Scheduler --- */
+
+/**
+ * Tape Schedule
+ * Dependency DAG of a tape (read-after-write, write-after-read and
+ * write-after-write on tensor indices), grouped into levels whose ops
+ * are mutually independent. Built once, reused every execution.
+ */
+typedef struct nodal_schedule nodal_schedule_t;
+
+typedef struct {
+    uint32_t num_ops;
+    uint32_t num_edges;            // Distinct op -> op dependencies
+    uint32_t num_levels;           // Critical path length in ops
+    uint32_t max_width;            // Most ops sharing one level
+    uint32_t num_solo;             // Ops of wide levels large enough to run alone on the whole pool
+} nodal_schedule_stats_t;
+
+/* --- Profiler --- */
+
+/**
+ * Tape Profiler
+ * Per-op wall time, FLOPs and bytes from the op's scalars, and optional
+ * perf counters, gathered by nodal_tape_run_profiled. The plain tape
+ * runners carry no hooks, so profiling costs nothing unless chosen.
+ */
+typedef struct nodal_profiler nodal_profiler_t;
+
+#define NODAL_PROFILE_COUNTERS 0x1 // perf_event_open: cycles, LLC misses, page faults
+#define NODAL_PROFILE_TRACE    0x2 // Keep every op run for nodal_profiler_write_trace
+
+typedef struct {
+    nodal_op_kind_t kind;
+    uint32_t calls;
+    double   total_us;
+    double   max_us;
+    double   flops;                // Per call; 0 when the scalars do not determine it
+    double   bytes;                // Per call: operands read + results written
+    uint64_t cycles;               // Summed over calls and threads; 0 without counters
+    uint64_t llc_misses;
+    uint64_t page_faults;
+} nodal_op_profile_t;
+
+/* --- KV Cache --- */
+
+/**
+ * Paged KV Cache
+ * Attention K/V storage carved from one preallocated slab into fixed
+ * blocks of block_tokens positions (every layer of those positions in
+ * one block). Blocks are reference-counted: forked sequences share
+ * their prefix, and a write into a shared block copies it first.
+ */
+typedef struct nodal_kv_cache nodal_kv_cache_t;
+
+/**
+ * KV Sequence
+ * One sequence's block table and per-layer length. Passed to
+ * OP_ATTENTION as inputs[3]; every run appends the op's new tokens.
+ */
+typedef struct nodal_kv_seq nodal_kv_seq_t;
+
+typedef struct {
+    uint32_t num_blocks;
+    uint32_t free_blocks;
+    uint32_t shared_blocks;        // Blocks referenced by more than one sequence
+    uint32_t block_tokens;
+    size_t   block_bytes;
+    uint64_t cow_copies;           // Shared blocks copied before a write
+} nodal_kv_stats_t;
+
+/* --- Sessions --- */
+
+/**
+ * Model Handle
+ * One reference-counted mapping of a .nbbin (weights, tensor table and
+ * tape), shared read-only by every session created from it.
+ */
+typedef struct nodal_model nodal_model_t;
+
+/**
+ * Inference Session
+ * Private runtime table, activation arena and input buffer over a
+ * shared model. Thread-safe: runs on one session are serialized.
+ */
+typedef struct nodal_session nodal_session_t;
+
+/**
+ * Request Batcher
+ * Queues concurrent requests on one model and runs them together, one
+ * row each of stacked activations, so matmuls stream weights once per
+ * batch.
+ */
+typedef struct nodal_batcher nodal_batcher_t;
+
+typedef struct {
+    uint64_t batches;
+    uint64_t requests;
+    uint32_t max_rows;             // Largest batch run
+    uint64_t weight_bytes;         // Shared operand bytes passed to kernels
+} nodal_batcher_stats_t;
+
+/* --- Memory Planner --- */
+
+/**
+ * Planned Tensor
+ * One intermediate placed in the activation arena. Lifetimes are in
+ * execution steps: tape positions, or levels for a scheduled tape.
+ */
+typedef struct {
+    uint32_t tensor;               // Runtime table index
+    uint32_t first;                // Step of the first write
+    uint32_t last;                 // Step of the last use (inclusive)
+    uint32_t pad;
+    size_t   offset;               // Byte offset into the arena, 64-byte aligned
+    size_t   bytes;                // Rounded up to 64
+} nodal_plan_entry_t;
+
+typedef struct {
+    nodal_plan_entry_t *entries;
+    uint32_t num_entries;
+    size_t   arena_bytes;          // Peak activation memory
+    size_t   live_peak_bytes;      // Most bytes live in one step (packing lower bound)
+    size_t   naive_bytes;          // One buffer per intermediate
+} nodal_plan_t;
+
+/* --- Kernel Math --- */
+
+/*
+ * Cephes expf shared by the kernels that exponentiate (softmax, the
+ * activations, the sampler): clamp, n = round(x / ln2), r = x - n ln2,
+ * e^r by polynomial. EXP_LO keeps 2^n normal, so exp underflows to
+ * ~1e-38 instead of 0; NaN clamps to EXP_LO.
+ */
+#define NODAL_EXP_HI     88.3762626647949f
+#define NODAL_EXP_LO     -87.3365447505531f
+#define NODAL_EXP_LOG2E  1.44269504088896341f
+#define NODAL_EXP_LN2_HI 0.693359375f
+#define NODAL_EXP_LN2_LO -2.12194440e-4f
+#define NODAL_EXP_P0     1.9875691500e-4f
+#define NODAL_EXP_P1     1.3981999507e-3f
+#define NODAL_EXP_P2     8.3334519073e-3f
+#define NODAL_EXP_P3     4.1665795894e-2f
+#define NODAL_EXP_P4     1.6666665459e-1f
+#define NODAL_EXP_P5     5.0000001201e-1f
+
+static inline float nodal_exp_scalar(float x) {
+    x = (x > NODAL_EXP_LO) ? x : NODAL_EXP_LO; // Also maps NaN to EXP_LO
+    x = (x < NODAL_EXP_HI) ? x : NODAL_EXP_HI;
+    float fx = x * NODAL_EXP_LOG2E;
+    float n = (float)(int32_t)(fx + (fx >= 0.0f ? 0.5f : -0.5f));
+    float r = x - n * NODAL_EXP_LN2_HI - n * NODAL_EXP_LN2_LO;
+    float p = NODAL_EXP_P0;
+    p = p * r + NODAL_EXP_P1;
+    p = p * r + NODAL_EXP_P2;
+    p = p * r + NODAL_EXP_P3;
+    p = p * r + NODAL_EXP_P4;
+    p = p * r + NODAL_EXP_P5;
+    p = p * r * r + r + 1.0f;
+    union { uint32_t u; float f; } scale = { (uint32_t)((int32_t)n + 127) << 23 };
+    return p * scale.f;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+__attribute__((target("avx512f")))
+static inline __m512 nodal_exp_avx512(__m512 x) {
+    x = _mm512_max_ps(x, _mm512_set1_ps(NODAL_EXP_LO));
+    x = _mm512_min_ps(x, _mm512_set1_ps(NODAL_EXP_HI));
+    __m512 n = _mm512_roundscale_ps(_mm512_mul_ps(x, _mm512_set1_ps(NODAL_EXP_LOG2E)),
+                                    _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512 r = _mm512_fnmadd_ps(n, _mm512_set1_ps(NODAL_EXP_LN2_HI), x);
+    r = _mm512_fnmadd_ps(n, _mm512_set1_ps(NODAL_EXP_LN2_LO), r);
+    __m512 p = _mm512_set1_ps(NODAL_EXP_P0);
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(NODAL_EXP_P1));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(NODAL_EXP_P2));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(NODAL_EXP_P3));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(NODAL_EXP_P4));
+    p = _mm512_fmadd_ps(p, r, _mm512_set1_ps(NODAL_EXP_P5));
+    p = _mm512_fmadd_ps(_mm512_mul_ps(p, r), r, _mm512_add_ps(r, _mm512_set1_ps(1.0f)));
+    return _mm512_scalef_ps(p, n);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 nodal_exp_avx2(__m256 x) {
+    x = _mm256_max_ps(x, _mm256_set1_ps(NODAL_EXP_LO));
+    x = _mm256_min_ps(x, _mm256_set1_ps(NODAL_EXP_HI));
+    __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(NODAL_EXP_LOG2E)),
+                               _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256 r = _mm256_fnmadd_ps(n, _mm256_set1_ps(NODAL_EXP_LN2_HI), x);
+    r = _mm256_fnmadd_ps(n, _mm256_set1_ps(NODAL_EXP_LN2_LO), r);
+    __m256 p = _mm256_set1_ps(NODAL_EXP_P0);
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(NODAL_EXP_P1));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(NODAL_EXP_P2));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(NODAL_EXP_P3));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(NODAL_EXP_P4));
+    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(NODAL_EXP_P5));
+    p = _mm256_fmadd_ps(_mm256_mul_ps(p, r), r, _mm256_add_ps(r, _mm256_set1_ps(1.0f)));
+    __m256i e = _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+    return _mm256_mul_ps(p, _mm256_castsi256_ps(e));
+}
+#endif
+
 #endif // NODAL_H
@@ -0,0 +1,236 @@
+/*
+ * planner.c - Static Activation Memory Planner for Nodal
+ * Intermediates produced by the tape share a single 64-byte-aligned
+ * arena: lifetimes are computed once, then tensors are packed like a
+ * register allocator so buffers that are never live together reuse the
+ * same bytes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nodal.h"
+
+extern uint32_t nodal_schedule_level(const nodal_schedule_t *sched, uint32_t i);
+extern size_t nodal_dtype_size(nodal_type_t t);
+extern size_t nodal_sample_scratch_bytes(uint32_t vocab, uint32_t rows);
+
+#define PLAN_ALIGN 64
+#define PLAN_UNSET 0xFFFFFFFFu
+
+/**
+ * nodal_op_output_bytes
+ * Bytes op writes to outputs[j], derived from its scalars. Returns 0
+ * when the size is not known statically.
+ */
+size_t nodal_op_output_bytes(const nodal_irop_t *op, uint32_t j) {
+    const nodal_scalar_t *s = op->scalars;
+    switch (op->kind) {
+        case OP_MATMUL:
+        case OP_MATMUL_QNF4:
+        case OP_MATMUL_ADD:
+        case OP_MATMUL_QNF4_ADD:
+        case OP_MATMUL_Q8_0:
+        case OP_MATMUL_Q8_0_ADD:
+            return j == 0 ? (size_t)s[0].v.u32 * s[1].v.u32 * sizeof(float) : 0;
+        case OP_ADD:
+        case OP_SILU:
+        case OP_GELU:
+            return j == 0 ? (size_t)s[0].v.u32 * sizeof(float) : 0;
+        case OP_CAST:
+            return j == 0 ? (size_t)s[0].v.u32 * nodal_dtype_size((nodal_type_t)s[2].v.u32) : 0;
+        case OP_SOFTMAX:
+        case OP_ADD_SOFTMAX:
+        case OP_RMSNORM:
+        case OP_LAYERNORM:
+            return j == 0 ? (size_t)s[0].v.u32 * (s[1].v.u32 ? s[1].v.u32 : 1) * sizeof(float) : 0;
+        case OP_ATTENTION:
+            return j == 0 ? (size_t)s[0].v.u32 * s[1].v.u32 * s[3].v.u32 * sizeof(float) : 0;
+        case OP_EMBED_GATHER:
+            return j == 0 ? (size_t)s[0].v.u32 * s[2].v.u32 * sizeof(float) : 0;
+        case OP_ROPE:
+            return j == 0 ? (size_t)s[0].v.u32 * s[1].v.u32 * s[2].v.u32 * sizeof(float) : 0;
+        case OP_SAMPLE:
+            if (j == 0) return (size_t)(s[1].v.u32 ? s[1].v.u32 : 1) * sizeof(uint32_t);
+            if (j == 1) return nodal_sample_scratch_bytes(s[0].v.u32, s[1].v.u32);
+            return 0;
+        case OP_TOKENIZE_BPE:
+        case OP_TOKENIZE_BPE_PARALLEL:
+            if (j == 0) return (size_t)s[1].v.u32 * sizeof(uint32_t);
+            if (j == 1) return sizeof(uint32_t);
+            if (j == 2) return (size_t)s[0].v.u32 * sizeof(uint32_t);
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * nodal_op_kv_input
+ * Which input of op is the nodal_kv_seq_t it reads: inputs[3] of
+ * OP_ATTENTION, inputs[1] of an OP_ROPE that declares one. Returns 0
+ * when it takes no sequence.
+ */
+uint32_t nodal_op_kv_input(const nodal_irop_t *op) {
+    if (op->kind == OP_ATTENTION && op->num_inputs >= 4) return 3;
+    if (op->kind == OP_ROPE && op->num_inputs >= 2) return 1;
+    return 0;
+}
+
+static int cmp_entry_size_desc(const void *a, const void *b) {
+    const nodal_plan_entry_t *x = (const nodal_plan_entry_t *)a;
+    const nodal_plan_entry_t *y = (const nodal_plan_entry_t *)b;
+    if (x->bytes != y->bytes) return x->bytes < y->bytes ? 1 : -1;
+    return (x->first > y->first) - (x->first < y->first);
+}
+
+static int cmp_entry_offset(const void *a, const void *b) {
+    const nodal_plan_entry_t *x = *(const nodal_plan_entry_t *const *)a;
+    const nodal_plan_entry_t *y = *(const nodal_plan_entry_t *const *)b;
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static inline int lifetimes_overlap(const nodal_plan_entry_t *a, const nodal_plan_entry_t *b) {
+    return a->first <= b->last && b->first <= a->last;
+}
+
+/**
+ * nodal_plan_build
+ * Plans every tensor the tape writes that is still unbound in
+ * tensor_runtime (NULL ptr). With sched, steps are levels and the plan
+ * is only valid for nodal_execute_schedule(sched); without it, steps are
+ * tape positions for nodal_execute_tape. Tensors written last and never
+ * read again stay live to the end so results survive. Unbound tensors
+ * read before any write are inputs the caller must bind itself.
+ * @return 0 on success, -1 on bad indices or allocation failure.
+ */
+int nodal_plan_build(const nodal_irop_t *ops, size_t op_count, const nodal_schedule_t *sched,
+                     const nodal_buffer_t *tensor_runtime, uint32_t num_tensors, nodal_plan_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint32_t *first = (uint32_t *)malloc(num_tensors * sizeof(uint32_t));
+    uint32_t *last = (uint32_t *)malloc(num_tensors * sizeof(uint32_t));
+    uint8_t *last_is_write = (uint8_t *)calloc(num_tensors, 1);
+    size_t *bytes = (size_t *)calloc(num_tensors, sizeof(size_t));
+    if (!first || !last || !last_is_write || !bytes) goto fail;
+    memset(first, 0xFF, num_tensors * sizeof(uint32_t));
+    memset(last, 0xFF, num_tensors * sizeof(uint32_t));
+
+    // 1. Lifetimes in execution steps
+    uint32_t num_steps = 0;
+    for (uint32_t i = 0; i < (uint32_t)op_count; i++) {
+        const nodal_irop_t *op = &ops[i];
+        uint32_t step = sched ? nodal_schedule_level(sched, i) : i;
+        if (step + 1 > num_steps) num_steps = step + 1;
+
+        for (uint32_t j = 0; j < op->num_inputs && j < 8; j++) {
+            uint32_t t = op->inputs[j];
+            if (t >= num_tensors) goto bad_index;
+            if (tensor_runtime[t].ptr || first[t] == PLAN_UNSET) continue;
+            if (last[t] == PLAN_UNSET || step >= last[t]) {
+                last[t] = step;
+                last_is_write[t] = 0;
+            }
+        }
+        for (uint32_t j = 0; j < op->num_outputs && j < 4; j++) {
+            uint32_t t = op->outputs[j];
+            if (t >= num_tensors) goto bad_index;
+            if (tensor_runtime[t].ptr) continue;
+            size_t need = nodal_op_output_bytes(op, j);
+            if (need > bytes[t]) bytes[t] = need;
+            if (first[t] == PLAN_UNSET || step < first[t]) first[t] = step;
+            if (last[t] == PLAN_UNSET || step >= last[t]) {
+                last[t] = step;
+                last_is_write[t] = 1;
+            }
+        }
+    }
+
+    // 2. Collect intermediates; outputs nobody reads stay live to the end
+    uint32_t count = 0;
+    for (uint32_t t = 0; t < num_tensors; t++) count += (first[t] != PLAN_UNSET && bytes[t] > 0);
+    out->entries = (nodal_plan_entry_t *)calloc(count ? count : 1, sizeof(nodal_plan_entry_t));
+    nodal_plan_entry_t **placed = (nodal_plan_entry_t **)malloc((count ? count : 1) * sizeof(void *));
+    size_t *live = (size_t *)calloc(num_steps ? num_steps : 1, sizeof(size_t));
+    if (!out->entries || !placed || !live) {
+        free(placed);
+        free(live);
+        goto fail;
+    }
+    for (uint32_t t = 0; t < num_tensors; t++) {
+        if (first[t] == PLAN_UNSET || bytes[t] == 0) continue;
+        nodal_plan_entry_t *e = &out->entries[out->num_entries++];
+        e->tensor = t;
+        e->first = first[t];
+        e->last = last_is_write[t] ? num_steps - 1 : last[t];
+        e->bytes = (bytes[t] + PLAN_ALIGN - 1) & ~(size_t)(PLAN_ALIGN - 1);
+        out->naive_bytes += e->bytes;
+        for (uint32_t s = e->first; s <= e->last; s++) live[s] += e->bytes;
+    }
+    for (uint32_t s = 0; s < num_steps; s++) {
+        if (live[s] > out->live_peak_bytes) out->live_peak_bytes = live[s];
+    }
+
+    // 3. Greedy by size: each tensor takes the tightest gap between the
+    // already-placed tensors whose lifetimes overlap its own
+    qsort(out->entries, out->num_entries, sizeof(nodal_plan_entry_t), cmp_entry_size_desc);
+    for (uint32_t i = 0; i < out->num_entries; i++) {
+        nodal_plan_entry_t *e = &out->entries[i];
+        uint32_t n_conflicts = 0;
+        for (uint32_t k = 0; k < i; k++) {
+            if (lifetimes_overlap(e, &out->entries[k])) placed[n_conflicts++] = &out->entries[k];
+        }
+        qsort(placed, n_conflicts, sizeof(void *), cmp_entry_offset);
+
+        size_t cursor = 0, best = (size_t)-1, best_gap = (size_t)-1;
+        for (uint32_t k = 0; k < n_conflicts; k++) {
+            if (placed[k]->offset >= cursor) {
+                size_t gap = placed[k]->offset - cursor;
+                if (gap >= e->bytes && gap < best_gap) {
+                    best = cursor;
+                    best_gap = gap;
+                }
+            }
+            size_t end = placed[k]->offset + placed[k]->bytes;
+            if (end > cursor) cursor = end;
+        }
+        e->offset = (best != (size_t)-1) ? best : cursor;
+        if (e->offset + e->bytes > out->arena_bytes) out->arena_bytes = e->offset + e->bytes;
+    }
+
+    free(placed);
+    free(live);
+    free(first);
+    free(last);
+    free(last_is_write);
+    free(bytes);
+    return 0;
+
+bad_index:
+    fprintf(stderr, "[PLAN] Tape references tensor beyond the %u-entry runtime table\n", num_tensors);
+fail:
+    free(first);
+    free(last);
+    free(last_is_write);
+    free(bytes);
+    free(out->entries);
+    memset(out, 0, sizeof(*out));
+    return -1;
+}
+
+void nodal_plan_free(nodal_plan_t *plan) {
+    free(plan->entries);
+    memset(plan, 0, sizeof(*plan));
+}
+
+/**
+ * nodal_plan_bind
+ * Points every planned runtime entry into arena, which must hold
+ * plan->arena_bytes and be 64-byte aligned.
+ */
+void nodal_plan_bind(const nodal_plan_t *plan, void *arena, nodal_buffer_t *tensor_runtime) {
+    for (uint32_t i = 0; i < plan->num_entries; i++) {
+        const nodal_plan_entry_t *e = &plan->entries[i];
+        tensor_runtime[e->tensor].ptr = (uint8_t *)arena + e->offset;
+        tensor_runtime[e->tensor].byte_len = e->bytes;
+    }
+}
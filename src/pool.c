@@ -0,0 +1,352 @@
+/*
+ * pool.c - Persistent Worker Pool for Nodal
+ * Threads are created once per runtime and parked between jobs. A job is
+ * a parallel-for over task indices: each participant owns a contiguous
+ * slice of the index space and steals half of a victim's remaining slice
+ * when it runs dry, so ragged shapes still balance. Each worker also
+ * owns a slice of kernel scratch allocated with the pool.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include "nodal.h"
+
+#define POOL_SPIN 20000            // Polls before a waiter falls back to sleeping
+
+/* Owned task slice, packed as (begin << 32 | end) for single-word CAS */
+typedef struct {
+    _Atomic uint64_t range;
+    char pad[56];
+} pool_slot_t;
+
+struct nodal_pool {
+    pthread_t *threads;
+    uint32_t num_workers;          // Spawned threads (caller is participant 0)
+    pool_slot_t *slots;            // num_workers + 1 task slices
+    uint8_t *scratch;              // NODAL_SCRATCH_BYTES per worker
+
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+    pthread_mutex_t run_lock;      // One job in flight at a time
+    _Atomic uint64_t generation;
+    _Atomic uint32_t busy_workers;
+    _Atomic int shutdown;
+
+    nodal_task_fn fn;
+    void *ctx;
+};
+
+typedef struct {
+    nodal_pool_t *pool;
+    uint32_t id;
+    int pin_cpu;                   // -1 = not pinned
+} pool_worker_arg_t;
+
+/* Set on pool threads so nested parallel regions run inline */
+static _Thread_local int tls_in_pool = 0;
+
+/* Kernel scratch: a worker's slice of its pool's block, else the thread's own buffer */
+static _Thread_local uint8_t *tls_scratch = NULL;
+static pthread_key_t g_scratch_key;
+static pthread_once_t g_scratch_once = PTHREAD_ONCE_INIT;
+
+static nodal_pool_t *g_default_pool = NULL;
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+static inline uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+/* Pops the front task of a slice; returns 0 if it is empty */
+static int slot_pop(pool_slot_t *slot, uint32_t *task) {
+    uint64_t r = atomic_load_explicit(&slot->range, memory_order_acquire);
+    for (;;) {
+        uint32_t begin = (uint32_t)(r >> 32), end = (uint32_t)r;
+        if (begin >= end) return 0;
+        if (atomic_compare_exchange_weak_explicit(&slot->range, &r, pack_range(begin + 1, end),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *task = begin;
+            return 1;
+        }
+    }
+}
+
+/* Takes the back half of a victim's slice as [begin_out, end_out) */
+static int slot_steal(pool_slot_t *victim, uint32_t *begin_out, uint32_t *end_out) {
+    uint64_t r = atomic_load_explicit(&victim->range, memory_order_acquire);
+    for (;;) {
+        uint32_t begin = (uint32_t)(r >> 32), end = (uint32_t)r;
+        if (begin >= end) return 0;
+        uint32_t mid = begin + (end - begin) / 2;
+        if (atomic_compare_exchange_weak_explicit(&victim->range, &r, pack_range(begin, mid),
+                                                  memory_order_acq_rel, memory_order_acquire)) {
+            *begin_out = mid;
+            *end_out = end;
+            return 1;
+        }
+    }
+}
+
+static void pool_drain(nodal_pool_t *pool, uint32_t id) {
+    uint32_t participants = pool->num_workers + 1;
+    pool_slot_t *own = &pool->slots[id];
+    uint32_t task;
+
+    for (;;) {
+        while (slot_pop(own, &task)) pool->fn(pool->ctx, task);
+
+        // Own slice is dry: steal from the others, nearest first
+        int stole = 0;
+        for (uint32_t step = 1; step < participants && !stole; step++) {
+            uint32_t begin, end;
+            if (slot_steal(&pool->slots[(id + step) % participants], &begin, &end)) {
+                atomic_store_explicit(&own->range, pack_range(begin + 1, end), memory_order_release);
+                pool->fn(pool->ctx, begin);
+                stole = 1;
+            }
+        }
+        if (!stole) return;
+    }
+}
+
+static void *pool_worker(void *arg) {
+    pool_worker_arg_t *wa = (pool_worker_arg_t *)arg;
+    nodal_pool_t *pool = wa->pool;
+    uint32_t id = wa->id;
+    uint64_t seen = 0;
+    tls_in_pool = 1;
+    tls_scratch = pool->scratch + (size_t)(id - 1) * NODAL_SCRATCH_BYTES;
+
+#if defined(__linux__)
+    if (wa->pin_cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(wa->pin_cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+#endif
+    free(wa);
+
+    for (;;) {
+        // Spin briefly so back-to-back tape ops skip the futex round trip
+        uint64_t gen = atomic_load_explicit(&pool->generation, memory_order_acquire);
+        for (uint32_t i = 0; gen == seen && i < POOL_SPIN && !atomic_load(&pool->shutdown); i++) {
+            cpu_relax();
+            gen = atomic_load_explicit(&pool->generation, memory_order_acquire);
+        }
+        if (gen == seen) {
+            pthread_mutex_lock(&pool->lock);
+            while (!atomic_load(&pool->shutdown) && atomic_load(&pool->generation) == seen) {
+                pthread_cond_wait(&pool->wake, &pool->lock);
+            }
+            pthread_mutex_unlock(&pool->lock);
+            gen = atomic_load_explicit(&pool->generation, memory_order_acquire);
+        }
+        if (atomic_load(&pool->shutdown)) break;
+        seen = gen;
+
+        pool_drain(pool, id);
+
+        if (atomic_fetch_sub_explicit(&pool->busy_workers, 1, memory_order_acq_rel) == 1) {
+            pthread_mutex_lock(&pool->lock);
+            pthread_cond_signal(&pool->done);
+            pthread_mutex_unlock(&pool->lock);
+        }
+    }
+    return NULL;
+}
+
+/**
+ * nodal_pool_create
+ * Spawns num_threads - 1 workers (0 = one per online CPU); the thread
+ * calling nodal_pool_run is the last one. With pin set, worker i is bound
+ * to CPU i and the caller keeps its own affinity.
+ */
+nodal_pool_t *nodal_pool_create(uint32_t num_threads, int pin) {
+    if (num_threads == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+    }
+
+    nodal_pool_t *pool = (nodal_pool_t *)calloc(1, sizeof(nodal_pool_t));
+    if (!pool) return NULL;
+
+    pool->num_workers = num_threads - 1;
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    pool->slots = (pool_slot_t *)aligned_alloc(64, num_threads * sizeof(pool_slot_t));
+    pool->threads = (pthread_t *)calloc(num_threads, sizeof(pthread_t));
+    size_t scratch_bytes = (size_t)pool->num_workers * NODAL_SCRATCH_BYTES;
+    pool->scratch = scratch_bytes ? (uint8_t *)aligned_alloc(64, scratch_bytes) : NULL;
+    if (!pool->slots || !pool->threads || (scratch_bytes && !pool->scratch)) {
+        free(pool->slots);
+        free(pool->threads);
+        free(pool->scratch);
+        free(pool);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < num_threads; i++) atomic_init(&pool->slots[i].range, 0);
+
+    for (uint32_t i = 0; i < pool->num_workers; i++) {
+        pool_worker_arg_t *wa = (pool_worker_arg_t *)malloc(sizeof(pool_worker_arg_t));
+        if (wa) *wa = (pool_worker_arg_t){ .pool = pool, .id = i + 1, .pin_cpu = pin ? (int)(i + 1) : -1 };
+        if (!wa || pthread_create(&pool->threads[i], NULL, pool_worker, wa) != 0) {
+            fprintf(stderr, "[POOL] Failed to spawn worker %u\n", i);
+            free(wa);
+            pool->num_workers = i;
+            break;
+        }
+    }
+    return pool;
+}
+
+void nodal_pool_destroy(nodal_pool_t *pool) {
+    if (!pool) return;
+    if (g_default_pool == pool) g_default_pool = NULL;
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_store(&pool->shutdown, 1);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (uint32_t i = 0; i < pool->num_workers; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->wake);
+    pthread_cond_destroy(&pool->done);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    free(pool->threads);
+    free(pool->slots);
+    free(pool->scratch);
+    free(pool);
+}
+
+uint32_t nodal_pool_size(const nodal_pool_t *pool) {
+    return pool ? pool->num_workers + 1 : 1;
+}
+
+/**
+ * nodal_pool_run
+ * Calls fn(ctx, task) for every task in [0, num_tasks) and returns when all
+ * are done, which makes it the barrier between tape ops. Runs inline when
+ * there is no pool, when called from a pool thread, or when another
+ * thread already owns the pool.
+ */
+void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks) {
+    if (!pool || pool->num_workers == 0 || num_tasks <= 1 || tls_in_pool ||
+        pthread_mutex_trylock(&pool->run_lock) != 0) {
+        for (uint32_t t = 0; t < num_tasks; t++) fn(ctx, t);
+        return;
+    }
+
+    // Even initial split; stealing fixes the imbalance
+    uint32_t participants = pool->num_workers + 1;
+    for (uint32_t p = 0; p < participants; p++) {
+        uint32_t begin = (uint32_t)((uint64_t)num_tasks * p / participants);
+        uint32_t end = (uint32_t)((uint64_t)num_tasks * (p + 1) / participants);
+        atomic_store_explicit(&pool->slots[p].range, pack_range(begin, end), memory_order_relaxed);
+    }
+    pool->fn = fn;
+    pool->ctx = ctx;
+    atomic_store_explicit(&pool->busy_workers, pool->num_workers, memory_order_relaxed);
+
+    pthread_mutex_lock(&pool->lock);
+    atomic_fetch_add_explicit(&pool->generation, 1, memory_order_release);
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    tls_in_pool = 1;
+    pool_drain(pool, 0);
+    tls_in_pool = 0;
+
+    for (uint32_t i = 0; i < POOL_SPIN && atomic_load_explicit(&pool->busy_workers, memory_order_acquire); i++) {
+        cpu_relax();
+    }
+    if (atomic_load_explicit(&pool->busy_workers, memory_order_acquire)) {
+        pthread_mutex_lock(&pool->lock);
+        while (atomic_load_explicit(&pool->busy_workers, memory_order_acquire) > 0) {
+            pthread_cond_wait(&pool->done, &pool->lock);
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+static void scratch_key_init(void) {
+    pthread_key_create(&g_scratch_key, free);
+}
+
+/**
+ * nodal_pool_scratch
+ * NODAL_SCRATCH_BYTES of 64-byte aligned kernel scratch for the calling
+ * thread: a pool worker's slice, allocated with its pool, or otherwise
+ * a buffer allocated on first use and freed when the thread exits.
+ * NULL if that allocation fails.
+ */
+void *nodal_pool_scratch(void) {
+    if (tls_scratch) return tls_scratch;
+    pthread_once(&g_scratch_once, scratch_key_init);
+    tls_scratch = (uint8_t *)aligned_alloc(64, NODAL_SCRATCH_BYTES);
+    if (tls_scratch) pthread_setspecific(g_scratch_key, tls_scratch);
+    return tls_scratch;
+}
+
+/**
+ * nodal_pool_tasks
+ * How many tasks to cut 'work' items into: at least 'grain' items each,
+ * and about 4 per thread so stealing has something to balance.
+ */
+uint32_t nodal_pool_tasks(const nodal_pool_t *pool, size_t work, size_t grain) {
+    size_t by_grain = (work + grain - 1) / (grain ? grain : 1);
+    size_t by_threads = 4 * (size_t)nodal_pool_size(pool);
+    size_t tasks = (by_grain < by_threads) ? by_grain : by_threads;
+    return tasks ? (uint32_t)tasks : 1;
+}
+
+/**
+ * nodal_pool_set_default / nodal_pool_default
+ * The pool kernels parallelize over. NULL (the default) means serial.
+ */
+void nodal_pool_set_default(nodal_pool_t *pool) {
+    g_default_pool = pool;
+}
+
+nodal_pool_t *nodal_pool_default(void) {
+    return g_default_pool;
+}
+
+/**
+ * nodal_set_num_threads
+ * Runtime-level control: replaces the default pool with one of
+ * num_threads threads (0 = one per online CPU, 1 = serial).
+ */
+int nodal_set_num_threads(uint32_t num_threads, int pin) {
+    nodal_pool_t *old = g_default_pool;
+    g_default_pool = NULL;
+    nodal_pool_destroy(old);
+
+    if (num_threads == 1) return 0;
+    nodal_pool_t *pool = nodal_pool_create(num_threads, pin);
+    if (!pool) return -1;
+    g_default_pool = pool;
+    return 0;
+}
+
+uint32_t nodal_get_num_threads(void) {
+    return nodal_pool_size(g_default_pool);
+}
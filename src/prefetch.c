@@ -0,0 +1,212 @@
+/*
+ * prefetch.c - Tape-Ordered Weight Prefetcher for Nodal
+ * A background thread walks the tape a fixed number of ops ahead of the
+ * executor and asks the kernel to page in the mapped tensors those ops
+ * will read, so storage I/O overlaps with compute instead of stalling
+ * the first touch inside a kernel.
+ */
+
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "nodal.h"
+
+#define PF_NO_CURSOR 0xFFFFFFFFu
+
+typedef struct {
+    uintptr_t begin;               // Page-aligned
+    size_t bytes;                  // Whole pages
+} pf_region_t;
+
+struct nodal_prefetch {
+    nodal_prefetch_mode_t mode;
+    uint32_t num_ops;
+    uint32_t distance;
+    size_t page;
+
+    uint32_t *region_start;        // CSR: op i reads regions [start[i], start[i + 1])
+    pf_region_t *regions;
+    unsigned char *residency;      // mincore() scratch, sized for the largest region
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    uint32_t next;                 // Next op the thread will prefetch
+    uint32_t target;               // Prefetch ops [next, target)
+    uint32_t cursor;               // Last op the executor reached
+    uint32_t pass;                 // Bumped when the executor restarts the tape
+    int stop;
+
+    nodal_prefetch_stats_t stats;  // Issue counters guarded by lock
+};
+
+/* Pages in mapped weights: one WILLNEED hint, or a read of each page */
+static void prefetch_region(const struct nodal_prefetch *pf, const pf_region_t *r) {
+    if (pf->mode == NODAL_PREFETCH_TOUCH) {
+        const volatile uint8_t *p = (const volatile uint8_t *)r->begin;
+        for (size_t off = 0; off < r->bytes; off += pf->page) (void)p[off];
+    } else {
+        madvise((void *)r->begin, r->bytes, MADV_WILLNEED);
+    }
+}
+
+static void *prefetch_main(void *arg) {
+    struct nodal_prefetch *pf = (struct nodal_prefetch *)arg;
+    pthread_mutex_lock(&pf->lock);
+    for (;;) {
+        while (!pf->stop && pf->next >= pf->target) pthread_cond_wait(&pf->wake, &pf->lock);
+        if (pf->stop) break;
+
+        uint32_t i = pf->next++;
+        uint32_t pass = pf->pass;
+        pthread_mutex_unlock(&pf->lock);
+
+        size_t bytes = 0;
+        for (uint32_t k = pf->region_start[i]; k < pf->region_start[i + 1]; k++) {
+            prefetch_region(pf, &pf->regions[k]);
+            bytes += pf->regions[k].bytes;
+        }
+
+        pthread_mutex_lock(&pf->lock);
+        if (pass == pf->pass) {
+            pf->stats.ops_prefetched++;
+            pf->stats.bytes_prefetched += bytes;
+        }
+    }
+    pthread_mutex_unlock(&pf->lock);
+    return NULL;
+}
+
+/**
+ * nodal_prefetch_create
+ * Collects, per op, the inputs that live inside the model mapping
+ * [map_base, map_base + map_bytes); activations and other buffers are
+ * ignored, as are OP_EMBED_GATHER tables, of which only the rows named
+ * by the ids are read. The thread starts prefetching the first distance
+ * ops at once.
+ * @return The prefetcher, or NULL on allocation or thread failure.
+ */
+nodal_prefetch_t *nodal_prefetch_create(const nodal_irop_t *ops, size_t op_count, const nodal_buffer_t *tensor_runtime,
+                                        const void *map_base, size_t map_bytes, uint32_t distance,
+                                        nodal_prefetch_mode_t mode) {
+    struct nodal_prefetch *pf = (struct nodal_prefetch *)calloc(1, sizeof(*pf));
+    if (!pf) return NULL;
+    pf->mode = mode;
+    pf->num_ops = (uint32_t)op_count;
+    pf->distance = distance ? distance : 1;
+    pf->page = (size_t)sysconf(_SC_PAGESIZE);
+    pf->region_start = (uint32_t *)calloc(op_count + 1, sizeof(uint32_t));
+    pf->regions = (pf_region_t *)malloc((op_count * 8 + 1) * sizeof(pf_region_t));
+    if (!pf->region_start || !pf->regions) goto fail;
+
+    // 1. Mapped input regions per op, page-rounded and deduplicated within the op
+    uintptr_t lo_map = (uintptr_t)map_base, hi_map = lo_map + map_bytes;
+    size_t max_pages = 1;
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < pf->num_ops; i++) {
+        pf->region_start[i] = count;
+        for (uint32_t j = 0; j < ops[i].num_inputs && j < 8; j++) {
+            const nodal_buffer_t *b = &tensor_runtime[ops[i].inputs[j]];
+            uintptr_t p = (uintptr_t)b->ptr;
+            if (!b->ptr || b->byte_len == 0 || p < lo_map || p >= hi_map) continue;
+            if (ops[i].kind == OP_EMBED_GATHER && j != 0) continue;
+
+            uintptr_t end = p + b->byte_len < hi_map ? p + b->byte_len : hi_map;
+            pf_region_t r = { p & ~(uintptr_t)(pf->page - 1), 0 };
+            r.bytes = ((end - r.begin) + pf->page - 1) & ~(pf->page - 1);
+            int dup = 0;
+            for (uint32_t k = pf->region_start[i]; k < count; k++) dup |= (pf->regions[k].begin == r.begin);
+            if (dup) continue;
+            pf->regions[count++] = r;
+            if (r.bytes / pf->page > max_pages) max_pages = r.bytes / pf->page;
+        }
+    }
+    pf->region_start[pf->num_ops] = count;
+    pf->residency = (unsigned char *)malloc(max_pages);
+    if (!pf->residency) goto fail;
+
+    // 2. Start ahead of the executor so cold-start I/O overlaps setup
+    pthread_mutex_init(&pf->lock, NULL);
+    pthread_cond_init(&pf->wake, NULL);
+    pf->target = pf->distance < pf->num_ops ? pf->distance : pf->num_ops;
+    pf->cursor = PF_NO_CURSOR;
+    if (pthread_create(&pf->thread, NULL, prefetch_main, pf) != 0) {
+        pthread_mutex_destroy(&pf->lock);
+        pthread_cond_destroy(&pf->wake);
+        goto fail;
+    }
+    return pf;
+
+fail:
+    free(pf->region_start);
+    free(pf->regions);
+    free(pf->residency);
+    free(pf);
+    return NULL;
+}
+
+/**
+ * nodal_prefetch_advance
+ * Called by the executor right before op i runs. Records whether op i's
+ * mapped inputs were already resident (hit) or still had pages to read
+ * (stall), then moves the prefetch window to [i + 1, i + 1 + distance).
+ * Going back to an earlier op starts a new pass over the tape.
+ */
+void nodal_prefetch_advance(nodal_prefetch_t *pf, uint32_t i) {
+    if (!pf || i >= pf->num_ops) return;
+
+    // 1. Residency of what op i is about to touch
+    uint64_t missing = 0;
+    for (uint32_t k = pf->region_start[i]; k < pf->region_start[i + 1]; k++) {
+        const pf_region_t *r = &pf->regions[k];
+        if (mincore((void *)r->begin, r->bytes, pf->residency) != 0) continue;
+        for (size_t p = 0; p < r->bytes / pf->page; p++) missing += !(pf->residency[p] & 1);
+    }
+
+    // 2. Slide the window
+    pthread_mutex_lock(&pf->lock);
+    if (pf->region_start[i + 1] > pf->region_start[i]) {
+        pf->stats.ops_checked++;
+        if (missing) {
+            pf->stats.stalls++;
+            pf->stats.stall_pages += missing;
+        } else {
+            pf->stats.hits++;
+        }
+    }
+    if (pf->cursor != PF_NO_CURSOR && i <= pf->cursor) {
+        pf->pass++;
+        pf->next = i + 1;
+    }
+    if (pf->next < i + 1) pf->next = i + 1;
+    pf->cursor = i;
+    uint32_t target = i + 1 + pf->distance;
+    pf->target = target < pf->num_ops ? target : pf->num_ops;
+    if (pf->next < pf->target) pthread_cond_signal(&pf->wake);
+    pthread_mutex_unlock(&pf->lock);
+}
+
+void nodal_prefetch_stats(nodal_prefetch_t *pf, nodal_prefetch_stats_t *out) {
+    pthread_mutex_lock(&pf->lock);
+    *out = pf->stats;
+    pthread_mutex_unlock(&pf->lock);
+}
+
+void nodal_prefetch_destroy(nodal_prefetch_t *pf) {
+    if (!pf) return;
+    pthread_mutex_lock(&pf->lock);
+    pf->stop = 1;
+    pthread_cond_signal(&pf->wake);
+    pthread_mutex_unlock(&pf->lock);
+    pthread_join(pf->thread, NULL);
+    pthread_mutex_destroy(&pf->lock);
+    pthread_cond_destroy(&pf->wake);
+    free(pf->region_start);
+    free(pf->regions);
+    free(pf->residency);
+    free(pf);
+}
@@ -0,0 +1,408 @@
+/*
+ * profiler.c - Per-Op Tape Profiler for Nodal
+ * Times every op of a resolved tape, derives its FLOPs and bytes from
+ * the op's scalars, and optionally samples perf counters around it.
+ * Results come out as a summary table or a Chrome trace_event file
+ * (chrome://tracing, Perfetto). Only nodal_tape_run_profiled calls in
+ * here; the normal tape runners are untouched.
+ */
+
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "nodal.h"
+
+extern size_t nodal_dtype_size(nodal_type_t t);
+
+#define PROF_MAX_THREADS  256
+#define PROF_MAX_EVENTS   (1u << 18)   // Trace records kept (about 12 MB)
+
+enum { PROF_CYCLES, PROF_LLC_MISSES, PROF_PAGE_FAULTS, PROF_NUM_COUNTERS };
+
+static const char *const PROF_OP_NAMES[] = {
+    [OP_MATMUL] = "MATMUL",
+    [OP_MATMUL_QNF4] = "MATMUL_QNF4",
+    [OP_SOFTMAX] = "SOFTMAX",
+    [OP_ADD] = "ADD",
+    [OP_TOKENIZE_BPE] = "TOKENIZE_BPE",
+    [OP_TOKENIZE_BPE_PARALLEL] = "TOKENIZE_BPE_PARALLEL",
+    [OP_MATMUL_ADD] = "MATMUL_ADD",
+    [OP_MATMUL_QNF4_ADD] = "MATMUL_QNF4_ADD",
+    [OP_ADD_SOFTMAX] = "ADD_SOFTMAX",
+    [OP_ATTENTION] = "ATTENTION",
+    [OP_MATMUL_Q8_0] = "MATMUL_Q8_0",
+    [OP_MATMUL_Q8_0_ADD] = "MATMUL_Q8_0_ADD",
+    [OP_CAST] = "CAST",
+    [OP_RMSNORM] = "RMSNORM",
+    [OP_LAYERNORM] = "LAYERNORM",
+    [OP_SILU] = "SILU",
+    [OP_GELU] = "GELU",
+    [OP_ROPE] = "ROPE",
+    [OP_EMBED_GATHER] = "EMBED_GATHER",
+    [OP_SAMPLE] = "SAMPLE",
+};
+
+#define PROF_NUM_NAMES (sizeof(PROF_OP_NAMES) / sizeof(PROF_OP_NAMES[0]))
+
+typedef struct {
+    uint32_t op;
+    double ts_us;                  // Start, relative to profiler creation
+    double dur_us;
+    uint64_t counters[PROF_NUM_COUNTERS];
+} prof_event_t;
+
+struct nodal_profiler {
+    uint32_t flags;
+    uint32_t num_ops;
+    nodal_op_profile_t *ops;
+
+    int fds[PROF_MAX_THREADS][PROF_NUM_COUNTERS];  // -1 where a counter could not be opened
+    uint32_t num_threads;
+    int have[PROF_NUM_COUNTERS];   // Counter opened on at least one thread
+
+    double origin_us;
+    double start_us;               // Of the op in flight
+    uint64_t start_counters[PROF_NUM_COUNTERS];
+
+    prof_event_t *events;
+    uint32_t num_events;
+    uint64_t dropped_events;
+};
+
+static double prof_now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+const char *nodal_op_name(nodal_op_kind_t kind) {
+    return ((uint32_t)kind < PROF_NUM_NAMES && PROF_OP_NAMES[kind]) ? PROF_OP_NAMES[kind] : "UNKNOWN";
+}
+
+/**
+ * op_cost
+ * FLOPs and memory traffic of one run of op, from its scalars alone.
+ * Softmax and the activations count exp as one FLOP; RoPE counts only
+ * the rotation, not its per-token sin/cos; attention depends on the
+ * cached context length, so only its Q/K/V/O traffic is counted.
+ */
+static void op_cost(const nodal_irop_t *op, double *flops, double *bytes) {
+    const nodal_scalar_t *s = op->scalars;
+    double M = s[0].v.u32, N = s[1].v.u32, K = s[2].v.u32;
+    *flops = 0.0;
+    *bytes = 0.0;
+    switch (op->kind) {
+        case OP_MATMUL:
+        case OP_MATMUL_ADD: {
+            size_t bsz = nodal_dtype_size((nodal_type_t)s[3].v.u32);
+            *flops = 2.0 * M * N * K;
+            *bytes = 4.0 * (M * K + M * N) + (double)(bsz ? bsz : 4) * K * N;
+            break;
+        }
+        case OP_MATMUL_QNF4:
+        case OP_MATMUL_QNF4_ADD: {
+            double bs = s[3].v.u32 ? s[3].v.u32 : 64;
+            *flops = 2.0 * M * N * K;
+            *bytes = 4.0 * M * K + N * K / 2.0 + 4.0 * N * K / bs + 4.0 * M * N;
+            break;
+        }
+        case OP_MATMUL_Q8_0:
+        case OP_MATMUL_Q8_0_ADD: {
+            double bs = s[3].v.u32 ? s[3].v.u32 : 32;
+            *flops = 2.0 * M * N * K;
+            *bytes = 4.0 * M * K + N * K + 4.0 * N * K / bs + 4.0 * M * N;
+            break;
+        }
+        case OP_SOFTMAX:
+        case OP_ADD_SOFTMAX: {
+            double n = M * (s[1].v.u32 ? s[1].v.u32 : 1);
+            *flops = 4.0 * n;
+            *bytes = 8.0 * n;
+            break;
+        }
+        case OP_ADD:
+            *flops = M;
+            *bytes = 12.0 * M;
+            break;
+        case OP_RMSNORM:
+        case OP_LAYERNORM: {
+            double n = M * (s[1].v.u32 ? s[1].v.u32 : 1);
+            *flops = (op->kind == OP_LAYERNORM ? 7.0 : 5.0) * n;
+            *bytes = 8.0 * n + (op->kind == OP_LAYERNORM ? 8.0 : 4.0) * M;
+            break;
+        }
+        case OP_SILU:
+        case OP_GELU:
+            *flops = (op->kind == OP_GELU ? 8.0 : 4.0) * M + (op->num_inputs > 1 ? M : 0.0);
+            *bytes = (op->num_inputs > 1 ? 12.0 : 8.0) * M;
+            break;
+        case OP_ROPE: {
+            double n = M * N * K;
+            *flops = 3.0 * n;
+            *bytes = 8.0 * n;
+            break;
+        }
+        case OP_EMBED_GATHER: {
+            // Rows read at the table's width (NF4 / Q8_0 plus their scales), written as F32
+            nodal_type_t dt = (nodal_type_t)s[5].v.u32;
+            double bs = s[3].v.u32 ? s[3].v.u32 : 1;
+            double row = (dt == NODAL_NF4) ? K / 2.0 + 4.0 * K / bs
+                       : (dt == NODAL_Q8_0) ? K + 4.0 * K / bs
+                       : (double)(nodal_dtype_size(dt) ? nodal_dtype_size(dt) : 4) * K;
+            *bytes = M * (4.0 + row + 4.0 * K);
+            break;
+        }
+        case OP_SAMPLE: {
+            // Two scans of the logits (max, then the window); survivors are noise
+            double n = M * (N ? N : 1);
+            *flops = 2.0 * n;
+            *bytes = 8.0 * n;
+            break;
+        }
+        case OP_CAST:
+            *bytes = M * (double)(nodal_dtype_size((nodal_type_t)s[1].v.u32) +
+                                  nodal_dtype_size((nodal_type_t)s[2].v.u32));
+            break;
+        case OP_TOKENIZE_BPE:
+        case OP_TOKENIZE_BPE_PARALLEL:
+            *bytes = M;
+            break;
+        case OP_ATTENTION: {
+            double n = M, H = N, Hkv = K, Dh = s[3].v.u32;
+            *bytes = 4.0 * n * (2.0 * H + 2.0 * Hkv) * Dh;
+            break;
+        }
+        default:
+            break;
+    }
+    if (op->kind == OP_MATMUL_ADD || op->kind == OP_MATMUL_QNF4_ADD || op->kind == OP_MATMUL_Q8_0_ADD) {
+        *flops += M * N;
+        *bytes += 4.0 * M * N;
+    }
+    if (op->kind == OP_ADD_SOFTMAX) {
+        double n = M * (s[1].v.u32 ? s[1].v.u32 : 1);
+        *flops += n;
+        *bytes += 4.0 * n;
+    }
+}
+
+static int perf_open(uint32_t type, uint64_t config, pid_t tid) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0);
+}
+
+/**
+ * open_counters
+ * One counter set per thread alive now (the caller and the worker pool),
+ * since a perf event only counts the thread it was opened on.
+ */
+static void open_counters(nodal_profiler_t *p) {
+    static const struct { uint32_t type; uint64_t config; } events[PROF_NUM_COUNTERS] = {
+        [PROF_CYCLES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        [PROF_LLC_MISSES] = { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        [PROF_PAGE_FAULTS] = { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+    };
+    DIR *dir = opendir("/proc/self/task");
+    if (!dir) return;
+    struct dirent *de;
+    while ((de = readdir(dir)) && p->num_threads < PROF_MAX_THREADS) {
+        if (de->d_name[0] == '.') continue;
+        pid_t tid = (pid_t)atoi(de->d_name);
+        int *fds = p->fds[p->num_threads++];
+        for (int c = 0; c < PROF_NUM_COUNTERS; c++) {
+            fds[c] = perf_open(events[c].type, events[c].config, tid);
+            p->have[c] |= fds[c] >= 0;
+        }
+    }
+    closedir(dir);
+}
+
+/* Current totals over every thread; page faults fall back to getrusage */
+static void read_counters(const nodal_profiler_t *p, uint64_t out[PROF_NUM_COUNTERS]) {
+    memset(out, 0, PROF_NUM_COUNTERS * sizeof(uint64_t));
+    for (uint32_t t = 0; t < p->num_threads; t++) {
+        for (int c = 0; c < PROF_NUM_COUNTERS; c++) {
+            uint64_t v;
+            if (p->fds[t][c] >= 0 && read(p->fds[t][c], &v, sizeof(v)) == sizeof(v)) out[c] += v;
+        }
+    }
+    if (!p->have[PROF_PAGE_FAULTS]) {
+        struct rusage ru;
+        getrusage(RUSAGE_SELF, &ru);
+        out[PROF_PAGE_FAULTS] = (uint64_t)(ru.ru_minflt + ru.ru_majflt);
+    }
+}
+
+/**
+ * nodal_profiler_create
+ * Profiler for a tape of op_count ops. flags is a mix of
+ * NODAL_PROFILE_*; counters that perf_event_open refuses (containers,
+ * perf_event_paranoid) read as 0 and are reported as unavailable.
+ */
+nodal_profiler_t *nodal_profiler_create(const nodal_irop_t *ops, size_t op_count, uint32_t flags) {
+    nodal_profiler_t *p = (nodal_profiler_t *)calloc(1, sizeof(nodal_profiler_t));
+    if (!p) return NULL;
+    p->flags = flags;
+    p->num_ops = (uint32_t)op_count;
+    p->ops = (nodal_op_profile_t *)calloc(op_count ? op_count : 1, sizeof(nodal_op_profile_t));
+    if (flags & NODAL_PROFILE_TRACE) p->events = (prof_event_t *)malloc(PROF_MAX_EVENTS * sizeof(prof_event_t));
+    if (!p->ops || ((flags & NODAL_PROFILE_TRACE) && !p->events)) {
+        free(p->ops);
+        free(p->events);
+        free(p);
+        return NULL;
+    }
+    for (uint32_t i = 0; i < p->num_ops; i++) {
+        p->ops[i].kind = ops[i].kind;
+        op_cost(&ops[i], &p->ops[i].flops, &p->ops[i].bytes);
+    }
+    if (flags & NODAL_PROFILE_COUNTERS) {
+        open_counters(p);
+        if (!p->have[PROF_CYCLES]) printf("[PROF] Hardware counters unavailable; timing only\n");
+    }
+    p->origin_us = prof_now_us();
+    return p;
+}
+
+void nodal_profiler_destroy(nodal_profiler_t *p) {
+    if (!p) return;
+    for (uint32_t t = 0; t < p->num_threads; t++) {
+        for (int c = 0; c < PROF_NUM_COUNTERS; c++) {
+            if (p->fds[t][c] >= 0) close(p->fds[t][c]);
+        }
+    }
+    free(p->events);
+    free(p->ops);
+    free(p);
+}
+
+/* Marks the start of the next op */
+void nodal_profiler_begin(nodal_profiler_t *p) {
+    if (p->flags & NODAL_PROFILE_COUNTERS) read_counters(p, p->start_counters);
+    p->start_us = prof_now_us();
+}
+
+/* Charges the time and counters since nodal_profiler_begin to op i */
+void nodal_profiler_end(nodal_profiler_t *p, uint32_t i) {
+    double end_us = prof_now_us();
+    uint64_t delta[PROF_NUM_COUNTERS] = {0};
+    if (p->flags & NODAL_PROFILE_COUNTERS) {
+        read_counters(p, delta);
+        for (int c = 0; c < PROF_NUM_COUNTERS; c++) delta[c] -= p->start_counters[c];
+    }
+    if (i >= p->num_ops) return;
+
+    nodal_op_profile_t *op = &p->ops[i];
+    double dur = end_us - p->start_us;
+    op->calls++;
+    op->total_us += dur;
+    if (dur > op->max_us) op->max_us = dur;
+    op->cycles += delta[PROF_CYCLES];
+    op->llc_misses += delta[PROF_LLC_MISSES];
+    op->page_faults += delta[PROF_PAGE_FAULTS];
+
+    if (!p->events) return;
+    if (p->num_events == PROF_MAX_EVENTS) {
+        p->dropped_events++;
+        return;
+    }
+    prof_event_t *ev = &p->events[p->num_events++];
+    ev->op = i;
+    ev->ts_us = p->start_us - p->origin_us;
+    ev->dur_us = dur;
+    memcpy(ev->counters, delta, sizeof(delta));
+}
+
+const nodal_op_profile_t *nodal_profiler_ops(const nodal_profiler_t *p, uint32_t *num_ops) {
+    *num_ops = p->num_ops;
+    return p->ops;
+}
+
+/**
+ * nodal_profiler_report
+ * Per-op table in tape order, then time per op kind, slowest first.
+ */
+void nodal_profiler_report(const nodal_profiler_t *p, FILE *out) {
+    int counters = p->have[PROF_CYCLES] || p->have[PROF_LLC_MISSES];
+    double total = 0.0;
+    for (uint32_t i = 0; i < p->num_ops; i++) total += p->ops[i].total_us;
+
+    fprintf(out, "[PROF] %5s %-22s %6s %10s %10s %10s %8s %8s", "op", "kind", "calls", "total ms", "mean us",
+            "max us", "GFLOP/s", "GB/s");
+    if (counters) fprintf(out, " %10s %10s", "Mcycles", "LLC miss");
+    fprintf(out, " %8s %6s\n", "faults", "share");
+    for (uint32_t i = 0; i < p->num_ops; i++) {
+        const nodal_op_profile_t *op = &p->ops[i];
+        if (!op->calls) continue;
+        double mean = op->total_us / op->calls;
+        fprintf(out, "[PROF] %5u %-22s %6u %10.3f %10.1f %10.1f %8.2f %8.2f", i, nodal_op_name(op->kind), op->calls,
+                op->total_us / 1e3, mean, op->max_us, op->flops / (mean * 1e3), op->bytes / (mean * 1e3));
+        if (counters) fprintf(out, " %10.2f %10llu", op->cycles / 1e6, (unsigned long long)op->llc_misses);
+        fprintf(out, " %8llu %5.1f%%\n", (unsigned long long)op->page_faults,
+                total > 0 ? 100.0 * op->total_us / total : 0.0);
+    }
+
+    // Per-kind totals, slowest first
+    double kind_us[PROF_NUM_NAMES] = {0};
+    uint32_t kind_calls[PROF_NUM_NAMES] = {0};
+    for (uint32_t i = 0; i < p->num_ops; i++) {
+        if ((uint32_t)p->ops[i].kind >= PROF_NUM_NAMES) continue;
+        kind_us[p->ops[i].kind] += p->ops[i].total_us;
+        kind_calls[p->ops[i].kind] += p->ops[i].calls;
+    }
+    for (;;) {
+        uint32_t best = PROF_NUM_NAMES;
+        for (uint32_t k = 0; k < PROF_NUM_NAMES; k++) {
+            if (kind_calls[k] && (best == PROF_NUM_NAMES || kind_us[k] > kind_us[best])) best = k;
+        }
+        if (best == PROF_NUM_NAMES) break;
+        fprintf(out, "[PROF] %-28s %6u calls %10.3f ms %5.1f%%\n", PROF_OP_NAMES[best], kind_calls[best],
+                kind_us[best] / 1e3, total > 0 ? 100.0 * kind_us[best] / total : 0.0);
+        kind_calls[best] = 0;
+    }
+    if (p->dropped_events) {
+        fprintf(out, "[PROF] Trace full: %llu op runs not recorded\n", (unsigned long long)p->dropped_events);
+    }
+}
+
+/**
+ * nodal_profiler_write_trace
+ * Chrome trace_event JSON: one complete ("X") event per op run with its
+ * index, FLOP/s, GB/s and counters as args.
+ * @return 0, or -1 without NODAL_PROFILE_TRACE or on an I/O error.
+ */
+int nodal_profiler_write_trace(const nodal_profiler_t *p, const char *path) {
+    if (!p->events) return -1;
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+    fprintf(f, "{\"traceEvents\": [\n");
+    fprintf(f, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"nodal\"}},\n");
+    fprintf(f, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"tape\"}}");
+    for (uint32_t e = 0; e < p->num_events; e++) {
+        const prof_event_t *ev = &p->events[e];
+        const nodal_op_profile_t *op = &p->ops[ev->op];
+        double dur = ev->dur_us > 0 ? ev->dur_us : 1e-3;
+        fprintf(f, ",\n{\"name\": \"%s\", \"cat\": \"op\", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, "
+                   "\"tid\": 1, \"args\": {\"op\": %u, \"gflops\": %.3f, \"gbps\": %.3f, \"cycles\": %llu, "
+                   "\"llc_misses\": %llu, \"page_faults\": %llu}}",
+                nodal_op_name(op->kind), ev->ts_us, ev->dur_us, ev->op, op->flops / (dur * 1e3),
+                op->bytes / (dur * 1e3), (unsigned long long)ev->counters[PROF_CYCLES],
+                (unsigned long long)ev->counters[PROF_LLC_MISSES], (unsigned long long)ev->counters[PROF_PAGE_FAULTS]);
+    }
+    fprintf(f, "\n], \"displayTimeUnit\": \"ms\"}\n");
+    return fclose(f) == 0 ? 0 : -1;
+}
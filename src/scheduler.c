@@ -0,0 +1,309 @@
+/*
+ * scheduler.c - Dependency-Aware Tape Scheduler for Nodal
+ * Turns a linear IR tape into a DAG over tensor hazards, then runs it
+ * level by level: every op in a level only depends on earlier levels,
+ * so a level's small ops run concurrently on the worker pool and the
+ * pool's join is the barrier to the next level. Ops big enough for
+ * their kernel to split over the pool run one at a time instead, so a
+ * level of Q/K/V projections keeps every core on each matmul. Results
+ * match in-order execution because no two ops in a level touch a
+ * tensor one of them writes.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "nodal.h"
+
+extern void nodal_dispatch_op(const nodal_irop_t *op, const nodal_buffer_t *tensor_runtime);
+extern nodal_pool_t *nodal_pool_default(void);
+extern void nodal_pool_run(nodal_pool_t *pool, nodal_task_fn fn, void *ctx, uint32_t num_tasks);
+extern int nodal_matmul_f32_splits(const nodal_scalar_t *s);
+extern int nodal_matmul_qnf4_splits(const nodal_scalar_t *s);
+extern int nodal_matmul_q8_0_splits(const nodal_scalar_t *s);
+extern int nodal_attention_splits(const nodal_scalar_t *s);
+extern int nodal_softmax_splits(const nodal_scalar_t *s);
+extern int nodal_norm_splits(const nodal_scalar_t *s);
+extern int nodal_add_splits(const nodal_scalar_t *s);
+extern int nodal_activation_splits(const nodal_scalar_t *s);
+extern int nodal_rope_splits(const nodal_scalar_t *s);
+extern int nodal_embed_gather_splits(const nodal_scalar_t *s);
+extern int nodal_sample_splits(const nodal_scalar_t *s);
+extern int nodal_tokenize_bpe_splits(const nodal_scalar_t *s);
+
+#define SCHED_NONE 0xFFFFFFFFu
+
+struct nodal_schedule {
+    const nodal_irop_t *ops;       // Borrowed; must outlive the schedule
+    uint32_t num_ops;
+    uint32_t num_levels;
+    uint32_t *level;               // Level of each op
+    uint32_t *order;               // Op indices grouped by level: small ops, then solo ops, each in tape order
+    uint32_t *level_start;         // num_levels + 1 offsets into order
+    uint32_t *level_solo;          // Per level, offset into order of its first solo op
+    uint32_t *pred_start;          // num_ops + 1 offsets into preds (CSR)
+    uint32_t *preds;
+    uint32_t num_edges;
+};
+
+typedef struct {
+    uint32_t op;
+    uint32_t next;
+} sched_reader_t;
+
+void nodal_schedule_destroy(nodal_schedule_t *sched);
+
+/* Records dep as a predecessor of the current op, once */
+static void add_pred(uint32_t dep, uint32_t self, uint32_t *mark, uint32_t *preds, uint32_t *count) {
+    if (dep == SCHED_NONE || dep == self || mark[dep] == self) return;
+    mark[dep] = self;
+    preds[(*count)++] = dep;
+}
+
+/*
+ * Whether op's kernel would split itself over the pool, as the kernel
+ * itself decides it. Such ops run solo rather than as one task of a
+ * wide level.
+ */
+static int sched_op_splits(const nodal_irop_t *op) {
+    const nodal_scalar_t *s = op->scalars;
+    switch (op->kind) {
+        case OP_MATMUL:
+        case OP_MATMUL_ADD:
+            return nodal_matmul_f32_splits(s);
+        case OP_MATMUL_QNF4:
+        case OP_MATMUL_QNF4_ADD:
+            return nodal_matmul_qnf4_splits(s);
+        case OP_MATMUL_Q8_0:
+        case OP_MATMUL_Q8_0_ADD:
+            return nodal_matmul_q8_0_splits(s);
+        case OP_ATTENTION:
+            return nodal_attention_splits(s);
+        case OP_SOFTMAX:
+        case OP_ADD_SOFTMAX:
+            return nodal_softmax_splits(s);
+        case OP_RMSNORM:
+        case OP_LAYERNORM:
+            return nodal_norm_splits(s);
+        case OP_ADD:
+            return nodal_add_splits(s);
+        case OP_SILU:
+        case OP_GELU:
+            return nodal_activation_splits(s);
+        case OP_ROPE:
+            return nodal_rope_splits(s);
+        case OP_EMBED_GATHER:
+            return nodal_embed_gather_splits(s);
+        case OP_SAMPLE:
+            return nodal_sample_splits(s);
+        case OP_TOKENIZE_BPE_PARALLEL:
+            return nodal_tokenize_bpe_splits(s);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * nodal_schedule_build
+ * Builds the dependency DAG and level grouping for ops[0..op_count).
+ * The tape is borrowed, not copied. Returns NULL on allocation failure.
+ */
+nodal_schedule_t *nodal_schedule_build(const nodal_irop_t *ops, size_t op_count) {
+    uint32_t n = (uint32_t)op_count;
+    uint32_t num_tensors = 0, num_reads = 0, num_edges = 0;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t ni = ops[i].num_inputs < 8 ? ops[i].num_inputs : 8;
+        uint32_t no = ops[i].num_outputs < 4 ? ops[i].num_outputs : 4;
+        for (uint32_t j = 0; j < ni; j++) if (ops[i].inputs[j] >= num_tensors) num_tensors = ops[i].inputs[j] + 1;
+        for (uint32_t j = 0; j < no; j++) if (ops[i].outputs[j] >= num_tensors) num_tensors = ops[i].outputs[j] + 1;
+        num_reads += ni;
+    }
+
+    nodal_schedule_t *sched = (nodal_schedule_t *)calloc(1, sizeof(nodal_schedule_t));
+    uint32_t *last_writer = (uint32_t *)malloc((num_tensors + 1) * sizeof(uint32_t));
+    uint32_t *reader_head = (uint32_t *)malloc((num_tensors + 1) * sizeof(uint32_t));
+    sched_reader_t *readers = (sched_reader_t *)malloc((num_reads + 1) * sizeof(sched_reader_t));
+    uint32_t *mark = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+    uint32_t *scratch = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+    if (sched) {
+        sched->ops = ops;
+        sched->num_ops = n;
+        sched->level = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+        sched->order = (uint32_t *)malloc((n + 1) * sizeof(uint32_t));
+        sched->pred_start = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+    }
+    if (!sched || !last_writer || !reader_head || !readers || !mark || !scratch ||
+        !sched->level || !sched->order || !sched->pred_start) {
+        goto fail;
+    }
+    memset(last_writer, 0xFF, (num_tensors + 1) * sizeof(uint32_t));
+    memset(reader_head, 0xFF, (num_tensors + 1) * sizeof(uint32_t));
+    memset(mark, 0xFF, (n + 1) * sizeof(uint32_t));
+
+    uint32_t *level = sched->level;
+
+    // 1. Hazards per tensor: the last writer and the readers since then
+    uint32_t num_readers = 0, cap = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        const nodal_irop_t *op = &ops[i];
+        uint32_t ni = op->num_inputs < 8 ? op->num_inputs : 8;
+        uint32_t no = op->num_outputs < 4 ? op->num_outputs : 4;
+        uint32_t count = 0;
+
+        for (uint32_t j = 0; j < ni; j++) {
+            add_pred(last_writer[op->inputs[j]], i, mark, scratch, &count);               // RAW
+        }
+        for (uint32_t j = 0; j < no; j++) {
+            uint32_t t = op->outputs[j];
+            add_pred(last_writer[t], i, mark, scratch, &count);                          // WAW
+            for (uint32_t r = reader_head[t]; r != SCHED_NONE; r = readers[r].next) {
+                add_pred(readers[r].op, i, mark, scratch, &count);                       // WAR
+            }
+        }
+
+        for (uint32_t j = 0; j < ni; j++) {
+            uint32_t t = op->inputs[j];
+            readers[num_readers] = (sched_reader_t){ .op = i, .next = reader_head[t] };
+            reader_head[t] = num_readers++;
+        }
+        for (uint32_t j = 0; j < no; j++) {
+            last_writer[op->outputs[j]] = i;
+            reader_head[op->outputs[j]] = SCHED_NONE;
+        }
+
+        // Append this op's predecessors to the CSR edge list
+        if (num_edges + count > cap) {
+            cap = (cap ? cap * 2 : 64) + count;
+            uint32_t *grown = (uint32_t *)realloc(sched->preds, cap * sizeof(uint32_t));
+            if (!grown) goto fail;
+            sched->preds = grown;
+        }
+        uint32_t lvl = 0;
+        for (uint32_t k = 0; k < count; k++) {
+            sched->preds[num_edges + k] = scratch[k];
+            if (level[scratch[k]] + 1 > lvl) lvl = level[scratch[k]] + 1;
+        }
+        level[i] = lvl;
+        num_edges += count;
+        sched->pred_start[i + 1] = num_edges;
+        if (lvl + 1 > sched->num_levels) sched->num_levels = lvl + 1;
+    }
+    sched->num_edges = num_edges;
+
+    // 2. Stable counting sort of ops by level
+    sched->level_start = (uint32_t *)calloc(sched->num_levels + 1, sizeof(uint32_t));
+    if (!sched->level_start) goto fail;
+    for (uint32_t i = 0; i < n; i++) sched->level_start[level[i] + 1]++;
+    for (uint32_t l = 0; l < sched->num_levels; l++) sched->level_start[l + 1] += sched->level_start[l];
+    memcpy(scratch, sched->level_start, sched->num_levels * sizeof(uint32_t));
+    for (uint32_t i = 0; i < n; i++) sched->order[scratch[level[i]]++] = i;
+
+    // 3. Stable partition of each level: small ops first, then the solo ones
+    sched->level_solo = (uint32_t *)malloc((sched->num_levels + 1) * sizeof(uint32_t));
+    if (!sched->level_solo) goto fail;
+    for (uint32_t l = 0; l < sched->num_levels; l++) {
+        uint32_t small = sched->level_start[l], solo = 0;
+        for (uint32_t k = sched->level_start[l]; k < sched->level_start[l + 1]; k++) {
+            uint32_t i = sched->order[k];
+            if (sched_op_splits(&ops[i])) scratch[solo++] = i;
+            else sched->order[small++] = i;
+        }
+        memcpy(sched->order + small, scratch, solo * sizeof(uint32_t));
+        sched->level_solo[l] = small;
+    }
+
+    free(last_writer);
+    free(reader_head);
+    free(readers);
+    free(mark);
+    free(scratch);
+    return sched;
+
+fail:
+    fprintf(stderr, "[SCHED] Out of memory building schedule for %u ops\n", n);
+    free(last_writer);
+    free(reader_head);
+    free(readers);
+    free(mark);
+    free(scratch);
+    nodal_schedule_destroy(sched);
+    return NULL;
+}
+
+void nodal_schedule_destroy(nodal_schedule_t *sched) {
+    if (!sched) return;
+    free(sched->level);
+    free(sched->order);
+    free(sched->level_start);
+    free(sched->level_solo);
+    free(sched->pred_start);
+    free(sched->preds);
+    free(sched);
+}
+
+void nodal_schedule_stats(const nodal_schedule_t *sched, nodal_schedule_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->num_ops = sched->num_ops;
+    out->num_edges = sched->num_edges;
+    out->num_levels = sched->num_levels;
+    for (uint32_t l = 0; l < sched->num_levels; l++) {
+        uint32_t width = sched->level_start[l + 1] - sched->level_start[l];
+        if (width > out->max_width) out->max_width = width;
+        if (width > 1) out->num_solo += sched->level_start[l + 1] - sched->level_solo[l];
+    }
+}
+
+/**
+ * nodal_schedule_preds
+ * Predecessors of op i (indices into the tape); returns their count.
+ */
+uint32_t nodal_schedule_preds(const nodal_schedule_t *sched, uint32_t i, const uint32_t **preds) {
+    *preds = sched->preds + sched->pred_start[i];
+    return sched->pred_start[i + 1] - sched->pred_start[i];
+}
+
+/**
+ * nodal_schedule_level
+ * Level op i executes in; ops only depend on ops of lower levels.
+ */
+uint32_t nodal_schedule_level(const nodal_schedule_t *sched, uint32_t i) {
+    return sched->level[i];
+}
+
+typedef struct {
+    const nodal_schedule_t *sched;
+    const nodal_buffer_t *tensor_runtime;
+    const uint32_t *level_ops;
+} sched_level_ctx_t;
+
+static void sched_level_task(void *ctx, uint32_t task) {
+    const sched_level_ctx_t *lc = (const sched_level_ctx_t *)ctx;
+    nodal_dispatch_op(&lc->sched->ops[lc->level_ops[task]], lc->tensor_runtime);
+}
+
+/**
+ * nodal_execute_schedule
+ * Runs the scheduled tape against tensor_runtime. A level's small ops
+ * each go to a worker and their kernels run single-threaded there; its
+ * solo ops (and any lone op) then run one after another on the calling
+ * thread so their kernels can use the whole pool.
+ */
+void nodal_execute_schedule(const nodal_schedule_t *sched, const nodal_buffer_t *tensor_runtime) {
+    nodal_pool_t *pool = nodal_pool_default();
+
+    for (uint32_t l = 0; l < sched->num_levels; l++) {
+        uint32_t begin = sched->level_start[l], solo = sched->level_solo[l];
+        uint32_t small = solo - begin;
+
+        if (small > 1) {
+            sched_level_ctx_t lc = { sched, tensor_runtime, sched->order + begin };
+            nodal_pool_run(pool, sched_level_task, &lc, small);
+        } else {
+            solo = begin;
+        }
+        for (uint32_t k = solo; k < sched->level_start[l + 1]; k++) {
+            nodal_dispatch_op(&sched->ops[sched->order[k]], tensor_runtime);
+        }
+    }
+}
@@ -0,0 +1,326 @@
+/*
+ * session.c - Shared Model Handles and Inference Sessions for Nodal
+ * A model is mapped once and reference-counted; every session holds a
+ * reference plus its own runtime table, activation arena and input
+ * buffer, so any number of sessions can run the same weights at once.
+ * The mapped tape is fused once at open into the model's own op list,
+ * which every session, the batcher and nr execute.
+ */
+
+#include <stdatomic.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include "nodal.h"
+
+extern void *nodal_load_model(const char *path, nodal_buffer_t *out_runtime, uint32_t max_tensors,
+                              const nodal_load_opts_t *opts, nodal_load_stats_t *stats);
+extern const nodal_tape_header_t *nodal_map_tape(const void *base, size_t size);
+extern int nodal_tensor_table(const void *base, size_t size, nodal_tensor_t *out, uint32_t max_tensors);
+extern int nodal_bind_aux(const nodal_irop_t *ops, size_t op_count, const nodal_tensor_t *tensors,
+                          uint32_t num_tensors, nodal_buffer_t *tensor_runtime, uint32_t num_slots);
+extern int nodal_plan_build(const nodal_irop_t *ops, size_t op_count, const nodal_schedule_t *sched,
+                            const nodal_buffer_t *tensor_runtime, uint32_t num_tensors, nodal_plan_t *out);
+extern void nodal_plan_free(nodal_plan_t *plan);
+extern void nodal_plan_bind(const nodal_plan_t *plan, void *arena, nodal_buffer_t *tensor_runtime);
+extern nodal_tape_t *nodal_tape_resolve(const nodal_irop_t *ops, size_t op_count,
+                                        const nodal_buffer_t *tensor_runtime, uint32_t num_slots);
+extern void nodal_tape_run(const nodal_tape_t *tape);
+extern void nodal_tape_destroy(nodal_tape_t *tape);
+extern size_t nodal_op_output_bytes(const nodal_irop_t *op, uint32_t j);
+extern uint32_t nodal_op_kv_input(const nodal_irop_t *op);
+extern uint32_t nodal_fuse_tape(nodal_irop_t *ops, size_t *op_count, const nodal_buffer_t *tensor_runtime);
+
+#define SESSION_MAX_TENSORS 1024
+
+struct nodal_model {
+    _Atomic uint32_t refs;
+    void *base;
+    nodal_load_stats_t load;
+    const nodal_tape_header_t *tape;
+    nodal_irop_t *ops;             // The tape after fusion; what actually runs
+    uint32_t num_ops;
+    nodal_tensor_t *tensors;
+    uint32_t num_tensors;
+    nodal_buffer_t *weights;       // Loader-filled table, copied into each session
+};
+
+struct nodal_session {
+    nodal_model_t *model;
+    pthread_mutex_t lock;          // One run at a time per session
+    nodal_buffer_t *runtime;       // num_slots entries: shared weights + private activations
+    nodal_plan_t plan;
+    void *arena;
+    void *input;
+    size_t output_bytes;           // Exact size of the output tensor
+    nodal_tape_t *tape;
+};
+
+/**
+ * fuse_model_tape
+ * Copies the mapped tape into m->ops and fuses it. Weights and the
+ * tape's output count as bound, so neither is ever fused away.
+ */
+static int fuse_model_tape(nodal_model_t *m) {
+    const nodal_tape_header_t *th = m->tape;
+    m->ops = (nodal_irop_t *)malloc((th->num_ops ? th->num_ops : 1) * sizeof(nodal_irop_t));
+    nodal_buffer_t *bound = (nodal_buffer_t *)calloc(th->num_slots + 1, sizeof(nodal_buffer_t));
+    if (!m->ops || !bound) {
+        free(bound);
+        return -1;
+    }
+    memcpy(m->ops, th + 1, th->num_ops * sizeof(nodal_irop_t));
+    m->num_ops = th->num_ops;
+
+    // The pass indexes bound by slot; out-of-range tapes are left for tape_resolve to reject
+    for (uint32_t i = 0; i < th->num_ops; i++) {
+        for (uint32_t j = 0; j < m->ops[i].num_inputs && j < 8; j++) {
+            if (m->ops[i].inputs[j] >= th->num_slots) goto done;
+        }
+        for (uint32_t j = 0; j < m->ops[i].num_outputs && j < 4; j++) {
+            if (m->ops[i].outputs[j] >= th->num_slots) goto done;
+        }
+    }
+    uint32_t shared = m->num_tensors < th->num_slots ? m->num_tensors : th->num_slots;
+    memcpy(bound, m->weights, shared * sizeof(nodal_buffer_t));
+    if (th->output_slot < th->num_slots) bound[th->output_slot].ptr = bound; // Any non-NULL pointer
+
+    size_t n = th->num_ops;
+    nodal_fuse_tape(m->ops, &n, bound);
+    m->num_ops = (uint32_t)n;
+done:
+    free(bound);
+    return 0;
+}
+
+/**
+ * nodal_model_open
+ * Maps a model once; the returned handle holds one reference.
+ * opts may be NULL (lazy mapping).
+ */
+nodal_model_t *nodal_model_open(const char *path, const nodal_load_opts_t *opts) {
+    nodal_model_t *m = (nodal_model_t *)calloc(1, sizeof(nodal_model_t));
+    if (!m) return NULL;
+    m->weights = (nodal_buffer_t *)calloc(SESSION_MAX_TENSORS, sizeof(nodal_buffer_t));
+    m->tensors = (nodal_tensor_t *)calloc(SESSION_MAX_TENSORS, sizeof(nodal_tensor_t));
+    if (!m->weights || !m->tensors) goto fail;
+
+    m->base = nodal_load_model(path, m->weights, SESSION_MAX_TENSORS, opts, &m->load);
+    if (!m->base) goto fail;
+
+    int n = nodal_tensor_table(m->base, m->load.map_bytes, m->tensors, SESSION_MAX_TENSORS - 1);
+    if (n < 0) goto fail;
+    m->num_tensors = (uint32_t)n;
+    m->tape = nodal_map_tape(m->base, m->load.map_bytes);
+    if (m->tape && fuse_model_tape(m) != 0) goto fail;
+    atomic_init(&m->refs, 1);
+    return m;
+
+fail:
+    if (m->base) munmap(m->base, m->load.map_bytes);
+    free(m->ops);
+    free(m->weights);
+    free(m->tensors);
+    free(m);
+    return NULL;
+}
+
+nodal_model_t *nodal_model_retain(nodal_model_t *model) {
+    atomic_fetch_add_explicit(&model->refs, 1, memory_order_relaxed);
+    return model;
+}
+
+/**
+ * nodal_model_release
+ * Drops one reference; the last one unmaps the file.
+ */
+void nodal_model_release(nodal_model_t *model) {
+    if (!model) return;
+    if (atomic_fetch_sub_explicit(&model->refs, 1, memory_order_acq_rel) != 1) return;
+    munmap(model->base, model->load.map_bytes);
+    free(model->ops);
+    free(model->weights);
+    free(model->tensors);
+    free(model);
+}
+
+uint32_t nodal_model_refs(const nodal_model_t *model) {
+    return atomic_load_explicit(&((nodal_model_t *)model)->refs, memory_order_relaxed);
+}
+
+const nodal_tape_header_t *nodal_model_tape(const nodal_model_t *model) {
+    return model->tape;
+}
+
+/**
+ * nodal_model_ops
+ * The fused op list to execute; it may be shorter than the mapped
+ * tape. Slots and the input/output contract are the tape header's.
+ */
+const nodal_irop_t *nodal_model_ops(const nodal_model_t *model, uint32_t *num_ops) {
+    *num_ops = model->num_ops;
+    return model->ops;
+}
+
+const nodal_tensor_t *nodal_model_tensors(const nodal_model_t *model, uint32_t *num_tensors) {
+    *num_tensors = model->num_tensors;
+    return model->tensors;
+}
+
+const void *nodal_model_base(const nodal_model_t *model) {
+    return model->base;
+}
+
+/* Loader-filled runtime table (1024 entries, vocab in the last slot) */
+const nodal_buffer_t *nodal_model_bindings(const nodal_model_t *model) {
+    return model->weights;
+}
+
+const nodal_load_stats_t *nodal_model_load_stats(const nodal_model_t *model) {
+    return &model->load;
+}
+
+/**
+ * nodal_session_create
+ * Builds a private execution context over a shared model: copies the
+ * weight bindings, binds quantization scales, plans and allocates the
+ * activation arena and the input buffer, and pre-resolves the tape.
+ * The session holds its own model reference.
+ */
+nodal_session_t *nodal_session_create(nodal_model_t *model) {
+    const nodal_tape_header_t *th = model->tape;
+    if (!th) {
+        fprintf(stderr, "[SESSION] Model has no IR tape\n");
+        return NULL;
+    }
+    if (th->num_slots >= SESSION_MAX_TENSORS) {
+        fprintf(stderr, "[SESSION] Tape needs %u slots, runtime has %d\n", th->num_slots, SESSION_MAX_TENSORS - 1);
+        return NULL;
+    }
+    const nodal_irop_t *ops = model->ops;
+    const uint32_t num_ops = model->num_ops;
+
+    nodal_session_t *s = (nodal_session_t *)calloc(1, sizeof(nodal_session_t));
+    if (!s) return NULL;
+    s->runtime = (nodal_buffer_t *)calloc(th->num_slots, sizeof(nodal_buffer_t));
+    if (!s->runtime) goto fail;
+
+    // 1. Shared weights, private input
+    uint32_t shared = model->num_tensors < th->num_slots ? model->num_tensors : th->num_slots;
+    memcpy(s->runtime, model->weights, shared * sizeof(nodal_buffer_t));
+    if (th->input_slot < th->num_slots) {
+        s->input = calloc(1, th->input_bytes ? th->input_bytes : 1);
+        if (!s->input) goto fail;
+        s->runtime[th->input_slot] = (nodal_buffer_t){ .ptr = s->input, .byte_len = th->input_bytes };
+    }
+    if (nodal_bind_aux(ops, num_ops, model->tensors, model->num_tensors, s->runtime, th->num_slots) < 0) goto fail;
+
+    // 2. Private activation arena
+    if (nodal_plan_build(ops, num_ops, NULL, s->runtime, th->num_slots, &s->plan) != 0) goto fail;
+    s->arena = aligned_alloc(64, s->plan.arena_bytes ? s->plan.arena_bytes : 64);
+    if (!s->arena) goto fail;
+    nodal_plan_bind(&s->plan, s->arena, s->runtime);
+
+    // 3. Pre-resolved dispatch over this session's buffers
+    s->tape = nodal_tape_resolve(ops, num_ops, s->runtime, th->num_slots);
+    if (!s->tape) goto fail;
+    for (uint32_t i = 0; i < num_ops; i++) {
+        for (uint32_t j = 0; j < ops[i].num_outputs && j < 4; j++) {
+            if (ops[i].outputs[j] == th->output_slot) s->output_bytes = nodal_op_output_bytes(&ops[i], j);
+        }
+    }
+
+    pthread_mutex_init(&s->lock, NULL);
+    s->model = nodal_model_retain(model);
+    return s;
+
+fail:
+    nodal_plan_free(&s->plan);
+    free(s->arena);
+    free(s->input);
+    free(s->runtime);
+    free(s);
+    return NULL;
+}
+
+/**
+ * nodal_session_run
+ * Copies input into the session, runs the tape and copies the output
+ * tensor out (truncated to output_bytes). Calls on the same session are
+ * serialized; distinct sessions run fully in parallel.
+ * @return Bytes written to output, or -1 on a size mismatch.
+ */
+long nodal_session_run(nodal_session_t *s, const void *input, size_t input_bytes, void *output, size_t output_bytes) {
+    const nodal_tape_header_t *th = s->model->tape;
+    if (input && (!s->input || input_bytes != th->input_bytes)) {
+        fprintf(stderr, "[SESSION] Input must be %u bytes, got %zu\n", th->input_bytes, input_bytes);
+        return -1;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    if (input) memcpy(s->input, input, input_bytes);
+    nodal_tape_run(s->tape);
+
+    size_t n = 0;
+    if (output && th->output_slot < th->num_slots) {
+        const nodal_buffer_t *out = &s->runtime[th->output_slot];
+        n = s->output_bytes < output_bytes ? s->output_bytes : output_bytes;
+        memcpy(output, out->ptr, n);
+    }
+    pthread_mutex_unlock(&s->lock);
+    return (long)n;
+}
+
+/**
+ * nodal_session_bind_kv
+ * Points every OP_ATTENTION in the tape at seq (NULL unbinds) and
+ * re-resolves the tape. Each run then appends its tokens to seq, so a
+ * session decodes one sequence at a time; fork seq to branch a prefix.
+ * OP_ROPE ops that declare a sequence input are bound too and take
+ * their positions from it.
+ * @return Number of attention ops bound, or -1 on failure.
+ */
+int nodal_session_bind_kv(nodal_session_t *s, nodal_kv_seq_t *seq) {
+    const nodal_tape_header_t *th = s->model->tape;
+    const nodal_irop_t *ops = s->model->ops;
+
+    pthread_mutex_lock(&s->lock);
+    int bound = 0;
+    for (uint32_t i = 0; i < s->model->num_ops; i++) {
+        uint32_t slot = nodal_op_kv_input(&ops[i]);
+        if (!slot) continue;
+        s->runtime[ops[i].inputs[slot]] = (nodal_buffer_t){ .ptr = seq, .byte_len = seq ? sizeof(void *) : 0 };
+        if (ops[i].kind == OP_ATTENTION) bound++;
+    }
+    nodal_tape_t *tape = nodal_tape_resolve(ops, s->model->num_ops, s->runtime, th->num_slots);
+    if (tape) {
+        nodal_tape_destroy(s->tape);
+        s->tape = tape;
+    }
+    pthread_mutex_unlock(&s->lock);
+    return tape ? bound : -1;
+}
+
+size_t nodal_session_output_bytes(const nodal_session_t *s) {
+    return s->output_bytes;
+}
+
+/* Bytes this session owns on top of the shared mapping */
+size_t nodal_session_private_bytes(const nodal_session_t *s) {
+    return s->plan.arena_bytes + (s->input ? s->model->tape->input_bytes : 0) +
+           s->model->tape->num_slots * sizeof(nodal_buffer_t);
+}
+
+void nodal_session_destroy(nodal_session_t *s) {
+    if (!s) return;
+    nodal_tape_destroy(s->tape);
+    nodal_plan_free(&s->plan);
+    pthread_mutex_destroy(&s->lock);
+    free(s->arena);
+    free(s->input);
+    free(s->runtime);
+    nodal_model_release(s->model);
+    free(s);
+}
@@ -12,6 +12,28 @@ NF4_LUT = np.array([
     0.5120928883552551, 0.6944172978401184, 1.0, 1.25
 ], dtype=np.float32)
 
+# Must match nodal_op_kind_t in src/nodal.h
+OP_KINDS = {
+    "MATMUL": 0, "MATMUL_QNF4": 1, "SOFTMAX": 2, "ADD": 3,
+    "TOKENIZE_BPE": 4, "TOKENIZE_BPE_PARALLEL": 5,
+    "MATMUL_ADD": 6, "MATMUL_QNF4_ADD": 7, "ADD_SOFTMAX": 8,
+    "ATTENTION": 9, "MATMUL_Q8_0": 10, "MATMUL_Q8_0_ADD": 11, "CAST": 12,
+    "RMSNORM": 13, "LAYERNORM": 14, "SILU": 15, "GELU": 16, "ROPE": 17,
+    "EMBED_GATHER": 18, "SAMPLE": 19,
+}
+NODAL_F32, NODAL_U32 = 0, 1
+DTYPES = {"F32": 0, "F16": 2, "BF16": 3, "NF4": 4, "Q8_0": 8}  # nodal_type_t
+LAYOUTS = {"row": 0, "tiled": 1}  # NODAL_LAYOUT_ROW_MAJOR, NODAL_LAYOUT_NF4_TILED
+NF4_PANEL = 16  # NODAL_NF4_PANEL
+NODAL_FLAG_TAPE = 0x0001
+NO_SLOT = 0xFFFFFFFF
+IROP_FORMAT = "<III8I4I" + "II" * 8  # nodal_irop_t, 124 bytes
+
+def scales_of(name):
+    """Operand name for a quantized tensor's block scales; the runtime binds it
+    to the tensor's aux segment (nodal_bind_aux)."""
+    return name + ".scales"
+
 def align_to(size, alignment=64):
     return (size + alignment - 1) & ~(alignment - 1)
 
@@ -38,11 +60,55 @@ def quantize_nf4(data, block_size=64):
 
     return bytes(packed_weights), np.array(scales, dtype=np.float32)
 
+def pack_nf4_tiled(packed, scales, shape, block_size=64):
+    """Regroups row-major NF4 bytes into NODAL_LAYOUT_NF4_TILED: panels of
+    NF4_PANEL rows, each stored block by block as [NF4_PANEL F32 scales]
+    [NF4_PANEL x block_size/2 nibble bytes], padding rows past N with zeros
+    so the kernel streams the weights front to back."""
+    n, k = shape
+    assert k % block_size == 0, "tiled NF4 needs whole blocks per row"
+    blocks, run = k // block_size, block_size // 2
+    rows = np.frombuffer(packed, dtype=np.uint8).reshape(n, blocks, run)
+    sc = np.asarray(scales, dtype=np.float32).reshape(n, blocks)
+    panels = (n + NF4_PANEL - 1) // NF4_PANEL
+    pad = panels * NF4_PANEL - n
+    rows = np.concatenate([rows, np.zeros((pad, blocks, run), np.uint8)]) if pad else rows
+    sc = np.concatenate([sc, np.zeros((pad, blocks), np.float32)]) if pad else sc
+    out = bytearray()
+    for p in range(panels):
+        for b in range(blocks):
+            out += sc[p * NF4_PANEL:(p + 1) * NF4_PANEL, b].tobytes()
+            out += rows[p * NF4_PANEL:(p + 1) * NF4_PANEL, b].tobytes()
+    return bytes(out)
+
+def to_bf16(data):
+    """F32 -> BF16 bit patterns with round-to-nearest-even, as the runtime's
+    nodal_f32_to_bf16 does; NaNs stay quiet NaNs."""
+    u = np.ascontiguousarray(data, dtype=np.float32).view(np.uint32).astype(np.uint64)
+    rounded = ((u + 0x7FFF + ((u >> 16) & 1)) >> 16).astype(np.uint16)
+    nan = np.isnan(np.asarray(data, dtype=np.float32))
+    return np.where(nan, ((u >> 16) | 0x40).astype(np.uint16), rounded)
+
+def quantize_q8_0(data, block_size=32):
+    """Blockwise int8: each block_size run of a row is stored as
+    round(x * 127 / max|x|) with F32 scale max|x| / 127. Blocks never
+    cross rows, so the last dimension must be a multiple of block_size."""
+    rows = data.astype(np.float32).reshape(-1, data.shape[-1])
+    assert rows.shape[1] % block_size == 0, "Q8_0 block size must divide the row length"
+    blocks = rows.reshape(-1, block_size)
+    max_abs = np.abs(blocks).max(axis=1)
+    scales = np.where(max_abs > 0, max_abs / 127.0, 1.0).astype(np.float32)
+    q = np.clip(np.rint(blocks / scales[:, None]), -127, 127).astype(np.int8)
+    return q.tobytes(), scales
+
 class NodalCompiler:
     def __init__(self, output_path):
         self.output_path = output_path
         self.tensors = []
         self.vocab_data = b""
+        self.ops = []
+        self.input = None   # (name, byte size)
+        self.output = None
 
     def load_vocab(self, tokenizer_json_path):
         """Parses tokenizer.json and builds the Nodal merge table."""
@@ -52,10 +118,10 @@ class NodalCompiler:
         
         # Extract Merges (the rules for BPE)
         merges = data.get("model", {}).get("merges", [])
-        binary_merges = b""
-        
+        ranks = {}
+
         # Nodal Binary Vocab Format: [p1_u32][p2_u32][rank_u32]
-        # This allows the C kernel to find merges in O(log N) via binary search
+        # Sorted by (p1, p2) so the C kernel finds merges in O(log N) via binary search
         for i, merge_str in enumerate(merges):
             # Typical format: "byte1 byte2"
             parts = merge_str.split()
@@ -63,28 +129,87 @@ class NodalCompiler:
                 # Note: This is a simplified mapping for the Alpha
                 # In production, we map strings to their initial byte IDs
                 try:
-                    p1 = ord(parts[0][0]) if len(parts[0]) == 1 else 0 
+                    p1 = ord(parts[0][0]) if len(parts[0]) == 1 else 0
                     p2 = ord(parts[1][0]) if len(parts[1]) == 1 else 0
-                    binary_merges += struct.pack("<III", p1, p2, i)
+                    # Keep the best (lowest) rank for duplicate pairs
+                    ranks.setdefault((p1, p2), i)
                 except: continue
-        
-        self.vocab_data = binary_merges
+
+        self.vocab_data = b"".join(struct.pack("<III", p1, p2, rank)
+                                   for (p1, p2), rank in sorted(ranks.items()))
         print(f"[VOCAB] Compiled {len(merges)} merge rules.")
 
-    def add_tensor(self, name, data, dtype="NF4", block_size=64):
-        if dtype == "NF4":
-            packed, scales = quantize_nf4(data, block_size)
+    def add_tensor(self, name, data, dtype="NF4", block_size=None, layout="row"):
+        """dtype is F32, F16, BF16, NF4 (block_size default 64) or Q8_0
+        (default 32), chosen per tensor to trade accuracy for speed layer by
+        layer. MATMUL ops over an F16 / BF16 weight pass DTYPES[dtype] as
+        scalar 3.
+        layout="tiled" repacks a 2-D NF4 weight for streaming matmuls; its
+        QNF4 ops must pass LAYOUTS["tiled"] as scalar 4."""
+        assert layout == "row" or (layout == "tiled" and dtype == "NF4" and data.ndim == 2)
+        if dtype in ("NF4", "Q8_0"):
+            if dtype == "NF4":
+                block_size = block_size or 64
+                packed, scales = quantize_nf4(data, block_size)
+            else:
+                block_size = block_size or 32
+                packed, scales = quantize_q8_0(data, block_size)
+            if layout == "tiled":
+                packed, scales = pack_nf4_tiled(packed, scales, data.shape, block_size), np.zeros(0, np.float32)
             aux_header = struct.pack("<BBBBII", 0, 0, 0, 0, block_size, len(scales))
             self.tensors.append({
                 "name": name, "data": packed, "aux_data": aux_header + scales.tobytes(),
-                "dtype": 4, "shape": list(data.shape)
+                "dtype": DTYPES[dtype], "layout": LAYOUTS[layout], "shape": list(data.shape)
             })
         else:
+            raw = {"F32": lambda d: d.astype(np.float32), "F16": lambda d: d.astype(np.float16),
+                   "BF16": to_bf16}[dtype](data)
             self.tensors.append({
-                "name": name, "data": data.tobytes(), "aux_data": None,
-                "dtype": 0, "shape": list(data.shape)
+                "name": name, "data": raw.tobytes(), "aux_data": None,
+                "dtype": DTYPES[dtype], "layout": 0, "shape": list(data.shape)
             })
 
+    def add_op(self, kind, inputs, outputs, scalars=()):
+        """Appends an IR op. Operands are tensor names; names that are not
+        model tensors become activation slots after the tensor table."""
+        assert len(inputs) <= 8 and len(outputs) <= 4 and len(scalars) <= 8
+        self.ops.append({"kind": OP_KINDS[kind], "inputs": list(inputs),
+                         "outputs": list(outputs), "scalars": list(scalars)})
+
+    def set_input(self, name, num_bytes):
+        self.input = (name, num_bytes)
+
+    def set_output(self, name):
+        self.output = name
+
+    def _resolve_slots(self):
+        slots = {t["name"]: i for i, t in enumerate(self.tensors)}
+        names = [self.input[0]] if self.input else []
+        for op in self.ops:
+            names += op["inputs"] + op["outputs"]
+        for name in names:
+            if name not in slots:
+                slots[name] = len(slots)
+        return slots
+
+    def _pack_tape(self):
+        slots = self._resolve_slots()
+        ops = []
+        for op in self.ops:
+            ins = [slots[n] for n in op["inputs"]]
+            outs = [slots[n] for n in op["outputs"]]
+            sc = []
+            for v in op["scalars"]:
+                sc += [NODAL_F32, struct.unpack("<I", struct.pack("<f", v))[0]] if isinstance(v, float) else [NODAL_U32, v]
+            ops.append(struct.pack(IROP_FORMAT, op["kind"], len(ins), len(outs),
+                                   *(ins + [0] * (8 - len(ins))), *(outs + [0] * (4 - len(outs))),
+                                   *(sc + [0] * (16 - len(sc)))))
+        op_size = struct.calcsize(IROP_FORMAT)
+        in_slot, in_bytes = (slots[self.input[0]], self.input[1]) if self.input else (NO_SLOT, 0)
+        out_slot = slots[self.output] if self.output else NO_SLOT
+        header = struct.pack("<8I", 0x45504154, len(ops), op_size, len(slots), in_slot, in_bytes, out_slot, 0)
+        return header + b"".join(ops)
+
     def compile(self):
         with open(self.output_path, "wb") as f:
             f.write(b"\x00" * 32) # Header placeholder
@@ -106,6 +231,13 @@ class NodalCompiler:
                     a_sz = len(t["aux_data"])
                 locs.append((d_off, d_sz, a_off, a_sz))
 
+            # IR tape: sub-header + ops, mapped zero-copy by the loader
+            tape_offset = 0
+            if self.ops:
+                f.write(b"\x00" * (align_to(f.tell()) - f.tell()))
+                tape_offset = f.tell()
+                f.write(self._pack_tape())
+
             # Write Vocab at the end
             vocab_offset = 0
             if self.vocab_data:
@@ -114,11 +246,13 @@ class NodalCompiler:
                 f.write(self.vocab_data)
 
             f.seek(0)
-            f.write(struct.pack("<IHHIIQ", 0x4E42444E, 1, 0, len(self.tensors), tensor_table_offset, vocab_offset))
+            flags = NODAL_FLAG_TAPE if self.ops else 0
+            f.write(struct.pack("<IHHIIQQ", 0x4E42444E, 1, flags, len(self.tensors), tensor_table_offset,
+                                vocab_offset, tape_offset))
             f.seek(tensor_table_offset)
             for i, t in enumerate(self.tensors):
                 d_off, d_sz, a_off, a_sz = locs[i]
-                f.write(struct.pack("<IBBBB4IQQQQ", 0, t["dtype"], len(t["shape"]), 0, 1 if t["aux_data"] else 0,
+                f.write(struct.pack("<IBBBB4IQQQQ", 0, t["dtype"], len(t["shape"]), t["layout"], 1 if t["aux_data"] else 0,
                     *(t["shape"] + [0]*(4-len(t["shape"]))), d_off, d_sz, a_off, a_sz).ljust(64, b"\x00"))
 
         print(f"[SUCCESS] Compiled to {self.output_path} ({os.path.getsize(self.output_path)} bytes)")
@@ -127,11 +261,21 @@ if __name__ == "__main__":
     parser = argparse.ArgumentParser()
     parser.add_argument("--mock", action="store_true")
     parser.add_argument("--vocab", type=str, help="Path to tokenizer.json")
+    parser.add_argument("--nf4-layout", choices=LAYOUTS, default="row", help="Layout of the mock NF4 weight")
     args = parser.parse_args()
     
     nc = NodalCompiler("test_model.nbbin")
     if args.vocab:
         nc.load_vocab(args.vocab)
     if args.mock:
-        nc.add_tensor("weight_0", np.random.randn(64, 64).astype(np.float32), dtype="NF4")
+        nc.add_tensor("weight_0", np.random.randn(64, 64).astype(np.float32), dtype="NF4", layout=args.nf4_layout)
+        # Two layers: probs = softmax((x @ weight_0^T) @ w_1 + b_1)
+        nc.add_tensor("w_1", (np.random.randn(64, 64) * 0.125).astype(np.float32), dtype="F32")
+        nc.add_tensor("b_1", np.random.randn(64).astype(np.float32), dtype="F32")
+        nc.add_op("MATMUL_QNF4", ["x", "weight_0", scales_of("weight_0")], ["h0"], [1, 64, 64, 64, LAYOUTS[args.nf4_layout]])
+        nc.add_op("MATMUL", ["h0", "w_1"], ["h"], [1, 64, 64])
+        nc.add_op("ADD", ["h", "b_1"], ["logits"], [64])
+        nc.add_op("SOFTMAX", ["logits"], ["probs"], [64])
+        nc.set_input("x", 64 * 4)
+        nc.set_output("probs")
     nc.compile()